@@ -0,0 +1,248 @@
+#include "AlertEngine.hpp"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+
+AlertEngine::AlertEngine(QObject *parent)
+    : QObject(parent)
+    , m_rulesByField(TelemetryFields::FieldCount)
+    , m_values(TelemetryFields::FieldCount, 0.0)
+    , m_seen(TelemetryFields::FieldCount, false)
+{
+    setRules(defaultRules());
+}
+
+QJsonArray AlertEngine::defaultRules()
+{
+    auto rule = [](const QString &id, const QString &name, const QString &input, const QString &when,
+                   double threshold, double clear, const QString &severity) {
+        QJsonObject object;
+        object["id"] = id;
+        object["name"] = name;
+        object["input"] = input;
+        object["kind"] = "value";
+        object["when"] = when;
+        object["threshold"] = threshold;
+        object["clear"] = clear;
+        object["severity"] = severity;
+        object["actions"] = QJsonArray{QJsonObject{{"type", "notify"}}};
+        return object;
+    };
+
+    QJsonObject dew = rule("dew-margin", "Front cell near dew point",
+                           "Environment.FrontCellTemperature - Environment.DewPoint",
+                           "below", 2.0, 3.0, "warning");
+    dew["actions"] = QJsonArray{QJsonObject{{"type", "notify"}},
+                                QJsonObject{{"type", "dewHeaterAggression"}, {"step", 2}, {"max", 10}}};
+
+    QJsonObject cooling = rule("temperature-falling", "Temperature falling fast, focus will drift",
+                               "Environment.AmbientTemperature", "below", -0.1, -0.05, "info");
+    cooling["kind"] = "rate";
+    cooling["rateWindowSec"] = 600;
+
+    return QJsonArray{
+        dew,
+        rule("battery-low", "Mount battery low", "Mount.BatteryVoltage", "below", 11.5, 11.8, "critical"),
+        rule("disk-low", "Telescope disk below 4 GB free", "Disk.FreeBytes", "below", 4e9, 5e9, "warning"),
+        rule("cpu-hot", "Telescope CPU hot", "Environment.CpuTemperature", "above", 70.0, 65.0, "warning"),
+        cooling
+    };
+}
+
+bool AlertEngine::compile(const QJsonObject &object, Rule &rule, QString *error)
+{
+    rule.id = object["id"].toString();
+    rule.name = object["name"].toString(rule.id);
+    rule.input = object["input"].toString();
+    rule.severity = object["severity"].toString("warning");
+    rule.actions = object["actions"].toArray();
+    if (rule.id.isEmpty()) {
+        *error = "missing id";
+        return false;
+    }
+
+    QString kind = object["kind"].toString("value");
+    if (kind != "value" && kind != "rate") {
+        *error = "unknown kind " + kind;
+        return false;
+    }
+    rule.rate = kind == "rate";
+    rule.rateWindowMs = qint64(object["rateWindowSec"].toDouble(60.0) * 1000);
+
+    QString when = object["when"].toString();
+    if (when != "below" && when != "above") {
+        *error = "\"when\" must be below or above";
+        return false;
+    }
+    rule.below = when == "below";
+
+    if (!object["threshold"].isDouble()) {
+        *error = "missing threshold";
+        return false;
+    }
+    rule.threshold = object["threshold"].toDouble();
+    rule.clear = object["clear"].toDouble(rule.threshold);
+    if (rule.below ? rule.clear < rule.threshold : rule.clear > rule.threshold) {
+        *error = "clear level is on the firing side of the threshold";
+        return false;
+    }
+
+    // Input: fields and constants joined by + and -
+    QString input = rule.input;
+    int pos = 0;
+    double sign = 1.0;
+    bool expectTerm = true;
+    while (pos < input.size()) {
+        QChar c = input[pos];
+        if (c.isSpace()) {
+            pos++;
+        } else if (c == '+' || c == '-') {
+            if (expectTerm && c == '-') sign = -sign;
+            else if (!expectTerm) sign = c == '-' ? -1.0 : 1.0;
+            expectTerm = true;
+            pos++;
+        } else {
+            if (!expectTerm) {
+                *error = "expected + or - in input";
+                return false;
+            }
+            int end = pos;
+            while (end < input.size() && !input[end].isSpace() && input[end] != '+' && input[end] != '-') end++;
+            QString token = input.mid(pos, end - pos);
+
+            bool isNumber = false;
+            double number = token.toDouble(&isNumber);
+            if (isNumber) {
+                rule.constant += sign * number;
+            } else {
+                TelemetryFields::Field field = TelemetryFields::fromName(token);
+                if (field == TelemetryFields::FieldCount) {
+                    *error = "unknown field " + token;
+                    return false;
+                }
+                rule.terms.append(qMakePair(field, sign));
+            }
+            sign = 1.0;
+            expectTerm = false;
+            pos = end;
+        }
+    }
+    if (rule.terms.isEmpty() || expectTerm) {
+        *error = "input must name at least one field";
+        return false;
+    }
+    return true;
+}
+
+int AlertEngine::setRules(const QJsonArray &rules)
+{
+    m_rules.clear();
+    for (QVector<int> &list : m_rulesByField) list.clear();
+
+    for (const QJsonValue &value : rules) {
+        Rule rule;
+        QString error;
+        if (!compile(value.toObject(), rule, &error)) {
+            qWarning() << "Skipping alert rule" << rule.id << ":" << error;
+            continue;
+        }
+
+        int index = m_rules.size();
+        for (const auto &term : rule.terms) {
+            QVector<int> &list = m_rulesByField[term.first];
+            if (list.isEmpty() || list.last() != index) list.append(index);
+        }
+        m_rules.append(rule);
+    }
+    return m_rules.size();
+}
+
+bool AlertEngine::loadRules(const QString &path)
+{
+    QFile file(path);
+    if (!file.exists()) {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(QJsonDocument(defaultRules()).toJson());
+        }
+        return setRules(defaultRules()) > 0;
+    }
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open alert rules:" << path;
+        return false;
+    }
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!doc.isArray()) {
+        qWarning() << "Alert rules must be a JSON array:" << path << parseError.errorString();
+        return false;
+    }
+    return setRules(doc.array()) > 0;
+}
+
+void AlertEngine::update(const TelescopeData &data, TelemetryFields::Group group, qint64 timestampMs)
+{
+    // Threshold rules only need another look when a field they read changed;
+    // a rate moves with time too, so rate rules are recomputed on every update
+    m_stamp++;
+    QVector<int> dirty;
+    for (TelemetryFields::Field field : TelemetryFields::fieldsInGroup(group)) {
+        double value = TelemetryFields::descriptor(field).read(data);
+        bool changed = !m_seen[field] || value != m_values[field];
+        m_values[field] = value;
+        m_seen[field] = true;
+
+        for (int index : m_rulesByField[field]) {
+            if (!changed && !m_rules[index].rate) continue;
+            if (m_rules[index].stamp == m_stamp) continue;
+            m_rules[index].stamp = m_stamp;
+            dirty.append(index);
+        }
+    }
+
+    for (int index : dirty) {
+        evaluate(m_rules[index], timestampMs);
+    }
+}
+
+void AlertEngine::evaluate(Rule &rule, qint64 timestampMs)
+{
+    double input = rule.constant;
+    for (const auto &term : rule.terms) {
+        if (!m_seen[term.first]) return;
+        input += term.second * m_values[term.first];
+    }
+    rule.lastInput = input;
+
+    double value = input;
+    if (rule.rate) {
+        if (rule.rateRefMs < 0) {
+            rule.rateRefMs = timestampMs;
+            rule.rateRefValue = input;
+            return;
+        }
+        qint64 elapsed = timestampMs - rule.rateRefMs;
+        if (elapsed < rule.rateWindowMs) return;
+
+        rule.lastRate = (input - rule.rateRefValue) * 60000.0 / elapsed;
+        rule.rateRefMs = timestampMs;
+        rule.rateRefValue = input;
+        value = rule.lastRate;
+    }
+
+    if (!rule.active) {
+        if (rule.below ? value < rule.threshold : value > rule.threshold) {
+            rule.active = true;
+            emit alertRaised(rule, value);
+            for (const QJsonValue &action : rule.actions) {
+                emit actionRequested(rule, action.toObject());
+            }
+        }
+    } else if (rule.below ? value >= rule.clear : value <= rule.clear) {
+        rule.active = false;
+        emit alertCleared(rule, value);
+    }
+}
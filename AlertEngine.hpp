@@ -0,0 +1,133 @@
+#pragma once
+
+#include <QObject>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+#include "TelemetryFields.hpp"
+
+/**
+ * @brief Threshold, rate-of-change and hysteresis alerts over telemetry
+ *
+ * Rules are JSON objects, e.g.
+ *
+ *   { "id": "dew-margin", "name": "Dew margin",
+ *     "input": "Environment.FrontCellTemperature - Environment.DewPoint",
+ *     "kind": "value", "when": "below", "threshold": 2.0, "clear": 3.0,
+ *     "severity": "warning",
+ *     "actions": [ { "type": "notify" },
+ *                  { "type": "dewHeaterAggression", "step": 2, "max": 10 } ] }
+ *
+ * The input is a sum or difference of telemetry fields and constants. With
+ * kind "rate" the predicate applies to the input's change per minute
+ * instead of its value. A rule fires when its input crosses the threshold
+ * and clears only once it is back past the clear level, so a reading
+ * hovering at the threshold does not flap.
+ *
+ * Rules are compiled into field/coefficient terms, and an index from each
+ * field to the rules that read it means an update only re-evaluates rules
+ * whose inputs actually changed.
+ */
+class AlertEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Rule {
+        QString id;
+        QString name;
+        QString input;
+        bool rate = false;              // compare change per minute, not the value
+        bool below = true;              // fire below the threshold rather than above
+        double threshold = 0.0;
+        double clear = 0.0;             // level that ends the alert; equals threshold without hysteresis
+        qint64 rateWindowMs = 60 * 1000;
+        QString severity;
+        QJsonArray actions;
+
+        // Compiled input: sum of coefficient * field, plus a constant
+        QVector<QPair<TelemetryFields::Field, double>> terms;
+        double constant = 0.0;
+
+        // Evaluation state
+        bool active = false;
+        double lastInput = 0.0;
+        double lastRate = 0.0;
+        qint64 rateRefMs = -1;
+        double rateRefValue = 0.0;
+        quint32 stamp = 0;
+    };
+
+    /**
+     * @brief Constructor
+     * @param parent The parent QObject
+     */
+    explicit AlertEngine(QObject *parent = nullptr);
+
+    /** @brief The rules shipped by default: dew margin, battery, disk space, CPU temperature, falling temperature */
+    static QJsonArray defaultRules();
+
+    /**
+     * @brief Replace the rule set
+     * @param rules Array of rule objects; invalid rules are skipped with a warning
+     * @return Number of rules compiled
+     */
+    int setRules(const QJsonArray &rules);
+
+    /**
+     * @brief Load rules from a JSON file, writing the defaults there if it does not exist
+     * @param path The rules file
+     * @return True if rules were loaded
+     */
+    bool loadRules(const QString &path);
+
+    /** @brief The compiled rules with their current state */
+    const QVector<Rule> &rules() const { return m_rules; }
+
+    /**
+     * @brief Feed the fields of a group that was just updated
+     * @param data The telescope state
+     * @param group Which status notification updated it
+     * @param timestampMs Update time in ms since epoch
+     */
+    void update(const TelescopeData &data, TelemetryFields::Group group, qint64 timestampMs);
+
+signals:
+    /**
+     * @brief A rule's condition became true
+     * @param rule The rule
+     * @param value The input (or its rate per minute) that triggered it
+     */
+    void alertRaised(const AlertEngine::Rule &rule, double value);
+
+    /**
+     * @brief A rule's condition ended
+     * @param rule The rule
+     * @param value The input (or its rate per minute) that cleared it
+     */
+    void alertCleared(const AlertEngine::Rule &rule, double value);
+
+    /**
+     * @brief An automatic action of a firing rule, for the owner to carry out
+     * @param rule The rule
+     * @param action The action object from the rule
+     */
+    void actionRequested(const AlertEngine::Rule &rule, const QJsonObject &action);
+
+private:
+    static bool compile(const QJsonObject &object, Rule &rule, QString *error);
+    void evaluate(Rule &rule, qint64 timestampMs);
+
+    QVector<Rule> m_rules;
+
+    /** Field -> indices of the rules reading it */
+    QVector<QVector<int>> m_rulesByField;
+
+    /** Last value of every field and whether it has been seen */
+    QVector<double> m_values;
+    QVector<bool> m_seen;
+
+    /** Bumped per update so a rule reading several changed fields is evaluated once */
+    quint32 m_stamp = 0;
+};
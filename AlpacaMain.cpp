@@ -3,6 +3,7 @@
 #include <QTimer>
 #include "AlpacaServer.hpp"
 #include "OriginBackend.hpp"
+#include "TelemetryShmPublisher.hpp"
 
 /**
  * @brief Example main function showing how to integrate the Alpaca server
@@ -34,6 +35,18 @@ int main(int argc, char *argv[])
         qDebug() << "Origin telescope status updated";
     });
     
+    // Local co-processes read the latest status from shared memory, see origin_telemetry_shm.h
+    TelemetryShmPublisher* telemetryShm = new TelemetryShmPublisher();
+    telemetryShm->open();
+    QObject::connect(originBackend, &OriginBackend::statusUpdated, [originBackend, telemetryShm]() {
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        telemetryShm->publish(originBackend->telescopeData(), now);
+        telemetryShm->publish(originBackend->status(), now);
+    });
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, [telemetryShm]() {
+        delete telemetryShm;
+    });
+    
     // Connect to server signals for logging
     QObject::connect(alpacaServer, &AlpacaServer::serverStarted, []() {
         qDebug() << "Alpaca server started successfully";
@@ -56,6 +69,7 @@ int main(int argc, char *argv[])
     qDebug() << "You can now connect ASCOM/Alpaca clients to:";
     qDebug() << "  Telescope: http://localhost:11111/api/v1/telescope/0/";
     qDebug() << "  Camera:    http://localhost:11111/api/v1/camera/0/";
+    qDebug() << "  Live view: http://localhost:11111/liveview.mjpg";
     qDebug() << "";
     qDebug() << "Example endpoints:";
     qDebug() << "  GET  /api/v1/telescope/0/connected";
@@ -1,11 +1,14 @@
 #include "AlpacaServer.hpp"
+#include "FitsWriter.hpp"
 #include <QNetworkDatagram>
 #include <QNetworkInterface>
 #include <QUdpSocket>
 #include <QCoreApplication>
+#include <QDir>
 #include <QFileInfo>
 #include <QRegularExpression>
 #include <QThread>
+#include <QThreadPool>
 #include <QBuffer>
 #include <QJsonDocument>
 #include <QJsonArray>
@@ -16,6 +19,7 @@
 
 AlpacaServer::AlpacaServer(QObject *parent)
     : QObject(parent)
+    , m_tcpserver(&m_liveView)
     , m_running(false)
     , m_telescopeBackend(nullptr)
     , m_transactionCounter(0)
@@ -91,6 +95,8 @@ void AlpacaServer::stop()
     // Stop discovery broadcast
     stopDiscoveryBroadcast();
     
+    m_liveView.disconnectViewers();
+    
     m_running = false;
     qDebug() << "Alpaca server stopped";
     
@@ -104,7 +110,34 @@ bool AlpacaServer::isRunning() const
 
 void AlpacaServer::setTelescopeBackend(OriginBackend* backend)
 {
+    if (m_telescopeBackend) {
+        disconnect(m_telescopeBackend, &OriginBackend::imageReady, this, nullptr);
+    }
     m_telescopeBackend = backend;
+    if (m_telescopeBackend) {
+        connect(m_telescopeBackend, &OriginBackend::imageReady, this, [this]() {
+            publishLiveFrame(m_telescopeBackend->getLastImage());
+        });
+    }
+}
+
+void AlpacaServer::publishLiveFrame(const QImage& frame)
+{
+    m_liveView.publish(frame);
+}
+
+void AlpacaServer::setFitsDirectory(const QString& directory)
+{
+    if (!directory.isEmpty() && !QDir().mkpath(directory)) {
+        qWarning() << "Cannot create FITS directory" << directory;
+        return;
+    }
+    m_fitsDirectory = directory;
+}
+
+QString AlpacaServer::fitsDirectory() const
+{
+    return m_fitsDirectory;
 }
 
 // Management API Endpoints
@@ -648,6 +681,27 @@ QJsonObject AlpacaServer::handleCameraStartExposure(const QHttpServerRequest& re
     if (!image.isNull()) {
         m_telescopeBackend->setLastImage(image);
         m_telescopeBackend->setImageReady(true);
+        
+        if (!m_fitsDirectory.isEmpty()) {
+            // Pointing is that of the frame just taken; the rest as the exposure began
+            TelescopeData data = m_telescopeBackend->lastExposureTelemetry();
+            data.lastImage = m_telescopeBackend->telescopeData().lastImage;
+            FitsWriter::Metadata metadata = FitsWriter::metadataFrom(data, m_telescopeBackend->lastExposureStartMs());
+            metadata.exposure = duration;
+            metadata.gain = gain;
+            metadata.binning = binning;
+            
+            QString path = QDir(m_fitsDirectory).filePath(
+                QString("Alpaca_%1.fits").arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss_zzz")));
+            QThreadPool::globalInstance()->start([path, image, metadata]() {
+                QString error;
+                if (FitsWriter::writeImage(path, image, metadata, &error)) {
+                    qDebug() << "Saved" << path;
+                } else {
+                    qWarning() << "Failed to save" << path << ":" << error;
+                }
+            });
+        }
     }
     
     return createSuccessResponse(true, transaction);
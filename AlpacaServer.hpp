@@ -18,6 +18,7 @@
 
 // Change from OpenStellinaBackend to OriginBackend
 #include "OriginBackend.hpp"
+#include "MjpegStreamer.hpp"
 
 /**
  * @class AlpacaServer
@@ -65,6 +66,27 @@ public:
      */
     void setTelescopeBackend(OriginBackend* backend);
 
+    /**
+     * @brief Offer a preview frame to live view viewers
+     *
+     * Viewers watch GET /liveview.mjpg on the server port. Frames from the
+     * backend are published automatically; this adds frames from elsewhere,
+     * such as the processed previews of the GUI.
+     * @param frame The frame to show
+     */
+    void publishLiveFrame(const QImage& frame);
+
+    /**
+     * @brief Save every captured frame as FITS in a directory
+     *
+     * Headers are filled from the telemetry at the start of the exposure.
+     * Files are written in the background, after the exposure has been
+     * answered, so clients are not kept waiting.
+     * @param directory Where to write, empty to stop saving
+     */
+    void setFitsDirectory(const QString& directory);
+    QString fitsDirectory() const;
+
 signals:
     /**
      * @brief Signal emitted when server starts
@@ -92,7 +114,8 @@ signals:
 
 private:
     QHttpServer m_server;
-    QTcpServer m_tcpserver;
+    MjpegStreamer m_liveView;
+    LiveViewTcpServer m_tcpserver;
     bool m_running;
     OriginBackend* m_telescopeBackend;  // Changed from OpenStellinaBackend
     QMap<QString, int> m_clientIDs;
@@ -106,6 +129,7 @@ private:
     QString m_location;
     int m_port;
     int m_instanceNumber;
+    QString m_fitsDirectory;
 
     // Utility methods
     QJsonObject createErrorResponse(int errorNumber, const QString& errorMessage);
@@ -1,28 +1,248 @@
 #include "AutoDownloader.hpp"
 #include <QDebug>
 #include <QEventLoop>
+#include <QFileInfo>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QPointer>
+#include <QDirIterator>
+#include <QStorageInfo>
+#include <QThreadPool>
 
-AutoDownloader::AutoDownloader(QWebSocket *webSocket, const QString &ipAddress, 
+namespace {
+    /** Previews the analyzer can decode; raw FITS/TIFF subframes are judged by these */
+    bool isPreviewImage(const QString &name) {
+        QString suffix = QFileInfo(name).suffix().toLower();
+        return suffix == "jpg" || suffix == "jpeg" || suffix == "png";
+    }
+    
+    bool isTiffImage(const QString &name) {
+        QString suffix = QFileInfo(name).suffix().toLower();
+        return suffix == "tif" || suffix == "tiff";
+    }
+    
+    /** Frames are matched across formats by their path without the suffix */
+    QString frameKey(const QString &path) {
+        QFileInfo info(path);
+        return info.path() + "/" + info.completeBaseName();
+    }
+}
+
+AutoDownloader::AutoDownloader(TelescopeLink *link, const QString &ipAddress, 
                                const QString &downloadPath, QObject *parent)
     : QObject(parent),
-      webSocket(webSocket),
+      link(link),
       ipAddress(ipAddress),
       downloadPath(downloadPath),
-      networkManager(new QNetworkAccessManager(this)),
       totalFiles(0),
       filesCompleted(0),
       downloadInProgress(false),
-      nextSequenceId(1000) {
+      nextSequenceId(1000),
+      mirrorSubframes(false),
+      skipRejected(true),
+      writeFits(false),
+      qualityIndex(downloadPath + "/.frame_quality.json"),
+      pendingAnalyses(0),
+      runGeneration(0),
+      capturesListed(0),
+      captureListSequenceId(-1),
+      captureContentsSequenceId(-1),
+      captureLookupStartedMs(0),
+      listingSequenceId(-1),
+      browseSequenceId(-1),
+      processingDirectory(false),
+      telescopeCritical(false),
+      localReserve(0),
+      localQuota(0),
+      localUsage(-1),
+      sizeChecked(false) {
     
     // Create download directory if it doesn't exist
     QDir dir(downloadPath);
     if (!dir.exists()) {
         dir.mkpath(".");
     }
+    loadStarred();
+    
+    // Measurements finished after their plan was dropped are saved together
+    indexSaveTimer.setSingleShot(true);
+    indexSaveTimer.setInterval(INDEX_SAVE_DELAY_MS);
+    connect(&indexSaveTimer, &QTimer::timeout, this, [this]() { qualityIndex.save(); });
+    
+    // Messages arrive decoded; transfers stream to disk on the I/O thread
+    connect(link, &TelescopeLink::messageReceived, 
+            this, &AutoDownloader::onMessageReceived);
+    connect(link, &TelescopeLink::downloadFinished, 
+            this, &AutoDownloader::onFileDownloaded);
+    connect(link, &TelescopeLink::downloadProgress, 
+            this, &AutoDownloader::onDownloadProgress);
+    connect(link, &TelescopeLink::imageFetched, 
+            this, &AutoDownloader::onImageFetched);
+    connect(link, &TelescopeLink::imageFetchFailed, 
+            this, &AutoDownloader::onImageFetchFailed);
+}
+
+void AutoDownloader::setMirrorSubframes(bool enabled) {
+    mirrorSubframes = enabled;
+}
+
+void AutoDownloader::setQualityThresholds(const FrameQualityThresholds &thresholds) {
+    this->thresholds = thresholds;
+}
+
+void AutoDownloader::setSkipRejectedFrames(bool skip) {
+    skipRejected = skip;
+}
+
+void AutoDownloader::setWriteFits(bool enabled) {
+    writeFits = enabled;
+}
+
+void AutoDownloader::recordFrameMetadata(const FitsWriter::Metadata &metadata) {
+    pendingCaptures.enqueue(metadata);
+    while (pendingCaptures.size() > MAX_FRAME_METADATA) {
+        pendingCaptures.dequeue();
+    }
     
-    // Connect WebSocket message received signal
-    connect(webSocket, &QWebSocket::textMessageReceived, 
-            this, &AutoDownloader::onTextMessageReceived);
+    // One lookup at a time; captures arriving meanwhile wait for the next.
+    // A lookup whose answer was lost to a reconnect is given up on
+    bool lookupPending = captureListSequenceId >= 0 || captureContentsSequenceId >= 0;
+    if (lookupPending && QDateTime::currentMSecsSinceEpoch() - captureLookupStartedMs < CAPTURE_LOOKUP_TIMEOUT_MS) {
+        return;
+    }
+    requestCaptureListing();
+}
+
+void AutoDownloader::requestCaptureListing() {
+    capturesListed = pendingCaptures.size();
+    captureContentsSequenceId = -1;
+    captureLookupStartedMs = QDateTime::currentMSecsSinceEpoch();
+    captureListSequenceId = sendCommand("GetListOfAvailableDirectories", "ImageServer");
+}
+
+void AutoDownloader::locateCaptures(const QJsonObject &obj) {
+    captureListSequenceId = -1;
+    
+    // The telescope lists observations in the order they were created, and
+    // frames are only ever added to the newest one
+    QJsonArray dirList = obj["DirectoryList"].toArray();
+    if (dirList.isEmpty()) {
+        qDebug() << "No observation on the telescope for" << capturesListed << "captured frames";
+        for (int i = 0; i < capturesListed && !pendingCaptures.isEmpty(); i++) {
+            pendingCaptures.dequeue();
+        }
+        capturesListed = 0;
+        return;
+    }
+    
+    captureDirectory = dirList.last().toString();
+    QJsonObject params;
+    params["Directory"] = "Images/Astrophotography/" + captureDirectory;
+    captureContentsSequenceId = sendCommand("GetDirectoryContents", "ImageServer", params);
+}
+
+void AutoDownloader::assignCaptures(const QJsonObject &obj) {
+    captureContentsSequenceId = -1;
+    
+    // Frames of the observation we hold no metadata for, oldest first
+    QString remoteDir = "Images/Astrophotography/" + captureDirectory;
+    QStringList unassigned;
+    for (const auto &value : obj["FileList"].toArray()) {
+        QString name = value.toString();
+        if (name.startsWith("FinalStackedMaster")) continue;
+        
+        QString key = frameKey(remoteDir + "/" + name);
+        if (!frameMetadata.contains(key)) {
+            unassigned.append(key);
+        }
+    }
+    unassigned.sort();
+    unassigned.removeDuplicates();
+    
+    // NewImageReady is sent once the frame is written, so the captures being
+    // looked up are the newest unassigned frames, in the same order; frames
+    // captured before we were listening are left without metadata
+    int matched = qMin(capturesListed, int(unassigned.size()));
+    for (int i = matched; i < capturesListed && !pendingCaptures.isEmpty(); i++) {
+        pendingCaptures.dequeue();
+    }
+    if (matched < capturesListed) {
+        qDebug() << capturesListed - matched << "captured frames not found in" << captureDirectory;
+    }
+    for (int i = unassigned.size() - matched; i < unassigned.size() && !pendingCaptures.isEmpty(); i++) {
+        FitsWriter::Metadata metadata = pendingCaptures.dequeue();
+        storeFrameMetadata(unassigned[i], metadata);
+        emit frameLocated(unassigned[i], metadata.dateObsMs);
+    }
+    capturesListed = 0;
+    
+    if (!pendingCaptures.isEmpty()) {
+        requestCaptureListing();
+    }
+}
+
+void AutoDownloader::storeFrameMetadata(const QString &key, const FitsWriter::Metadata &metadata) {
+    if (!frameMetadata.contains(key)) {
+        frameMetadataOrder.enqueue(key);
+        while (frameMetadataOrder.size() > MAX_FRAME_METADATA) {
+            frameMetadata.remove(frameMetadataOrder.dequeue());
+        }
+    }
+    frameMetadata.insert(key, metadata);
+}
+
+FitsWriter::Metadata AutoDownloader::metadataFor(const QString &filePath) const {
+    QString key = frameKey(filePath);
+    if (frameMetadata.contains(key)) {
+        return frameMetadata.value(key);
+    }
+    
+    FitsWriter::Metadata metadata;
+    if (!QFileInfo(filePath).fileName().startsWith("FinalStackedMaster")) {
+        return metadata;
+    }
+    
+    // The master stacks every frame of its observation: it began with the
+    // first of them and has their exposures summed
+    QString prefix = QFileInfo(filePath).path() + "/";
+    double totalExposure = 0.0;
+    bool found = false;
+    for (auto it = frameMetadata.constBegin(); it != frameMetadata.constEnd(); ++it) {
+        if (!it.key().startsWith(prefix)) continue;
+        if (!found || (it->dateObsMs > 0 && (metadata.dateObsMs <= 0 || it->dateObsMs < metadata.dateObsMs))) {
+            metadata = it.value();
+        }
+        if (it->exposure > 0.0) totalExposure += it->exposure;
+        found = true;
+    }
+    if (found) {
+        metadata.exposure = totalExposure;
+        metadata.imageType = "Master Light";
+    }
+    return metadata;
+}
+
+void AutoDownloader::writeFitsInBackground(const QString &filePath, const QString &localPath) {
+    QFileInfo info(localPath);
+    QString fitsPath = info.path() + "/" + info.completeBaseName() + ".fits";
+    FitsWriter::Metadata metadata = metadataFor(filePath);
+    
+    // Decoding a full-size TIFF takes long enough to stall the GUI thread
+    QPointer<AutoDownloader> self(this);
+    QThreadPool::globalInstance()->start([self, localPath, fitsPath, metadata]() {
+        QString error;
+        bool ok = FitsWriter::convertFile(localPath, fitsPath, metadata, &error);
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, fitsPath, ok, error]() {
+            if (!ok) {
+                qWarning() << "Failed to write" << fitsPath << "-" << error;
+                return;
+            }
+            qDebug() << "Wrote" << fitsPath << "(" << QFileInfo(fitsPath).size() << "bytes)";
+            if (self && self->localUsage >= 0) {
+                self->localUsage += QFileInfo(fitsPath).size();
+            }
+        }, Qt::QueuedConnection);
+    });
 }
 
 void AutoDownloader::stopDownload() {
@@ -31,32 +251,31 @@ void AutoDownloader::stopDownload() {
     // Clear the queues
     directoryQueue.clear();
     fileQueue.clear();
+    plannedFiles.clear();
+    pendingPreviews.clear();
+    pendingAnalyses = 0;
+    runGeneration++;
+    listingSequenceId = -1;
+    processingDirectory = false;
+    indexSaveTimer.stop();
+    qualityIndex.save();
     
     // Cancel any ongoing download
     if (downloadInProgress) {
-        QNetworkReply *reply = networkManager->findChild<QNetworkReply*>();
-        if (reply) {
-            reply->abort();
-            reply->deleteLater();
-        }
+        link->abortDownloads();
+        currentUrl.clear();
         downloadInProgress = false;
     }
 }
 
-void AutoDownloader::processFileList(const QString &message) {
-    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8());
-    if (!doc.isObject()) {
-        qDebug() << "Failed to parse file list JSON";
-        return;
-    }
-    
-    QJsonObject obj = doc.object();
-    
+void AutoDownloader::processFileList(const QJsonObject &obj) {
     // Check if this is a response to GetDirectoryContents
     if (obj["Command"].toString() != "GetDirectoryContents" || 
         obj["Type"].toString() != "Response") {
         return;
     }
+    if (obj["SequenceID"].toInt() != listingSequenceId) return;
+    listingSequenceId = -1;
     
     // Get the file list
     QJsonArray fileList = obj["FileList"].toArray();
@@ -75,23 +294,176 @@ void AutoDownloader::processFileList(const QString &message) {
     QDir dir(downloadPath);
     dir.mkpath(currentDirectory);
     
-    // Add each file to the queue
+    QString remoteDir = "Images/Astrophotography/" + currentDirectory;
+    
+    // Previews by base name, so a raw subframe can be judged by its sibling JPEG
+    QHash<QString, QString> previews;
+    plannedFiles.clear();
     for (const auto &file : fileList) {
-        QString filePath = currentDirectory + "/" + file.toString();
-        fileQueue.enqueue(filePath);
+        QString name = file.toString();
+        plannedFiles.append(name);
+        if (isPreviewImage(name)) {
+            previews.insert(QFileInfo(name).completeBaseName(), name);
+        }
+    }
+    directoryFiles = plannedFiles;
+    
+    // Fetch the previews of frames we have not measured yet; the stacked
+    // master is always wanted and frames without a preview are accepted
+    pendingPreviews.clear();
+    pendingAnalyses = 0;
+    for (const QString &name : plannedFiles) {
+        if (name.startsWith("FinalStackedMaster")) continue;
+        
+        QString remotePath = remoteDir + "/" + name;
+        if (qualityIndex.lookup(remotePath, nullptr)) continue;
+        
+        QString preview = previews.value(QFileInfo(name).completeBaseName());
+        if (preview.isEmpty()) continue;
+        
+        QString url = remoteUrl(remoteDir + "/" + preview);
+        if (!pendingPreviews.contains(url)) {
+            link->fetchImage(QUrl(url));
+        }
+        pendingPreviews[url].append(remotePath);
+        pendingAnalyses++;
+    }
+    
+    if (pendingAnalyses > 0) {
+        qDebug() << "Measuring" << pendingAnalyses << "subframes before downloading" << currentDirectory;
+    } else {
+        planDirectory();
+    }
+}
+
+void AutoDownloader::onImageFetched(const QString &url, const QImage &image) {
+    if (thumbnailRequests.contains(url)) {
+        storeThumbnail(thumbnailRequests.take(url), image);
+        return;
+    }
+    if (pendingPreviews.contains(url)) {
+        analyzeInBackground(pendingPreviews.take(url), image);
+    }
+}
+
+void AutoDownloader::onImageFetchFailed(const QString &url, const QString &error) {
+    if (thumbnailRequests.contains(url)) {
+        qDebug() << "Thumbnail fetch failed:" << url << "-" << error;
+        emit thumbnailReady(thumbnailRequests.take(url), QImage());
+        return;
+    }
+    if (!pendingPreviews.contains(url)) return;
+    
+    // Unmeasured frames are accepted
+    qDebug() << "Preview fetch failed, accepting frames unjudged:" << url << "-" << error;
+    pendingAnalyses -= pendingPreviews.take(url).size();
+    if (pendingAnalyses <= 0) {
+        planDirectory();
+    }
+}
+
+void AutoDownloader::analyzeInBackground(const QStringList &files, const QImage &image) {
+    // The analysis is a few milliseconds per preview but must not stall the
+    // GUI thread; the result comes back through the application object so a
+    // downloader destroyed meanwhile is simply skipped
+    QPointer<AutoDownloader> self(this);
+    int generation = runGeneration;
+    QThreadPool::globalInstance()->start([self, files, image, generation]() {
+        FrameQuality quality = FrameQualityAnalyzer::analyze(image);
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, files, quality, generation]() {
+            if (self) {
+                self->onFrameAnalyzed(files, quality, generation);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void AutoDownloader::onFrameAnalyzed(const QStringList &files, const FrameQuality &quality, int generation) {
+    for (const QString &file : files) {
+        qualityIndex.insert(file, quality);
+        emit frameAnalyzed(file, quality);
+    }
+    
+    // The measurement stays useful, but the plan it was for was stopped or replaced;
+    // planDirectory() saves the index for measurements it waited for
+    if (generation != runGeneration) {
+        indexSaveTimer.start();
+        return;
+    }
+    
+    pendingAnalyses -= files.size();
+    if (pendingAnalyses <= 0) {
+        planDirectory();
+    }
+}
+
+void AutoDownloader::planDirectory() {
+    pendingAnalyses = 0;
+    if (currentDirectory.isEmpty()) return;
+    
+    QString remoteDir = "Images/Astrophotography/" + currentDirectory;
+    QStringList accepted;
+    QStringList deferred;
+    
+    for (const QString &name : plannedFiles) {
+        QString remotePath = remoteDir + "/" + name;
+        FrameQuality quality;
+        QString reason;
+        if (!name.startsWith("FinalStackedMaster") &&
+            qualityIndex.lookup(remotePath, &quality) &&
+            !thresholds.passes(quality, &reason)) {
+            qDebug() << "Rejected" << remotePath << "-" << reason;
+            // With the scope about to fill up there is no time for frames we will not stack
+            bool skip = skipRejected || telescopeCritical;
+            emit frameRejected(remotePath, reason, skip);
+            if (!skip) {
+                deferred.append(name);
+            }
+            continue;
+        }
+        accepted.append(name);
+    }
+    plannedFiles.clear();
+    qualityIndex.save();
+    
+    // Good frames first; rejected ones (if kept) only once those are safe
+    for (const QString &name : accepted + deferred) {
+        fileQueue.enqueue(name);
         totalFiles++;
     }
     
-    // Start downloading the first file
     processNextFile();
 }
 
-void AutoDownloader::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal) {
+void AutoDownloader::onDownloadProgress(const QString &url, qint64 bytesReceived, qint64 bytesTotal) {
+    if (url != currentUrl) return;
+    
+    // The first progress report carries Content-Length; drop transfers that will not fit
+    if (bytesTotal > 0 && !sizeChecked) {
+        sizeChecked = true;
+        QString reason;
+        if (!hasLocalRoom(bytesTotal - bytesReceived, &reason)) {
+            qDebug() << "Deferring" << currentFile << "-" << reason;
+            if (!deferredDirectories.contains(currentDirectory)) {
+                deferredDirectories.append(currentDirectory);
+            }
+            QString deferredFile = currentFile;
+            currentUrl.clear();
+            downloadInProgress = false;
+            link->abortDownloads();
+            emit downloadDeferred(deferredFile, reason);
+            
+            // A smaller file may still fit
+            processNextFile();
+            return;
+        }
+    }
+    
     emit downloadProgress(currentFile, filesCompleted, totalFiles, bytesReceived, bytesTotal);
 }
 
-void AutoDownloader::sendCommand(const QString &command, const QString &destination,
-                               const QJsonObject &params) {
+int AutoDownloader::sendCommand(const QString &command, const QString &destination,
+                                const QJsonObject &params) {
     nextSequenceId++;
     
     // Create the JSON command
@@ -107,56 +479,130 @@ void AutoDownloader::sendCommand(const QString &command, const QString &destinat
         jsonCommand[it.key()] = it.value();
     }
     
-    // Send via WebSocket
-    QJsonDocument doc(jsonCommand);
-    QString message = doc.toJson();
-    
-    if (webSocket->isValid() && webSocket->state() == QAbstractSocket::ConnectedState) {
-        webSocket->sendTextMessage(message);
-    }
+    // Send via the link's WebSocket
+    link->sendJson(jsonCommand);
+    return nextSequenceId;
 }
 
-void AutoDownloader::downloadFile(const QString &filePath) {
+QString AutoDownloader::remoteUrl(const QString &filePath) const {
+    return QUrl(QString("http://%1/SmartScope-1.0/dev2/%2").arg(ipAddress, filePath)).toString();
+}
+
+void AutoDownloader::downloadFile(const QString &filePath, const QString &localPath) {
     if (ipAddress.isEmpty()) return;
     
     // Construct the proper URL path
-    QString fullPath = QString("http://%1/SmartScope-1.0/dev2/%2").arg(ipAddress, filePath);
-    QUrl url(fullPath);
-    QNetworkRequest request(url);
-    
-    // Set appropriate headers for the request
-    request.setRawHeader("Cache-Control", "no-cache");
-    request.setRawHeader("Accept", "*/*");
-    request.setRawHeader("User-Agent", "CelestronOriginMonitor Qt Application");
-    request.setRawHeader("Connection", "keep-alive");
+    QString fullPath = remoteUrl(filePath);
     
     qDebug() << "Downloading file from:" << fullPath;
     
-    QNetworkReply *reply = networkManager->get(request);
-    
-    connect(reply, &QNetworkReply::finished, this, &AutoDownloader::onFileDownloaded);
-    connect(reply, &QNetworkReply::downloadProgress, this, &AutoDownloader::onDownloadProgress);
-    
     // Update state
     downloadInProgress = true;
+    sizeChecked = false;
     currentFile = filePath;
+    currentUrl = QUrl(fullPath).toString();
+    
+    link->download(QUrl(fullPath), localPath.isEmpty() ? downloadPath + "/" + filePath : localPath);
     
     // Emit signal
     emit fileDownloadStarted(filePath);
 }
 
 void AutoDownloader::processNextFile() {
-    if (fileQueue.isEmpty()) {
-        qDebug() << "All files processed in current directory";
+    while (!fileQueue.isEmpty()) {
+        // Get the next file of the current observation
+        QString name = fileQueue.dequeue();
+        QString filePath = "Images/Astrophotography/" + currentDirectory + "/" + name;
+        QString localPath = downloadPath + "/" + currentDirectory + "/" + name;
+        
+        // Subframes never change once written, so an earlier run's copy is final;
+        // the stacked master keeps growing while the target is imaged
+        if (!name.startsWith("FinalStackedMaster") && QFileInfo::exists(localPath)) {
+            filesCompleted++;
+            continue;
+        }
+        
+        QString reason;
+        if (!hasLocalRoom(0, &reason)) {
+            qWarning() << "Local storage limit reached:" << reason;
+            if (!deferredDirectories.contains(currentDirectory)) {
+                deferredDirectories.append(currentDirectory);
+            }
+            stopDownload();
+            emit localSpaceExhausted(reason);
+            return;
+        }
+        
+        qDebug() << "Processing file:" << filePath;
+        
+        // Download the file
+        downloadFile(filePath, localPath);
         return;
     }
     
-    // Get the next file
-    QString filePath = fileQueue.dequeue();
-    qDebug() << "Processing file:" << filePath;
+    // A directory with a deferred file is not done; it stays pending for the next start
+    if (deferredDirectories.contains(currentDirectory)) {
+        qDebug() << "Directory" << currentDirectory << "left incomplete, files were deferred";
+    } else {
+        qDebug() << "All files processed in current directory";
+        emit directoryDownloaded(currentDirectory);
+    }
+    
+    // Process the next directory; this reports completion when none are left
+    processNextDirectory();
+}
+
+bool AutoDownloader::hasLocalRoom(qint64 expectedBytes, QString *reason) {
+    QStorageInfo storage(downloadPath);
+    if (storage.isValid() && storage.bytesAvailable() - expectedBytes < localReserve) {
+        *reason = QString("only %1 MB free locally (reserve %2 MB)")
+                      .arg(storage.bytesAvailable() / (1024 * 1024))
+                      .arg(localReserve / (1024 * 1024));
+        return false;
+    }
+    
+    if (localQuota > 0) {
+        if (localUsage < 0) {
+            // Measured once per run, then kept up to date as files arrive
+            localUsage = 0;
+            QDirIterator it(downloadPath, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                it.next();
+                localUsage += it.fileInfo().size();
+            }
+        }
+        if (localUsage + expectedBytes > localQuota) {
+            *reason = QString("download directory would exceed its %1 MB quota")
+                          .arg(localQuota / (1024 * 1024));
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+void AutoDownloader::setLocalLimits(qint64 reserveBytes, qint64 quotaBytes) {
+    localReserve = reserveBytes;
+    localQuota = quotaBytes;
+}
+
+bool AutoDownloader::isDiskCritical(const DiskStatus &disk) {
+    if (disk.capacity <= 0) return false;
     
-    // Download the file
-    downloadFile(filePath);
+    return disk.freeBytes < disk.capacity * CRITICAL_FREE_FRACTION ||
+           (disk.secondsToFull >= 0 && disk.secondsToFull < CRITICAL_SECONDS_TO_FULL);
+}
+
+void AutoDownloader::updateTelescopeDisk(const DiskStatus &disk) {
+    telescopeDisk = disk;
+    
+    bool critical = isDiskCritical(disk);
+    if (critical && !telescopeCritical) {
+        qWarning() << "Telescope disk critical:" << disk.freeBytes / (1024 * 1024) << "MB free,"
+                   << disk.secondsToFull << "s to full";
+        emit telescopeDiskCritical(disk.freeBytes, disk.secondsToFull);
+    }
+    telescopeCritical = critical;
 }
 
 void AutoDownloader::setDownloadPath(const QString &path) {
@@ -167,45 +613,63 @@ void AutoDownloader::setDownloadPath(const QString &path) {
     if (!dir.exists()) {
         dir.mkpath(".");
     }
+    
+    // Measurements travel with the files they describe
+    qualityIndex.setPath(downloadPath + "/.frame_quality.json");
+    loadStarred();
+    localUsage = -1;
 }
 
 // Changes to AutoDownloader.cpp
 
 // Modify the startDownload method to reset only necessary counters
 void AutoDownloader::startDownload() {
-    qDebug() << "Starting automatic download of stacked images";
+    qDebug() << "Starting automatic download of" << (mirrorSubframes ? "subframes" : "stacked images");
     
     // Reset counters and queues
     totalFiles = 0;
     filesCompleted = 0;
+    localUsage = -1;
     directoryQueue.clear();
-    // We don't need the file queue anymore
-    // fileQueue.clear();
+    fileQueue.clear();
+    plannedFiles.clear();
+    pendingPreviews.clear();
+    pendingAnalyses = 0;
+    runGeneration++;
+    
+    // Directories left incomplete last time come first
+    for (const QString &directory : deferredDirectories) {
+        directoryQueue.enqueue(directory);
+        if (!mirrorSubframes) {
+            totalFiles++;
+        }
+    }
     
     // Request the list of available directories
     sendCommand("GetListOfAvailableDirectories", "ImageServer");
 }
 
 // Modify processDirectoryList to count directories as total files
-void AutoDownloader::processDirectoryList(const QString &message) {
-    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8());
-    if (!doc.isObject()) {
-        qDebug() << "Failed to parse directory list JSON";
-        return;
-    }
-    
-    QJsonObject obj = doc.object();
-    
+void AutoDownloader::processDirectoryList(const QJsonObject &obj) {
     // Check if this is a response to GetListOfAvailableDirectories
     if (obj["Command"].toString() != "GetListOfAvailableDirectories" || 
         obj["Type"].toString() != "Response") {
         return;
     }
     
+    if (obj["SequenceID"].toInt() == browseSequenceId) {
+        browseDirectoryList(obj);
+        return;
+    }
+    if (obj["SequenceID"].toInt() == captureListSequenceId) {
+        locateCaptures(obj);
+        return;
+    }
+    
     // Get the directory list
     QJsonArray dirList = obj["DirectoryList"].toArray();
     
-    if (dirList.isEmpty()) {
+    if (dirList.isEmpty() && directoryQueue.isEmpty()) {
         qDebug() << "No directories found";
         emit allDownloadsComplete();
         return;
@@ -215,8 +679,11 @@ void AutoDownloader::processDirectoryList(const QString &message) {
     
     // Add each directory to the queue
     for (const auto &dir : dirList) {
+        if (directoryQueue.contains(dir.toString())) continue;
         directoryQueue.enqueue(dir.toString());
-        totalFiles++; // Count each directory as one file (the stacked image)
+        if (!mirrorSubframes) {
+            totalFiles++; // Count each directory as one file (the stacked image)
+        }
     }
     
     // Start processing the first directory
@@ -230,25 +697,17 @@ void AutoDownloader::downloadStackedImage(const QString &directory) {
     // Construct the proper URL path using the fixed pattern
     QString filePath = QString("Images/Astrophotography/%1/FinalStackedMaster.tiff").arg(directory);
     QString fullPath = QString("http://%1/SmartScope-1.0/dev2/%2").arg(ipAddress, filePath);
-    QUrl url(fullPath);
-    QNetworkRequest request(url);
-    
-    // Set appropriate headers for the request
-    request.setRawHeader("Cache-Control", "no-cache");
-    request.setRawHeader("Accept", "*/*");
-    request.setRawHeader("User-Agent", "CelestronOriginMonitor Qt Application");
-    request.setRawHeader("Connection", "keep-alive");
     
     qDebug() << "Downloading stacked image from:" << fullPath;
     
-    QNetworkReply *reply = networkManager->get(request);
-    
-    connect(reply, &QNetworkReply::finished, this, &AutoDownloader::onFileDownloaded);
-    connect(reply, &QNetworkReply::downloadProgress, this, &AutoDownloader::onDownloadProgress);
-    
     // Update state
     downloadInProgress = true;
+    sizeChecked = false;
     currentFile = filePath;
+    currentUrl = QUrl(fullPath).toString();
+    
+    // Streamed to disk on the I/O thread
+    link->download(QUrl(fullPath), downloadPath + "/" + directory + "/FinalStackedMaster.tiff");
     
     // Emit signal
     emit fileDownloadStarted(filePath);
@@ -258,90 +717,252 @@ void AutoDownloader::downloadStackedImage(const QString &directory) {
 void AutoDownloader::processNextDirectory() {
     if (directoryQueue.isEmpty()) {
         qDebug() << "All directories processed";
+        processingDirectory = false;
         if (!downloadInProgress) {
             emit allDownloadsComplete();
         }
         return;
     }
     
-    // Get the next directory
+    // Get the next directory; deferred files get another chance now
     currentDirectory = directoryQueue.dequeue();
+    directoryFiles.clear();
+    deferredDirectories.removeAll(currentDirectory);
+    processingDirectory = true;
     qDebug() << "Processing directory:" << currentDirectory;
     
     // Emit signal
     emit directoryDownloadStarted(currentDirectory);
     
-    // Instead of requesting file list, directly download the stacked image
-    downloadStackedImage(currentDirectory);
+    if (mirrorSubframes) {
+        // List the subframes so they can be judged before transfer
+        QJsonObject params;
+        params["Directory"] = "Images/Astrophotography/" + currentDirectory;
+        listingSequenceId = sendCommand("GetDirectoryContents", "ImageServer", params);
+    } else {
+        QString reason;
+        if (!hasLocalRoom(0, &reason)) {
+            qWarning() << "Local storage limit reached:" << reason;
+            deferredDirectories.append(currentDirectory);
+            stopDownload();
+            emit localSpaceExhausted(reason);
+            return;
+        }
+        
+        // Directly download the stacked image
+        downloadStackedImage(currentDirectory);
+    }
 }
 
 // Modify onFileDownloaded to handle directory completion
-void AutoDownloader::onFileDownloaded() {
-    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
-    if (!reply) return;
-    
-    bool success = false;
+void AutoDownloader::onFileDownloaded(const QString &url, const QString &localPath, bool success, const QString &error) {
+    // Transfers started by other users of the link are not ours
+    if (url != currentUrl) return;
+    currentUrl.clear();
     
-    if (reply->error() == QNetworkReply::NoError) {
-        // Get the file data
-        QByteArray fileData = reply->readAll();
-        
-        // Create directory for this observation
-        QString localDir = downloadPath + "/" + currentDirectory;
-        QDir dir;
-        dir.mkpath(localDir);
-        
-        // Save the file to disk
-        QString localPath = localDir + "/FinalStackedMaster.tiff";
-        QFile file(localPath);
-        if (file.open(QIODevice::WriteOnly)) {
-            file.write(fileData);
-            file.close();
-            success = true;
-            qDebug() << "Downloaded stacked image for:" << currentDirectory << "(" << fileData.size() << "bytes)";
-        } else {
-            qDebug() << "Failed to save stacked image for:" << currentDirectory;
-        }
+    if (success) {
+        qDebug() << "Downloaded" << currentFile << "to" << localPath << "(" << QFileInfo(localPath).size() << "bytes)";
     } else {
-        qDebug() << "Error downloading stacked image:" << currentFile << "-" << reply->errorString();
+        qDebug() << "Error downloading:" << currentFile << "-" << error;
     }
     
-    // Clean up
-    reply->deleteLater();
-    
     // Update counters
     filesCompleted++;
     downloadInProgress = false;
+    if (success && localUsage >= 0) {
+        localUsage += QFileInfo(localPath).size();
+    }
+    
+    // Raw TIFFs are converted; previews only when the frame has no TIFF
+    if (success && writeFits) {
+        QString name = QFileInfo(currentFile).fileName();
+        bool hasTiff = false;
+        for (const QString &listed : directoryFiles) {
+            if (isTiffImage(listed) && frameKey(listed) == frameKey(name)) {
+                hasTiff = true;
+                break;
+            }
+        }
+        if (isTiffImage(name) || (isPreviewImage(name) && !hasTiff)) {
+            writeFitsInBackground(currentFile, localPath);
+        }
+    }
     
     // Emit signals
     emit fileDownloaded(currentFile, success);
-    emit directoryDownloaded(currentDirectory);
-    
-    // Process the next directory
-    processNextDirectory();
     
-    // Check if all downloads are complete
-    if (directoryQueue.isEmpty() && !downloadInProgress) {
-        emit allDownloadsComplete();
-    }
+    // Continue with the rest of this observation, then the next one
+    processNextFile();
 }
 
-// Modify onTextMessageReceived to no longer handle GetDirectoryContents
-void AutoDownloader::onTextMessageReceived(const QString &message) {
-    // Process messages from the telescope
-    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8());
-    if (!doc.isObject()) return;
-    
-    QJsonObject obj = doc.object();
-    
+void AutoDownloader::onMessageReceived(const QJsonObject &obj) {
     // Check the type of message
     QString type = obj["Type"].toString();
     QString command = obj["Command"].toString();
     
     if (type == "Response") {
         if (command == "GetListOfAvailableDirectories") {
-            processDirectoryList(message);
+            processDirectoryList(obj);
+        } else if (command == "GetDirectoryContents") {
+            int sequenceId = obj["SequenceID"].toInt();
+            if (sequenceId == captureContentsSequenceId) {
+                assignCaptures(obj);
+            } else if (browseListings.contains(sequenceId)) {
+                browseFileList(browseListings.take(sequenceId), obj);
+            } else {
+                processFileList(obj);
+            }
+        }
+    }
+}
+
+void AutoDownloader::startBrowse() {
+    qDebug() << "Browsing observations";
+    
+    browseListings.clear();
+    thumbnailRequests.clear();
+    browseSequenceId = sendCommand("GetListOfAvailableDirectories", "ImageServer");
+}
+
+void AutoDownloader::browseDirectoryList(const QJsonObject &obj) {
+    browseSequenceId = -1;
+    
+    QJsonArray dirList = obj["DirectoryList"].toArray();
+    qDebug() << "Browsing" << dirList.size() << "directories";
+    
+    for (const auto &value : dirList) {
+        QString directory = value.toString();
+        
+        // Cached thumbnails cost nothing; only list directories we have not seen
+        QImage cached(thumbnailPath(downloadPath, directory));
+        if (!cached.isNull()) {
+            emit thumbnailReady(directory, cached);
+            continue;
+        }
+        
+        QJsonObject params;
+        params["Directory"] = "Images/Astrophotography/" + directory;
+        browseListings.insert(sendCommand("GetDirectoryContents", "ImageServer", params), directory);
+    }
+}
+
+void AutoDownloader::browseFileList(const QString &directory, const QJsonObject &obj) {
+    // Prefer an explicit thumbnail, then the stacked preview, then any frame preview
+    QString preview;
+    int bestRank = 0;
+    for (const auto &value : obj["FileList"].toArray()) {
+        QString name = value.toString();
+        if (!isPreviewImage(name)) continue;
+        
+        int rank = 1;
+        if (name.contains("thumb", Qt::CaseInsensitive)) {
+            rank = 3;
+        } else if (name.startsWith("FinalStackedMaster")) {
+            rank = 2;
+        }
+        if (rank > bestRank) {
+            bestRank = rank;
+            preview = name;
+        }
+    }
+    
+    if (preview.isEmpty()) {
+        emit thumbnailReady(directory, QImage());
+        return;
+    }
+    
+    QString url = remoteUrl("Images/Astrophotography/" + directory + "/" + preview);
+    thumbnailRequests.insert(url, directory);
+    link->fetchImage(QUrl(url));
+}
+
+void AutoDownloader::storeThumbnail(const QString &directory, const QImage &image) {
+    // Smoothing a full-size preview down takes longer than decoding it;
+    // keep it and the JPEG encode off the GUI thread
+    QPointer<AutoDownloader> self(this);
+    QString path = thumbnailPath(downloadPath, directory);
+    QThreadPool::globalInstance()->start([self, directory, image, path]() {
+        QImage thumbnail = image.scaled(THUMBNAIL_SIZE, THUMBNAIL_SIZE, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        if (!thumbnail.save(path, "JPG", 85)) {
+            qWarning() << "Failed to cache thumbnail:" << path;
+        }
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, directory, thumbnail]() {
+            if (self) {
+                emit self->thumbnailReady(directory, thumbnail);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+QString AutoDownloader::thumbnailPath(const QString &downloadPath, const QString &directory) {
+    return downloadPath + "/.thumbnails/" + directory + ".jpg";
+}
+
+QStringList AutoDownloader::pendingDirectories() const {
+    QStringList directories;
+    if (processingDirectory && !currentDirectory.isEmpty()) {
+        directories.append(currentDirectory);
+    }
+    for (const QString &directory : directoryQueue) {
+        directories.append(directory);
+    }
+    for (const QString &directory : deferredDirectories) {
+        if (!directories.contains(directory)) {
+            directories.append(directory);
         }
-        // We no longer need to handle GetDirectoryContents
     }
+    return directories;
+}
+
+void AutoDownloader::fetchDirectory(const QString &directory) {
+    if (directory == currentDirectory && processingDirectory) return;
+    if (directoryQueue.contains(directory)) return;
+    
+    directoryQueue.enqueue(directory);
+    if (!mirrorSubframes) {
+        totalFiles++;
+    }
+    
+    if (!processingDirectory) {
+        processNextDirectory();
+    }
+}
+
+void AutoDownloader::setStarred(const QString &directory, bool starred) {
+    if (starred == starredDirectories.contains(directory)) return;
+    
+    if (starred) {
+        starredDirectories.insert(directory);
+        fetchDirectory(directory);
+    } else {
+        starredDirectories.remove(directory);
+    }
+    saveStarred();
+}
+
+void AutoDownloader::loadStarred() {
+    starredDirectories.clear();
+    
+    QFile file(downloadPath + "/.thumbnails/starred.json");
+    if (!file.open(QIODevice::ReadOnly)) return;
+    
+    for (const auto &value : QJsonDocument::fromJson(file.readAll()).array()) {
+        starredDirectories.insert(value.toString());
+    }
+}
+
+void AutoDownloader::saveStarred() const {
+    QJsonArray starred;
+    for (const QString &directory : starredDirectories) {
+        starred.append(directory);
+    }
+    
+    QDir().mkpath(downloadPath + "/.thumbnails");
+    QFile file(downloadPath + "/.thumbnails/starred.json");
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to save starred observations";
+        return;
+    }
+    file.write(QJsonDocument(starred).toJson());
 }
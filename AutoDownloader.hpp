@@ -10,7 +10,13 @@
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QTimer>
-#include <QWebSocket>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include "FitsWriter.hpp"
+#include "FrameQualityAnalyzer.hpp"
+#include "TelescopeData.hpp"
+#include "TelescopeLink.hpp"
 
 /**
  * @brief Class for automatically downloading observations from the telescope
@@ -22,14 +28,17 @@ class AutoDownloader : public QObject {
     Q_OBJECT
     
 public:
+    /** Frames remembered for FITS headers; a night of short subframes fits easily */
+    static const int MAX_FRAME_METADATA = 10000;
+    
     /**
      * @brief Constructor
-     * @param webSocket The WebSocket for sending commands
+     * @param link The telescope link for commands and transfers
      * @param ipAddress The IP address of the telescope
      * @param downloadPath The path to download observations to
      * @param parent The parent QObject
      */
-    AutoDownloader(QWebSocket *webSocket, const QString &ipAddress, 
+    AutoDownloader(TelescopeLink *link, const QString &ipAddress, 
                    const QString &downloadPath = "Downloads", QObject *parent = nullptr);
     
     /**
@@ -46,8 +55,110 @@ public:
     * @param path The new download path
     */
     void setDownloadPath(const QString &path);
+    
+    /**
+     * @brief Mirror every subframe of each observation instead of only the stacked master
+     * @param enabled Whether subframe mirroring is on
+     */
+    void setMirrorSubframes(bool enabled);
+    
+    /**
+     * @brief Set the limits a subframe must meet to be transferred in mirror mode
+     * @param thresholds The quality limits
+     */
+    void setQualityThresholds(const FrameQualityThresholds &thresholds);
+    
+    /**
+     * @brief Choose what happens to subframes that fail the quality limits
+     * @param skip true to never download them, false to download them after all good frames
+     */
+    void setSkipRejectedFrames(bool skip);
+    
+    /**
+     * @brief Also write a FITS copy of every downloaded frame
+     *
+     * Frames captured while we were connected get headers from the
+     * telemetry passed to recordFrameMetadata(); others get only what the
+     * image itself says.
+     * @param enabled Whether FITS copies are written
+     */
+    void setWriteFits(bool enabled);
+    
+    /**
+     * @brief Remember the acquisition details of a frame the telescope just announced
+     *
+     * NewImageReady only names a recycled Images/Temp preview, so the frame
+     * is matched to its archive file by listing the newest observation;
+     * its download then gets these values.
+     * @param metadata Its header values
+     */
+    void recordFrameMetadata(const FitsWriter::Metadata &metadata);
+    
+    /**
+     * @brief The quality measurements gathered so far
+     */
+    const FrameQualityIndex &frameQualityIndex() const { return qualityIndex; }
+    
+    /**
+     * @brief Fetch a small preview of every observation without downloading any masters
+     *
+     * Thumbnails are cached under .thumbnails in the download directory, so
+     * browsing the same night again costs one directory listing.
+     */
+    void startBrowse();
+    
+    /**
+     * @brief Download one observation at full resolution
+     * @param directory The observation directory; queued behind any download in progress
+     */
+    void fetchDirectory(const QString &directory);
+    
+    /**
+     * @brief Star or unstar an observation; starring also fetches it at full resolution
+     * @param directory The observation directory
+     * @param starred Whether it is starred
+     */
+    void setStarred(const QString &directory, bool starred);
+    
+    /**
+     * @brief Whether an observation has been starred
+     */
+    bool isStarred(const QString &directory) const { return starredDirectories.contains(directory); }
+    
+    /**
+     * @brief Path of the cached thumbnail for an observation
+     * @param downloadPath The download directory the cache lives in
+     * @param directory The observation directory
+     */
+    static QString thumbnailPath(const QString &downloadPath, const QString &directory);
+    
+    /**
+     * @brief Observations still to be downloaded, the one in progress first
+     *
+     * Includes observations left incomplete because a file did not fit locally.
+     */
+    QStringList pendingDirectories() const;
+    
+    /**
+     * @brief Feed the telescope's latest DiskStatus into the scheduler
+     * @param disk The disk status, including the derived fill rate
+     */
+    void updateTelescopeDisk(const DiskStatus &disk);
+    
+    /**
+     * @brief Whether a telescope disk is close enough to full to risk aborting an imaging run
+     * @param disk The disk status
+     */
+    static bool isDiskCritical(const DiskStatus &disk);
+    
+    /**
+     * @brief Set the local storage limits downloads must respect
+     * @param reserveBytes Free space to always leave on the local volume
+     * @param quotaBytes Maximum size of the download directory, 0 for no quota
+     */
+    void setLocalLimits(qint64 reserveBytes, qint64 quotaBytes);
   
-    void processFileList(const QString &message);
+    void processFileList(const QJsonObject &obj);
 
     void downloadStackedImage(const QString &directory);
 signals:
@@ -92,46 +203,179 @@ signals:
     void downloadProgress(const QString &currentFile, int filesCompleted, 
                           int totalFiles, qint64 bytesReceived, qint64 bytesTotal);
     
+    /**
+     * @brief Signal emitted when a captured frame has been matched to its archive file
+     * @param filePath The archive path without suffix
+     * @param dateObsMs The capture's exposure start, as recorded
+     */
+    void frameLocated(const QString &filePath, qint64 dateObsMs);
+    
+    /**
+     * @brief Signal emitted when a subframe has been measured
+     * @param fileName The telescope file location
+     * @param quality The measurement
+     */
+    void frameAnalyzed(const QString &fileName, const FrameQuality &quality);
+    
+    /**
+     * @brief Signal emitted when a subframe fails the quality limits
+     * @param fileName The telescope file location
+     * @param reason Why it failed
+     * @param skipped true if it will not be downloaded, false if it was moved to the end of the queue
+     */
+    void frameRejected(const QString &fileName, const QString &reason, bool skipped);
+    
+    /**
+     * @brief Signal emitted once per observation while browsing
+     * @param directory The observation directory
+     * @param thumbnail The thumbnail, null if the observation has no preview image
+     */
+    void thumbnailReady(const QString &directory, const QImage &thumbnail);
+    
+    /**
+     * @brief Signal emitted when the telescope disk becomes critically full
+     * @param freeBytes Free space left on the telescope
+     * @param secondsToFull Estimated time until full at the current fill rate, -1 if unknown
+     */
+    void telescopeDiskCritical(qint64 freeBytes, qint64 secondsToFull);
+    
+    /**
+     * @brief Signal emitted when a file is not downloaded because it would overrun local limits
+     * @param fileName The file on the telescope
+     * @param reason Which limit it would overrun
+     */
+    void downloadDeferred(const QString &fileName, const QString &reason);
+    
+    /**
+     * @brief Signal emitted when downloading stops because the local limits are already reached
+     * @param reason Which limit was reached
+     */
+    void localSpaceExhausted(const QString &reason);
+    
 private slots:
     /**
      * @brief Process the list of available directories
-     * @param message The JSON message containing the directory list
+     * @param obj The JSON response containing the directory list
      */
-    void processDirectoryList(const QString &message);
+    void processDirectoryList(const QJsonObject &obj);
     
     /**
      * @brief Slot called when a file download is complete
+     * @param url The URL that was downloaded
+     * @param localPath Where the file was written
+     * @param success Whether the transfer and write succeeded
+     * @param error The error string on failure
      */
-    void onFileDownloaded();
+    void onFileDownloaded(const QString &url, const QString &localPath, bool success, const QString &error);
     
     /**
      * @brief Slot called when a file download reports progress
+     * @param url The URL being downloaded
      * @param bytesReceived The number of bytes received
      * @param bytesTotal The total number of bytes
      */
-    void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void onDownloadProgress(const QString &url, qint64 bytesReceived, qint64 bytesTotal);
     
     /**
-     * @brief Slot called when a message is received from the WebSocket
-     * @param message The received message
+     * @brief Slot called when a message is received from the telescope
+     * @param obj The decoded packet
      */
-    void onTextMessageReceived(const QString &message);
+    void onMessageReceived(const QJsonObject &obj);
+    
+    /**
+     * @brief Slot called when a preview fetched for analysis arrives
+     * @param url The preview URL
+     * @param image The decoded preview
+     */
+    void onImageFetched(const QString &url, const QImage &image);
+    
+    /**
+     * @brief Slot called when a preview fetch fails
+     * @param url The preview URL
+     * @param error The error string
+     */
+    void onImageFetchFailed(const QString &url, const QString &error);
     
 private:
+    /** Longest side of a cached thumbnail in pixels */
+    static const int THUMBNAIL_SIZE = 160;
+    
+    /** Telescope free space below which the disk is critical */
+    static constexpr double CRITICAL_FREE_FRACTION = 0.05;
+    
+    /** Time to full below which the disk is critical */
+    static const qint64 CRITICAL_SECONDS_TO_FULL = 30 * 60;
+    
+    /** Delay before late measurements are saved to the quality index */
+    static const int INDEX_SAVE_DELAY_MS = 5000;
+    
+    /** Time after which an unanswered capture lookup is sent again */
+    static const qint64 CAPTURE_LOOKUP_TIMEOUT_MS = 30 * 1000;
+    
     /**
      * @brief Send a command to the telescope
      * @param command The command to send
      * @param destination The destination for the command
      * @param params Additional parameters for the command
+     * @return The SequenceID the response will carry
      */
-    void sendCommand(const QString &command, const QString &destination, 
-                     const QJsonObject &params = QJsonObject());
+    int sendCommand(const QString &command, const QString &destination, 
+                    const QJsonObject &params = QJsonObject());
     
     /**
      * @brief Download a file from the telescope
      * @param filePath The path to the file on the telescope
+     * @param localPath Where to save it; defaults to the same path under the download directory
+     */
+    void downloadFile(const QString &filePath, const QString &localPath = QString());
+    
+    /**
+     * @brief Build the HTTP URL of a file on the telescope
+     * @param filePath The path to the file on the telescope
+     */
+    QString remoteUrl(const QString &filePath) const;
+    
+    /**
+     * @brief Measure a preview on the global thread pool
+     * @param files The telescope file locations the preview stands for
+     * @param image The decoded preview
+     */
+    void analyzeInBackground(const QStringList &files, const QImage &image);
+    
+    /**
+     * @brief Record a measurement made on the thread pool
+     * @param generation The run that requested it
+     */
+    void onFrameAnalyzed(const QStringList &files, const FrameQuality &quality, int generation);
+    
+    /**
+     * @brief Queue the current directory's files once every preview has been judged
+     */
+    void planDirectory();
+    
+    /**
+     * @brief Request thumbnails for a browsed directory list
+     * @param obj The GetListOfAvailableDirectories response
+     */
+    void browseDirectoryList(const QJsonObject &obj);
+    
+    /**
+     * @brief Pick and fetch the preview of one browsed observation
+     * @param directory The observation directory
+     * @param obj The GetDirectoryContents response
      */
-    void downloadFile(const QString &filePath);
+    void browseFileList(const QString &directory, const QJsonObject &obj);
+    
+    /**
+     * @brief Shrink a fetched preview on the thread pool and cache it
+     */
+    void storeThumbnail(const QString &directory, const QImage &image);
+    
+    /** @brief Load the starred observations from the thumbnail cache */
+    void loadStarred();
+    
+    /** @brief Save the starred observations to the thumbnail cache */
+    void saveStarred() const;
     
     /**
      * @brief Process the next directory in the queue
@@ -139,12 +383,55 @@ private:
     void processNextDirectory();
     
     /**
-     * @brief Process the next file in the queue
+     * @brief Process the next file in the queue, or finish the directory when it is empty
      */
     void processNextFile();
     
-    /** The WebSocket for sending commands */
-    QWebSocket *webSocket;
+    /**
+     * @brief Check a transfer against the local reserve and quota
+     * @param expectedBytes Bytes the transfer will still write
+     * @param reason Receives which limit would be overrun
+     * @return true if the transfer fits
+     */
+    bool hasLocalRoom(qint64 expectedBytes, QString *reason);
+    
+    /**
+     * @brief Write the FITS copy of a downloaded file on the thread pool
+     * @param filePath The file on the telescope
+     * @param localPath The downloaded copy
+     */
+    void writeFitsInBackground(const QString &filePath, const QString &localPath);
+    
+    /** @brief List the observations to find where the pending captures were filed */
+    void requestCaptureListing();
+    
+    /**
+     * @brief List the newest observation, which holds the pending captures
+     * @param obj The GetListOfAvailableDirectories response
+     */
+    void locateCaptures(const QJsonObject &obj);
+    
+    /**
+     * @brief Match the pending captures to the newest frames of the observation
+     * @param obj The GetDirectoryContents response
+     */
+    void assignCaptures(const QJsonObject &obj);
+    
+    /**
+     * @brief Keep a frame's header values, forgetting the oldest beyond MAX_FRAME_METADATA
+     * @param key The archive path without suffix
+     */
+    void storeFrameMetadata(const QString &key, const FitsWriter::Metadata &metadata);
+    
+    /**
+     * @brief Header values for a downloaded file
+     * @param filePath The file on the telescope
+     * @return The recorded metadata; a stacked master gets its first frame's, with the total exposure
+     */
+    FitsWriter::Metadata metadataFor(const QString &filePath) const;
+    
+    /** The link for sending commands and downloading files */
+    TelescopeLink *link;
     
     /** The IP address of the telescope */
     QString ipAddress;
@@ -152,8 +439,8 @@ private:
     /** The base path to download observations to */
     QString downloadPath;
     
-    /** The network access manager for downloading files */
-    QNetworkAccessManager *networkManager;
+    /** The URL of the transfer in progress */
+    QString currentUrl;
     
     /** The queue of directories to process */
     QQueue<QString> directoryQueue;
@@ -178,4 +465,100 @@ private:
     
     /** The sequence ID for the next command */
     int nextSequenceId;
+    
+    /** Whether every subframe is mirrored, not just the stacked master */
+    bool mirrorSubframes;
+    
+    /** Whether rejected subframes are skipped rather than deferred */
+    bool skipRejected;
+    
+    /** Whether downloaded frames are also written as FITS */
+    bool writeFits;
+    
+    /** Archive path without suffix -> header values recorded at capture */
+    QHash<QString, FitsWriter::Metadata> frameMetadata;
+    
+    /** Keys of frameMetadata, oldest first, to bound it over long sessions */
+    QQueue<QString> frameMetadataOrder;
+    
+    /** Captures not yet matched to an archive file, oldest first */
+    QQueue<FitsWriter::Metadata> pendingCaptures;
+    
+    /** Number of pendingCaptures the outstanding lookup is for */
+    int capturesListed;
+    
+    /** SequenceID of the outstanding capture GetListOfAvailableDirectories */
+    int captureListSequenceId;
+    
+    /** SequenceID of the outstanding capture GetDirectoryContents */
+    int captureContentsSequenceId;
+    
+    /** Observation the outstanding capture GetDirectoryContents lists */
+    QString captureDirectory;
+    
+    /** When the outstanding capture lookup was sent, ms since epoch */
+    qint64 captureLookupStartedMs;
+    
+    /** Limits a subframe must meet to be downloaded */
+    FrameQualityThresholds thresholds;
+    
+    /** Measurements by telescope file location, persisted in the download directory */
+    FrameQualityIndex qualityIndex;
+    
+    /** Files of the current directory awaiting the quality decision */
+    QStringList plannedFiles;
+    
+    /** Every file listed in the current directory, to pair frames across formats */
+    QStringList directoryFiles;
+    
+    /** Preview URL -> telescope files it is being fetched to judge */
+    QHash<QString, QStringList> pendingPreviews;
+    
+    /** Number of planned files still waiting for a measurement */
+    int pendingAnalyses;
+    
+    /** Bumped on every start and stop, so analyses planned by an earlier run are not counted */
+    int runGeneration;
+    
+    /** Saves the index once late measurements stop arriving */
+    QTimer indexSaveTimer;
+    
+    /** SequenceID of the outstanding mirror GetDirectoryContents */
+    int listingSequenceId;
+    
+    /** SequenceID of the outstanding browse GetListOfAvailableDirectories */
+    int browseSequenceId;
+    
+    /** Browse GetDirectoryContents SequenceID -> observation directory */
+    QHash<int, QString> browseListings;
+    
+    /** Preview URL -> observation directory awaiting a thumbnail */
+    QHash<QString, QString> thumbnailRequests;
+    
+    /** Observations the user starred */
+    QSet<QString> starredDirectories;
+    
+    /** Whether a directory taken from the queue is still being worked on */
+    bool processingDirectory;
+    
+    /** The latest telescope disk report */
+    DiskStatus telescopeDisk;
+    
+    /** Whether the telescope disk was critical at the last report */
+    bool telescopeCritical;
+    
+    /** Free space to leave on the local volume */
+    qint64 localReserve;
+    
+    /** Maximum size of the download directory, 0 for none */
+    qint64 localQuota;
+    
+    /** Current size of the download directory, -1 until measured */
+    qint64 localUsage;
+    
+    /** Whether the current transfer's Content-Length has been checked */
+    bool sizeChecked;
+    
+    /** Observations with a file that did not fit locally, retried on the next start */
+    QStringList deferredDirectories;
 };
@@ -0,0 +1,298 @@
+#include "BackgroundModel.hpp"
+#include "ParallelFor.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // The downsampled copy is about this many pixels on its long side
+    const int PLANE_SIZE = 128;
+    // Tile edge in downsampled pixels
+    const int TILE_SIZE = 8;
+    const double CLIP_SIGMA = 3.0;
+    const double REJECT_SIGMA = 2.5;
+    // Keeps tabulated offsets positive so int() truncation rounds the same way on both signs
+    const float OFFSET_BIAS = 131072.0f;
+
+    struct Sample {
+        double x;
+        double y;
+        double value;
+    };
+
+    double medianOf(QVector<float> &values)
+    {
+        auto middle = values.begin() + values.size() / 2;
+        std::nth_element(values.begin(), middle, values.end());
+        return *middle;
+    }
+
+    // Sky level of one tile: median after iteratively clipping outliers (stars, hot pixels)
+    bool clippedMedian(QVector<float> values, double &result)
+    {
+        for (int pass = 0; pass < 3 && values.size() >= 4; pass++) {
+            double median = medianOf(values);
+            QVector<float> deviations(values.size());
+            for (int i = 0; i < values.size(); i++) deviations[i] = std::fabs(values[i] - median);
+            double sigma = 1.4826 * medianOf(deviations);
+            result = median;
+            if (sigma <= 0.0) return true;
+
+            QVector<float> kept;
+            for (float value : values) {
+                if (std::fabs(value - median) <= CLIP_SIGMA * sigma) kept.append(value);
+            }
+            if (kept.size() == values.size()) return true;
+            values = kept;
+        }
+        if (values.size() < 4) return false;
+        result = medianOf(values);
+        return true;
+    }
+
+    constexpr int termCount(int degree)
+    {
+        return (degree + 1) * (degree + 2) / 2;
+    }
+
+    // Powers x^i y^j in the order the coefficients use
+    void terms(int degree, double x, double y, double *out)
+    {
+        int k = 0;
+        double yPower = 1.0;
+        for (int j = 0; j <= degree; j++) {
+            double power = yPower;
+            for (int i = 0; i + j <= degree; i++) {
+                out[k++] = power;
+                power *= x;
+            }
+            yPower *= y;
+        }
+    }
+
+    // Least squares via the normal equations; the systems are at most 10x10
+    bool solve(const QVector<Sample> &samples, int degree, QVector<double> &coefficients)
+    {
+        const int n = termCount(degree);
+        if (samples.size() < n) return false;
+
+        QVector<double> a(n * (n + 1), 0.0);  // augmented matrix
+        double t[termCount(BackgroundModel::MAX_DEGREE)];
+        for (const Sample &s : samples) {
+            terms(degree, s.x, s.y, t);
+            for (int r = 0; r < n; r++) {
+                for (int c = 0; c < n; c++) a[r * (n + 1) + c] += t[r] * t[c];
+                a[r * (n + 1) + n] += t[r] * s.value;
+            }
+        }
+
+        for (int col = 0; col < n; col++) {
+            int pivot = col;
+            for (int r = col + 1; r < n; r++) {
+                if (std::fabs(a[r * (n + 1) + col]) > std::fabs(a[pivot * (n + 1) + col])) pivot = r;
+            }
+            if (std::fabs(a[pivot * (n + 1) + col]) < 1e-12) return false;
+            for (int c = 0; c <= n; c++) std::swap(a[col * (n + 1) + c], a[pivot * (n + 1) + c]);
+
+            for (int r = 0; r < n; r++) {
+                if (r == col) continue;
+                double factor = a[r * (n + 1) + col] / a[col * (n + 1) + col];
+                for (int c = col; c <= n; c++) a[r * (n + 1) + c] -= factor * a[col * (n + 1) + c];
+            }
+        }
+
+        coefficients.resize(n);
+        for (int r = 0; r < n; r++) coefficients[r] = a[r * (n + 1) + n] / a[r * (n + 1) + r];
+        return true;
+    }
+
+    double evaluate(const QVector<double> &coefficients, int degree, double x, double y)
+    {
+        double t[termCount(BackgroundModel::MAX_DEGREE)];
+        terms(degree, x, y, t);
+        double sum = 0.0;
+        for (int k = 0; k < coefficients.size(); k++) sum += coefficients[k] * t[k];
+        return sum;
+    }
+
+    // Box-average every channel at once into planes of planeWidth x planeHeight
+    template <typename Pixel, int Channels, typename Read>
+    void downsample(const QImage &image, int factor, int planeWidth, int planeHeight, Read read,
+                    QVector<float> *planes)
+    {
+        for (int c = 0; c < Channels; c++) planes[c] = QVector<float>(planeWidth * planeHeight, 0.0f);
+        const float scale = 1.0f / (factor * factor);
+        parallelFor(planeHeight, [&](int begin, int end) {
+            for (int py = begin; py < end; py++) {
+                float *out[Channels];
+                for (int c = 0; c < Channels; c++) out[c] = planes[c].data() + py * planeWidth;
+
+                for (int y = py * factor; y < (py + 1) * factor; y++) {
+                    const Pixel *line = reinterpret_cast<const Pixel*>(image.constScanLine(y));
+                    for (int px = 0; px < planeWidth; px++) {
+                        float sum[Channels] = {};
+                        for (int x = px * factor; x < (px + 1) * factor; x++) {
+                            for (int c = 0; c < Channels; c++) sum[c] += read(line[x], c);
+                        }
+                        for (int c = 0; c < Channels; c++) out[c][px] += sum[c];
+                    }
+                }
+                for (int c = 0; c < Channels; c++) {
+                    for (int px = 0; px < planeWidth; px++) out[c][px] *= scale;
+                }
+            }
+        });
+    }
+}
+
+bool BackgroundModel::fit(const QVector<float> &plane, int width, int height, int degree)
+{
+    m_coefficients.clear();
+    m_degree = qBound(0, degree, MAX_DEGREE);
+
+    // 1. Sigma-clipped sky level of each tile
+    QVector<Sample> samples;
+    QVector<float> tile;
+    for (int ty = 0; ty + TILE_SIZE <= height; ty += TILE_SIZE) {
+        for (int tx = 0; tx + TILE_SIZE <= width; tx += TILE_SIZE) {
+            tile.clear();
+            for (int y = ty; y < ty + TILE_SIZE; y++) {
+                for (int x = tx; x < tx + TILE_SIZE; x++) tile.append(plane[y * width + x]);
+            }
+            double level;
+            if (!clippedMedian(tile, level)) continue;
+            samples.append({2.0 * (tx + TILE_SIZE / 2.0) / width - 1.0,
+                            2.0 * (ty + TILE_SIZE / 2.0) / height - 1.0,
+                            level});
+        }
+    }
+    if (samples.isEmpty()) return false;
+
+    QVector<float> levels;
+    for (const Sample &s : samples) levels.append(float(s.value));
+    m_pedestal = medianOf(levels);
+
+    // 2. Fit, drop tiles well off the surface (nebulosity, galaxies, bright stars), fit again
+    QVector<double> coefficients;
+    if (!solve(samples, m_degree, coefficients)) return false;
+
+    QVector<float> residuals;
+    for (const Sample &s : samples) residuals.append(float(std::fabs(s.value - evaluate(coefficients, m_degree, s.x, s.y))));
+    double sigma = 1.4826 * medianOf(residuals);
+    if (sigma > 0.0) {
+        QVector<Sample> kept;
+        for (const Sample &s : samples) {
+            if (std::fabs(s.value - evaluate(coefficients, m_degree, s.x, s.y)) <= REJECT_SIGMA * sigma) kept.append(s);
+        }
+        QVector<double> refined;
+        if (kept.size() < samples.size() && solve(kept, m_degree, refined)) coefficients = refined;
+    }
+
+    m_coefficients = coefficients;
+    return true;
+}
+
+double BackgroundModel::valueAt(double u, double v) const
+{
+    if (!isValid()) return 0.0;
+    return evaluate(m_coefficients, m_degree, 2.0 * u - 1.0, 2.0 * v - 1.0);
+}
+
+QImage BackgroundModel::subtract(const QImage &source, int degree)
+{
+    if (source.isNull()) return source;
+
+    QImage image = source;
+    bool gray16 = image.format() == QImage::Format_Grayscale16;
+    bool gray8 = image.format() == QImage::Format_Grayscale8;
+    if (!gray16 && !gray8 && image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32) {
+        image = image.convertToFormat(QImage::Format_RGB32);
+    }
+
+    const int width = image.width();
+    const int height = image.height();
+    const int factor = qMax(1, (qMax(width, height) + PLANE_SIZE - 1) / PLANE_SIZE);
+    const int planeWidth = width / factor;
+    const int planeHeight = height / factor;
+    if (planeWidth < TILE_SIZE || planeHeight < TILE_SIZE) return source;
+
+    const int channels = (gray16 || gray8) ? 1 : 3;
+    QVector<float> planes[3];
+    if (gray16) {
+        downsample<quint16, 1>(image, factor, planeWidth, planeHeight, [](quint16 p, int) { return float(p); }, planes);
+    } else if (gray8) {
+        downsample<uchar, 1>(image, factor, planeWidth, planeHeight, [](uchar p, int) { return float(p); }, planes);
+    } else {
+        downsample<QRgb, 3>(image, factor, planeWidth, planeHeight,
+                            [](QRgb p, int c) { return float((p >> (16 - 8 * c)) & 0xff); }, planes);
+    }
+
+    BackgroundModel models[3];
+    bool fitted[3] = {false, false, false};
+    parallelFor(channels, [&](int begin, int end) {
+        for (int c = begin; c < end; c++) fitted[c] = models[c].fit(planes[c], planeWidth, planeHeight, degree);
+    }, 1);
+    for (int c = 0; c < channels; c++) {
+        if (!fitted[c]) return source;
+    }
+
+    // 3. Subtract. Per row the surface is a polynomial in x; it is tabulated
+    // for the row with plain float loops the compiler vectorises, then
+    // subtracted with integer arithmetic
+    const int d = models[0].m_degree;
+    parallelFor(height, [&](int begin, int end) {
+        QVector<int> offsets(channels * width);
+        QVector<float> nx(width);
+        for (int x = 0; x < width; x++) nx[x] = 2.0f * (x + 0.5f) / width - 1.0f;
+
+        for (int y = begin; y < end; y++) {
+            double ny = 2.0 * (y + 0.5) / height - 1.0;
+            for (int c = 0; c < channels; c++) {
+                // x^i coefficients for this row: sum_j c_ij y^j
+                float row[MAX_DEGREE + 1] = {};
+                int k = 0;
+                double yPower = 1.0;
+                for (int j = 0; j <= d; j++) {
+                    for (int i = 0; i + j <= d; i++) row[i] += float(models[c].m_coefficients[k++] * yPower);
+                    yPower *= ny;
+                }
+                // Less the pedestal so the sky keeps its level; the bias makes
+                // truncation round to nearest without a call to floor()
+                row[0] += OFFSET_BIAS + 0.5f - float(models[c].m_pedestal);
+
+                // Fixed cubic (higher terms zero for lower degrees) so the loop vectorises
+                static_assert(MAX_DEGREE == 3, "row evaluation is written out for a cubic");
+                int *offset = offsets.data() + c * width;
+                const float r0 = row[0], r1 = row[1], r2 = row[2], r3 = row[3];
+                for (int x = 0; x < width; x++) {
+                    float u = nx[x];
+                    offset[x] = int(((r3 * u + r2) * u + r1) * u + r0) - int(OFFSET_BIAS);
+                }
+            }
+
+            uchar *line = image.scanLine(y);
+            if (gray16) {
+                quint16 *pixels = reinterpret_cast<quint16*>(line);
+                for (int x = 0; x < width; x++) {
+                    pixels[x] = quint16(qBound(0, pixels[x] - offsets[x], 65535));
+                }
+            } else if (gray8) {
+                for (int x = 0; x < width; x++) {
+                    line[x] = uchar(qBound(0, line[x] - offsets[x], 255));
+                }
+            } else {
+                const int *red = offsets.data();
+                const int *green = red + width;
+                const int *blue = green + width;
+                QRgb *pixels = reinterpret_cast<QRgb*>(line);
+                for (int x = 0; x < width; x++) {
+                    QRgb p = pixels[x];
+                    int r = qBound(0, qRed(p) - red[x], 255);
+                    int g = qBound(0, qGreen(p) - green[x], 255);
+                    int b = qBound(0, qBlue(p) - blue[x], 255);
+                    pixels[x] = (p & 0xff000000u) | (quint32(r) << 16) | (quint32(g) << 8) | quint32(b);
+                }
+            }
+        }
+    });
+    return image;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QImage>
+#include <QVector>
+
+/**
+ * @brief Smooth sky background (light-pollution gradient) of a frame
+ *
+ * Built in three steps on a copy box-downsampled to about 128 pixels
+ * across: the copy is cut into tiles whose sigma-clipped median is the
+ * local sky, a low-order 2D polynomial is least-squares fitted through
+ * those samples (tiles sitting on nebulosity or a galaxy are rejected and
+ * the fit repeated), and the fitted surface is subtracted from the full
+ * frame. The frame keeps its median sky level as a pedestal, so only the
+ * gradient goes away.
+ *
+ * Only the subtraction touches every pixel, and it costs a couple of
+ * multiply-adds per pixel, so the whole stage suits live previews and
+ * per-frame metrics.
+ */
+class BackgroundModel
+{
+public:
+    static const int MAX_DEGREE = 3;
+
+    /**
+     * @brief Fit a model to one channel
+     * @param plane Downsampled channel values, row by row
+     * @param width Plane width
+     * @param height Plane height
+     * @param degree Polynomial degree, 0 to MAX_DEGREE
+     * @return False if there were too few usable tiles
+     */
+    bool fit(const QVector<float> &plane, int width, int height, int degree = 2);
+
+    bool isValid() const { return !m_coefficients.isEmpty(); }
+
+    /**
+     * @brief Model value at a position
+     * @param u Horizontal position, 0 (left edge) to 1 (right edge)
+     * @param v Vertical position, 0 (top edge) to 1 (bottom edge)
+     */
+    double valueAt(double u, double v) const;
+
+    /** @brief Median sky level of the tiles, which subtraction keeps */
+    double pedestal() const { return m_pedestal; }
+
+    /**
+     * @brief Remove the gradient from every channel of an image
+     * @param image Grayscale8, Grayscale16, RGB32 or ARGB32; other formats are converted to RGB32
+     * @param degree Polynomial degree
+     * @return The flattened image, or the input unchanged if no model could be fitted
+     */
+    static QImage subtract(const QImage &image, int degree = 2);
+
+private:
+    /** Coefficients of x^i y^j for i + j <= degree, in normalised [-1, 1] coordinates */
+    QVector<double> m_coefficients;
+    int m_degree = 0;
+    double m_pedestal = 0.0;
+};
@@ -50,9 +50,150 @@ HEADERS += \
     OriginBackend.hpp \
     AlpacaServer.hpp
 
-# Optional: Add AutoDownloader if you want download functionality in Alpaca
-# SOURCES += AutoDownloader.cpp
-# HEADERS += AutoDownloader.hpp
+# MJPEG live view on the Alpaca port
+SOURCES += MjpegStreamer.cpp
+HEADERS += MjpegStreamer.hpp
+
+# AutoDownloader is used by the Auto Download tab
+SOURCES += AutoDownloader.cpp
+HEADERS += AutoDownloader.hpp
+
+# Network I/O thread: sockets and decoding off the GUI thread
+SOURCES += \
+    TelescopeLink.cpp
+
+HEADERS += \
+    SpscQueue.hpp \
+    TelescopeLink.hpp
+
+# Subframe quality index for the mirror downloader
+SOURCES += \
+    BackgroundModel.cpp \
+    FrameQualityAnalyzer.cpp
+
+HEADERS += \
+    BackgroundModel.hpp \
+    FrameQualityAnalyzer.hpp \
+    ParallelFor.hpp
+
+# Telemetry history
+SOURCES += \
+    TelemetryFields.cpp \
+    TelemetryRollups.cpp \
+    TelemetryStore.cpp
+
+HEADERS += \
+    TelemetryFields.hpp \
+    TelemetryRollups.hpp \
+    TelemetryStore.hpp
+
+# Alert rules over telemetry
+SOURCES += \
+    AlertEngine.cpp
+
+HEADERS += \
+    AlertEngine.hpp
+
+# Indexed viewer for WebSocket logs
+SOURCES += \
+    WebSocketLogIndex.cpp \
+    WebSocketLogViewer.cpp
+
+HEADERS += \
+    WebSocketLogIndex.hpp \
+    WebSocketLogViewer.hpp
+
+# Warm-start state checkpoint
+SOURCES += \
+    StateCheckpoint.cpp
+
+HEADERS += \
+    StateCheckpoint.hpp
+
+# Sub-exposure advice from preview sky background
+SOURCES += \
+    ExposureAdvisor.cpp
+
+HEADERS += \
+    ExposureAdvisor.hpp
+
+# Offline plate solving against a local star index (built with StarIndexTool.pro)
+SOURCES += \
+    StarIndex.cpp \
+    PlateSolver.cpp
+
+HEADERS += \
+    StarIndex.hpp \
+    PlateSolver.hpp
+
+# Sun, Moon and planet positions for targets and Moon avoidance
+SOURCES += \
+    Ephemeris.cpp
+
+HEADERS += \
+    Ephemeris.hpp
+
+# Live telemetry in POSIX shared memory for local co-processes
+SOURCES += \
+    TelemetryShmPublisher.cpp
+
+HEADERS += \
+    TelemetryShmPublisher.hpp \
+    origin_telemetry_shm.h
+
+unix:!macx: LIBS += -lrt
+
+# INDI protocol server for KStars/Ekos
+SOURCES += \
+    IndiServer.cpp
+
+HEADERS += \
+    IndiServer.hpp
+
+# Relay of the telescope connection to other WebSocket clients
+SOURCES += \
+    TelemetryRelay.cpp
+
+HEADERS += \
+    TelemetryRelay.hpp
+
+# Scripted command runs for the Command tab
+SOURCES += \
+    CommandScriptRunner.cpp
+
+HEADERS += \
+    CommandScriptRunner.hpp
+
+# Offset and drift of the telescope's clock
+SOURCES += \
+    ClockSync.cpp
+
+HEADERS += \
+    ClockSync.hpp
+
+# FITS output with telemetry headers
+SOURCES += \
+    FitsWriter.cpp
+
+HEADERS += \
+    FitsWriter.hpp
+
+# Sky coverage of captured frames
+SOURCES += \
+    SkyCoverageIndex.cpp
+
+HEADERS += \
+    SkyCoverageIndex.hpp
+
+# Demosaicing and colour of raw frames and previews
+SOURCES += \
+    ColorBalance.cpp \
+    Debayer.cpp
+
+HEADERS += \
+    ColorBalance.hpp \
+    Debayer.hpp \
+    SimdUtils.hpp
 
 # Default rules
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -0,0 +1,327 @@
+#include "ClockSync.hpp"
+#include "TelescopeLink.hpp"
+#include <QDebug>
+#include <cmath>
+#include <limits>
+
+namespace {
+    // Probes get SequenceIDs from here up, clear of every other sender's
+    const int FIRST_SEQUENCE_ID = 800000;
+    const qint64 PROBE_INTERVAL_MS = 2000;
+    // Probes unanswered by then are forgotten
+    const qint64 PROBE_TIMEOUT_MS = 10000;
+
+    // Bounds are intersected over this much history
+    const qint64 WINDOW_MS = 30 * 60 * 1000;
+    const int MAX_SAMPLES = 2048;
+    // Drift is only fitted over a window at least this long
+    const qint64 MIN_DRIFT_SPAN_MS = 60 * 1000;
+    // Crystal oscillators are well within this
+    const double MAX_DRIFT = 500e-6;
+    // Drifts the polygon's centroid is integrated over
+    const int CENTROID_STEPS = 64;
+    // This many contradicting stamps in a row restart the estimate
+    const int MAX_REJECTED_IN_ROW = 5;
+
+    const double INFINITE = std::numeric_limits<double>::infinity();
+}
+
+ClockSync::ClockSync(TelescopeLink *link, const QString &source, QObject *parent)
+    : QObject(parent)
+    , m_link(link)
+    , m_source(source)
+    , m_nextSequenceId(FIRST_SEQUENCE_ID)
+{
+    connect(m_link, &TelescopeLink::connected, this, &ClockSync::onConnected);
+    connect(m_link, &TelescopeLink::disconnected, this, &ClockSync::onDisconnected);
+    connect(m_link, &TelescopeLink::messageReceived, this, &ClockSync::onMessageReceived);
+    m_probeTimer.setSingleShot(true);
+    m_probeTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_probeTimer, &QTimer::timeout, this, &ClockSync::sendProbe);
+
+    if (m_link->isConnected()) onConnected();
+}
+
+void ClockSync::onConnected()
+{
+    // A new session may be talking to a scope whose clock has been re-set
+    m_samples.clear();
+    m_probes.clear();
+    m_rejectedInRow = 0;
+    m_minRoundTripMs = -1;
+    m_estimate = Estimate();
+
+    sendProbe();
+}
+
+void ClockSync::onDisconnected()
+{
+    // The estimate stays usable for what was received before
+    m_probeTimer.stop();
+    m_probes.clear();
+}
+
+void ClockSync::sendProbe()
+{
+    if (!m_link->isConnected()) return;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (auto it = m_probes.begin(); it != m_probes.end();) {
+        if (now - it.value() > PROBE_TIMEOUT_MS) {
+            it = m_probes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    QJsonObject probe;
+    probe["Command"] = "GetStatus";
+    probe["Destination"] = "Mount";
+    probe["SequenceID"] = m_nextSequenceId;
+    probe["Source"] = m_source;
+    probe["Type"] = "Command";
+
+    // Stamped before queueing: a send time that is early only loosens the bound
+    m_probes.insert(m_nextSequenceId++, QDateTime::currentMSecsSinceEpoch());
+    m_link->sendJson(probe);
+
+    scheduleProbe();
+}
+
+void ClockSync::scheduleProbe()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 sendMs = now + PROBE_INTERVAL_MS;
+
+    // A probe that reaches the scope as its seconds tick over, at the best
+    // guess of when that is, halves what is left of the doubt; probes at a
+    // steady rate would keep landing at the same point of the scope's second
+    if (m_estimate.valid) {
+        const double scopeMs = double(arrivalTimeMs(sendMs)) + offsetMs(sendMs);
+        sendMs += qint64(std::llround(std::ceil(scopeMs / 1000.0) * 1000.0 - scopeMs));
+    }
+    m_probeTimer.start(int(sendMs - now));
+}
+
+void ClockSync::onMessageReceived(const QJsonObject &obj, const QString &text, qint64 receivedMs)
+{
+    Q_UNUSED(text);
+
+    if (obj["Source"].toString() != "Mount") return;
+
+    int resolutionMs = 0;
+    const qint64 scopeMs = scopeTimeMs(obj, &resolutionMs);
+
+    Sample sample;
+    sample.hostMs = receivedMs;
+    sample.lowMs = double(scopeMs - receivedMs);
+    sample.highMs = INFINITE;
+
+    if (obj["Type"].toString() == "Response") {
+        auto it = m_probes.find(obj["SequenceID"].toInt());
+        if (it == m_probes.end()) {
+            if (scopeMs >= 0) addSample(sample);
+            return;
+        }
+        const qint64 sentMs = it.value();
+        m_probes.erase(it);
+
+        const qint64 roundTripMs = receivedMs - sentMs;
+        if (m_minRoundTripMs < 0 || roundTripMs < m_minRoundTripMs) m_minRoundTripMs = roundTripMs;
+
+        if (scopeMs >= 0) {
+            sample.hostMs = sentMs + roundTripMs / 2;
+            sample.highMs = double(scopeMs + resolutionMs - sentMs);
+            addSample(sample);
+        }
+    } else if (scopeMs >= 0) {
+        addSample(sample);
+    }
+}
+
+void ClockSync::addSample(const Sample &sample)
+{
+    m_samples.append(sample);
+
+    while (!m_samples.isEmpty()
+           && (m_samples.size() > MAX_SAMPLES || sample.hostMs - m_samples.first().hostMs > WINDOW_MS)) {
+        m_samples.removeFirst();
+    }
+
+    Estimate estimate;
+    if (!solve(&estimate)) {
+        m_samples.removeLast();
+        m_estimate.rejected++;
+        if (++m_rejectedInRow < MAX_REJECTED_IN_ROW) return;
+
+        qWarning() << "Telescope clock no longer agrees with its offset estimate, starting over";
+        const int rejected = m_estimate.rejected;
+        m_samples.clear();
+        m_samples.append(sample);
+        solve(&estimate);
+        estimate.rejected = rejected;
+    } else {
+        estimate.rejected = m_estimate.rejected;
+    }
+
+    m_rejectedInRow = 0;
+    estimate.minRoundTripMs = m_minRoundTripMs;
+    m_estimate = estimate;
+    emit estimateUpdated();
+}
+
+bool ClockSync::solve(Estimate *estimate) const
+{
+    const qint64 referenceMs = m_samples.last().hostMs;
+    bool twoSided = false;
+
+    // Tightest bounds on the offset at referenceMs for a given drift
+    auto bounds = [&](double slope, double *low, double *high) {
+        *low = -INFINITE;
+        *high = INFINITE;
+        for (const Sample &sample : m_samples) {
+            const double shift = slope * double(sample.hostMs - referenceMs);
+            *low = qMax(*low, sample.lowMs - shift);
+            *high = qMin(*high, sample.highMs - shift);
+        }
+    };
+    auto width = [&](double slope) {
+        double low, high;
+        bounds(slope, &low, &high);
+        return high - low;
+    };
+
+    for (const Sample &sample : m_samples) {
+        if (std::isfinite(sample.highMs)) {
+            twoSided = true;
+            break;
+        }
+    }
+
+    estimate->samples = m_samples.size();
+    estimate->referenceMs = referenceMs;
+    if (!twoSided) return true;
+
+    // The offsets and drifts that satisfy every bound form a convex polygon;
+    // its centroid is the estimate. The interval width is concave in the
+    // drift, so the widest is found by ternary search and the drifts that
+    // leave any interval at all form one range around it
+    double slope = 0.0;
+    double low, high;
+    if (referenceMs - m_samples.first().hostMs < MIN_DRIFT_SPAN_MS) {
+        bounds(slope, &low, &high);
+        if (high < low) return false;
+        estimate->valid = true;
+        estimate->offsetMs = (low + high) / 2.0;
+        estimate->uncertaintyMs = (high - low) / 2.0;
+        estimate->driftPpm = 0.0;
+        return true;
+    }
+
+    double left = -MAX_DRIFT;
+    double right = MAX_DRIFT;
+    for (int i = 0; i < 100 && right - left > 1e-12; i++) {
+        const double a = left + (right - left) / 3.0;
+        const double b = right - (right - left) / 3.0;
+        if (width(a) < width(b)) {
+            left = a;
+        } else {
+            right = b;
+        }
+    }
+    const double best = (left + right) / 2.0;
+    if (width(best) < 0.0) return false;
+
+    auto edge = [&](double inside, double outside) {
+        if (width(outside) >= 0.0) return outside;
+        for (int i = 0; i < 50; i++) {
+            const double middle = (inside + outside) / 2.0;
+            if (width(middle) >= 0.0) {
+                inside = middle;
+            } else {
+                outside = middle;
+            }
+        }
+        return inside;
+    };
+    const double lowestSlope = edge(best, -MAX_DRIFT);
+    const double highestSlope = edge(best, MAX_DRIFT);
+
+    double area = 0.0;
+    double slopeMoment = 0.0;
+    double offsetMoment = 0.0;
+    double lowestOffset = INFINITE;
+    double highestOffset = -INFINITE;
+    for (int i = 0; i < CENTROID_STEPS; i++) {
+        slope = lowestSlope + (highestSlope - lowestSlope) * (i + 0.5) / CENTROID_STEPS;
+        bounds(slope, &low, &high);
+        if (high < low) continue;
+        area += high - low;
+        slopeMoment += slope * (high - low);
+        offsetMoment += (low + high) / 2.0 * (high - low);
+        lowestOffset = qMin(lowestOffset, low);
+        highestOffset = qMax(highestOffset, high);
+    }
+
+    estimate->valid = true;
+    if (area > 0.0) {
+        estimate->offsetMs = offsetMoment / area;
+        estimate->driftPpm = slopeMoment / area * 1e6;
+        estimate->uncertaintyMs = (highestOffset - lowestOffset) / 2.0;
+    } else {
+        // A sliver: every bound is tight at one drift
+        bounds(best, &low, &high);
+        estimate->offsetMs = (low + high) / 2.0;
+        estimate->driftPpm = best * 1e6;
+        estimate->uncertaintyMs = 0.0;
+    }
+    return true;
+}
+
+qint64 ClockSync::scopeTimeMs(const QJsonObject &obj, int *resolutionMs)
+{
+    const QString dateText = obj["Date"].toString();
+    const QString timeText = obj["Time"].toString();
+    if (dateText.isEmpty() || timeText.isEmpty()) return -1;
+
+    // The same formats RunInitialize sets the clock with
+    const QDate date = QDate::fromString(dateText, "dd MM yyyy");
+    QTime time = QTime::fromString(timeText, "HH:mm:ss");
+    *resolutionMs = 1000;
+    if (!time.isValid()) {
+        time = QTime::fromString(timeText, "HH:mm:ss.zzz");
+        *resolutionMs = 1;
+    }
+    if (!date.isValid() || !time.isValid()) return -1;
+
+    const QString zoneId = obj["TimeZone"].toString();
+    if (zoneId != m_timeZoneId) {
+        m_timeZoneId = zoneId;
+        m_timeZone = QTimeZone(zoneId.toUtf8());
+        if (!m_timeZone.isValid()) {
+            qWarning() << "Unknown telescope time zone" << zoneId << "- taking its clock as UTC";
+            m_timeZone = QTimeZone::utc();
+        }
+    }
+
+    return QDateTime(date, time, m_timeZone).toMSecsSinceEpoch();
+}
+
+double ClockSync::offsetMs(qint64 hostMs) const
+{
+    if (!m_estimate.valid) return 0.0;
+    return m_estimate.offsetMs + m_estimate.driftPpm * 1e-6 * double(hostMs - m_estimate.referenceMs);
+}
+
+qint64 ClockSync::eventTimeMs(qint64 receivedMs)
+{
+    const qint64 oneWayMs = m_minRoundTripMs > 0 ? m_minRoundTripMs / 2 : 0;
+    m_lastEventMs = qMax(m_lastEventMs, receivedMs - oneWayMs);
+    return m_lastEventMs;
+}
+
+qint64 ClockSync::arrivalTimeMs(qint64 sentMs) const
+{
+    const qint64 oneWayMs = m_minRoundTripMs > 0 ? m_minRoundTripMs / 2 : 0;
+    return sentMs + oneWayMs;
+}
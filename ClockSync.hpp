@@ -0,0 +1,117 @@
+#pragma once
+
+#include <QDateTime>
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QTimeZone>
+#include <QTimer>
+#include <QVector>
+
+class TelescopeLink;
+
+/**
+ * @brief Estimates the offset and drift of the telescope's clock against ours
+ *
+ * The Origin stamps its Mount status with its own Date, Time and TimeZone,
+ * to the second. A GetStatus probe sent at host time t0 whose answer,
+ * stamped T, arrives at t3 bounds the offset (scope minus host) to
+ * [T - t3, T + 1 s - t0]; a notification stamped T and received at t3 only
+ * bounds it from below. Probes go out every couple of seconds, matched by
+ * SequenceID, timed to reach the scope when its seconds are estimated to
+ * tick over, and the bounds are intersected over a sliding window, so each
+ * probe cuts the remaining doubt and the offset narrows to milliseconds.
+ * Samples with long round trips only give looser bounds, so Wi-Fi jitter
+ * and queueing widen the estimate instead of biasing it.
+ *
+ * Drift is fitted over the same window: the offset is modelled as linear
+ * in host time, and the estimate is the centroid of the offsets and drifts
+ * that satisfy every bound. A stamp that contradicts the window is dropped
+ * as stale; several in a row mean the scope's clock was re-set, and the
+ * estimate starts over.
+ *
+ * The common time base is the host clock, which is assumed to be
+ * disciplined by NTP. Events the scope reports are placed at their receive
+ * time less the one-way delay, taken as half the shortest round trip seen;
+ * the scope's own one-second stamps are too coarse to place them, so the
+ * offset only times the probes and is reported, to show how far the
+ * scope's clock has wandered.
+ */
+class ClockSync : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Estimate {
+        bool valid = false;             // At least one probe answered
+        double offsetMs = 0.0;          // Scope minus host at referenceMs
+        double driftPpm = 0.0;          // Rate of the scope's clock against ours
+        double uncertaintyMs = 0.0;     // Half the range of offsets still possible
+        qint64 referenceMs = 0;         // Host time the offset applies at
+        qint64 minRoundTripMs = -1;     // Shortest probe round trip, -1 before the first
+        int samples = 0;                // Bounds in the window
+        int rejected = 0;               // Stamps that contradicted the window
+    };
+
+    /**
+     * @param link The connection to probe and listen on
+     * @param source Source field of the probes, as the link's other commands use
+     */
+    ClockSync(TelescopeLink *link, const QString &source, QObject *parent = nullptr);
+
+    Estimate estimate() const { return m_estimate; }
+    bool isValid() const { return m_estimate.valid; }
+
+    /** @brief Offset of the scope's clock from ours at a host time, in ms */
+    double offsetMs(qint64 hostMs) const;
+
+    /**
+     * @brief Host time a received message left the scope
+     *
+     * Never earlier than the previous result, so per-field telemetry
+     * histories stay ordered.
+     * @param receivedMs Receive time as stamped by the link
+     */
+    qint64 eventTimeMs(qint64 receivedMs);
+
+    /** @brief Host time a command sent at sentMs reaches the scope */
+    qint64 arrivalTimeMs(qint64 sentMs) const;
+
+signals:
+    void estimateUpdated();
+
+private:
+    struct Sample {
+        qint64 hostMs;      // Host time the bounds apply at
+        double lowMs;       // Offset lower bound
+        double highMs;      // Offset upper bound, infinite for notifications
+    };
+
+    void onConnected();
+    void onDisconnected();
+    void onMessageReceived(const QJsonObject &obj, const QString &text, qint64 receivedMs);
+    void sendProbe();
+    void scheduleProbe();
+    void addSample(const Sample &sample);
+    bool solve(Estimate *estimate) const;
+
+    /**
+     * @brief The Mount's Date, Time and TimeZone in ms since epoch
+     * @param resolutionMs Set to the precision of the stamp
+     * @return -1 if the fields are missing or malformed
+     */
+    qint64 scopeTimeMs(const QJsonObject &obj, int *resolutionMs);
+
+    TelescopeLink *m_link;
+    QString m_source;
+    QTimer m_probeTimer;
+    QHash<int, qint64> m_probes;        // SequenceID -> host send time
+    int m_nextSequenceId;
+    QVector<Sample> m_samples;          // Oldest first
+    int m_rejectedInRow = 0;
+    qint64 m_minRoundTripMs = -1;
+    Estimate m_estimate;
+    qint64 m_lastEventMs = 0;
+    QString m_timeZoneId;
+    QTimeZone m_timeZone;
+};
@@ -0,0 +1,96 @@
+#include "ColorBalance.hpp"
+#include "ParallelFor.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Roughly this many pixels are sampled for the background estimate
+    const int BACKGROUND_SAMPLES = 16384;
+
+    int median(const int histogram[256], int total)
+    {
+        int seen = 0;
+        for (int level = 0; level < 256; level++) {
+            seen += histogram[level];
+            if (2 * seen >= total) return level;
+        }
+        return 255;
+    }
+}
+
+void ColorBalance::setWhiteBalance(double red, double green, double blue)
+{
+    // Relative to green; a missing or nonsensical gain leaves its channel alone
+    double reference = green > 0.0 ? green : 1.0;
+    m_gain[0] = red > 0.0 ? red / reference : 1.0;
+    m_gain[1] = 1.0;
+    m_gain[2] = blue > 0.0 ? blue / reference : 1.0;
+}
+
+ColorBalance::Background ColorBalance::measureBackground(const QImage &image)
+{
+    Background background;
+    if (image.isNull()) return background;
+
+    int step = qMax(1, int(std::sqrt(double(image.width()) * image.height() / BACKGROUND_SAMPLES)));
+    int histogram[3][256] = {};
+    int total = 0;
+    for (int y = step / 2; y < image.height(); y += step) {
+        const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (int x = step / 2; x < image.width(); x += step) {
+            histogram[0][qRed(line[x])]++;
+            histogram[1][qGreen(line[x])]++;
+            histogram[2][qBlue(line[x])]++;
+            total++;
+        }
+    }
+
+    background.red = median(histogram[0], total);
+    background.green = median(histogram[1], total);
+    background.blue = median(histogram[2], total);
+    return background;
+}
+
+QImage ColorBalance::apply(const QImage &image) const
+{
+    if (!isActive() || image.isNull() || image.isGrayscale()) return image;
+
+    QImage result = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+
+    double gain[3] = {1.0, 1.0, 1.0};
+    if (m_whiteBalance) {
+        std::copy(m_gain, m_gain + 3, gain);
+    }
+
+    // Sky level of each channel after white balance; the darkest is the neutral target
+    double offset[3] = {0.0, 0.0, 0.0};
+    if (m_neutralize) {
+        Background background = measureBackground(result);
+        double level[3] = {background.red * gain[0], background.green * gain[1], background.blue * gain[2]};
+        double target = qMin(level[0], qMin(level[1], level[2]));
+        for (int c = 0; c < 3; c++) offset[c] = level[c] - target;
+    }
+
+    uchar lut[3][256];
+    for (int c = 0; c < 3; c++) {
+        for (int v = 0; v < 256; v++) {
+            lut[c][v] = uchar(qBound(0, int(std::lround(v * gain[c] - offset[c])), 255));
+        }
+    }
+
+    // Byte lookups do not map onto SSE2/NEON lanes; bands across cores do the work instead
+    const int width = result.width();
+    parallelFor(result.height(), [&](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            quint32 *line = reinterpret_cast<quint32*>(result.scanLine(y));
+            for (int x = 0; x < width; x++) {
+                quint32 p = line[x];
+                line[x] = (p & 0xff000000u)
+                        | (quint32(lut[0][(p >> 16) & 0xff]) << 16)
+                        | (quint32(lut[1][(p >> 8) & 0xff]) << 8)
+                        | quint32(lut[2][p & 0xff]);
+            }
+        }
+    });
+    return result;
+}
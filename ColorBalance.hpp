@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QImage>
+
+/**
+ * @brief Colour stage for previews: camera white balance and sky-glow removal
+ *
+ * White balance uses the camera's ColorRBalance/ColorGBalance/ColorBBalance
+ * gains, normalised to green. Background neutralisation measures the sky
+ * level of each channel as the median of a sparse grid of samples (stars
+ * cover too little of a frame to move it) and subtracts the excess over
+ * the darkest channel, so the sky comes out grey instead of tinted.
+ *
+ * Both are folded into one 256-entry table per channel, rebuilt for every
+ * frame, so applying them costs one lookup per component.
+ */
+class ColorBalance
+{
+public:
+    /** @brief Per-channel sky level, 0-255 */
+    struct Background {
+        int red = 0;
+        int green = 0;
+        int blue = 0;
+    };
+
+    /**
+     * @brief Set the camera's white balance gains
+     * @param red ColorRBalance
+     * @param green ColorGBalance
+     * @param blue ColorBBalance
+     */
+    void setWhiteBalance(double red, double green, double blue);
+
+    void setWhiteBalanceEnabled(bool enabled) { m_whiteBalance = enabled; }
+    void setNeutralizeBackground(bool enabled) { m_neutralize = enabled; }
+    bool isActive() const { return m_whiteBalance || m_neutralize; }
+
+    /**
+     * @brief Estimate the sky level of each channel
+     * @param image An RGB32 or ARGB32 image
+     */
+    static Background measureBackground(const QImage &image);
+
+    /**
+     * @brief Apply the colour stage
+     * @param image A colour preview; grayscale images are returned unchanged
+     * @return The balanced image in RGB32 (or ARGB32 if the input had alpha)
+     */
+    QImage apply(const QImage &image) const;
+
+private:
+    bool m_whiteBalance = true;
+    bool m_neutralize = true;
+    double m_gain[3] = {1.0, 1.0, 1.0};
+};
@@ -1,9 +1,79 @@
 #include "TelescopeGUI.hpp"
 #include "CommandInterface.hpp"
+#include <QDateTime>
+#include <QFile>
+#include <QFileDialog>
+#include <QFontDatabase>
+#include <QHeaderView>
+#include <QSplitter>
+
+namespace {
+    // Oldest history entries are dropped beyond this
+    const int MAX_HISTORY_ITEMS = 500;
+}
 
 CommandInterface::CommandInterface(TelescopeGUI *telescopeGUI, QWidget *parent) 
     : QWidget(parent), telescopeGUI(telescopeGUI) {
+    scriptRunner = new CommandScriptRunner(this);
     setupUI();
+    
+    connect(scriptRunner, &CommandScriptRunner::sendRequested, this, [this](const QJsonObject &command) {
+        if (this->telescopeGUI) this->telescopeGUI->sendJsonMessage(command);
+    });
+    
+    connect(scriptRunner, &CommandScriptRunner::stepStarted, this, [this](int index) {
+        QTreeWidgetItem *item = scriptStepsTree->topLevelItem(index);
+        if (!item) return;
+        item->setText(1, "Running...");
+        scriptStepsTree->scrollToItem(item);
+    });
+    
+    connect(scriptRunner, &CommandScriptRunner::stepFinished, this,
+            [this](int index, bool ok, const QString &result, qint64 latencyMs) {
+        QTreeWidgetItem *item = scriptStepsTree->topLevelItem(index);
+        if (!item) return;
+        item->setText(1, result);
+        item->setToolTip(1, result);
+        item->setText(2, QString("%1 ms").arg(latencyMs));
+        item->setForeground(1, ok ? palette().text() : QBrush(Qt::red));
+    });
+    
+    connect(scriptRunner, &CommandScriptRunner::finished, this, [this](bool ok, qint64 elapsedMs) {
+        runScriptButton->setEnabled(true);
+        stopScriptButton->setEnabled(false);
+        scriptEdit->setReadOnly(false);
+        scriptStatusLabel->setText(QString("%1 after %2 s")
+                                   .arg(ok ? "Completed" : "Failed")
+                                   .arg(elapsedMs / 1000.0, 0, 'f', 2));
+        scriptStatusLabel->setStyleSheet(ok ? "color: green;" : "color: red;");
+    });
+}
+
+void CommandInterface::handleMessage(const QJsonObject &obj, const QString &text, qint64 receivedMs) {
+    Q_UNUSED(text);
+    
+    scriptRunner->handleMessage(obj, receivedMs);
+    
+    if (obj["Type"].toString() != "Response") {
+        return;
+    }
+    
+    auto it = awaitingResponse.find(obj["SequenceID"].toInt());
+    if (it == awaitingResponse.end()) {
+        return;
+    }
+    
+    QListWidgetItem *item = it->first;
+    qint64 latencyMs = receivedMs - it->second;
+    awaitingResponse.erase(it);
+    
+    if (obj["ErrorCode"].toInt() != 0) {
+        item->setForeground(Qt::red);
+    }
+    
+    // Cut short in the list, whole in the tooltip
+    item->setText(QString("%1 - %2 (%3 ms)").arg(item->text(), CommandScriptRunner::summarize(obj, 200)).arg(latencyMs));
+    item->setToolTip(CommandScriptRunner::summarize(obj));
 }
 
 void CommandInterface::sendCommand() {
@@ -47,12 +117,68 @@ void CommandInterface::sendCommand() {
     // Send the command using the TelescopeGUI's method
     telescopeGUI->sendJsonMessage(jsonCommand);
     
-    // Add to command history - we'll assume it worked if we got here
+    // Add to command history; the response is filled in when it arrives
     QListWidgetItem *item = new QListWidgetItem(QString("Sent: %1 to %2").arg(command, destination));
     commandHistoryList->addItem(item);
+    awaitingResponse.insert(sequenceId, qMakePair(item, QDateTime::currentMSecsSinceEpoch()));
+    
+    while (commandHistoryList->count() > MAX_HISTORY_ITEMS) {
+        QListWidgetItem *oldest = commandHistoryList->takeItem(0);
+        for (auto it = awaitingResponse.begin(); it != awaitingResponse.end();) {
+            if (it->first == oldest) {
+                it = awaitingResponse.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        delete oldest;
+    }
     commandHistoryList->scrollToBottom();
 }
 
+void CommandInterface::runScript() {
+    if (!telescopeGUI) {
+        QMessageBox::warning(this, "Error", "Cannot run script - not properly connected to main window");
+        return;
+    }
+    
+    QString error;
+    if (!scriptRunner->load(scriptEdit->toPlainText(), &error)) {
+        QMessageBox::warning(this, "Invalid Script", error);
+        return;
+    }
+    
+    scriptStepsTree->clear();
+    for (const CommandScriptRunner::Step &step : scriptRunner->steps()) {
+        QTreeWidgetItem *item = new QTreeWidgetItem(scriptStepsTree);
+        item->setText(0, step.text);
+        item->setToolTip(0, QString("Line %1").arg(step.line));
+    }
+    
+    scriptRunner->setStopOnError(stopOnErrorCheckBox->isChecked());
+    runScriptButton->setEnabled(false);
+    stopScriptButton->setEnabled(true);
+    scriptEdit->setReadOnly(true);
+    scriptStatusLabel->setText("Running...");
+    scriptStatusLabel->setStyleSheet("");
+    scriptRunner->start();
+}
+
+void CommandInterface::loadScript() {
+    QString fileName = QFileDialog::getOpenFileName(this, "Load Command Script", QString(),
+                                                    "Scripts (*.txt *.json *.origin);;All Files (*)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+    
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QMessageBox::warning(this, "Load Failed", QString("Cannot open %1: %2").arg(fileName, file.errorString()));
+        return;
+    }
+    scriptEdit->setPlainText(QString::fromUtf8(file.readAll()));
+}
+
 void CommandInterface::setupUI() {
     QVBoxLayout *mainLayout = new QVBoxLayout(this);
     
@@ -109,5 +235,54 @@ void CommandInterface::setupUI() {
     commandHistoryList = new QListWidget(this);
     historyLayout->addWidget(commandHistoryList);
     
+    // Scripted runs
+    QGroupBox *scriptGroup = new QGroupBox("Command Script", this);
+    QVBoxLayout *scriptLayout = new QVBoxLayout(scriptGroup);
+    
+    scriptEdit = new QPlainTextEdit(this);
+    scriptEdit->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    scriptEdit->setPlaceholderText(
+        "# One step per line, or a JSON array of command objects\n"
+        "send Camera SetCaptureParameters {\"ISO\": 200, \"Exposure\": 2.0}\n"
+        "send Focuser MoveToPosition {\"Position\": 18000}\n"
+        "wait until Focuser.IsMoveToOver timeout 120\n"
+        "send Mount StartTracking\n"
+        "wait 2.5\n"
+        "sync");
+    
+    scriptStepsTree = new QTreeWidget(this);
+    scriptStepsTree->setHeaderLabels({"Step", "Result", "Latency"});
+    scriptStepsTree->setRootIsDecorated(false);
+    scriptStepsTree->header()->setSectionResizeMode(0, QHeaderView::Interactive);
+    scriptStepsTree->header()->setSectionResizeMode(1, QHeaderView::Stretch);
+    scriptStepsTree->header()->setSectionResizeMode(2, QHeaderView::ResizeToContents);
+    scriptStepsTree->setColumnWidth(0, 300);
+    
+    QSplitter *scriptSplitter = new QSplitter(Qt::Horizontal, this);
+    scriptSplitter->addWidget(scriptEdit);
+    scriptSplitter->addWidget(scriptStepsTree);
+    scriptLayout->addWidget(scriptSplitter);
+    
+    QHBoxLayout *scriptButtonLayout = new QHBoxLayout();
+    runScriptButton = new QPushButton("Run Script", this);
+    stopScriptButton = new QPushButton("Stop", this);
+    stopScriptButton->setEnabled(false);
+    QPushButton *loadScriptButton = new QPushButton("Load...", this);
+    stopOnErrorCheckBox = new QCheckBox("Stop on error", this);
+    stopOnErrorCheckBox->setChecked(true);
+    scriptStatusLabel = new QLabel(this);
+    
+    connect(runScriptButton, &QPushButton::clicked, this, &CommandInterface::runScript);
+    connect(stopScriptButton, &QPushButton::clicked, scriptRunner, &CommandScriptRunner::stop);
+    connect(loadScriptButton, &QPushButton::clicked, this, &CommandInterface::loadScript);
+    
+    scriptButtonLayout->addWidget(runScriptButton);
+    scriptButtonLayout->addWidget(stopScriptButton);
+    scriptButtonLayout->addWidget(loadScriptButton);
+    scriptButtonLayout->addWidget(stopOnErrorCheckBox);
+    scriptButtonLayout->addWidget(scriptStatusLabel, 1);
+    scriptLayout->addLayout(scriptButtonLayout);
+    
     mainLayout->addWidget(historyGroup);
+    mainLayout->addWidget(scriptGroup);
 }
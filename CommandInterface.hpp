@@ -12,13 +12,23 @@
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QMessageBox>
+#include <QHash>
+#include <QPlainTextEdit>
+#include <QCheckBox>
+#include <QTreeWidget>
+#include <QLabel>
+#include "CommandScriptRunner.hpp"
 
 /**
  * @brief Interface for sending commands to the telescope
  * 
  * This class provides a UI for sending commands to the telescope,
  * with a dropdown for selecting the command and destination,
- * and a text field for entering additional parameters.
+ * and a text field for entering additional parameters. Responses are
+ * matched to sent commands by SequenceID and shown with their latency.
+ *
+ * A script panel runs a sequence of commands with waits and conditions
+ * through CommandScriptRunner.
  */
 
 class TelescopeGUI;
@@ -34,6 +44,14 @@ public:
      */
     CommandInterface(TelescopeGUI *telescopeGUI, QWidget *parent = nullptr);
     
+    /**
+     * @brief Handle a message received from the telescope
+     * 
+     * Fills in the response of a command in the history and feeds
+     * the script runner.
+     */
+    void handleMessage(const QJsonObject &obj, const QString &text, qint64 receivedMs);
+    
 private slots:
     /**
      * @brief Slot triggered when the send button is clicked
@@ -43,6 +61,16 @@ private slots:
      */
     void sendCommand();
     
+    /**
+     * @brief Parse the script in the editor and run it
+     */
+    void runScript();
+    
+    /**
+     * @brief Load a script from a file into the editor
+     */
+    void loadScript();
+    
 private:
     /**
      * @brief Set up the UI elements
@@ -66,6 +94,28 @@ private:
     
     /** List for displaying the command history */
     QListWidget *commandHistoryList;
+    
+    /** History entries awaiting a response, by SequenceID, with the time sent */
+    QHash<int, QPair<QListWidgetItem*, qint64>> awaitingResponse;
+    
+    /** Runs the script in the editor */
+    CommandScriptRunner *scriptRunner;
+    
+    /** Editor for the script */
+    QPlainTextEdit *scriptEdit;
+    
+    /** Buttons for running and stopping the script */
+    QPushButton *runScriptButton;
+    QPushButton *stopScriptButton;
+    
+    /** Whether a failed step stops the script */
+    QCheckBox *stopOnErrorCheckBox;
+    
+    /** Steps of the running script with their results and latencies */
+    QTreeWidget *scriptStepsTree;
+    
+    /** Summary of the last script run */
+    QLabel *scriptStatusLabel;
 
     /** Whether the telescope is connected */
     TelescopeGUI *telescopeGUI;
@@ -0,0 +1,378 @@
+#include "CommandScriptRunner.hpp"
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QRegularExpression>
+
+namespace {
+    // Scripted commands use SequenceIDs from here up, clear of the GUI's own
+    const int FIRST_SEQUENCE_ID = 50000;
+    const int DEFAULT_RESPONSE_TIMEOUT_MS = 30000;
+    const int DEFAULT_CONDITION_TIMEOUT_MS = 60000;
+    const int MAX_RESULT_LENGTH = 200;
+
+    bool isTrue(const QJsonValue &value)
+    {
+        if (value.isBool()) return value.toBool();
+        if (value.isDouble()) return value.toDouble() != 0.0;
+        if (value.isString()) return !value.toString().isEmpty() && value.toString() != "false";
+        return false;
+    }
+}
+
+QString CommandScriptRunner::summarize(const QJsonObject &response, int maxLength)
+{
+    QString text;
+    const int errorCode = response["ErrorCode"].toInt();
+    if (errorCode != 0) {
+        text = QString("Error %1: %2").arg(errorCode).arg(response["ErrorMessage"].toString());
+    } else {
+        QJsonObject body = response;
+        for (const char *key : {"Command", "Destination", "SequenceID", "Source", "Type", "ErrorCode", "ErrorMessage"}) {
+            body.remove(key);
+        }
+        text = body.isEmpty() ? QString("OK")
+                              : QString::fromUtf8(QJsonDocument(body).toJson(QJsonDocument::Compact));
+    }
+    return maxLength > 0 && text.size() > maxLength ? text.left(maxLength) + "..." : text;
+}
+
+CommandScriptRunner::CommandScriptRunner(QObject *parent)
+    : QObject(parent)
+    , m_nextSequenceId(FIRST_SEQUENCE_ID)
+{
+    m_delayTimer.setSingleShot(true);
+    connect(&m_delayTimer, &QTimer::timeout, this, [this]() {
+        finishStep(m_current, true, "Waited", QDateTime::currentMSecsSinceEpoch() - m_waitStartMs);
+        m_waiting = false;
+        m_current++;
+        advance();
+    });
+
+    m_deadlineTimer.setInterval(250);
+    connect(&m_deadlineTimer, &QTimer::timeout, this, &CommandScriptRunner::checkDeadlines);
+}
+
+bool CommandScriptRunner::load(const QString &script, QString *error)
+{
+    if (m_running) {
+        *error = "A script is running";
+        return false;
+    }
+    m_steps.clear();
+
+    if (script.trimmed().startsWith('[')) {
+        QJsonParseError parseError;
+        QJsonDocument document = QJsonDocument::fromJson(script.toUtf8(), &parseError);
+        if (!document.isArray()) {
+            *error = QString("Invalid JSON script: %1 at offset %2").arg(parseError.errorString()).arg(parseError.offset);
+            return false;
+        }
+        return parseJson(document.array(), error);
+    }
+
+    const QStringList lines = script.split('\n');
+    for (int i = 0; i < lines.size(); i++) {
+        if (!parseLine(lines[i].trimmed(), i + 1, error)) return false;
+    }
+    if (m_steps.isEmpty()) {
+        *error = "The script has no steps";
+        return false;
+    }
+    return true;
+}
+
+bool CommandScriptRunner::parseLine(const QString &line, int number, QString *error)
+{
+    if (line.isEmpty() || line.startsWith('#')) return true;
+
+    static const QRegularExpression sendPattern("^send\\s+(\\S+)\\s+(\\S+)(?:\\s+(\\{.*\\}))?$",
+                                                QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression waitUntilPattern(
+        "^wait\\s+until\\s+([\\w.]+)(?:\\s*(==|!=|<=|>=|<|>)\\s*(\"[^\"]*\"|\\S+))?(?:\\s+timeout\\s+([\\d.]+))?$",
+        QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression waitPattern("^wait\\s+([\\d.]+)$", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression syncPattern("^sync$", QRegularExpression::CaseInsensitiveOption);
+
+    Step step;
+    step.line = number;
+    step.text = line;
+
+    QRegularExpressionMatch match;
+    if ((match = sendPattern.match(line)).hasMatch()) {
+        step.kind = Step::Send;
+        step.command["Destination"] = match.captured(1);
+        step.command["Command"] = match.captured(2);
+        if (!match.captured(3).isEmpty()) {
+            QJsonDocument parameters = QJsonDocument::fromJson(match.captured(3).toUtf8());
+            if (!parameters.isObject()) {
+                *error = QString("Line %1: parameters must be a JSON object").arg(number);
+                return false;
+            }
+            const QJsonObject object = parameters.object();
+            for (auto it = object.begin(); it != object.end(); ++it) {
+                step.command[it.key()] = it.value();
+            }
+        }
+        step.command["Source"] = "QtApp";
+        step.command["Type"] = "Command";
+        step.timeoutMs = DEFAULT_RESPONSE_TIMEOUT_MS;
+    } else if ((match = waitUntilPattern.match(line)).hasMatch()) {
+        step.kind = Step::WaitUntil;
+        step.field = match.captured(1);
+        step.op = match.captured(2);
+        step.value = parseValue(match.captured(3));
+        step.timeoutMs = match.captured(4).isEmpty() ? DEFAULT_CONDITION_TIMEOUT_MS
+                                                     : int(match.captured(4).toDouble() * 1000.0);
+    } else if ((match = waitPattern.match(line)).hasMatch()) {
+        step.kind = Step::Delay;
+        step.delayMs = int(match.captured(1).toDouble() * 1000.0);
+    } else if (syncPattern.match(line).hasMatch()) {
+        step.kind = Step::Sync;
+    } else {
+        *error = QString("Line %1: expected send, wait, wait until or sync: %2").arg(number).arg(line);
+        return false;
+    }
+
+    m_steps.append(step);
+    return true;
+}
+
+bool CommandScriptRunner::parseJson(const QJsonArray &array, QString *error)
+{
+    for (int i = 0; i < array.size(); i++) {
+        if (!array[i].isObject()) {
+            *error = QString("Step %1 is not an object").arg(i + 1);
+            return false;
+        }
+        const QJsonObject object = array[i].toObject();
+
+        Step step;
+        step.line = i + 1;
+        step.text = QString::fromUtf8(QJsonDocument(object).toJson(QJsonDocument::Compact));
+
+        if (object.contains("Command")) {
+            step.kind = Step::Send;
+            step.command = object;
+            if (!step.command.contains("Source")) step.command["Source"] = "QtApp";
+            if (!step.command.contains("Type")) step.command["Type"] = "Command";
+            step.timeoutMs = object.contains("Timeout") ? int(object["Timeout"].toDouble() * 1000.0)
+                                                        : DEFAULT_RESPONSE_TIMEOUT_MS;
+            step.command.remove("Timeout");
+        } else if (object.contains("WaitUntil")) {
+            step.kind = Step::WaitUntil;
+            step.field = object["WaitUntil"].toString();
+            step.op = object["Op"].toString(object.contains("Value") ? "==" : QString());
+            step.value = object["Value"];
+            step.timeoutMs = object.contains("Timeout") ? int(object["Timeout"].toDouble() * 1000.0)
+                                                        : DEFAULT_CONDITION_TIMEOUT_MS;
+        } else if (object.contains("Wait")) {
+            step.kind = Step::Delay;
+            step.delayMs = int(object["Wait"].toDouble() * 1000.0);
+        } else if (object.contains("Sync")) {
+            step.kind = Step::Sync;
+        } else {
+            *error = QString("Step %1: expected Command, Wait, WaitUntil or Sync").arg(i + 1);
+            return false;
+        }
+        m_steps.append(step);
+    }
+
+    if (m_steps.isEmpty()) {
+        *error = "The script has no steps";
+        return false;
+    }
+    return true;
+}
+
+QJsonValue CommandScriptRunner::parseValue(const QString &text)
+{
+    if (text.isEmpty()) return QJsonValue();
+    if (text.compare("true", Qt::CaseInsensitive) == 0) return true;
+    if (text.compare("false", Qt::CaseInsensitive) == 0) return false;
+
+    bool ok = false;
+    double number = text.toDouble(&ok);
+    if (ok) return number;
+
+    if (text.size() >= 2 && text.startsWith('"') && text.endsWith('"')) return text.mid(1, text.size() - 2);
+    return text;
+}
+
+void CommandScriptRunner::start()
+{
+    if (m_running || m_steps.isEmpty()) return;
+
+    m_running = true;
+    m_failed = false;
+    m_current = 0;
+    m_waiting = false;
+    m_inFlight.clear();
+    m_elapsed.start();
+    m_deadlineTimer.start();
+    advance();
+}
+
+void CommandScriptRunner::stop()
+{
+    if (m_running) finish(false);
+}
+
+void CommandScriptRunner::advance()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    while (m_running && m_current < m_steps.size()) {
+        const Step &step = m_steps[m_current];
+
+        if (step.kind == Step::Send) {
+            // Not waiting for the response: the next send goes out straight away
+            QJsonObject command = step.command;
+            const int sequenceId = m_nextSequenceId++;
+            command["SequenceID"] = sequenceId;
+            m_inFlight.insert(sequenceId, InFlight{m_current, now});
+            emit stepStarted(m_current);
+            emit sendRequested(command);
+            m_current++;
+            continue;
+        }
+
+        // Barriers: everything sent so far has to be answered first
+        if (!m_waiting) {
+            m_waiting = true;
+            m_waitStartMs = now;
+            m_conditionAfter = m_messageCount;
+            emit stepStarted(m_current);
+        }
+        if (!m_inFlight.isEmpty()) return;
+
+        if (step.kind == Step::Delay) {
+            if (!m_delayTimer.isActive()) m_delayTimer.start(step.delayMs);
+            return;
+        }
+        if (step.kind == Step::WaitUntil && !conditionHolds(step)) {
+            return;  // Re-tested as messages arrive
+        }
+
+        finishStep(m_current, true, step.kind == Step::Sync ? QString("All answered") : QString("Condition met"),
+                   now - m_waitStartMs);
+        m_waiting = false;
+        m_current++;
+    }
+
+    if (m_running && m_current >= m_steps.size() && m_inFlight.isEmpty()) {
+        finish(!m_failed);
+    }
+}
+
+void CommandScriptRunner::handleMessage(const QJsonObject &obj, qint64 receivedMs)
+{
+    // Every field is kept, numbered by message so conditions can ignore stale ones
+    const QString source = obj["Source"].toString();
+    m_messageCount++;
+    for (auto it = obj.begin(); it != obj.end(); ++it) {
+        const Observed observed{it.value(), m_messageCount};
+        m_state.insert(it.key(), observed);
+        if (!source.isEmpty()) m_state.insert(source + "." + it.key(), observed);
+    }
+
+    if (!m_running) return;
+
+    if (obj["Type"].toString() == "Response") {
+        auto it = m_inFlight.find(obj["SequenceID"].toInt());
+        if (it != m_inFlight.end()) {
+            const InFlight inFlight = it.value();
+            m_inFlight.erase(it);
+            // What the barrier waits for has only just been answered
+            if (m_waiting) m_conditionAfter = m_messageCount;
+
+            const bool ok = obj["ErrorCode"].toInt() == 0;
+            finishStep(inFlight.step, ok, summarize(obj, MAX_RESULT_LENGTH), receivedMs - inFlight.sentMs);
+            if (!ok && m_stopOnError) {
+                finish(false);
+                return;
+            }
+        }
+    }
+
+    advance();
+}
+
+bool CommandScriptRunner::conditionHolds(const Step &step) const
+{
+    auto it = m_state.constFind(step.field);
+    if (it == m_state.constEnd() || it->message <= m_conditionAfter) return false;
+    const QJsonValue actual = it->value;
+
+    if (step.op.isEmpty()) return isTrue(actual);
+
+    if (step.value.isBool()) {
+        bool equal = isTrue(actual) == step.value.toBool();
+        return step.op == "!=" ? !equal : (step.op == "==" && equal);
+    }
+
+    if (step.value.isDouble() && actual.isDouble()) {
+        const double a = actual.toDouble();
+        const double b = step.value.toDouble();
+        if (step.op == "==") return a == b;
+        if (step.op == "!=") return a != b;
+        if (step.op == "<") return a < b;
+        if (step.op == "<=") return a <= b;
+        if (step.op == ">") return a > b;
+        if (step.op == ">=") return a >= b;
+        return false;
+    }
+
+    const QString a = actual.toVariant().toString();
+    const QString b = step.value.toVariant().toString();
+    if (step.op == "==") return a == b;
+    if (step.op == "!=") return a != b;
+    return false;
+}
+
+void CommandScriptRunner::finishStep(int index, bool ok, const QString &result, qint64 latencyMs)
+{
+    if (!ok) m_failed = true;
+    emit stepFinished(index, ok, result, latencyMs);
+}
+
+void CommandScriptRunner::checkDeadlines()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    for (auto it = m_inFlight.begin(); it != m_inFlight.end();) {
+        const Step &step = m_steps[it->step];
+        if (now - it->sentMs <= step.timeoutMs) {
+            ++it;
+            continue;
+        }
+        finishStep(it->step, false, "No response", now - it->sentMs);
+        it = m_inFlight.erase(it);
+        if (m_stopOnError) {
+            finish(false);
+            return;
+        }
+    }
+
+    if (m_waiting && m_current < m_steps.size() && m_steps[m_current].kind == Step::WaitUntil
+        && now - m_waitStartMs > m_steps[m_current].timeoutMs) {
+        finishStep(m_current, false, "Timed out", now - m_waitStartMs);
+        if (m_stopOnError) {
+            finish(false);
+            return;
+        }
+        m_waiting = false;
+        m_current++;
+    }
+
+    advance();
+}
+
+void CommandScriptRunner::finish(bool ok)
+{
+    m_running = false;
+    m_waiting = false;
+    m_delayTimer.stop();
+    m_deadlineTimer.stop();
+    m_inFlight.clear();
+    emit finished(ok, m_elapsed.elapsed());
+}
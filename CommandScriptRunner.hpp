@@ -0,0 +1,135 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+/**
+ * @brief Runs scripts of Origin commands with waits and conditions
+ *
+ * A script is either line based:
+ *
+ *     # Set up the camera, focus, then start tracking
+ *     send Camera SetCaptureParameters {"ISO": 200, "Exposure": 2.0}
+ *     send Focuser MoveToPosition {"Position": 18000}
+ *     wait until Focuser.IsMoveToOver timeout 120
+ *     send Mount StartTracking
+ *     wait 2.5
+ *     sync
+ *
+ * or a JSON array of the same steps: command objects as the Command tab
+ * sends them, {"Wait": 2.5}, {"Sync": true} and
+ * {"WaitUntil": "Mount.IsGotoOver", "Op": "==", "Value": true, "Timeout": 60}.
+ *
+ * Consecutive sends are pipelined: each goes out as soon as the previous
+ * one has been sent, and responses are matched by SequenceID as they come
+ * back. Waits, conditions and sync are barriers that first wait for every
+ * outstanding response. A condition is tested against the latest value of
+ * a field from any message, as Source.Field or just Field, and is
+ * re-tested as messages arrive. Only values received after the barrier
+ * began and after the responses it waited for count, so a field cached
+ * from before a move cannot satisfy the wait for that move.
+ *
+ * Every step reports its latency: send to matched response for commands,
+ * elapsed time for waits. An error response or a timeout fails the step
+ * and, unless told otherwise, stops the script.
+ */
+class CommandScriptRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Step {
+        enum Kind {
+            Send,
+            Sync,
+            Delay,
+            WaitUntil
+        };
+
+        Kind kind = Send;
+        int line = 0;
+        QString text;               // As shown to the user
+        QJsonObject command;        // Send
+        int delayMs = 0;            // Delay
+        QString field;              // WaitUntil
+        QString op;                 // Empty to test the field for truth
+        QJsonValue value;
+        int timeoutMs = 0;          // WaitUntil and Send
+    };
+
+    explicit CommandScriptRunner(QObject *parent = nullptr);
+
+    /**
+     * @brief Parse a script, replacing any loaded one
+     * @param error Set to a message naming the offending line on failure
+     */
+    bool load(const QString &script, QString *error);
+
+    const QVector<Step> &steps() const { return m_steps; }
+
+    void setStopOnError(bool stop) { m_stopOnError = stop; }
+
+    void start();
+    void stop();
+    bool isRunning() const { return m_running; }
+
+    /** @brief Feed every message received from the telescope */
+    void handleMessage(const QJsonObject &obj, qint64 receivedMs);
+
+    /**
+     * @brief A response as one line: its body without the envelope, "OK" if empty, or its error
+     * @param maxLength Longer text is cut and ends in "...", 0 for no limit
+     */
+    static QString summarize(const QJsonObject &response, int maxLength = 0);
+
+signals:
+    /** @brief A command for the telescope, with its SequenceID filled in */
+    void sendRequested(const QJsonObject &command);
+
+    void stepStarted(int index);
+    void stepFinished(int index, bool ok, const QString &result, qint64 latencyMs);
+    void finished(bool ok, qint64 elapsedMs);
+
+private:
+    struct InFlight {
+        int step;
+        qint64 sentMs;
+    };
+
+    bool parseLine(const QString &line, int number, QString *error);
+    bool parseJson(const QJsonArray &array, QString *error);
+    static QJsonValue parseValue(const QString &text);
+
+    void advance();
+    bool conditionHolds(const Step &step) const;
+    void finishStep(int index, bool ok, const QString &result, qint64 latencyMs);
+    void checkDeadlines();
+    void finish(bool ok);
+
+    QVector<Step> m_steps;
+    bool m_stopOnError = true;
+
+    bool m_running = false;
+    bool m_failed = false;
+    int m_current = 0;
+    bool m_waiting = false;                 // The current barrier step has started
+    qint64 m_waitStartMs = 0;
+    QHash<int, InFlight> m_inFlight;        // By SequenceID
+    int m_nextSequenceId;
+    struct Observed {
+        QJsonValue value;
+        qint64 message = 0;                 // Index of the message it came in
+    };
+    QHash<QString, Observed> m_state;       // Latest value per Source.Field and Field
+    qint64 m_messageCount = 0;
+    qint64 m_conditionAfter = 0;            // Conditions only see later messages
+    QTimer m_delayTimer;
+    QTimer m_deadlineTimer;
+    QElapsedTimer m_elapsed;
+};
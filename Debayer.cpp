@@ -0,0 +1,229 @@
+#include "Debayer.hpp"
+#include "ParallelFor.hpp"
+#include "SimdUtils.hpp"
+#include <QDebug>
+#include <algorithm>
+#include <vector>
+
+namespace {
+    // Two pixels of border on every side, reflected so the CFA phase is preserved
+    const int BORDER = 2;
+
+    struct Padded {
+        int width;
+        int height;
+        qsizetype stride;
+        std::vector<quint16> pixels;
+
+        Padded(int w, int h)
+            : width(w), height(h), stride(w + 2 * BORDER), pixels(size_t(stride) * (h + 2 * BORDER))
+        {
+        }
+
+        /** Row y of the image (y may reach into the border), pointing at column 0 */
+        quint16 *row(int y) { return pixels.data() + (y + BORDER) * stride + BORDER; }
+        const quint16 *row(int y) const { return pixels.data() + (y + BORDER) * stride + BORDER; }
+
+        /** Fill the left and right borders of rows [begin, end) */
+        void reflectColumns(int begin, int end)
+        {
+            for (int y = begin; y < end; y++) {
+                quint16 *r = row(y);
+                for (int i = 1; i <= BORDER; i++) {
+                    r[-i] = r[i];
+                    r[width - 1 + i] = r[width - 1 - i];
+                }
+            }
+        }
+
+        /** Fill the top and bottom border rows; call once every row has its side borders */
+        void reflectRows()
+        {
+            for (int i = 1; i <= BORDER; i++) {
+                std::copy(row(i) - BORDER, row(i) - BORDER + stride, row(-i) - BORDER);
+                std::copy(row(height - 1 - i) - BORDER, row(height - 1 - i) - BORDER + stride,
+                          row(height - 1 + i) - BORDER);
+            }
+        }
+    };
+
+    inline quint16 clamp16(int value)
+    {
+        return quint16(qBound(0, value, 65535));
+    }
+
+    inline void put(quint16 *out, int x, quint16 r, quint16 g, quint16 b)
+    {
+        out[4 * x] = r;
+        out[4 * x + 1] = g;
+        out[4 * x + 2] = b;
+        out[4 * x + 3] = 0xffff;
+    }
+
+    void bilinear(const Padded &src, int redX, int redY, quint16 *rgb, qsizetype rgbStride)
+    {
+        const int width = src.width;
+        parallelFor(src.height, [&](int begin, int end) {
+            // Whole-row averages; each output pixel then just picks from them
+            std::vector<quint16> scratch(size_t(width) * 5);
+            quint16 *h = scratch.data();            // left/right
+            quint16 *v = h + width;                 // up/down
+            quint16 *dg = v + width;                // four diagonals
+            quint16 *cr = dg + width;               // four orthogonal neighbours
+            quint16 *tmp = cr + width;
+
+            for (int y = begin; y < end; y++) {
+                const quint16 *u = src.row(y - 1);
+                const quint16 *c = src.row(y);
+                const quint16 *d = src.row(y + 1);
+
+                SimdUtils::average(c - 1, c + 1, h, width);
+                SimdUtils::average(u, d, v, width);
+                SimdUtils::average(u - 1, u + 1, dg, width);
+                SimdUtils::average(d - 1, d + 1, tmp, width);
+                SimdUtils::average(dg, tmp, dg, width);
+                SimdUtils::average(h, v, cr, width);
+
+                quint16 *out = rgb + y * rgbStride;
+                if ((y & 1) == redY) {
+                    for (int x = 0; x < width; x++) {
+                        if ((x & 1) == redX) put(out, x, c[x], cr[x], dg[x]);
+                        else put(out, x, h[x], c[x], v[x]);
+                    }
+                } else {
+                    for (int x = 0; x < width; x++) {
+                        if ((x & 1) != redX) put(out, x, dg[x], cr[x], c[x]);
+                        else put(out, x, v[x], c[x], h[x]);
+                    }
+                }
+            }
+        });
+    }
+
+    void edgeAware(const Padded &src, int redX, int redY, quint16 *rgb, qsizetype rgbStride)
+    {
+        const int width = src.width;
+        const int height = src.height;
+
+        // Green everywhere, interpolated along the smoother direction
+        Padded green(width, height);
+        parallelFor(height, [&](int begin, int end) {
+            for (int y = begin; y < end; y++) {
+                const quint16 *uu = src.row(y - 2);
+                const quint16 *u = src.row(y - 1);
+                const quint16 *c = src.row(y);
+                const quint16 *d = src.row(y + 1);
+                const quint16 *dd = src.row(y + 2);
+                quint16 *g = green.row(y);
+
+                // Green sites alternate with red or blue on every row
+                int firstGreen = ((y & 1) == redY) ? (redX ^ 1) : redX;
+                for (int x = 0; x < width; x++) {
+                    if ((x & 1) == firstGreen) {
+                        g[x] = c[x];
+                        continue;
+                    }
+                    int laplaceH = 2 * c[x] - c[x - 2] - c[x + 2];
+                    int laplaceV = 2 * c[x] - uu[x] - dd[x];
+                    int gradH = qAbs(c[x - 1] - c[x + 1]) + qAbs(laplaceH);
+                    int gradV = qAbs(u[x] - d[x]) + qAbs(laplaceV);
+                    int estH = 2 * (c[x - 1] + c[x + 1]) + laplaceH;   // 4x
+                    int estV = 2 * (u[x] + d[x]) + laplaceV;
+                    int est = gradH < gradV ? estH : gradV < gradH ? estV : (estH + estV) / 2;
+                    g[x] = clamp16(est / 4);
+                }
+            }
+            green.reflectColumns(begin, end);
+        });
+        green.reflectRows();
+
+        // Red and blue from the colour difference to green at their neighbours
+        parallelFor(height, [&](int begin, int end) {
+            for (int y = begin; y < end; y++) {
+                const quint16 *u = src.row(y - 1);
+                const quint16 *c = src.row(y);
+                const quint16 *d = src.row(y + 1);
+                const quint16 *gu = green.row(y - 1);
+                const quint16 *g = green.row(y);
+                const quint16 *gd = green.row(y + 1);
+                quint16 *out = rgb + y * rgbStride;
+
+                auto across = [&](int x) { return (c[x - 1] - g[x - 1] + c[x + 1] - g[x + 1]) / 2; };
+                auto vertical = [&](int x) { return (u[x] - gu[x] + d[x] - gd[x]) / 2; };
+                auto diagonal = [&](int x) {
+                    return (u[x - 1] - gu[x - 1] + u[x + 1] - gu[x + 1] + d[x - 1] - gd[x - 1] + d[x + 1] - gd[x + 1]) / 4;
+                };
+
+                bool redRow = (y & 1) == redY;
+                for (int x = 0; x < width; x++) {
+                    bool redColumn = (x & 1) == redX;
+                    if (redRow && redColumn) {
+                        put(out, x, c[x], g[x], clamp16(g[x] + diagonal(x)));
+                    } else if (!redRow && !redColumn) {
+                        put(out, x, clamp16(g[x] + diagonal(x)), g[x], c[x]);
+                    } else if (redRow) {
+                        put(out, x, clamp16(g[x] + across(x)), g[x], clamp16(g[x] + vertical(x)));
+                    } else {
+                        put(out, x, clamp16(g[x] + vertical(x)), g[x], clamp16(g[x] + across(x)));
+                    }
+                }
+            }
+        });
+    }
+}
+
+QString Debayer::patternName(Pattern pattern)
+{
+    switch (pattern) {
+    case RGGB: return "RGGB";
+    case BGGR: return "BGGR";
+    case GRBG: return "GRBG";
+    default: return "GBRG";
+    }
+}
+
+void Debayer::demosaic(const quint16 *mosaic, int width, int height, qsizetype stride,
+                       Pattern pattern, Method method, quint16 *rgb, qsizetype rgbStride)
+{
+    if (width < 4 || height < 4) {
+        qWarning() << "Mosaic too small to demosaic:" << width << "x" << height;
+        return;
+    }
+
+    // Position of red in the 2x2 cell; blue is diagonally opposite
+    int redX = (pattern == GRBG || pattern == BGGR) ? 1 : 0;
+    int redY = (pattern == GBRG || pattern == BGGR) ? 1 : 0;
+
+    Padded src(width, height);
+    parallelFor(height, [&](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            const quint16 *in = mosaic + y * stride;
+            std::copy(in, in + width, src.row(y));
+        }
+        src.reflectColumns(begin, end);
+    });
+    src.reflectRows();
+
+    if (method == EdgeAware) {
+        edgeAware(src, redX, redY, rgb, rgbStride);
+    } else {
+        bilinear(src, redX, redY, rgb, rgbStride);
+    }
+}
+
+QImage Debayer::demosaic(const QImage &mosaic, Pattern pattern, Method method)
+{
+    QImage gray = mosaic;
+    if (gray.format() == QImage::Format_Grayscale8) {
+        gray = gray.convertToFormat(QImage::Format_Grayscale16);
+    }
+    if (gray.format() != QImage::Format_Grayscale16 || gray.width() < 4 || gray.height() < 4) {
+        return QImage();
+    }
+
+    QImage result(gray.width(), gray.height(), QImage::Format_RGBX64);
+    demosaic(reinterpret_cast<const quint16*>(gray.constBits()), gray.width(), gray.height(),
+             gray.bytesPerLine() / 2, pattern, method,
+             reinterpret_cast<quint16*>(result.bits()), result.bytesPerLine() / 2);
+    return result;
+}
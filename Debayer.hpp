@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QImage>
+#include <QString>
+
+/**
+ * @brief Demosaicing of raw colour subframes
+ *
+ * The Origin's sensor delivers a Bayer mosaic; this turns it into 16-bit
+ * RGB. Rows are split into bands across the global thread pool.
+ *
+ * Bilinear averages the nearest samples of each missing colour, built
+ * from whole-row SIMD averages. EdgeAware interpolates green along
+ * whichever of the horizontal or vertical direction has the smaller
+ * gradient (Hamilton-Adams), then fills red and blue from colour
+ * differences against green. That avoids most of the zipper artefacts
+ * bilinear leaves on star edges. Its direction is chosen per pixel, so it
+ * is scalar code and costs a few times as much as Bilinear per band.
+ */
+class Debayer
+{
+public:
+    /** @brief Colour of the top-left 2x2 cell, read row by row */
+    enum Pattern {
+        RGGB,
+        BGGR,
+        GRBG,
+        GBRG
+    };
+
+    enum Method {
+        Bilinear,
+        EdgeAware
+    };
+
+    /** @brief Pattern name as used in FITS BAYERPAT headers */
+    static QString patternName(Pattern pattern);
+
+    /**
+     * @brief Demosaic a mosaic image
+     * @param mosaic A Grayscale16 (or Grayscale8) mosaic at least 4x4 pixels
+     * @param pattern The CFA phase of the top-left pixel
+     * @param method The interpolation
+     * @return An RGBX64 image of the same size, or a null image if the input is not a mosaic
+     */
+    static QImage demosaic(const QImage &mosaic, Pattern pattern, Method method = Bilinear);
+
+    /**
+     * @brief Demosaic raw pixels
+     * @param mosaic First pixel of the mosaic
+     * @param width Width in pixels, at least 4
+     * @param height Height in pixels, at least 4
+     * @param stride Distance between rows of the mosaic, in pixels
+     * @param pattern The CFA phase of the top-left pixel
+     * @param method The interpolation
+     * @param rgb Output, four 16-bit components per pixel (R, G, B, 0xffff) as in QImage::Format_RGBX64
+     * @param rgbStride Distance between output rows, in 16-bit components
+     */
+    static void demosaic(const quint16 *mosaic, int width, int height, qsizetype stride,
+                         Pattern pattern, Method method, quint16 *rgb, qsizetype rgbStride);
+};
@@ -0,0 +1,334 @@
+#include "Ephemeris.hpp"
+#include <cmath>
+
+namespace {
+    const double DEGREES = M_PI / 180.0;
+    const double OBLIQUITY_J2000 = 23.4392911 * DEGREES;
+    const double KM_PER_AU = 149597870.7;
+    const double EARTH_RADIUS_AU = 6378.137 / KM_PER_AU;
+    const double LIGHT_DAYS_PER_AU = 0.0057755183;
+    const qint64 DAY_MS = 86400000;
+
+    double julianDay(qint64 ms)
+    {
+        return 2440587.5 + ms / double(DAY_MS);
+    }
+
+    /**
+     * Keplerian elements and their rates per Julian century, J2000 ecliptic
+     * (Standish, "Approximate Positions of the Planets", table 1, 1800-2050):
+     * a (AU), e, I, L, longitude of perihelion, longitude of node (degrees)
+     */
+    struct Elements {
+        double a, e, i, l, perihelion, node;
+        double aRate, eRate, iRate, lRate, perihelionRate, nodeRate;
+    };
+
+    const Elements EARTH_MOON = {
+        1.00000261, 0.01671123, -0.00001531, 100.46457166, 102.93768193, 0.0,
+        0.00000562, -0.00004392, -0.01294668, 35999.37244981, 0.32327364, 0.0
+    };
+
+    // Mercury to Neptune, in Ephemeris::Body order
+    const Elements PLANETS[] = {
+        {0.38709927, 0.20563593, 7.00497902, 252.25032350, 77.45779628, 48.33076593,
+         0.00000037, 0.00001906, -0.00594749, 149472.67411175, 0.16047689, -0.12534081},
+        {0.72333566, 0.00677672, 3.39467605, 181.97909950, 131.60246718, 76.67984255,
+         0.00000390, -0.00004107, -0.00078890, 58517.81538729, 0.00268329, -0.27769418},
+        {1.52371034, 0.09339410, 1.84969142, -4.55343205, -23.94362959, 49.55953891,
+         0.00001847, 0.00007882, -0.00813131, 19140.30268499, 0.44441088, -0.29257343},
+        {5.20288700, 0.04838624, 1.30439695, 34.39644051, 14.72847983, 100.47390909,
+         -0.00011607, -0.00013253, -0.00183714, 3034.74612775, 0.21252668, 0.20469106},
+        {9.53667594, 0.05386179, 2.48599187, 49.95424423, 92.59887831, 113.66242448,
+         -0.00125060, -0.00050991, 0.00193609, 1222.49362201, -0.41897216, -0.28867794},
+        {19.18916464, 0.04725744, 0.77263783, 313.23810451, 170.95427630, 74.01692503,
+         -0.00196176, -0.00004397, -0.00242939, 428.48202785, 0.40805281, 0.04240589},
+        {30.06992276, 0.00859048, 1.77004347, -55.12002969, 44.96476227, 131.78422574,
+         0.00026291, 0.00005105, 0.00035372, 218.45945325, -0.32241464, -0.00508664}
+    };
+
+    /**
+     * Principal periodic terms of the Moon's longitude (1e-6 degree) and
+     * distance (1e-3 km), Meeus, Astronomical Algorithms, table 47.A:
+     * multiples of D, M, M', F
+     */
+    struct LunarTerm {
+        qint8 d, m, mp, f;
+        int longitude;
+        int distance;
+    };
+
+    const LunarTerm LONGITUDE_DISTANCE[] = {
+        {0, 0, 1, 0, 6288774, -20905355},
+        {2, 0, -1, 0, 1274027, -3699111},
+        {2, 0, 0, 0, 658314, -2955968},
+        {0, 0, 2, 0, 213618, -569925},
+        {0, 1, 0, 0, -185116, 48888},
+        {0, 0, 0, 2, -114332, -3149},
+        {2, 0, -2, 0, 58793, 246158},
+        {2, -1, -1, 0, 57066, -152138},
+        {2, 0, 1, 0, 53322, -170733},
+        {2, -1, 0, 0, 45758, -204586},
+        {0, 1, -1, 0, -40923, -129620},
+        {1, 0, 0, 0, -34720, 108743},
+        {0, 1, 1, 0, -30383, 104755},
+        {2, 0, 0, -2, 15327, 10321},
+        {0, 0, 1, 2, -12528, 0},
+        {0, 0, 1, -2, 10980, 79661},
+        {4, 0, -1, 0, 10675, -34782},
+        {0, 0, 3, 0, 10034, -23210},
+        {4, 0, -2, 0, 8548, -21636},
+        {2, 1, -1, 0, -7888, 24208},
+        {2, 1, 0, 0, -6766, 30824},
+        {1, 0, -1, 0, -5163, -8379},
+        {1, 1, 0, 0, 4987, -16675},
+        {2, -1, 1, 0, 4036, -12831},
+        {2, 0, 2, 0, 3994, -10445},
+        {4, 0, 0, 0, 3861, -11650},
+        {2, 0, -3, 0, 3665, 14403},
+        {0, 1, -2, 0, -2689, -7003},
+        {2, 0, -1, 2, -2602, 0},
+        {2, -1, -2, 0, 2390, 10056},
+        {1, 0, 1, 0, -2348, 6322},
+        {2, -2, 0, 0, 2236, -9884},
+        {0, 1, 2, 0, -2120, 5751},
+        {0, 2, 0, 0, -2069, 0}
+    };
+
+    // The Moon's latitude (1e-6 degree), Meeus table 47.B
+    const LunarTerm LATITUDE[] = {
+        {0, 0, 0, 1, 5128122, 0},
+        {0, 0, 1, 1, 280602, 0},
+        {0, 0, 1, -1, 277693, 0},
+        {2, 0, 0, -1, 173237, 0},
+        {2, 0, -1, 1, 55413, 0},
+        {2, 0, -1, -1, 46271, 0},
+        {2, 0, 0, 1, 32573, 0},
+        {0, 0, 2, 1, 17198, 0},
+        {2, 0, 1, -1, 9266, 0},
+        {0, 0, 2, -1, 8822, 0},
+        {2, -1, 0, -1, 8216, 0},
+        {2, 0, -2, -1, 4324, 0},
+        {2, 0, 1, 1, 4200, 0},
+        {2, 1, 0, -1, -3359, 0},
+        {2, -1, -1, 1, 2463, 0},
+        {2, -1, 0, 1, 2211, 0},
+        {2, -1, -1, -1, 2065, 0},
+        {0, 1, -1, -1, -1870, 0},
+        {4, 0, -1, -1, 1828, 0},
+        {0, 1, 0, 1, -1794, 0},
+        {0, 0, 0, 3, -1749, 0},
+        {0, 1, -1, 1, -1565, 0},
+        {1, 0, 0, 1, -1491, 0},
+        {0, 1, 1, 1, -1475, 0},
+        {0, 1, 1, -1, -1410, 0},
+        {0, 1, 0, -1, -1344, 0},
+        {1, 0, 0, -1, -1335, 0},
+        {0, 0, 3, 1, 1107, 0}
+    };
+
+    double degrees(double base, double rate, double t)
+    {
+        return std::fmod(base + rate * t, 360.0) * DEGREES;
+    }
+
+    // Heliocentric position in the J2000 ecliptic frame, AU
+    void heliocentric(const Elements &el, double t, double &x, double &y, double &z)
+    {
+        const double a = el.a + el.aRate * t;
+        const double e = el.e + el.eRate * t;
+        const double i = (el.i + el.iRate * t) * DEGREES;
+        const double perihelion = (el.perihelion + el.perihelionRate * t) * DEGREES;
+        const double node = (el.node + el.nodeRate * t) * DEGREES;
+        const double omega = perihelion - node;
+        double m = std::remainder(degrees(el.l, el.lRate, t) - perihelion, 2 * M_PI);
+
+        // Kepler's equation by Newton's method; e is small for every planet
+        double anomaly = m + e * std::sin(m);
+        for (int k = 0; k < 5; k++) {
+            anomaly -= (anomaly - e * std::sin(anomaly) - m) / (1.0 - e * std::cos(anomaly));
+        }
+        const double px = a * (std::cos(anomaly) - e);
+        const double py = a * std::sqrt(1.0 - e * e) * std::sin(anomaly);
+
+        const double cw = std::cos(omega), sw = std::sin(omega);
+        const double cn = std::cos(node), sn = std::sin(node);
+        const double ci = std::cos(i), si = std::sin(i);
+        x = (cw * cn - sw * sn * ci) * px + (-sw * cn - cw * sn * ci) * py;
+        y = (cw * sn + sw * cn * ci) * px + (-sw * sn + cw * cn * ci) * py;
+        z = sw * si * px + cw * si * py;
+    }
+
+    // Geocentric Moon in the J2000 ecliptic frame, AU
+    void moon(double t, double &x, double &y, double &z)
+    {
+        const double lp = degrees(218.3164477, 481267.88123421, t);
+        const double d = degrees(297.8501921, 445267.1114034, t);
+        const double m = degrees(357.5291092, 35999.0502909, t);
+        const double mp = degrees(134.9633964, 477198.8675055, t);
+        const double f = degrees(93.2720950, 483202.0175233, t);
+        const double e = 1.0 - 0.002516 * t;
+        const double a1 = degrees(119.75, 131.849, t);
+        const double a2 = degrees(53.09, 479264.290, t);
+        const double a3 = degrees(313.45, 481266.484, t);
+
+        // Terms with the Sun's anomaly shrink with the Earth's orbital eccentricity
+        auto eccentricity = [e](int multiple) { return multiple == 0 ? 1.0 : (std::abs(multiple) == 1 ? e : e * e); };
+
+        double sumL = 3958 * std::sin(a1) + 1962 * std::sin(lp - f) + 318 * std::sin(a2);
+        double sumR = 0.0;
+        for (const LunarTerm &term : LONGITUDE_DISTANCE) {
+            const double argument = term.d * d + term.m * m + term.mp * mp + term.f * f;
+            const double scale = eccentricity(term.m);
+            sumL += term.longitude * scale * std::sin(argument);
+            sumR += term.distance * scale * std::cos(argument);
+        }
+
+        double sumB = -2235 * std::sin(lp) + 382 * std::sin(a3) + 175 * std::sin(a1 - f) + 175 * std::sin(a1 + f)
+                      + 127 * std::sin(lp - mp) - 115 * std::sin(lp + mp);
+        for (const LunarTerm &term : LATITUDE) {
+            const double argument = term.d * d + term.m * m + term.mp * mp + term.f * f;
+            sumB += term.longitude * eccentricity(term.m) * std::sin(argument);
+        }
+
+        // Back from the equinox of date to J2000 by the general precession in longitude
+        const double longitude = lp + (sumL / 1e6 - 1.396971 * t) * DEGREES;
+        const double latitude = sumB / 1e6 * DEGREES;
+        const double distance = (385000.56 + sumR / 1000.0) / KM_PER_AU;
+        x = distance * std::cos(latitude) * std::cos(longitude);
+        y = distance * std::cos(latitude) * std::sin(longitude);
+        z = distance * std::sin(latitude);
+    }
+}
+
+QString Ephemeris::name(Body body)
+{
+    static const char *const NAMES[BodyCount] = {
+        "Sun", "Moon", "Mercury", "Venus", "Mars", "Jupiter", "Saturn", "Uranus", "Neptune"
+    };
+    return body >= 0 && body < BodyCount ? NAMES[body] : "";
+}
+
+Ephemeris::Vector Ephemeris::geocentric(Body body, double jd)
+{
+    const double t = (jd - 2451545.0) / 36525.0;
+    double x, y, z;
+    if (body == Moon) {
+        moon(t, x, y, z);
+    } else {
+        double ex, ey, ez;
+        heliocentric(EARTH_MOON, t, ex, ey, ez);
+        if (body == Sun) {
+            x = -ex;
+            y = -ey;
+            z = -ez;
+        } else {
+            // Where the planet was when the light left it
+            const Elements &el = PLANETS[body - Mercury];
+            heliocentric(el, t, x, y, z);
+            const double lightTime = std::sqrt((x - ex) * (x - ex) + (y - ey) * (y - ey) + (z - ez) * (z - ez))
+                                     * LIGHT_DAYS_PER_AU;
+            heliocentric(el, t - lightTime / 36525.0, x, y, z);
+            x -= ex;
+            y -= ey;
+            z -= ez;
+        }
+    }
+
+    // Ecliptic to equatorial
+    const double ce = std::cos(OBLIQUITY_J2000), se = std::sin(OBLIQUITY_J2000);
+    return {x, y * ce - z * se, y * se + z * ce};
+}
+
+Ephemeris::Position Ephemeris::toPosition(const Vector &v)
+{
+    Position position;
+    position.distance = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+    position.ra = std::atan2(v.y, v.x);
+    if (position.ra < 0) position.ra += 2 * M_PI;
+    position.dec = std::asin(v.z / position.distance);
+    return position;
+}
+
+Ephemeris::Position Ephemeris::compute(Body body, qint64 ms)
+{
+    return toPosition(geocentric(body, julianDay(ms)));
+}
+
+Ephemeris::Vector Ephemeris::interpolate(Body body, qint64 ms)
+{
+    Table &table = m_tables[body];
+    if (table.stepMs == 0) {
+        table.stepMs = body == Moon ? DAY_MS / 48 : DAY_MS / 4;
+    }
+
+    double u = double(ms - table.startMs) / table.stepMs;
+    int i = int(std::floor(u));
+    if (table.points.isEmpty() || i < 1 || i + 2 >= table.points.size()) {
+        // A three-day window from a day before the query, on whole steps
+        table.startMs = (ms - DAY_MS) / table.stepMs * table.stepMs;
+        table.points.resize(int(3 * DAY_MS / table.stepMs) + 4);
+        for (int k = 0; k < table.points.size(); k++) {
+            table.points[k] = geocentric(body, julianDay(table.startMs + k * table.stepMs));
+        }
+        u = double(ms - table.startMs) / table.stepMs;
+        i = int(std::floor(u));
+    }
+
+    // Catmull-Rom cubic through the four nearest points
+    const double s = u - i;
+    const Vector &p0 = table.points[i - 1];
+    const Vector &p1 = table.points[i];
+    const Vector &p2 = table.points[i + 1];
+    const Vector &p3 = table.points[i + 2];
+    auto cubic = [s](double a, double b, double c, double d) {
+        return b + 0.5 * s * (c - a + s * (2 * a - 5 * b + 4 * c - d + s * (3 * (b - c) + d - a)));
+    };
+    return {cubic(p0.x, p1.x, p2.x, p3.x), cubic(p0.y, p1.y, p2.y, p3.y), cubic(p0.z, p1.z, p2.z, p3.z)};
+}
+
+Ephemeris::Position Ephemeris::position(Body body, qint64 ms)
+{
+    return toPosition(interpolate(body, ms));
+}
+
+Ephemeris::Position Ephemeris::topocentric(Body body, qint64 ms, double latitude, double longitude)
+{
+    // The observer's offset from the Earth's centre, on a spherical Earth
+    Vector v = interpolate(body, ms);
+    const double lst = siderealTime(ms, longitude);
+    v.x -= EARTH_RADIUS_AU * std::cos(latitude) * std::cos(lst);
+    v.y -= EARTH_RADIUS_AU * std::cos(latitude) * std::sin(lst);
+    v.z -= EARTH_RADIUS_AU * std::sin(latitude);
+    return toPosition(v);
+}
+
+double Ephemeris::moonIllumination(qint64 ms)
+{
+    const Position sun = position(Sun, ms);
+    const Position moon = position(Moon, ms);
+    const double elongation = separation(sun.ra, sun.dec, moon.ra, moon.dec);
+    const double phaseAngle = std::atan2(sun.distance * std::sin(elongation),
+                                         moon.distance - sun.distance * std::cos(elongation));
+    return (1.0 + std::cos(phaseAngle)) / 2.0;
+}
+
+double Ephemeris::siderealTime(qint64 ms, double longitude)
+{
+    const double days = julianDay(ms) - 2451545.0;
+    const double gmst = std::fmod(280.46061837 + 360.98564736629 * days, 360.0) * DEGREES;
+    double lst = std::fmod(gmst + longitude, 2 * M_PI);
+    return lst < 0 ? lst + 2 * M_PI : lst;
+}
+
+double Ephemeris::altitude(double ra, double dec, qint64 ms, double latitude, double longitude)
+{
+    const double hourAngle = siderealTime(ms, longitude) - ra;
+    return std::asin(std::sin(latitude) * std::sin(dec) + std::cos(latitude) * std::cos(dec) * std::cos(hourAngle));
+}
+
+double Ephemeris::separation(double ra1, double dec1, double ra2, double dec2)
+{
+    const double cosDistance = std::sin(dec1) * std::sin(dec2) + std::cos(dec1) * std::cos(dec2) * std::cos(ra1 - ra2);
+    return std::acos(qBound(-1.0, cosDistance, 1.0));
+}
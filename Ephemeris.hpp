@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+/**
+ * @brief Positions of the Sun, Moon and planets, cached on a time grid
+ *
+ * The series are deliberately short: the Moon from the principal terms of
+ * the ELP-2000/82 theory as tabulated by Meeus (about 10" in longitude),
+ * the Sun and planets from JPL's Keplerian elements with linear rates for
+ * 1800-2050 (an arcminute or so) with light time. That is ample for
+ * choosing targets, keeping away from the Moon and pointing an Origin.
+ *
+ * Evaluating a series costs a few hundred transcendental calls, so each
+ * body is tabulated once for a three-day window around the first query
+ * (every 30 minutes for the Moon, 6 hours for the rest) and queries
+ * interpolate the geocentric vectors with a cubic through the four
+ * nearest grid points. A query is then a few dozen flops; the window is
+ * rebuilt only when a query falls outside it.
+ *
+ * Positions are geocentric, J2000 equatorial like the built-in target
+ * list; the Moon can be corrected to the observer's position, where its
+ * parallax reaches a degree. All angles are in radians, times are ms
+ * since the epoch (UTC; the difference from TT is ignored).
+ */
+class Ephemeris
+{
+public:
+    enum Body {
+        Sun,
+        Moon,
+        Mercury,
+        Venus,
+        Mars,
+        Jupiter,
+        Saturn,
+        Uranus,
+        Neptune,
+        BodyCount
+    };
+
+    struct Position {
+        double ra = 0.0;
+        double dec = 0.0;
+        double distance = 0.0;  // AU
+    };
+
+    static QString name(Body body);
+
+    /** @brief Position from the series directly, bypassing the cache */
+    static Position compute(Body body, qint64 ms);
+
+    /** @brief Geocentric position, interpolated from the cache */
+    Position position(Body body, qint64 ms);
+
+    /**
+     * @brief Position seen from a place on the Earth's surface
+     * @param latitude Geodetic latitude
+     * @param longitude East longitude
+     */
+    Position topocentric(Body body, qint64 ms, double latitude, double longitude);
+
+    /** @brief Illuminated fraction of the Moon's disc, 0 (new) to 1 (full) */
+    double moonIllumination(qint64 ms);
+
+    /** @brief Local apparent sidereal time, approximated by the mean */
+    static double siderealTime(qint64 ms, double longitude);
+
+    /** @brief Altitude above the horizon of an equatorial position */
+    static double altitude(double ra, double dec, qint64 ms, double latitude, double longitude);
+
+    /** @brief Angular distance between two positions */
+    static double separation(double ra1, double dec1, double ra2, double dec2);
+
+private:
+    struct Vector {
+        double x, y, z;
+    };
+
+    struct Table {
+        qint64 startMs = 0;
+        qint64 stepMs = 0;
+        QVector<Vector> points;
+    };
+
+    static Vector geocentric(Body body, double jd);
+    static Position toPosition(const Vector &v);
+    Vector interpolate(Body body, qint64 ms);
+
+    Table m_tables[BodyCount];
+};
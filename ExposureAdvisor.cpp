@@ -0,0 +1,117 @@
+#include "ExposureAdvisor.hpp"
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    double medianOf(QVector<double> values)
+    {
+        if (values.isEmpty()) return 0.0;
+        int mid = values.size() / 2;
+        std::nth_element(values.begin(), values.begin() + mid, values.end());
+        return values[mid];
+    }
+
+    /** Value below which `fraction` of the histogram's samples fall */
+    int histogramQuantile(const QVector<qint64> &histogram, qint64 total, double fraction)
+    {
+        qint64 target = qint64(total * fraction);
+        qint64 seen = 0;
+        for (int i = 0; i < histogram.size(); i++) {
+            seen += histogram[i];
+            if (seen > target) return i;
+        }
+        return histogram.size() - 1;
+    }
+}
+
+bool ExposureAdvisor::measure(const QImage &source, double *level, double *sigma)
+{
+    if (source.isNull()) return false;
+
+    // The sky level of a frame does not need every pixel
+    QImage image = source;
+    if (qMax(image.width(), image.height()) > MAX_DIMENSION) {
+        image = image.scaled(MAX_DIMENSION, MAX_DIMENSION, Qt::KeepAspectRatio, Qt::FastTransformation);
+    }
+    image = image.convertToFormat(QImage::Format_Grayscale16);
+
+    QVector<qint64> histogram(65536, 0);
+    for (int y = 0; y < image.height(); y++) {
+        const quint16 *line = reinterpret_cast<const quint16*>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); x++) histogram[line[x]]++;
+    }
+    const qint64 total = qint64(image.width()) * image.height();
+    const int median = histogramQuantile(histogram, total, 0.5);
+
+    QVector<qint64> deviations(65536, 0);
+    for (int i = 0; i < 65536; i++) {
+        if (histogram[i]) deviations[std::abs(i - median)] += histogram[i];
+    }
+    const int mad = histogramQuantile(deviations, total, 0.5);
+
+    *level = median / 65535.0;
+    *sigma = 1.4826 * mad / 65535.0;
+    return true;
+}
+
+bool ExposureAdvisor::addFrame(const QImage &image, const CameraStatus &camera)
+{
+    double level, sigma;
+    if (camera.exposure <= 0.0 || !measure(image, &level, &sigma)) return false;
+    return addMeasurement(level, sigma, camera);
+}
+
+bool ExposureAdvisor::addMeasurement(double level, double sigma, const CameraStatus &camera)
+{
+    if (camera.exposure <= 0.0) return false;
+
+    const int bits = camera.bitDepth >= 8 && camera.bitDepth <= 16 ? camera.bitDepth : m_sensor.adcBits;
+    const double fullScale = (1 << bits) - 1;
+    const int iso = camera.iso > 0 ? camera.iso : m_sensor.referenceIso;
+
+    Sample sample;
+    sample.electronsPerAdu = m_sensor.electronsPerAdu * m_sensor.referenceIso / iso;
+    sample.skyAdu = level * fullScale - camera.offset;
+    sample.skyNoiseAdu = sigma * fullScale;
+    sample.exposure = camera.exposure;
+    if (sample.skyAdu <= 0.0) {
+        // Nothing above the offset: a dark frame, a closed dome, or a wrong offset
+        qDebug() << "Exposure advisor: no sky above the offset in this preview";
+        return false;
+    }
+    sample.skyFlux = sample.skyAdu * sample.electronsPerAdu / camera.exposure;
+
+    m_samples.append(sample);
+    if (m_samples.size() > WINDOW) m_samples.removeFirst();
+    return true;
+}
+
+ExposureAdvisor::Advice ExposureAdvisor::advice() const
+{
+    Advice advice;
+    if (m_samples.isEmpty()) return advice;
+
+    // Medians over the window, so one frame with a cloud or a passing light does not swing it
+    QVector<double> fluxes, levels, noises;
+    for (const Sample &sample : m_samples) {
+        fluxes.append(sample.skyFlux);
+        levels.append(sample.skyAdu);
+        noises.append(sample.skyNoiseAdu);
+    }
+
+    const Sample &latest = m_samples.last();
+    const double readNoise = m_sensor.readNoise;
+    advice.valid = true;
+    advice.frames = m_samples.size();
+    advice.skyFlux = medianOf(fluxes);
+    advice.skyAdu = medianOf(levels);
+    advice.skyNoiseAdu = medianOf(noises);
+    advice.electronsPerAdu = latest.electronsPerAdu;
+    advice.currentExposure = latest.exposure;
+    advice.subExposure = std::pow(m_swampFactor * readNoise, 2) / advice.skyFlux;
+
+    const double skyElectrons = advice.skyFlux * advice.currentExposure;
+    advice.readNoisePenalty = std::sqrt(1.0 + readNoise * readNoise / skyElectrons) - 1.0;
+    return advice;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <QImage>
+#include <QVector>
+#include "TelescopeData.hpp"
+
+/**
+ * @brief Sub-exposure length recommended from the sky background of live previews
+ *
+ * Each preview's sky level and noise are measured as the median and MAD of
+ * its luminance histogram, which stars and satellites hardly move. With the
+ * camera's ISO (gain) and offset the level becomes a sky flux in electrons
+ * per second per pixel, and the recommended sub is the exposure at which
+ * the sky's shot noise is `swampFactor` times the read noise:
+ *
+ *     t = (swampFactor * readNoise)^2 / skyFlux
+ *
+ * At a factor of 3 read noise adds about 5% to the total noise, so longer
+ * subs gain almost nothing while costing more frames to clouds, wind and
+ * satellites. The flux is the median of the last few frames, so the advice
+ * follows the sky as the target sinks or the moon rises.
+ *
+ * Previews are 8-bit renderings of the frame, so their level is taken as a
+ * fraction of the ADC's full scale; the result is a starting point to
+ * refine, not a calibration.
+ */
+class ExposureAdvisor
+{
+public:
+    /** @brief Sensor characteristics the measurement is converted with */
+    struct Sensor {
+        double readNoise = 2.2;         // Read noise in electrons
+        double electronsPerAdu = 0.9;   // Conversion gain at referenceIso
+        int referenceIso = 100;         // Gain scales inversely with ISO
+        int adcBits = 14;               // Used when the camera reports no bit depth
+    };
+
+    /** @brief The current recommendation */
+    struct Advice {
+        bool valid = false;
+        int frames = 0;                 // Previews the flux was taken from
+        double skyAdu = 0.0;            // Sky level above the offset
+        double skyNoiseAdu = 0.0;       // Robust sky sigma
+        double skyFlux = 0.0;           // Electrons per second per pixel
+        double electronsPerAdu = 0.0;
+        double subExposure = 0.0;       // Recommended sub length in seconds
+        double currentExposure = 0.0;
+        double readNoisePenalty = 0.0;  // Extra noise from read noise at the current exposure, 0..1
+    };
+
+    void setSensor(const Sensor &sensor) { m_sensor = sensor; }
+    const Sensor &sensor() const { return m_sensor; }
+
+    /** @brief Sky shot noise to read noise ratio to aim for */
+    void setSwampFactor(double factor) { m_swampFactor = factor; }
+    double swampFactor() const { return m_swampFactor; }
+
+    /**
+     * @brief Measure the sky in a preview
+     * @param image The preview; any format, colour is collapsed to luminance
+     * @param level Receives the sky median, normalised to 0..1
+     * @param sigma Receives the robust sky sigma, normalised to 0..1
+     * @return False for empty images
+     */
+    static bool measure(const QImage &image, double *level, double *sigma);
+
+    /**
+     * @brief Add a preview taken with the given capture parameters
+     * @param image The preview
+     * @param camera The camera's capture parameters when the frame was taken
+     * @return False if the frame could not be used
+     */
+    bool addFrame(const QImage &image, const CameraStatus &camera);
+
+    /**
+     * @brief Add a preview measured elsewhere, e.g. on a worker thread
+     * @param level The sky median from measure()
+     * @param sigma The sky sigma from measure()
+     * @param camera The camera's capture parameters when the frame was taken
+     * @return False if the frame could not be used
+     */
+    bool addMeasurement(double level, double sigma, const CameraStatus &camera);
+
+    /** @brief Forget the measured frames, e.g. after slewing to another target */
+    void clear() { m_samples.clear(); }
+
+    /** @brief Recommendation from the recent frames and the current settings */
+    Advice advice() const;
+
+private:
+    struct Sample {
+        double skyAdu;
+        double skyNoiseAdu;
+        double skyFlux;
+        double electronsPerAdu;
+        double exposure;
+    };
+
+    static const int WINDOW = 9;
+    static const int MAX_DIMENSION = 1024;
+
+    Sensor m_sensor;
+    double m_swampFactor = 3.0;
+    QVector<Sample> m_samples;
+};
@@ -0,0 +1,155 @@
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <cmath>
+#include "AutoDownloader.hpp"
+#include "FitsWriter.hpp"
+#include "SimulatedOrigin.hpp"
+#include "TelescopeDataProcessor.hpp"
+#include "TelescopeLink.hpp"
+
+namespace {
+// Frames to capture before mirroring the observation
+const int FRAMES_TO_CAPTURE = 5;
+// Real seconds to wait for the downloads and FITS copies
+const int TIMEOUT_MS = 60 * 1000;
+
+/** Header cards of a FITS file, keyword -> value with quotes and comment removed */
+QHash<QString, QString> readHeader(const QString &path)
+{
+    QHash<QString, QString> cards;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return cards;
+
+    while (true) {
+        QByteArray card = file.read(80);
+        if (card.size() < 80) break;
+        QString key = QString::fromLatin1(card.left(8)).trimmed();
+        if (key == "END") break;
+        if (card.mid(8, 2) != "= ") continue;
+
+        QString value = QString::fromLatin1(card.mid(10)).section('/', 0, 0).trimmed();
+        if (value.startsWith('\'')) value = value.mid(1, value.lastIndexOf('\'') - 1).trimmed();
+        cards.insert(key, value);
+    }
+    return cards;
+}
+}
+
+/**
+ * @brief Check that mirrored subframes carry their capture telemetry in FITS
+ *
+ * Captures a few frames from a SimulatedOrigin, handing each NewImageReady
+ * to the downloader the way TelescopeGUI does, then mirrors the observation
+ * with FITS output on. Fails (exit code 1) unless every frame captured while
+ * listening is written with DATE-OBS, RA and DEC cards from its own capture.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("OriginFitsDownloadTest");
+
+    // A frame every 100 ms of real time
+    SimulatedOrigin origin(100.0);
+    if (!origin.start()) {
+        qCritical() << "Failed to start simulated Origin";
+        return 2;
+    }
+
+    QTemporaryDir downloadDir;
+    TelescopeLink link;
+    TelescopeDataProcessor processor;
+    AutoDownloader downloader(&link, QString("127.0.0.1:%1").arg(origin.port()), downloadDir.path());
+    downloader.setMirrorSubframes(true);
+    downloader.setWriteFits(true);
+    downloader.setSkipRejectedFrames(false);
+
+    FrameQualityThresholds thresholds;
+    thresholds.minStars = 0;
+    thresholds.rejectTrailed = false;
+    downloader.setQualityThresholds(thresholds);
+
+    // Capture start and pointing of every frame we heard about, oldest first
+    QVector<FitsWriter::Metadata> captures;
+    QObject::connect(&link, &TelescopeLink::messageReceived, &processor,
+                     [&processor](const QJsonObject &obj, const QString &, qint64 receivedMs) {
+        processor.processJsonObject(obj, receivedMs);
+    });
+    QObject::connect(&processor, &TelescopeDataProcessor::newImageAvailable, &app, [&]() {
+        const TelescopeData &data = processor.getData();
+        qint64 startMs = processor.lastPacketTimeMs() - qint64(data.camera.exposure * 1000.0);
+        FitsWriter::Metadata metadata = FitsWriter::metadataFrom(data, startMs);
+        downloader.recordFrameMetadata(metadata);
+        captures.append(metadata);
+
+        if (captures.size() == FRAMES_TO_CAPTURE) {
+            // Let the last capture be matched before listing the observation
+            QTimer::singleShot(500, &downloader, &AutoDownloader::startDownload);
+        }
+    });
+    link.open("127.0.0.1", origin.port());
+
+    int exitCode = 2;
+    auto finish = [&](int code) {
+        exitCode = code;
+        origin.stop();
+        app.exit(code);
+    };
+
+    // FITS copies are written on the thread pool after each download completes
+    QTimer checkTimer;
+    checkTimer.setInterval(100);
+    QObject::connect(&downloader, &AutoDownloader::allDownloadsComplete, &checkTimer,
+                     static_cast<void (QTimer::*)()>(&QTimer::start));
+    QObject::connect(&checkTimer, &QTimer::timeout, &app, [&]() {
+        QDir session(downloadDir.path() + "/Session_001");
+        QStringList frames = session.entryList({"frame_*.jpg"}, QDir::Files, QDir::Name);
+        QStringList fits = session.entryList({"frame_*.fits"}, QDir::Files, QDir::Name);
+        if (frames.isEmpty() || fits.size() < frames.size()) return;
+        checkTimer.stop();
+
+        // Frames from before we were listening have no capture cards; every
+        // later one must carry those of its own capture, told apart by RA
+        int checked = 0;
+        int lastCapture = -1;
+        bool passed = true;
+        for (const QString &name : fits) {
+            QHash<QString, QString> cards = readHeader(session.filePath(name));
+            if (!cards.contains("RA") && checked == 0) continue;
+
+            int capture = -1;
+            for (int i = 0; i < captures.size(); i++) {
+                if (std::abs(cards.value("RA").toDouble() - captures[i].ra) < 1e-5 &&
+                    std::abs(cards.value("DEC").toDouble() - captures[i].dec) < 1e-5) {
+                    capture = i;
+                    break;
+                }
+            }
+            if (!cards.contains("DATE-OBS") || capture <= lastCapture) {
+                qWarning() << "Missing or wrong capture cards in" << name << cards;
+                passed = false;
+            }
+            lastCapture = capture;
+            checked++;
+        }
+
+        if (checked < FRAMES_TO_CAPTURE) {
+            qWarning() << "Only" << checked << "captured frames were written as FITS";
+            passed = false;
+        }
+        qDebug() << "Checked" << checked << "FITS frames:" << (passed ? "PASSED" : "FAILED");
+        finish(passed ? 0 : 1);
+    });
+
+    QTimer::singleShot(TIMEOUT_MS, &app, [&]() {
+        qWarning() << "Timed out with" << captures.size() << "frames captured";
+        finish(1);
+    });
+
+    app.exec();
+    return exitCode;
+}
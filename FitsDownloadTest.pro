@@ -0,0 +1,37 @@
+QT += core gui network websockets
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = FitsDownloadTest
+TEMPLATE = app
+
+# Checks that mirrored subframes are written as FITS with the DATE-OBS
+# and RA/DEC of their capture, against a simulated Origin.
+# Usage: FitsDownloadTest (exit code 0 on success)
+
+SOURCES += \
+    FitsDownloadMain.cpp \
+    SimulatedOrigin.cpp \
+    AutoDownloader.cpp \
+    BackgroundModel.cpp \
+    FitsWriter.cpp \
+    FrameQualityAnalyzer.cpp \
+    TelescopeDataProcessor.cpp \
+    TelescopeLink.cpp
+
+HEADERS += \
+    SimulatedOrigin.hpp \
+    AutoDownloader.hpp \
+    BackgroundModel.hpp \
+    FitsWriter.hpp \
+    FrameQualityAnalyzer.hpp \
+    ParallelFor.hpp \
+    TelescopeDataProcessor.hpp \
+    TelescopeData.hpp \
+    TelescopeLink.hpp \
+    SpscQueue.hpp
+
+macx {
+    QMAKE_MACOSX_DEPLOYMENT_TARGET = 10.14
+}
@@ -0,0 +1,351 @@
+#include "FitsWriter.hpp"
+#include <QDateTime>
+#include <QDebug>
+#include <QImageReader>
+#include <QTimeZone>
+#include <QVector>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    const int BLOCK_SIZE = 2880;
+    const int CARD_SIZE = 80;
+    // Samples are byte-swapped into this much memory before each write
+    const int CHUNK_SIZE = 10 * BLOCK_SIZE;
+
+    QByteArray card(const QString &key, const QString &value, const QString &comment = QString())
+    {
+        QString text = key.leftJustified(8, ' ', true);
+        if (!value.isNull()) text += "= " + value;
+        if (!comment.isEmpty()) text += " / " + comment;
+        return text.toLatin1().leftJustified(CARD_SIZE, ' ', true);
+    }
+
+    // Fixed format: numbers and logicals right-justified to column 30
+    QString fixed(const QString &value)
+    {
+        return value.rightJustified(20);
+    }
+
+    QString quoted(const QString &value)
+    {
+        QString escaped = value;
+        escaped.replace('\'', "''");
+        return "'" + escaped.leftJustified(8) + "'";
+    }
+
+    QString real(double value, int decimals)
+    {
+        return fixed(QString::number(value, 'f', decimals));
+    }
+
+    QString integer(qint64 value)
+    {
+        return fixed(QString::number(value));
+    }
+
+    QString timestamp(qint64 ms)
+    {
+        return quoted(QDateTime::fromMSecsSinceEpoch(ms, QTimeZone::utc()).toString("yyyy-MM-ddTHH:mm:ss.zzz"));
+    }
+}
+
+FitsWriter::Metadata FitsWriter::metadataFrom(const TelescopeData &data, qint64 exposureStartMs)
+{
+    Metadata metadata;
+    metadata.dateObsMs = exposureStartMs;
+    metadata.imageType = "Light Frame";
+
+    if (data.cameraLastUpdate.isValid()) {
+        metadata.exposure = data.camera.exposure;
+        metadata.gain = data.camera.iso;
+        metadata.offset = data.camera.offset;
+        metadata.binning = data.camera.binning;
+    }
+
+    // The Origin reports angles in radians
+    if (!data.lastImage.fileLocation.isEmpty()) {
+        metadata.hasPointing = true;
+        metadata.ra = data.lastImage.ra * 180.0 / M_PI;
+        metadata.dec = data.lastImage.dec * 180.0 / M_PI;
+        if (metadata.ra < 0.0) metadata.ra += 360.0;
+    }
+    if (data.focuserLastUpdate.isValid()) {
+        metadata.hasFocus = true;
+        metadata.focusPosition = data.focuser.position;
+    }
+    if (data.environmentLastUpdate.isValid()) {
+        metadata.hasCcdTemperature = true;
+        metadata.ccdTemperature = data.environment.cameraTemperature;
+        metadata.hasAmbientTemperature = true;
+        metadata.ambientTemperature = data.environment.ambientTemperature;
+    }
+    if (data.mountLastUpdate.isValid()) {
+        metadata.hasSite = true;
+        metadata.siteLatitude = data.mount.latitude * 180.0 / M_PI;
+        metadata.siteLongitude = data.mount.longitude * 180.0 / M_PI;
+    }
+    return metadata;
+}
+
+FitsWriter::FitsWriter()
+{
+}
+
+FitsWriter::~FitsWriter()
+{
+    // Never committed: the temporary is discarded
+    if (m_open) m_file.cancelWriting();
+}
+
+bool FitsWriter::open(const QString &path, int width, int height, int planes, int bitpix, const Metadata &metadata)
+{
+    if (width <= 0 || height <= 0 || (planes != 1 && planes != 3) || (bitpix != 8 && bitpix != 16)) {
+        m_error = "Unsupported image geometry";
+        return false;
+    }
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    m_width = width;
+    m_height = height;
+    m_planes = planes;
+    m_bitpix = bitpix;
+    m_expected = qint64(width) * height * planes;
+    m_written = 0;
+    m_chunk.resize(CHUNK_SIZE);
+    m_chunkUsed = 0;
+    m_open = true;
+    m_error.clear();
+
+    if (!writeHeader(metadata)) {
+        fail(m_file.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool FitsWriter::writeHeader(const Metadata &metadata)
+{
+    QByteArray header;
+    header += card("SIMPLE", fixed("T"), "Standard FITS");
+    header += card("BITPIX", integer(m_bitpix));
+    header += card("NAXIS", integer(m_planes == 1 ? 2 : 3));
+    header += card("NAXIS1", integer(m_width));
+    header += card("NAXIS2", integer(m_height));
+    if (m_planes > 1) header += card("NAXIS3", integer(m_planes), "Red, green, blue");
+    if (m_bitpix == 16) {
+        header += card("BZERO", integer(32768), "Unsigned 16-bit data");
+        header += card("BSCALE", integer(1));
+    }
+    header += card("ROWORDER", quoted("TOP-DOWN"));
+    header += card("DATE", timestamp(QDateTime::currentMSecsSinceEpoch()), "File written, UTC");
+    header += card("TELESCOP", quoted("Celestron Origin"));
+    header += card("INSTRUME", quoted("Origin Camera"));
+    header += card("CREATOR", quoted("OriginMonitor"));
+
+    if (!metadata.imageType.isEmpty()) header += card("IMAGETYP", quoted(metadata.imageType));
+    if (metadata.dateObsMs > 0) header += card("DATE-OBS", timestamp(metadata.dateObsMs), "Exposure start, UTC");
+    if (metadata.exposure >= 0.0) header += card("EXPTIME", real(metadata.exposure, 3), "Exposure time [s]");
+    if (metadata.gain >= 0) header += card("GAIN", integer(metadata.gain), "Sensor gain (ISO)");
+    if (metadata.offset >= 0) header += card("OFFSET", integer(metadata.offset), "Sensor offset");
+    if (metadata.binning > 0) {
+        header += card("XBINNING", integer(metadata.binning));
+        header += card("YBINNING", integer(metadata.binning));
+    }
+    if (metadata.hasPointing) {
+        header += card("RA", real(metadata.ra, 6), "Image centre right ascension [deg]");
+        header += card("DEC", real(metadata.dec, 6), "Image centre declination [deg]");
+    }
+    if (metadata.hasFocus) header += card("FOCUSPOS", integer(metadata.focusPosition), "Focuser position [steps]");
+    if (metadata.hasCcdTemperature) header += card("CCD-TEMP", real(metadata.ccdTemperature, 1), "Sensor temperature [C]");
+    if (metadata.hasAmbientTemperature) header += card("AMB-TEMP", real(metadata.ambientTemperature, 1), "Ambient temperature [C]");
+    if (metadata.hasSite) {
+        header += card("SITELAT", real(metadata.siteLatitude, 5), "Site latitude [deg]");
+        header += card("SITELONG", real(metadata.siteLongitude, 5), "Site longitude [deg], east positive");
+    }
+    if (m_planes == 1 && !metadata.bayerPattern.isEmpty()) {
+        header += card("BAYERPAT", quoted(metadata.bayerPattern), "CFA phase of the top-left pixel");
+    }
+    header += card("END", QString());
+
+    header.append(QByteArray((BLOCK_SIZE - header.size() % BLOCK_SIZE) % BLOCK_SIZE, ' '));
+    return m_file.write(header) == header.size();
+}
+
+bool FitsWriter::write(const quint8 *samples, qint64 count)
+{
+    if (!m_open) return false;
+    if (m_bitpix != 8 || m_written + count > m_expected) {
+        fail("Samples do not match the declared image");
+        return false;
+    }
+
+    while (count > 0) {
+        const int n = int(qMin<qint64>(count, CHUNK_SIZE - m_chunkUsed));
+        std::memcpy(m_chunk.data() + m_chunkUsed, samples, n);
+        m_chunkUsed += n;
+        samples += n;
+        count -= n;
+        m_written += n;
+        if (m_chunkUsed == CHUNK_SIZE && !flushChunk()) return false;
+    }
+    return true;
+}
+
+bool FitsWriter::write(const quint16 *samples, qint64 count)
+{
+    if (!m_open) return false;
+    if (m_bitpix != 16 || m_written + count > m_expected) {
+        fail("Samples do not match the declared image");
+        return false;
+    }
+
+    while (count > 0) {
+        const int n = int(qMin<qint64>(count, (CHUNK_SIZE - m_chunkUsed) / 2));
+        uchar *out = reinterpret_cast<uchar *>(m_chunk.data()) + m_chunkUsed;
+        for (int i = 0; i < n; i++) {
+            // Minus BZERO is a flip of the top bit; then big-endian
+            const quint16 value = samples[i] ^ 0x8000;
+            out[2 * i] = uchar(value >> 8);
+            out[2 * i + 1] = uchar(value);
+        }
+        m_chunkUsed += 2 * n;
+        samples += n;
+        count -= n;
+        m_written += n;
+        if (m_chunkUsed == CHUNK_SIZE && !flushChunk()) return false;
+    }
+    return true;
+}
+
+bool FitsWriter::flushChunk()
+{
+    if (m_chunkUsed == 0) return true;
+    if (m_file.write(m_chunk.constData(), m_chunkUsed) != m_chunkUsed) {
+        fail(m_file.errorString());
+        return false;
+    }
+    m_chunkUsed = 0;
+    return true;
+}
+
+bool FitsWriter::close()
+{
+    if (!m_open) return false;
+
+    if (m_written != m_expected) {
+        fail(QString("Only %1 of %2 samples were written").arg(m_written).arg(m_expected));
+        return false;
+    }
+    if (!flushChunk()) return false;
+
+    const qint64 dataBytes = m_expected * (m_bitpix / 8);
+    const QByteArray padding((BLOCK_SIZE - dataBytes % BLOCK_SIZE) % BLOCK_SIZE, '\0');
+    if (m_file.write(padding) != padding.size()) {
+        fail(m_file.errorString());
+        return false;
+    }
+
+    m_open = false;
+    if (!m_file.commit()) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void FitsWriter::fail(const QString &error)
+{
+    m_error = error;
+    if (m_open) {
+        m_file.cancelWriting();
+        m_file.commit();
+        m_open = false;
+    }
+}
+
+bool FitsWriter::writeImage(const QString &path, const QImage &image, const Metadata &metadata, QString *error)
+{
+    if (image.isNull()) {
+        if (error) *error = "No image";
+        return false;
+    }
+
+    const int width = image.width();
+    const int height = image.height();
+    const QImage::Format format = image.format();
+    const bool mono = format == QImage::Format_Grayscale8 || format == QImage::Format_Grayscale16;
+    const bool deep = format == QImage::Format_Grayscale16 || format == QImage::Format_RGBX64
+                   || format == QImage::Format_RGBA64 || format == QImage::Format_RGBA64_Premultiplied;
+
+    FitsWriter writer;
+    if (!writer.open(path, width, height, mono ? 1 : 3, deep ? 16 : 8, metadata)) {
+        if (error) *error = writer.errorString();
+        return false;
+    }
+
+    bool ok = true;
+    if (format == QImage::Format_Grayscale8) {
+        for (int y = 0; ok && y < height; y++) {
+            ok = writer.write(image.constScanLine(y), width);
+        }
+    } else if (format == QImage::Format_Grayscale16) {
+        for (int y = 0; ok && y < height; y++) {
+            ok = writer.write(reinterpret_cast<const quint16 *>(image.constScanLine(y)), width);
+        }
+    } else if (deep) {
+        // Four 16-bit components per pixel; one plane per pass over the image
+        QVector<quint16> row(width);
+        for (int plane = 0; ok && plane < 3; plane++) {
+            for (int y = 0; ok && y < height; y++) {
+                const quint16 *pixels = reinterpret_cast<const quint16 *>(image.constScanLine(y));
+                for (int x = 0; x < width; x++) row[x] = pixels[4 * x + plane];
+                ok = writer.write(row.constData(), width);
+            }
+        }
+    } else {
+        const bool rgb32 = format == QImage::Format_RGB32 || format == QImage::Format_ARGB32
+                        || format == QImage::Format_ARGB32_Premultiplied;
+        QVector<quint8> row(width);
+        for (int plane = 0; ok && plane < 3; plane++) {
+            for (int y = 0; ok && y < height; y++) {
+                // Other formats are converted a row at a time, never as a whole
+                QImage converted;
+                const QRgb *pixels;
+                if (rgb32) {
+                    pixels = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+                } else {
+                    converted = image.copy(0, y, width, 1).convertToFormat(QImage::Format_RGB32);
+                    pixels = reinterpret_cast<const QRgb *>(converted.constScanLine(0));
+                }
+                for (int x = 0; x < width; x++) {
+                    row[x] = quint8(plane == 0 ? qRed(pixels[x]) : plane == 1 ? qGreen(pixels[x]) : qBlue(pixels[x]));
+                }
+                ok = writer.write(row.constData(), width);
+            }
+        }
+    }
+
+    if (!ok || !writer.close()) {
+        if (error) *error = writer.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool FitsWriter::convertFile(const QString &sourcePath, const QString &fitsPath, const Metadata &metadata, QString *error)
+{
+    QImageReader reader(sourcePath);
+    reader.setAutoTransform(false);
+    QImage image = reader.read();
+    if (image.isNull()) {
+        if (error) *error = QString("Cannot read %1: %2").arg(sourcePath, reader.errorString());
+        return false;
+    }
+    return writeImage(fitsPath, image, metadata, error);
+}
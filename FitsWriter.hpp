@@ -0,0 +1,126 @@
+#pragma once
+
+#include <QByteArray>
+#include <QImage>
+#include <QSaveFile>
+#include <QString>
+#include "TelescopeData.hpp"
+
+/**
+ * @brief Writes FITS images a chunk at a time, headed with the telescope's state
+ *
+ * The header is written on open() and samples are streamed after it
+ * through a small fixed buffer that is byte-swapped to big-endian and
+ * flushed as it fills, so no second copy of the frame is ever held. 16-bit
+ * data is stored signed with BZERO 32768, as FITS requires. Colour images
+ * are written as three planes (NAXIS3 = 3) by walking the source image
+ * once per plane. Rows are written top-down and marked ROWORDER TOP-DOWN.
+ *
+ * The file is written to a temporary and only replaces the target on a
+ * successful close(), so an interrupted write never leaves a truncated
+ * FITS behind.
+ */
+class FitsWriter
+{
+public:
+    /**
+     * @brief Acquisition details for the header
+     *
+     * Values left at their defaults are not written.
+     */
+    struct Metadata {
+        qint64 dateObsMs = 0;           // Exposure start, UTC ms since epoch
+        double exposure = -1.0;         // Seconds
+        int gain = -1;                  // The Origin's ISO setting
+        int offset = -1;
+        int binning = 0;
+        bool hasPointing = false;
+        double ra = 0.0;                // Degrees
+        double dec = 0.0;               // Degrees
+        bool hasFocus = false;
+        int focusPosition = 0;
+        bool hasCcdTemperature = false;
+        double ccdTemperature = 0.0;    // Celsius
+        bool hasAmbientTemperature = false;
+        double ambientTemperature = 0.0;
+        bool hasSite = false;
+        double siteLatitude = 0.0;      // Degrees, north positive
+        double siteLongitude = 0.0;     // Degrees, east positive
+        QString bayerPattern;           // Mosaics only, e.g. "RGGB"
+        QString imageType;              // IMAGETYP, e.g. "Light Frame"
+    };
+
+    /**
+     * @brief Fill the metadata from a telemetry snapshot
+     *
+     * Pointing comes from the last ImageInfo, so the snapshot should be
+     * taken once the frame's NewImageReady has been processed; the rest
+     * describes the scope whenever the snapshot was taken.
+     * @param data The telescope state
+     * @param exposureStartMs Exposure start in ms since epoch, 0 if unknown
+     */
+    static Metadata metadataFrom(const TelescopeData &data, qint64 exposureStartMs);
+
+    FitsWriter();
+    ~FitsWriter();
+
+    /**
+     * @brief Create the file and write its header
+     * @param path The FITS file
+     * @param width Samples per row
+     * @param height Rows per plane
+     * @param planes 1 for mono or mosaic data, 3 for RGB
+     * @param bitpix 8 or 16
+     * @param metadata What to put in the header
+     */
+    bool open(const QString &path, int width, int height, int planes, int bitpix, const Metadata &metadata);
+
+    /** @brief Append 8-bit samples, in plane, row, column order */
+    bool write(const quint8 *samples, qint64 count);
+
+    /** @brief Append 16-bit samples, in plane, row, column order */
+    bool write(const quint16 *samples, qint64 count);
+
+    /**
+     * @brief Pad the data unit and commit the file
+     * @return false, leaving no file, if fewer samples were written than open() declared
+     */
+    bool close();
+
+    QString errorString() const { return m_error; }
+
+    /**
+     * @brief Write a whole QImage, one row at a time
+     *
+     * Grayscale8 and Grayscale16 images become one plane of 8 or 16 bits,
+     * 64-bit RGB formats three 16-bit planes, and anything else three
+     * 8-bit planes.
+     */
+    static bool writeImage(const QString &path, const QImage &image, const Metadata &metadata,
+                           QString *error = nullptr);
+
+    /**
+     * @brief Convert an image file, e.g. a downloaded TIFF or JPEG, to FITS
+     * @param sourcePath The image to read
+     * @param fitsPath The FITS file to write
+     */
+    static bool convertFile(const QString &sourcePath, const QString &fitsPath, const Metadata &metadata,
+                            QString *error = nullptr);
+
+private:
+    bool writeHeader(const Metadata &metadata);
+    bool flushChunk();
+    void fail(const QString &error);
+
+    QSaveFile m_file;
+    QByteArray m_chunk;                 // Big-endian samples waiting to be written
+    int m_chunkUsed = 0;
+    int m_bitpix = 0;
+    qint64 m_expected = 0;
+    qint64 m_written = 0;
+    int m_width = 0;
+    int m_height = 0;
+    int m_planes = 0;
+    bool m_open = false;
+    QString m_error;
+};
@@ -0,0 +1,328 @@
+#include "FrameQualityAnalyzer.hpp"
+#include "BackgroundModel.hpp"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    double medianOf(QVector<double> values)
+    {
+        if (values.isEmpty()) return 0.0;
+        int mid = values.size() / 2;
+        std::nth_element(values.begin(), values.begin() + mid, values.end());
+        return values[mid];
+    }
+
+    /** Value below which `fraction` of the histogram's samples fall */
+    int histogramQuantile(const QVector<qint64> &histogram, qint64 total, double fraction)
+    {
+        qint64 target = qint64(total * fraction);
+        qint64 seen = 0;
+        for (int i = 0; i < histogram.size(); i++) {
+            seen += histogram[i];
+            if (seen > target) return i;
+        }
+        return histogram.size() - 1;
+    }
+
+    struct Peak {
+        quint16 value;
+        int x;
+        int y;
+    };
+}
+
+// ---------------------------------------------------------------------------
+// FrameQuality
+// ---------------------------------------------------------------------------
+
+QJsonObject FrameQuality::toJson() const
+{
+    QJsonObject obj;
+    obj["Valid"] = valid;
+    obj["StarCount"] = starCount;
+    obj["MedianHfr"] = medianHfr;
+    obj["Background"] = background;
+    obj["Noise"] = noise;
+    obj["Elongation"] = elongation;
+    obj["Trailed"] = trailed;
+    obj["Width"] = width;
+    obj["Height"] = height;
+    obj["AnalyzedAt"] = analyzedAt.toString(Qt::ISODate);
+    return obj;
+}
+
+FrameQuality FrameQuality::fromJson(const QJsonObject &obj)
+{
+    FrameQuality quality;
+    quality.valid = obj["Valid"].toBool();
+    quality.starCount = obj["StarCount"].toInt();
+    quality.medianHfr = obj["MedianHfr"].toDouble();
+    quality.background = obj["Background"].toDouble();
+    quality.noise = obj["Noise"].toDouble();
+    quality.elongation = obj["Elongation"].toDouble(1.0);
+    quality.trailed = obj["Trailed"].toBool();
+    quality.width = obj["Width"].toInt();
+    quality.height = obj["Height"].toInt();
+    quality.analyzedAt = QDateTime::fromString(obj["AnalyzedAt"].toString(), Qt::ISODate);
+    return quality;
+}
+
+bool FrameQualityThresholds::passes(const FrameQuality &quality, QString *reason) const
+{
+    // Never discard a frame we could not measure
+    if (!quality.valid) return true;
+
+    QString why;
+    if (quality.starCount < minStars) {
+        why = QString("%1 stars (min %2)").arg(quality.starCount).arg(minStars);
+    } else if (quality.medianHfr > maxHfr) {
+        why = QString("HFR %1 px (max %2)").arg(quality.medianHfr, 0, 'f', 2).arg(maxHfr, 0, 'f', 2);
+    } else if (quality.background > maxBackground) {
+        why = QString("background %1% (max %2%)").arg(quality.background * 100.0, 0, 'f', 0)
+                                                   .arg(maxBackground * 100.0, 0, 'f', 0);
+    } else if (rejectTrailed && quality.trailed) {
+        why = QString("trailed stars (elongation %1)").arg(quality.elongation, 0, 'f', 2);
+    }
+
+    if (reason) *reason = why;
+    return why.isEmpty();
+}
+
+// ---------------------------------------------------------------------------
+// FrameQualityAnalyzer
+// ---------------------------------------------------------------------------
+
+FrameQuality FrameQualityAnalyzer::analyze(const QImage &source)
+{
+    FrameQuality quality;
+    quality.analyzedAt = QDateTime::currentDateTimeUtc();
+    if (source.isNull()) return quality;
+
+    QImage image = source;
+    if (qMax(image.width(), image.height()) > MAX_DIMENSION) {
+        image = image.scaled(MAX_DIMENSION, MAX_DIMENSION, Qt::KeepAspectRatio, Qt::FastTransformation);
+    }
+    image = image.convertToFormat(QImage::Format_Grayscale16);
+
+    // A light-pollution gradient would inflate the MAD and push the
+    // detection threshold above faint stars on the dark side of the frame
+    image = BackgroundModel::subtract(image);
+
+    const int w = image.width();
+    const int h = image.height();
+    const int R = STAMP_RADIUS;
+    quality.width = w;
+    quality.height = h;
+    if (w <= 2 * R || h <= 2 * R) return quality;
+
+    // Sky background and noise from the histogram: median and MAD are
+    // insensitive to the few percent of pixels that belong to stars
+    QVector<qint64> histogram(65536, 0);
+    for (int y = 0; y < h; y++) {
+        const quint16 *line = reinterpret_cast<const quint16*>(image.constScanLine(y));
+        for (int x = 0; x < w; x++) histogram[line[x]]++;
+    }
+    const qint64 total = qint64(w) * h;
+    const int median = histogramQuantile(histogram, total, 0.5);
+
+    QVector<qint64> deviations(65536, 0);
+    for (int i = 0; i < 65536; i++) {
+        if (histogram[i]) deviations[std::abs(i - median)] += histogram[i];
+    }
+    const int mad = histogramQuantile(deviations, total, 0.5);
+    const double sigma = qMax(1.4826 * mad, 1.0);
+    const double threshold = median + 5.0 * sigma;
+
+    quality.background = median / 65535.0;
+    quality.noise = sigma / 65535.0;
+
+    // Local maxima above the detection threshold
+    QVector<Peak> peaks;
+    for (int y = R; y < h - R; y++) {
+        const quint16 *prev = reinterpret_cast<const quint16*>(image.constScanLine(y - 1));
+        const quint16 *line = reinterpret_cast<const quint16*>(image.constScanLine(y));
+        const quint16 *next = reinterpret_cast<const quint16*>(image.constScanLine(y + 1));
+        for (int x = R; x < w - R; x++) {
+            quint16 v = line[x];
+            if (v <= threshold) continue;
+            // Strict on one side, non-strict on the other so flat-topped
+            // (saturated) stars yield exactly one peak
+            if (v > line[x - 1] && v >= line[x + 1] &&
+                v > prev[x - 1] && v > prev[x] && v > prev[x + 1] &&
+                v >= next[x - 1] && v >= next[x] && v >= next[x + 1]) {
+                peaks.append({v, x, y});
+            }
+        }
+    }
+
+    std::sort(peaks.begin(), peaks.end(), [](const Peak &a, const Peak &b) { return a.value > b.value; });
+
+    // Measure the brightest isolated peaks
+    QVector<double> hfrs;
+    QVector<double> elongations;
+    QVector<QPoint> accepted;
+    for (const Peak &peak : peaks) {
+        if (accepted.size() >= MAX_STARS) break;
+
+        bool crowded = false;
+        for (const QPoint &p : accepted) {
+            if (std::abs(p.x() - peak.x) <= 2 * R && std::abs(p.y() - peak.y) <= 2 * R) {
+                crowded = true;
+                break;
+            }
+        }
+        if (crowded) continue;
+
+        double flux = 0.0, sx = 0.0, sy = 0.0;
+        int litPixels = 0;
+        for (int dy = -R; dy <= R; dy++) {
+            const quint16 *line = reinterpret_cast<const quint16*>(image.constScanLine(peak.y + dy));
+            for (int dx = -R; dx <= R; dx++) {
+                double f = line[peak.x + dx] - median;
+                if (f <= 0) continue;
+                flux += f;
+                sx += f * dx;
+                sy += f * dy;
+                if (line[peak.x + dx] > threshold) litPixels++;
+            }
+        }
+        // Single hot pixels and cosmic rays are not stars
+        if (flux <= 0.0 || litPixels < 3) continue;
+
+        double cx = sx / flux, cy = sy / flux;
+        double radiusSum = 0.0, mxx = 0.0, myy = 0.0, mxy = 0.0;
+        for (int dy = -R; dy <= R; dy++) {
+            const quint16 *line = reinterpret_cast<const quint16*>(image.constScanLine(peak.y + dy));
+            for (int dx = -R; dx <= R; dx++) {
+                double f = line[peak.x + dx] - median;
+                if (f <= 0) continue;
+                double ddx = dx - cx, ddy = dy - cy;
+                radiusSum += f * std::sqrt(ddx * ddx + ddy * ddy);
+                mxx += f * ddx * ddx;
+                myy += f * ddy * ddy;
+                mxy += f * ddx * ddy;
+            }
+        }
+        mxx /= flux;
+        myy /= flux;
+        mxy /= flux;
+
+        // Axis ratio from the eigenvalues of the second-moment matrix
+        double trace = mxx + myy;
+        double root = std::sqrt(qMax(0.0, (mxx - myy) * (mxx - myy) / 4.0 + mxy * mxy));
+        double major = trace / 2.0 + root;
+        double minor = trace / 2.0 - root;
+
+        accepted.append(QPoint(peak.x, peak.y));
+        hfrs.append(radiusSum / flux);
+        elongations.append(minor > 1e-6 ? std::sqrt(major / minor) : 1.0);
+    }
+
+    quality.starCount = accepted.size();
+    quality.medianHfr = medianOf(hfrs);
+    quality.elongation = elongations.isEmpty() ? 1.0 : medianOf(elongations);
+    quality.trailed = quality.starCount >= 5 && quality.elongation > 1.6;
+    quality.valid = true;
+
+    return quality;
+}
+
+// ---------------------------------------------------------------------------
+// FrameQualityIndex
+// ---------------------------------------------------------------------------
+
+FrameQualityIndex::FrameQualityIndex(const QString &path)
+    : m_path(path)
+    , m_dirty(false)
+{
+    if (!m_path.isEmpty()) load();
+}
+
+void FrameQualityIndex::setPath(const QString &path)
+{
+    if (path == m_path) return;
+    save();
+    m_path = path;
+    load();
+}
+
+QString FrameQualityIndex::stemOf(const QString &file)
+{
+    QFileInfo info(file);
+    return info.path() + "/" + info.completeBaseName();
+}
+
+bool FrameQualityIndex::load()
+{
+    m_entries.clear();
+    m_byStem.clear();
+    m_dirty = false;
+
+    QFile file(m_path);
+    if (!file.exists()) return true;
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open frame quality index:" << m_path;
+        return false;
+    }
+
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    QJsonObject frames = root["Frames"].toObject();
+    for (auto it = frames.begin(); it != frames.end(); ++it) {
+        m_entries.insert(it.key(), FrameQuality::fromJson(it.value().toObject()));
+        m_byStem.insert(stemOf(it.key()), it.key());
+    }
+    return true;
+}
+
+bool FrameQualityIndex::save()
+{
+    if (!m_dirty || m_path.isEmpty()) return true;
+
+    QJsonObject frames;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        frames[it.key()] = it.value().toJson();
+    }
+    QJsonObject root;
+    root["Version"] = 1;
+    root["Frames"] = frames;
+
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write frame quality index:" << m_path;
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    if (!file.commit()) return false;
+
+    m_dirty = false;
+    return true;
+}
+
+void FrameQualityIndex::insert(const QString &file, const FrameQuality &quality)
+{
+    m_entries.insert(file, quality);
+    m_byStem.insert(stemOf(file), file);
+    m_dirty = true;
+}
+
+bool FrameQualityIndex::lookup(const QString &file, FrameQuality *quality) const
+{
+    auto it = m_entries.constFind(file);
+    if (it == m_entries.constEnd()) {
+        auto stem = m_byStem.constFind(stemOf(file));
+        if (stem == m_byStem.constEnd()) return false;
+        it = m_entries.constFind(stem.value());
+        if (it == m_entries.constEnd()) return false;
+    }
+    if (quality) *quality = it.value();
+    return true;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <QObject>
+#include <QImage>
+#include <QJsonObject>
+#include <QDateTime>
+#include <QHash>
+#include <QString>
+
+/**
+ * @brief Quality metrics measured on one frame (usually its preview JPEG)
+ */
+struct FrameQuality {
+    bool valid = false;
+    int starCount = 0;
+    double medianHfr = 0.0;     // Half-flux radius in analysed pixels
+    double background = 0.0;    // Sky median, normalised to 0..1
+    double noise = 0.0;         // Robust sky sigma, normalised to 0..1
+    double elongation = 1.0;    // Median major/minor axis ratio of stars
+    bool trailed = false;       // Stars consistently elongated (wind, tracking, satellites)
+    int width = 0;              // Size of the analysed image
+    int height = 0;
+    QDateTime analyzedAt;
+
+    QJsonObject toJson() const;
+    static FrameQuality fromJson(const QJsonObject &obj);
+};
+
+/**
+ * @brief User limits below which a subframe is not worth transferring
+ */
+struct FrameQualityThresholds {
+    int minStars = 10;
+    double maxHfr = 6.0;
+    double maxBackground = 0.5;
+    bool rejectTrailed = true;
+
+    /**
+     * @brief Check a frame against the limits
+     * @param quality The measured quality
+     * @param reason Receives a short explanation when the frame fails
+     * @return true if the frame passes (frames without a valid measurement pass)
+     */
+    bool passes(const FrameQuality &quality, QString *reason = nullptr) const;
+};
+
+/**
+ * @brief Measures star count, HFR, sky background and trailing on an image
+ *
+ * Designed for the small preview JPEGs the Origin produces for every
+ * frame: the whole pass is a histogram, one peak scan and a few hundred
+ * small stamps, so it costs milliseconds rather than a full transfer.
+ */
+class FrameQualityAnalyzer {
+public:
+    /**
+     * @brief Analyse an image
+     * @param image The frame or its preview; any format, colour is collapsed to luminance
+     * @return The measured quality (valid is false for empty images)
+     */
+    static FrameQuality analyze(const QImage &image);
+
+private:
+    static const int STAMP_RADIUS = 6;
+    static const int MAX_STARS = 300;
+    static const int MAX_DIMENSION = 2048;
+};
+
+/**
+ * @brief Persistent per-file quality index
+ *
+ * Entries are keyed by the file location reported by the telescope.
+ * Lookups fall back to the same path without its extension, so a raw
+ * subframe finds the measurement taken on its sibling preview JPEG.
+ */
+class FrameQualityIndex {
+public:
+    /**
+     * @brief Constructor
+     * @param path JSON file to load from and save to
+     */
+    explicit FrameQualityIndex(const QString &path = QString());
+
+    /**
+     * @brief Switch to a different index file and load it
+     * @param path The JSON file
+     */
+    void setPath(const QString &path);
+
+    /** @brief Load entries from disk, replacing those in memory */
+    bool load();
+
+    /** @brief Write entries to disk if anything changed since the last save */
+    bool save();
+
+    /**
+     * @brief Record a measurement
+     * @param file The telescope file location
+     * @param quality The measurement
+     */
+    void insert(const QString &file, const FrameQuality &quality);
+
+    /**
+     * @brief Find the measurement for a file
+     * @param file The telescope file location
+     * @param quality Receives the measurement
+     * @return true if the file or a same-named sibling has been measured
+     */
+    bool lookup(const QString &file, FrameQuality *quality) const;
+
+    /** @brief Number of indexed files */
+    int size() const { return m_entries.size(); }
+
+private:
+    static QString stemOf(const QString &file);
+
+    QString m_path;
+    QHash<QString, FrameQuality> m_entries;
+    QHash<QString, QString> m_byStem;
+    bool m_dirty;
+};
+
+Q_DECLARE_METATYPE(FrameQuality)
@@ -0,0 +1,661 @@
+#include "IndiServer.hpp"
+#include "OriginBackend.hpp"
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QPointer>
+#include <QTcpSocket>
+#include <QThreadPool>
+#include <QXmlStreamReader>
+#include <cmath>
+
+namespace {
+    const QString TELESCOPE = "Origin Telescope";
+    const QString CAMERA = "Origin Camera";
+
+    // A client with more than this still unsent skips frames
+    const qint64 MAX_PENDING_BLOB_BYTES = 64 * 1024 * 1024;
+    // A top-level element larger than this is not a request
+    const qint64 MAX_ELEMENT_BYTES = 1024 * 1024;
+    // A goto the mount has not started slewing for by then is taken as done
+    const qint64 GOTO_START_TIMEOUT_MS = 15000;
+
+    QString timestamp()
+    {
+        return QDateTime::currentDateTimeUtc().toString("yyyy-MM-ddTHH:mm:ss");
+    }
+
+    QString attribute(const QString &name, const QString &value)
+    {
+        return QString(" %1=\"%2\"").arg(name, value.toHtmlEscaped());
+    }
+}
+
+IndiServer::IndiServer(OriginBackend *backend, QObject *parent)
+    : QObject(parent)
+    , m_backend(backend)
+{
+    defineProperties();
+
+    connect(&m_server, &QTcpServer::newConnection, this, &IndiServer::onNewConnection);
+    connect(m_backend, &OriginBackend::statusUpdated, this, &IndiServer::refresh);
+    connect(m_backend, &OriginBackend::connected, this, &IndiServer::refresh);
+    connect(m_backend, &OriginBackend::disconnected, this, &IndiServer::refresh);
+    connect(m_backend, &OriginBackend::imageReady, this, &IndiServer::onImageReady);
+
+    // Count the exposure down for clients' progress displays
+    m_exposureTimer.setInterval(1000);
+    connect(&m_exposureTimer, &QTimer::timeout, this, [this]() {
+        double remaining = qMax(0.0, (m_exposureEndMs - QDateTime::currentMSecsSinceEpoch()) / 1000.0);
+        setNumbers(CAMERA, "CCD_EXPOSURE", {remaining});
+    });
+}
+
+IndiServer::~IndiServer()
+{
+    stop();
+}
+
+bool IndiServer::start(int port)
+{
+    if (m_server.isListening()) return true;
+
+    if (!m_server.listen(QHostAddress::Any, port)) {
+        qWarning() << "INDI server cannot listen on port" << port << m_server.errorString();
+        return false;
+    }
+    refresh();
+    qDebug() << "INDI server listening on port" << port;
+    return true;
+}
+
+void IndiServer::stop()
+{
+    m_server.close();
+    for (Client *client : m_clients) {
+        client->socket->disconnect(this);
+        client->socket->deleteLater();
+        delete client->reader;
+        delete client;
+    }
+    bool hadClients = !m_clients.isEmpty();
+    m_clients.clear();
+    if (hadClients) emit clientCountChanged(0);
+}
+
+void IndiServer::defineProperties()
+{
+    for (const QString &device : {TELESCOPE, CAMERA}) {
+        Property &connection = addProperty(device, "CONNECTION", "Connection", "Main Control", "Switch", "rw");
+        connection.rule = "OneOfMany";
+        addElement(connection, "CONNECT", "Connect", "Off");
+        addElement(connection, "DISCONNECT", "Disconnect", "On");
+
+        Property &info = addProperty(device, "DRIVER_INFO", "Driver Info", "General Info", "Text", "ro");
+        addElement(info, "DRIVER_NAME", "Name", "Celestron Origin");
+        addElement(info, "DRIVER_EXEC", "Exec", QCoreApplication::applicationName());
+        addElement(info, "DRIVER_VERSION", "Version", "1.0");
+        // INDI interface bits: 1 telescope, 2 CCD
+        addElement(info, "DRIVER_INTERFACE", "Interface", device == TELESCOPE ? "1" : "2");
+    }
+
+    Property &coordinates = addProperty(TELESCOPE, "EQUATORIAL_EOD_COORD", "Eq. Coordinates", "Main Control", "Number", "rw");
+    addNumber(coordinates, "RA", "RA (hh:mm:ss)", "%010.6m", 0, 24, 0, 6, 0);
+    addNumber(coordinates, "DEC", "DEC (dd:mm:ss)", "%010.6m", -90, 90, 0, 5, 0);
+
+    Property &coordSet = addProperty(TELESCOPE, "ON_COORD_SET", "On Set", "Main Control", "Switch", "rw");
+    coordSet.rule = "OneOfMany";
+    addElement(coordSet, "TRACK", "Track", "On");
+    addElement(coordSet, "SLEW", "Slew", "Off");
+    addElement(coordSet, "SYNC", "Sync", "Off");
+
+    Property &abort = addProperty(TELESCOPE, "TELESCOPE_ABORT_MOTION", "Abort Motion", "Main Control", "Switch", "rw");
+    abort.rule = "AtMostOne";
+    addElement(abort, "ABORT", "Abort", "Off");
+
+    Property &track = addProperty(TELESCOPE, "TELESCOPE_TRACK_STATE", "Tracking", "Main Control", "Switch", "rw");
+    track.rule = "OneOfMany";
+    addElement(track, "TRACK_ON", "On", "Off");
+    addElement(track, "TRACK_OFF", "Off", "On");
+
+    Property &park = addProperty(TELESCOPE, "TELESCOPE_PARK", "Parking", "Main Control", "Switch", "rw");
+    park.rule = "OneOfMany";
+    addElement(park, "PARK", "Park", "Off");
+    addElement(park, "UNPARK", "UnPark", "On");
+
+    Property &site = addProperty(TELESCOPE, "GEOGRAPHIC_COORD", "Location", "Site Management", "Number", "ro");
+    addNumber(site, "LAT", "Lat (dd:mm:ss)", "%010.6m", -90, 90, 0, 4, 0);
+    addNumber(site, "LONG", "Lon (dd:mm:ss)", "%010.6m", 0, 360, 0, 4, 0);
+    addNumber(site, "ELEV", "Elevation (m)", "%g", -200, 10000, 0, 0, 0);
+
+    Property &exposure = addProperty(CAMERA, "CCD_EXPOSURE", "Expose", "Main Control", "Number", "rw");
+    addNumber(exposure, "CCD_EXPOSURE_VALUE", "Duration (s)", "%5.2f", 0.001, 3600, 1, 2, 1);
+
+    Property &abortExposure = addProperty(CAMERA, "CCD_ABORT_EXPOSURE", "Abort", "Main Control", "Switch", "rw");
+    abortExposure.rule = "AtMostOne";
+    addElement(abortExposure, "ABORT", "Abort", "Off");
+
+    Property &temperature = addProperty(CAMERA, "CCD_TEMPERATURE", "Temperature", "Main Control", "Number", "ro");
+    addNumber(temperature, "CCD_TEMPERATURE_VALUE", "Temperature (C)", "%5.2f", -50, 70, 0, 1, 0);
+
+    Property &gain = addProperty(CAMERA, "CCD_GAIN", "Gain", "Main Control", "Number", "rw");
+    addNumber(gain, "GAIN", "ISO", "%.0f", 100, 25600, 100, 0, 200);
+
+    Property &binning = addProperty(CAMERA, "CCD_BINNING", "Binning", "Image Settings", "Number", "rw");
+    addNumber(binning, "HOR_BIN", "X", "%2.0f", 1, 2, 1, 0, 1);
+    addNumber(binning, "VER_BIN", "Y", "%2.0f", 1, 2, 1, 0, 1);
+
+    Property &image = addProperty(CAMERA, "CCD1", "Image Data", "Image Info", "BLOB", "ro");
+    addElement(image, "CCD1", "Image", QString());
+}
+
+IndiServer::Property &IndiServer::addProperty(const QString &device, const QString &name, const QString &label,
+                                              const QString &group, const QString &type, const QString &perm)
+{
+    Property property;
+    property.device = device;
+    property.name = name;
+    property.label = label;
+    property.group = group;
+    property.type = type;
+    property.perm = perm;
+    m_properties.append(property);
+    return m_properties.last();
+}
+
+void IndiServer::addNumber(Property &property, const QString &name, const QString &label, const QString &format,
+                           double min, double max, double step, int decimals, double value)
+{
+    Element element;
+    element.name = name;
+    element.label = label;
+    element.format = format;
+    element.min = min;
+    element.max = max;
+    element.step = step;
+    element.decimals = decimals;
+    element.value = QString::number(value, 'f', decimals);
+    property.elements.append(element);
+}
+
+void IndiServer::addElement(Property &property, const QString &name, const QString &label, const QString &value)
+{
+    Element element;
+    element.name = name;
+    element.label = label;
+    element.value = value;
+    property.elements.append(element);
+}
+
+IndiServer::Property *IndiServer::findProperty(const QString &device, const QString &name)
+{
+    for (Property &property : m_properties) {
+        if (property.device == device && property.name == name) return &property;
+    }
+    return nullptr;
+}
+
+void IndiServer::setNumbers(const QString &device, const QString &name, const QVector<double> &values,
+                            const QString &state)
+{
+    Property *property = findProperty(device, name);
+    if (!property) return;
+
+    QStringList formatted;
+    for (int i = 0; i < property->elements.size(); i++) {
+        formatted.append(i < values.size() ? QString::number(values[i], 'f', property->elements[i].decimals)
+                                           : property->elements[i].value);
+    }
+    update(*property, formatted, state);
+}
+
+void IndiServer::setSwitch(const QString &device, const QString &name, const QString &on, const QString &state)
+{
+    Property *property = findProperty(device, name);
+    if (!property) return;
+
+    QStringList values;
+    for (const Element &element : property->elements) {
+        values.append(element.name == on ? "On" : "Off");
+    }
+    update(*property, values, state);
+}
+
+void IndiServer::setState(const QString &device, const QString &name, const QString &state)
+{
+    Property *property = findProperty(device, name);
+    if (!property) return;
+
+    QStringList values;
+    for (const Element &element : property->elements) values.append(element.value);
+    update(*property, values, state);
+}
+
+void IndiServer::update(Property &property, const QStringList &values, const QString &state)
+{
+    bool changed = !state.isEmpty() && state != property.state;
+    if (!state.isEmpty()) property.state = state;
+    for (int i = 0; i < property.elements.size() && i < values.size(); i++) {
+        if (property.elements[i].value != values[i]) {
+            property.elements[i].value = values[i];
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        broadcast(property.device, setXml(property));
+    }
+}
+
+double IndiServer::number(const QString &device, const QString &name, const QString &element)
+{
+    Property *property = findProperty(device, name);
+    if (property) {
+        for (const Element &candidate : property->elements) {
+            if (candidate.name == element) return candidate.value.toDouble();
+        }
+    }
+    return 0.0;
+}
+
+QString IndiServer::selectedSwitch(const QString &device, const QString &name)
+{
+    Property *property = findProperty(device, name);
+    if (property) {
+        for (const Element &element : property->elements) {
+            if (element.value == "On") return element.name;
+        }
+    }
+    return QString();
+}
+
+void IndiServer::refresh()
+{
+    const OriginBackend::TelescopeStatus status = m_backend->status();
+    const TelescopeData &data = m_backend->telescopeData();
+    const bool connected = m_backend->isConnected();
+
+    for (const QString &device : {TELESCOPE, CAMERA}) {
+        setSwitch(device, "CONNECTION", connected ? "CONNECT" : "DISCONNECT", connected ? "Ok" : "Idle");
+    }
+    if (!connected) return;
+
+    // A goto stays busy until the mount reports it finished; status sent
+    // before the mount has picked the goto up still says it is not slewing
+    if (m_gotoPending) {
+        if (status.isSlewing) {
+            m_gotoSeenSlewing = true;
+        } else if (m_gotoSeenSlewing
+                   || QDateTime::currentMSecsSinceEpoch() - m_gotoStartMs > GOTO_START_TIMEOUT_MS) {
+            m_gotoPending = false;
+        }
+    }
+    Property *coordinates = findProperty(TELESCOPE, "EQUATORIAL_EOD_COORD");
+    QString coordinateState = (status.isSlewing || m_gotoPending) ? "Busy"
+                            : (coordinates->state == "Alert" ? "Alert" : "Ok");
+    setNumbers(TELESCOPE, "EQUATORIAL_EOD_COORD", {status.raPosition, status.decPosition}, coordinateState);
+    setSwitch(TELESCOPE, "TELESCOPE_TRACK_STATE", status.isTracking ? "TRACK_ON" : "TRACK_OFF", "Ok");
+    setSwitch(TELESCOPE, "TELESCOPE_PARK", status.isParked ? "PARK" : "UNPARK", "Ok");
+
+    if (data.mount.latitude != 0.0 || data.mount.longitude != 0.0) {
+        double longitude = std::fmod(data.mount.longitude * 180.0 / M_PI + 360.0, 360.0);
+        setNumbers(TELESCOPE, "GEOGRAPHIC_COORD", {data.mount.latitude * 180.0 / M_PI, longitude, 0.0}, "Ok");
+    }
+
+    setNumbers(CAMERA, "CCD_TEMPERATURE", {data.environment.cameraTemperature}, "Ok");
+    // A client's setting is only sent with its next exposure; until then the
+    // camera still reports its own, which must not overwrite the request
+    if (m_requestedGain < 0 && data.camera.iso > 0) {
+        setNumbers(CAMERA, "CCD_GAIN", {double(data.camera.iso)}, "Ok");
+    }
+    if (m_requestedBinning < 0 && data.camera.binning > 0) {
+        setNumbers(CAMERA, "CCD_BINNING", {double(data.camera.binning), double(data.camera.binning)}, "Ok");
+    }
+}
+
+void IndiServer::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server.nextPendingConnection()) {
+        Client *client = new Client;
+        client->socket = socket;
+        client->reader = new QXmlStreamReader;
+        // INDI is a stream of top-level elements; give the reader one root to hang them from
+        client->reader->addData("<indi>");
+        socket->setParent(this);
+
+        connect(socket, &QTcpSocket::readyRead, this, [this, client]() { onReadyRead(client); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, client]() { removeClient(client); });
+
+        m_clients.append(client);
+        qDebug() << "INDI client connected from" << socket->peerAddress().toString()
+                 << "-" << m_clients.size() << "connected";
+        emit clientCountChanged(m_clients.size());
+    }
+}
+
+void IndiServer::removeClient(Client *client)
+{
+    if (!m_clients.removeOne(client)) return;
+
+    client->socket->deleteLater();
+    delete client->reader;
+    delete client;
+    emit clientCountChanged(m_clients.size());
+}
+
+void IndiServer::onReadyRead(Client *client)
+{
+    QXmlStreamReader &reader = *client->reader;
+    reader.addData(client->socket->readAll());
+
+    while (!reader.atEnd()) {
+        QXmlStreamReader::TokenType token = reader.readNext();
+        if (token == QXmlStreamReader::Invalid) break;
+
+        if (token == QXmlStreamReader::StartElement) {
+            client->depth++;
+            if (client->depth == 2) {
+                client->tag = reader.name().toString();
+                client->attributes.clear();
+                for (const QXmlStreamAttribute &attr : reader.attributes()) {
+                    client->attributes.insert(attr.name().toString(), attr.value().toString());
+                }
+                client->text.clear();
+                client->members.clear();
+            } else if (client->depth == 3) {
+                client->memberName = reader.attributes().value("name").toString();
+                client->text.clear();
+            }
+        } else if (token == QXmlStreamReader::Characters) {
+            if (client->text.size() < MAX_ELEMENT_BYTES) client->text += reader.text();
+        } else if (token == QXmlStreamReader::EndElement) {
+            if (client->depth == 3) {
+                client->members.insert(client->memberName, client->text.trimmed());
+                client->text.clear();
+            } else if (client->depth == 2) {
+                handleElement(client);
+                if (!m_clients.contains(client)) return;
+            }
+            client->depth--;
+        }
+    }
+
+    if (reader.hasError() && reader.error() != QXmlStreamReader::PrematureEndOfDocumentError) {
+        qWarning() << "INDI client sent malformed XML:" << reader.errorString();
+        client->socket->disconnectFromHost();
+    }
+}
+
+void IndiServer::handleElement(Client *client)
+{
+    const QString device = client->attributes.value("device");
+    const QString name = client->attributes.value("name");
+
+    if (client->tag == "getProperties") {
+        for (const Property &property : m_properties) {
+            if (!device.isEmpty() && property.device != device) continue;
+            if (!name.isEmpty() && property.name != name) continue;
+            send(client, definitionXml(property));
+        }
+    } else if (client->tag == "enableBLOB") {
+        const QString mode = client->text.trimmed();
+        BlobMode blobMode = mode == "Also" ? BlobAlso : (mode == "Only" ? BlobOnly : BlobNever);
+        if (device.isEmpty()) {
+            client->blobModes.insert(TELESCOPE, blobMode);
+            client->blobModes.insert(CAMERA, blobMode);
+        } else {
+            client->blobModes.insert(device, blobMode);
+        }
+    } else if (client->tag == "newNumberVector") {
+        handleNewNumbers(device, name, client->members);
+    } else if (client->tag == "newSwitchVector") {
+        handleNewSwitches(device, name, client->members);
+    } else if (client->tag.startsWith("new")) {
+        Property *property = findProperty(device, name);
+        if (property) {
+            send(client, messageXml(device, QString("%1 cannot be changed").arg(property->label)));
+        }
+    }
+}
+
+void IndiServer::handleNewNumbers(const QString &device, const QString &name, const QHash<QString, QString> &members)
+{
+    if (!m_backend->isConnected()) {
+        setState(device, name, "Alert");
+        message(device, "The monitor is not connected to a telescope");
+        return;
+    }
+
+    if (device == TELESCOPE && name == "EQUATORIAL_EOD_COORD") {
+        double ra = members.value("RA", QString::number(number(device, name, "RA"))).toDouble();
+        double dec = members.value("DEC", QString::number(number(device, name, "DEC"))).toDouble();
+        bool sync = selectedSwitch(TELESCOPE, "ON_COORD_SET") == "SYNC";
+        bool ok = sync ? m_backend->syncPosition(ra, dec) : m_backend->gotoPosition(ra, dec);
+        if (ok && !sync) {
+            m_gotoPending = true;
+            m_gotoSeenSlewing = false;
+            m_gotoStartMs = QDateTime::currentMSecsSinceEpoch();
+        }
+        setState(device, name, ok ? (sync ? "Ok" : "Busy") : "Alert");
+        message(device, QString("%1 to RA %2h, Dec %3°").arg(sync ? "Syncing" : "Slewing")
+                        .arg(ra, 0, 'f', 4).arg(dec, 0, 'f', 4));
+    } else if (device == CAMERA && name == "CCD_EXPOSURE") {
+        startExposure(members.value("CCD_EXPOSURE_VALUE").toDouble());
+    } else if (device == CAMERA && (name == "CCD_GAIN" || name == "CCD_BINNING")) {
+        // Applied with the next exposure
+        Property *property = findProperty(device, name);
+        QVector<double> values;
+        for (const Element &element : property->elements) {
+            double value = members.value(element.name, element.value).toDouble();
+            values.append(qBound(element.min, value, element.max));
+        }
+        setNumbers(device, name, values, "Ok");
+        if (name == "CCD_GAIN") {
+            m_requestedGain = int(values[0]);
+        } else {
+            m_requestedBinning = int(values[0]);
+        }
+    }
+}
+
+void IndiServer::handleNewSwitches(const QString &device, const QString &name, const QHash<QString, QString> &members)
+{
+    auto isOn = [&members](const QString &element) { return members.value(element) == "On"; };
+
+    if (name == "CONNECTION") {
+        // The monitor owns the connection; clients just see whether it is up
+        if (isOn("CONNECT") && !m_backend->isConnected()) {
+            setState(device, name, "Alert");
+            message(device, "Connect the monitor to a telescope first");
+        } else if (isOn("DISCONNECT") && m_backend->isConnected()) {
+            message(device, "The telescope stays connected while the monitor uses it");
+        }
+        return;
+    }
+
+    if (name == "ON_COORD_SET") {
+        for (const QString &element : {"TRACK", "SLEW", "SYNC"}) {
+            if (isOn(element)) setSwitch(device, name, element, "Ok");
+        }
+        return;
+    }
+
+    if (!m_backend->isConnected()) {
+        setState(device, name, "Alert");
+        message(device, "The monitor is not connected to a telescope");
+        return;
+    }
+
+    if (device == TELESCOPE && name == "TELESCOPE_ABORT_MOTION" && isOn("ABORT")) {
+        bool ok = m_backend->abortMotion();
+        m_gotoPending = false;
+        setSwitch(device, name, QString(), ok ? "Ok" : "Alert");
+        setState(TELESCOPE, "EQUATORIAL_EOD_COORD", "Idle");
+        message(device, "Motion aborted");
+    } else if (device == TELESCOPE && name == "TELESCOPE_TRACK_STATE") {
+        bool enable = isOn("TRACK_ON");
+        bool ok = m_backend->setTracking(enable);
+        setSwitch(device, name, enable ? "TRACK_ON" : "TRACK_OFF", ok ? "Ok" : "Alert");
+    } else if (device == TELESCOPE && name == "TELESCOPE_PARK") {
+        bool parking = isOn("PARK");
+        bool ok = parking ? m_backend->parkMount() : m_backend->unparkMount();
+        setSwitch(device, name, parking ? "PARK" : "UNPARK", ok ? "Busy" : "Alert");
+    } else if (device == CAMERA && name == "CCD_ABORT_EXPOSURE" && isOn("ABORT")) {
+        bool ok = m_backend->abortExposure();
+        setSwitch(device, name, QString(), ok ? "Ok" : "Alert");
+        m_exposureTimer.stop();
+        setNumbers(CAMERA, "CCD_EXPOSURE", {0.0}, "Alert");
+    }
+}
+
+void IndiServer::startExposure(double seconds)
+{
+    if (m_exposing) {
+        message(CAMERA, "An exposure is already running");
+        return;
+    }
+    if (seconds <= 0.0) {
+        setState(CAMERA, "CCD_EXPOSURE", "Alert");
+        return;
+    }
+
+    m_exposing = true;
+    m_exposureEndMs = QDateTime::currentMSecsSinceEpoch() + qint64(seconds * 1000.0);
+    setNumbers(CAMERA, "CCD_EXPOSURE", {seconds}, "Busy");
+    m_exposureTimer.start();
+
+    int gain = m_requestedGain >= 0 ? m_requestedGain : int(number(CAMERA, "CCD_GAIN", "GAIN"));
+    int binning = m_requestedBinning >= 0 ? m_requestedBinning : int(number(CAMERA, "CCD_BINNING", "HOR_BIN"));
+
+    // singleShot waits in a local event loop; run it after this request has been handled
+    QPointer<IndiServer> self(this);
+    QTimer::singleShot(0, this, [self, seconds, gain, binning]() {
+        QImage image = self->m_backend->singleShot(gain, binning, int(seconds * 1000000.0));
+        if (!self) return;
+        self->m_exposing = false;
+        self->m_exposureTimer.stop();
+        // The frame itself goes out as a BLOB from onImageReady
+        self->setNumbers(CAMERA, "CCD_EXPOSURE", {0.0}, image.isNull() ? "Alert" : "Ok");
+        if (image.isNull()) self->message(CAMERA, "Exposure failed or timed out");
+    });
+}
+
+void IndiServer::onImageReady()
+{
+    bool wanted = false;
+    for (Client *client : m_clients) {
+        if (client->blobModes.value(CAMERA, BlobNever) != BlobNever) wanted = true;
+    }
+    // Frames arriving while one is encoding are dropped; the next one will be newer
+    if (!wanted || m_encoding) return;
+
+    QImage image = m_backend->getLastImage();
+    if (image.isNull()) return;
+
+    // PNG keeps the pixels as received; encoding a full frame takes a while, so off the event loop
+    m_encoding = true;
+    QPointer<IndiServer> self(this);
+    QThreadPool::globalInstance()->start([self, image]() {
+        QByteArray png;
+        QBuffer buffer(&png);
+        buffer.open(QIODevice::WriteOnly);
+        if (!image.save(&buffer, "PNG")) png.clear();
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, png]() {
+            if (!self) return;
+            self->m_encoding = false;
+            if (png.isEmpty()) {
+                qWarning() << "Failed to encode frame for INDI clients";
+                return;
+            }
+            self->sendBlob(png, ".png");
+        }, Qt::QueuedConnection);
+    });
+}
+
+void IndiServer::sendBlob(const QByteArray &data, const QString &format)
+{
+    const QByteArray base64 = data.toBase64();
+    QByteArray xml = "<setBLOBVector" + (attribute("device", CAMERA) + attribute("name", "CCD1")
+                     + attribute("state", "Ok") + attribute("timeout", "60")
+                     + attribute("timestamp", timestamp())).toUtf8() + ">\n";
+    xml += "  <oneBLOB" + (attribute("name", "CCD1") + attribute("size", QString::number(data.size()))
+                          + attribute("format", format) + attribute("len", QString::number(base64.size()))).toUtf8() + ">\n";
+    xml += base64;
+    xml += "\n  </oneBLOB>\n</setBLOBVector>\n";
+
+    for (Client *client : m_clients) {
+        if (client->blobModes.value(CAMERA, BlobNever) == BlobNever) continue;
+        if (client->socket->bytesToWrite() > MAX_PENDING_BLOB_BYTES) {
+            qDebug() << "INDI client" << client->socket->peerAddress().toString() << "is behind, skipping a frame";
+            continue;
+        }
+        client->socket->write(xml);
+    }
+}
+
+QByteArray IndiServer::definitionXml(const Property &property) const
+{
+    QString xml = "<def" + property.type + "Vector" + attribute("device", property.device)
+                  + attribute("name", property.name) + attribute("label", property.label)
+                  + attribute("group", property.group) + attribute("state", property.state)
+                  + attribute("perm", property.perm);
+    if (property.type == "Switch") xml += attribute("rule", property.rule);
+    xml += attribute("timeout", "60") + attribute("timestamp", timestamp()) + ">\n";
+
+    for (const Element &element : property.elements) {
+        xml += "  <def" + property.type + attribute("name", element.name) + attribute("label", element.label);
+        if (property.type == "Number") {
+            xml += attribute("format", element.format) + attribute("min", QString::number(element.min))
+                   + attribute("max", QString::number(element.max)) + attribute("step", QString::number(element.step));
+        }
+        if (property.type == "BLOB") {
+            xml += "/>\n";
+        } else {
+            xml += ">" + element.value.toHtmlEscaped() + "</def" + property.type + ">\n";
+        }
+    }
+    xml += "</def" + property.type + "Vector>\n";
+    return xml.toUtf8();
+}
+
+QByteArray IndiServer::setXml(const Property &property) const
+{
+    QString xml = "<set" + property.type + "Vector" + attribute("device", property.device)
+                  + attribute("name", property.name) + attribute("state", property.state)
+                  + attribute("timeout", "60") + attribute("timestamp", timestamp()) + ">\n";
+    if (property.type != "BLOB") {
+        for (const Element &element : property.elements) {
+            xml += "  <one" + property.type + attribute("name", element.name) + ">"
+                   + element.value.toHtmlEscaped() + "</one" + property.type + ">\n";
+        }
+    }
+    xml += "</set" + property.type + "Vector>\n";
+    return xml.toUtf8();
+}
+
+QByteArray IndiServer::messageXml(const QString &device, const QString &message) const
+{
+    return ("<message" + attribute("device", device) + attribute("timestamp", timestamp())
+            + attribute("message", message) + "/>\n").toUtf8();
+}
+
+void IndiServer::send(Client *client, const QByteArray &xml)
+{
+    client->socket->write(xml);
+}
+
+void IndiServer::broadcast(const QString &device, const QByteArray &xml)
+{
+    for (Client *client : m_clients) {
+        // Clients that asked for BLOBs only get nothing else from that device
+        if (client->blobModes.value(device, BlobNever) == BlobOnly) continue;
+        client->socket->write(xml);
+    }
+}
+
+void IndiServer::message(const QString &device, const QString &text)
+{
+    broadcast(device, messageXml(device, text));
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTimer>
+#include <QVector>
+
+class OriginBackend;
+class QTcpSocket;
+class QXmlStreamReader;
+
+/**
+ * @brief INDI protocol server for KStars/Ekos and other INDI clients
+ *
+ * Serves two INDI devices, "Origin Telescope" and "Origin Camera", over
+ * the INDI XML protocol on TCP (port 7624 by default), backed by the same
+ * OriginBackend as the Alpaca server. Clients no longer need a bridge that
+ * polls the Alpaca endpoints.
+ *
+ * Updates are pushed: every backend status update refreshes the property
+ * values, and a setNumberVector/setSwitchVector/setTextVector goes out
+ * only for properties whose formatted value or state changed. Numbers are
+ * compared at their published precision, so noise below it is not sent.
+ *
+ * Every new frame is offered as the CCD1 BLOB to clients that asked for
+ * BLOBs with enableBLOB. It is encoded once, on the thread pool, and the
+ * same bytes go to every client; a client still holding too much unsent
+ * data skips a frame instead of queueing it.
+ *
+ * Standard property names are used (EQUATORIAL_EOD_COORD, ON_COORD_SET,
+ * TELESCOPE_PARK, CCD_EXPOSURE, ...) so Ekos recognises both devices.
+ * Coordinates are passed through as the Origin reports them.
+ */
+class IndiServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int DEFAULT_PORT = 7624;
+
+    explicit IndiServer(OriginBackend *backend, QObject *parent = nullptr);
+    ~IndiServer();
+
+    bool start(int port = DEFAULT_PORT);
+    void stop();
+    bool isRunning() const { return m_server.isListening(); }
+    int clientCount() const { return m_clients.size(); }
+
+signals:
+    void clientCountChanged(int count);
+
+private:
+    struct Element {
+        QString name;
+        QString label;
+        QString value;          // Numbers formatted to `decimals`, switches "On"/"Off"
+        QString format;         // printf-style display format for numbers
+        double min = 0.0;
+        double max = 0.0;
+        double step = 0.0;
+        int decimals = 0;
+    };
+
+    struct Property {
+        QString device;
+        QString name;
+        QString label;
+        QString group;
+        QString type;           // Number, Switch, Text or BLOB
+        QString perm;
+        QString rule;           // Switches only
+        QString state = "Idle";
+        QVector<Element> elements;
+    };
+
+    enum BlobMode {
+        BlobNever,
+        BlobAlso,
+        BlobOnly
+    };
+
+    struct Client {
+        QTcpSocket *socket = nullptr;
+        QXmlStreamReader *reader = nullptr;
+        QHash<QString, BlobMode> blobModes;     // Per device
+        // The top-level element being parsed
+        int depth = 0;
+        QString tag;
+        QHash<QString, QString> attributes;
+        QString text;
+        QHash<QString, QString> members;
+        QString memberName;
+    };
+
+    void defineProperties();
+    Property &addProperty(const QString &device, const QString &name, const QString &label,
+                          const QString &group, const QString &type, const QString &perm);
+    void addNumber(Property &property, const QString &name, const QString &label, const QString &format,
+                   double min, double max, double step, int decimals, double value);
+    void addElement(Property &property, const QString &name, const QString &label, const QString &value);
+    Property *findProperty(const QString &device, const QString &name);
+
+    // Change values and push the property to clients if anything changed
+    void setNumbers(const QString &device, const QString &name, const QVector<double> &values,
+                    const QString &state = QString());
+    void setSwitch(const QString &device, const QString &name, const QString &on,
+                   const QString &state = QString());
+    void setState(const QString &device, const QString &name, const QString &state);
+    void update(Property &property, const QStringList &values, const QString &state);
+    double number(const QString &device, const QString &name, const QString &element);
+    QString selectedSwitch(const QString &device, const QString &name);
+
+    void onNewConnection();
+    void onReadyRead(Client *client);
+    void removeClient(Client *client);
+    void handleElement(Client *client);
+    void handleNewNumbers(const QString &device, const QString &name, const QHash<QString, QString> &members);
+    void handleNewSwitches(const QString &device, const QString &name, const QHash<QString, QString> &members);
+    void startExposure(double seconds);
+
+    void refresh();
+    void onImageReady();
+    void sendBlob(const QByteArray &data, const QString &format);
+
+    QByteArray definitionXml(const Property &property) const;
+    QByteArray setXml(const Property &property) const;
+    QByteArray messageXml(const QString &device, const QString &message) const;
+    void send(Client *client, const QByteArray &xml);
+    void broadcast(const QString &device, const QByteArray &xml);
+    void message(const QString &device, const QString &text);
+
+    OriginBackend *m_backend;
+    QTcpServer m_server;
+    QList<Client*> m_clients;
+    QVector<Property> m_properties;
+
+    // A goto is busy until the mount has been seen slewing and then stopped
+    bool m_gotoPending = false;
+    bool m_gotoSeenSlewing = false;
+    qint64 m_gotoStartMs = 0;
+
+    // Set by clients for their exposures; -1 until one does, then the camera's are shown
+    int m_requestedGain = -1;
+    int m_requestedBinning = -1;
+
+    bool m_exposing = false;
+    qint64 m_exposureEndMs = 0;
+    QTimer m_exposureTimer;
+    bool m_encoding = false;
+};
@@ -0,0 +1,193 @@
+#include "MjpegStreamer.hpp"
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QPointer>
+#include <QTcpSocket>
+#include <QThreadPool>
+
+namespace {
+    const QByteArray BOUNDARY = "liveviewframe";
+    // A request line longer than this is not one of ours
+    const int MAX_REQUEST_LINE = 1024;
+
+    QByteArray encodePart(const QImage &frame, int quality, int maxWidth)
+    {
+        QImage image = frame.width() > maxWidth
+                     ? frame.scaledToWidth(maxWidth, Qt::SmoothTransformation)
+                     : frame;
+
+        QByteArray jpeg;
+        QBuffer buffer(&jpeg);
+        buffer.open(QIODevice::WriteOnly);
+        if (!image.save(&buffer, "JPG", quality)) {
+            qWarning() << "Failed to encode live view frame";
+            return QByteArray();
+        }
+
+        QByteArray part = "--" + BOUNDARY + "\r\n"
+                          "Content-Type: image/jpeg\r\n"
+                          "Content-Length: " + QByteArray::number(jpeg.size()) + "\r\n\r\n";
+        part += jpeg;
+        part += "\r\n";
+        return part;
+    }
+}
+
+MjpegStreamer::MjpegStreamer(QObject *parent)
+    : QObject(parent)
+{
+}
+
+bool MjpegStreamer::isStreamRequest(const QByteArray &requestLine)
+{
+    QList<QByteArray> fields = requestLine.trimmed().split(' ');
+    if (fields.size() < 2 || fields[0] != "GET") return false;
+
+    QByteArray path = fields[1];
+    int query = path.indexOf('?');
+    if (query >= 0) path.truncate(query);
+    return path == "/liveview.mjpg" || path == "/api/v1/liveview";
+}
+
+void MjpegStreamer::addViewer(QTcpSocket *socket)
+{
+    socket->setParent(this);
+    // The request headers are not needed; drop them and anything else the viewer sends
+    connect(socket, &QTcpSocket::readyRead, socket, [socket]() { socket->readAll(); });
+    connect(socket, &QTcpSocket::disconnected, this, [this, socket]() { removeViewer(socket); });
+    socket->readAll();
+
+    socket->write("HTTP/1.1 200 OK\r\n"
+                  "Content-Type: multipart/x-mixed-replace; boundary=" + BOUNDARY + "\r\n"
+                  "Cache-Control: no-cache, no-store, must-revalidate\r\n"
+                  "Pragma: no-cache\r\n"
+                  "Access-Control-Allow-Origin: *\r\n"
+                  "Connection: close\r\n\r\n");
+
+    m_viewers.append(socket);
+    qDebug() << "Live view viewer connected from" << socket->peerAddress().toString()
+             << "-" << m_viewers.size() << "watching";
+    emit viewerCountChanged(m_viewers.size());
+
+    // Something to look at straight away rather than at the next frame
+    if (!m_lastPart.isEmpty()) {
+        socket->write(m_lastPart);
+    } else {
+        encodeNext();
+    }
+}
+
+void MjpegStreamer::removeViewer(QTcpSocket *socket)
+{
+    if (!m_viewers.removeOne(socket)) return;
+    socket->deleteLater();
+    qDebug() << "Live view viewer disconnected -" << m_viewers.size() << "watching";
+    emit viewerCountChanged(m_viewers.size());
+}
+
+void MjpegStreamer::disconnectViewers()
+{
+    for (QTcpSocket *socket : QList<QTcpSocket*>(m_viewers)) {
+        socket->disconnectFromHost();
+    }
+}
+
+void MjpegStreamer::publish(const QImage &frame)
+{
+    if (frame.isNull()) return;
+
+    // Kept even without viewers so the first one to join gets a current frame
+    m_pending = frame;
+    m_lastPart.clear();
+    if (!m_viewers.isEmpty()) {
+        encodeNext();
+    }
+}
+
+void MjpegStreamer::encodeNext()
+{
+    // One encode in flight; frames arriving meanwhile collapse into m_pending
+    if (m_encoding || m_pending.isNull()) return;
+    m_encoding = true;
+
+    QImage frame = m_pending;
+    m_pending = QImage();
+    int quality = m_quality;
+    int maxWidth = m_maxWidth;
+
+    // Encoding a full preview takes tens of milliseconds; keep it off the
+    // GUI thread. The result comes back through the application object so
+    // a streamer destroyed meanwhile is simply skipped
+    QPointer<MjpegStreamer> self(this);
+    QThreadPool::globalInstance()->start([self, frame, quality, maxWidth]() {
+        QByteArray part = encodePart(frame, quality, maxWidth);
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, part]() {
+            if (self) {
+                self->onFrameEncoded(part);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MjpegStreamer::onFrameEncoded(const QByteArray &part)
+{
+    m_encoding = false;
+
+    if (!part.isEmpty()) {
+        m_lastPart = part;
+        for (QTcpSocket *socket : m_viewers) {
+            // Still sending an earlier frame: this viewer is slower than the
+            // camera, so it skips this one rather than falling behind
+            if (socket->bytesToWrite() > 0) continue;
+            socket->write(part);
+        }
+    }
+
+    if (!m_viewers.isEmpty()) {
+        encodeNext();
+    }
+}
+
+LiveViewTcpServer::LiveViewTcpServer(MjpegStreamer *streamer, QObject *parent)
+    : QTcpServer(parent)
+    , m_streamer(streamer)
+{
+}
+
+void LiveViewTcpServer::incomingConnection(qintptr socketDescriptor)
+{
+    QTcpSocket *socket = new QTcpSocket(this);
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        qWarning() << "Failed to accept connection:" << socket->errorString();
+        delete socket;
+        return;
+    }
+
+    // Connections made with this context object go away with it once the
+    // connection has been routed
+    QObject *router = new QObject(socket);
+    connect(socket, &QTcpSocket::disconnected, router, [socket]() { socket->deleteLater(); });
+    connect(socket, &QTcpSocket::readyRead, router, [this, socket, router]() {
+        if (!socket->canReadLine() && socket->bytesAvailable() < MAX_REQUEST_LINE) return;
+        delete router;
+
+        // Peek, so a request for QHttpServer reaches it untouched
+        QByteArray line = socket->peek(MAX_REQUEST_LINE);
+        line.truncate(line.indexOf('\n'));
+        if (m_streamer && MjpegStreamer::isStreamRequest(line)) {
+            m_streamer->addViewer(socket);
+            return;
+        }
+
+        addPendingConnection(socket);
+        emit newConnection();
+        // The request is already buffered and will not raise readyRead
+        // again; replay it for the new owner unless it has read it already
+        QMetaObject::invokeMethod(socket, [socket]() {
+            if (socket->bytesAvailable() > 0) {
+                emit socket->readyRead();
+            }
+        }, Qt::QueuedConnection);
+    });
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QByteArray>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QTcpServer>
+
+class QTcpSocket;
+
+/**
+ * @brief Live view of the latest preview frames as an MJPEG stream
+ *
+ * Browsers and remote monitors open GET /liveview.mjpg and receive a
+ * multipart/x-mixed-replace response in which every part is a JPEG. Each
+ * published frame is encoded once, on the thread pool, and the same bytes
+ * are written to every viewer, so extra viewers only cost socket writes.
+ *
+ * Frames are never queued: frames published while an encode is running
+ * collapse into the newest one, and a viewer whose socket still has
+ * unsent data skips the frame instead of buffering it.
+ */
+class MjpegStreamer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MjpegStreamer(QObject *parent = nullptr);
+
+    /**
+     * @brief Check whether an HTTP request line asks for the stream
+     * @param requestLine First line of the request, e.g. "GET /liveview.mjpg HTTP/1.1"
+     */
+    static bool isStreamRequest(const QByteArray &requestLine);
+
+    /**
+     * @brief Start streaming to a connection that asked for the stream
+     *
+     * The streamer takes ownership of the socket and drops it when the
+     * viewer disconnects.
+     */
+    void addViewer(QTcpSocket *socket);
+
+    /** @brief Close every viewer's connection */
+    void disconnectViewers();
+
+    int viewerCount() const { return m_viewers.size(); }
+
+    /**
+     * @brief Offer a new frame to the viewers
+     *
+     * Cheap to call for every preview; nothing is encoded while there are
+     * no viewers.
+     */
+    void publish(const QImage &frame);
+
+    /** @brief JPEG quality, 0-100 */
+    void setQuality(int quality) { m_quality = qBound(0, quality, 100); }
+
+    /** @brief Frames wider than this are scaled down before encoding */
+    void setMaxWidth(int width) { m_maxWidth = qMax(1, width); }
+
+signals:
+    void viewerCountChanged(int count);
+
+private:
+    void encodeNext();
+    void onFrameEncoded(const QByteArray &part);
+    void removeViewer(QTcpSocket *socket);
+
+    QList<QTcpSocket*> m_viewers;
+    QImage m_pending;
+    bool m_encoding = false;
+    QByteArray m_lastPart;
+    int m_quality = 75;
+    int m_maxWidth = 1280;
+};
+
+/**
+ * @brief TCP server that hands stream requests to an MjpegStreamer
+ *
+ * QHttpServer answers each request with one complete response, which an
+ * endless stream cannot be. This server peeks at the request line of every
+ * new connection; stream requests go to the streamer and everything else
+ * is passed on as a pending connection to whatever is bound to the server,
+ * so the stream shares the Alpaca port.
+ */
+class LiveViewTcpServer : public QTcpServer
+{
+public:
+    explicit LiveViewTcpServer(MjpegStreamer *streamer, QObject *parent = nullptr);
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    MjpegStreamer *m_streamer;
+};
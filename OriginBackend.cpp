@@ -10,30 +10,35 @@
 
 OriginBackend::OriginBackend(QObject *parent)
     : QObject(parent)
-    , m_webSocket(nullptr)
+    , m_link(nullptr)
     , m_dataProcessor(nullptr)
-    , m_networkManager(nullptr)
+    , m_clockSync(nullptr)
     , m_statusTimer(nullptr)
     , m_connectedPort(80)
     , m_isConnected(false)
     , m_isExposing(false)
     , m_imageReady(false)
+    , m_exposureStartMs(0)
     , m_nextSequenceId(2000)
     , m_logFile(nullptr)  // ADD THIS
     , m_logStream(nullptr)  // ADD THIS
 {
-    m_webSocket = new QWebSocket("", QWebSocketProtocol::VersionLatest, this);
+    m_link = new TelescopeLink(this);
     m_dataProcessor = new TelescopeDataProcessor(this);
-    m_networkManager = new QNetworkAccessManager(this);
+    m_clockSync = new ClockSync(m_link, "AlpacaServer", this);
     m_statusTimer = new QTimer(this);
 
     // Initialize logging - ADD THIS
     initializeLogging();
 
-    // Connect WebSocket signals
-    connect(m_webSocket, &QWebSocket::connected, this, &OriginBackend::onWebSocketConnected);
-    connect(m_webSocket, &QWebSocket::disconnected, this, &OriginBackend::onWebSocketDisconnected);
-    connect(m_webSocket, &QWebSocket::textMessageReceived, this, &OriginBackend::onTextMessageReceived);
+    // Connect link signals (socket I/O and decoding happen on the I/O thread)
+    connect(m_link, &TelescopeLink::connected, this, &OriginBackend::onWebSocketConnected);
+    connect(m_link, &TelescopeLink::disconnected, this, &OriginBackend::onWebSocketDisconnected);
+    connect(m_link, &TelescopeLink::messageReceived, this, &OriginBackend::onMessageReceived);
+    connect(m_link, &TelescopeLink::imageFetched, this, &OriginBackend::onImageFetched);
+    connect(m_link, &TelescopeLink::imageFetchFailed, this, [](const QString &url, const QString &error) {
+        qWarning() << "Error downloading image:" << url << error;
+    });
 
     // Connect data processor signals
     connect(m_dataProcessor, &TelescopeDataProcessor::mountStatusUpdated, 
@@ -62,12 +67,9 @@ bool OriginBackend::connectToTelescope(const QString& host, int port)
     m_connectedHost = host;
     m_connectedPort = port;
 
-    // Construct WebSocket URL for Origin telescope
-    QString url = QString("ws://%1:%2/SmartScope-1.0/mountControlEndpoint").arg(host).arg(port);
+    qDebug() << "Connecting to Origin telescope at:" << host << port;
     
-    qDebug() << "Connecting to Origin telescope at:" << url;
-    
-    m_webSocket->open(QUrl(url));
+    m_link->open(host, port);
     
     // Wait for connection with timeout
     QEventLoop loop;
@@ -75,7 +77,7 @@ bool OriginBackend::connectToTelescope(const QString& host, int port)
     timeoutTimer.setSingleShot(true);
     timeoutTimer.setInterval(10000); // 10 second timeout
     
-    connect(m_webSocket, &QWebSocket::connected, &loop, &QEventLoop::quit);
+    connect(m_link, &TelescopeLink::connected, &loop, &QEventLoop::quit);
     connect(&timeoutTimer, &QTimer::timeout, &loop, &QEventLoop::quit);
     
     timeoutTimer.start();
@@ -86,8 +88,8 @@ bool OriginBackend::connectToTelescope(const QString& host, int port)
 
 void OriginBackend::disconnectFromTelescope()
 {
-    if (m_webSocket && m_webSocket->state() == QAbstractSocket::ConnectedState) {
-        m_webSocket->close();
+    if (m_link && m_link->isConnected()) {
+        m_link->close();
     }
     
     if (m_statusTimer->isActive()) {
@@ -281,11 +283,26 @@ OriginBackend::TelescopeStatus OriginBackend::status() const
     return m_status;
 }
 
+const TelescopeData &OriginBackend::telescopeData() const
+{
+    return m_dataProcessor->getData();
+}
+
 double OriginBackend::temperature() const
 {
     return m_status.temperature;
 }
 
+void OriginBackend::setStatusPollInterval(int milliseconds)
+{
+    m_statusTimer->setInterval(milliseconds);
+}
+
+int OriginBackend::pendingCommandCount() const
+{
+    return m_pendingCommands.size();
+}
+
 bool OriginBackend::isExposing() const
 {
     return m_isExposing;
@@ -301,6 +318,21 @@ QImage OriginBackend::getLastImage() const
     return m_lastImage;
 }
 
+qint64 OriginBackend::lastExposureStartMs() const
+{
+    return m_exposureStartMs;
+}
+
+const TelescopeData &OriginBackend::lastExposureTelemetry() const
+{
+    return m_exposureTelemetry;
+}
+
+const ClockSync *OriginBackend::clockSync() const
+{
+    return m_clockSync;
+}
+
 void OriginBackend::setLastImage(const QImage& image)
 {
     m_lastImage = image;
@@ -354,6 +386,9 @@ QImage OriginBackend::singleShot(int gain, int binning, int exposureTimeMicrosec
     imagingParams["Uuid"] = m_currentImagingSession;
     imagingParams["SaveRawImage"] = true;
 
+    // The exposure starts when the command reaches the scope
+    m_exposureStartMs = m_clockSync->arrivalTimeMs(QDateTime::currentMSecsSinceEpoch());
+    m_exposureTelemetry = m_dataProcessor->getData();
     sendCommand("RunImaging", "TaskController", imagingParams);
     
     m_isExposing = true;
@@ -418,23 +453,26 @@ void OriginBackend::onWebSocketDisconnected()
     emit disconnected();
 }
 
-// Modify the onTextMessageReceived method in OriginBackend.cpp:
-void OriginBackend::onTextMessageReceived(const QString &message)
+// Handle a packet delivered by the link:
+void OriginBackend::onMessageReceived(const QJsonObject &obj, const QString &message, qint64 receivedMs)
 {
     // LOG THE INCOMING MESSAGE - ADD THIS
     logWebSocketMessage("RECV", message);
     
-    // Process the message through the data processor
-    bool processed = m_dataProcessor->processJsonPacket(message.toUtf8());
+    // Process the message through the data processor (decoded on the I/O thread),
+    // stamped with when it left the telescope
+    bool processed = !obj.isEmpty() && m_dataProcessor->processJsonObject(obj, m_clockSync->eventTimeMs(receivedMs));
     
     if (processed) {
         updateStatusFromProcessor();
     }
 
     // Check for image ready notifications
-    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8());
-    if (doc.isObject()) {
-        QJsonObject obj = doc.object();
+    if (!obj.isEmpty()) {
+        // Responses retire the matching pending command
+        if (obj["Type"].toString() == "Response") {
+            m_pendingCommands.remove(obj["SequenceID"].toInt());
+        }
         
         if (obj["Source"].toString() == "ImageServer" && 
             obj["Command"].toString() == "NewImageReady" &&
@@ -448,30 +486,16 @@ void OriginBackend::onTextMessageReceived(const QString &message)
     }
 }
 
-void OriginBackend::onImageDownloaded()
+void OriginBackend::onImageFetched(const QString &url, const QImage &image, const QByteArray &data)
 {
-    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
-    if (!reply) return;
-
-    if (reply->error() == QNetworkReply::NoError) {
-        QByteArray imageData = reply->readAll();
-        
-        // Try to load as an image
-        QImage image;
-        if (image.loadFromData(imageData)) {
-            m_lastImage = image;
-            m_imageReady = true;
-            
-            qDebug() << "Image downloaded successfully, size:" << imageData.size() << "bytes";
-            emit imageReady();
-        } else {
-            qWarning() << "Failed to load image from downloaded data";
-        }
-    } else {
-        qWarning() << "Error downloading image:" << reply->errorString();
-    }
+    Q_UNUSED(url);
 
-    reply->deleteLater();
+    // Already decoded on the I/O thread
+    m_lastImage = image;
+    m_imageReady = true;
+    
+    qDebug() << "Image downloaded successfully, size:" << data.size() << "bytes";
+    emit imageReady();
 }
 
 void OriginBackend::updateStatus()
@@ -511,11 +535,11 @@ void OriginBackend::sendCommand(const QString& command, const QString& destinati
     QJsonDocument doc(jsonCommand);
     QString message = doc.toJson(QJsonDocument::Compact);  // Use Compact for cleaner logs
     
-    if (m_webSocket->isValid() && m_webSocket->state() == QAbstractSocket::ConnectedState) {
+    if (m_link->isConnected()) {
         // LOG THE OUTGOING MESSAGE - ADD THIS
         logWebSocketMessage("SEND", message);
         
-        m_webSocket->sendTextMessage(message);
+        m_link->sendText(message);
         
         // Store the command for potential response tracking
         int sequenceId = jsonCommand["SequenceID"].toInt();
@@ -566,21 +590,12 @@ void OriginBackend::requestImage(const QString& filePath)
         return;
     }
 
-    // Construct the URL for image download
-    QString fullPath = QString("http://%1/SmartScope-1.0/dev2/%2").arg(m_connectedHost, filePath);
-    QUrl url(fullPath);
-    QNetworkRequest request(url);
-    
-    // Set appropriate headers
-    request.setRawHeader("Cache-Control", "no-cache");
-    request.setRawHeader("Accept", "*/*");
-    request.setRawHeader("User-Agent", "OriginAlpacaServer");
-    request.setRawHeader("Connection", "keep-alive");
+    // Origin serves HTTP on the WebSocket port; fetched and decoded on the I/O thread
+    QUrl url = m_link->fileUrl(filePath);
     
-    qDebug() << "Requesting image from:" << fullPath;
+    qDebug() << "Requesting image from:" << url.toString();
     
-    QNetworkReply *reply = m_networkManager->get(request);
-    connect(reply, &QNetworkReply::finished, this, &OriginBackend::onImageDownloaded);
+    m_link->fetchImage(url);
 }
 
 double OriginBackend::radiansToHours(double radians)
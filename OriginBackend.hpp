@@ -18,6 +18,8 @@
 #include <QStringConverter>
 #include <QWebSocket>
 #include "TelescopeDataProcessor.hpp"
+#include "TelescopeLink.hpp"
+#include "ClockSync.hpp"
 
 /**
  * @brief Backend adapter to connect Alpaca server to Celestron Origin telescope
@@ -67,8 +69,13 @@ public:
 
     // Status access
     TelescopeStatus status() const;
+    const TelescopeData &telescopeData() const;
     double temperature() const;
 
+    // Diagnostics (used by the soak harness)
+    void setStatusPollInterval(int milliseconds);
+    int pendingCommandCount() const;
+
     // Camera operations
     bool isExposing() const;
     bool isImageReady() const;
@@ -77,6 +84,9 @@ public:
     void setImageReady(bool ready);
     bool abortExposure();
     QImage singleShot(int gain, int binning, int exposureTimeMicroseconds);
+    qint64 lastExposureStartMs() const;     // When the last exposure began, in our clock
+    const TelescopeData &lastExposureTelemetry() const;    // Telemetry as the last exposure began
+    const ClockSync *clockSync() const;
 
 signals:
     void connected();
@@ -87,14 +97,14 @@ signals:
 private slots:
     void onWebSocketConnected();
     void onWebSocketDisconnected();
-    void onTextMessageReceived(const QString &message);
-    void onImageDownloaded();
+    void onMessageReceived(const QJsonObject &obj, const QString &message, qint64 receivedMs);
+    void onImageFetched(const QString &url, const QImage &image, const QByteArray &data);
     void updateStatus();
 
 private:
-    QWebSocket *m_webSocket;
+    TelescopeLink *m_link;
     TelescopeDataProcessor *m_dataProcessor;
-    QNetworkAccessManager *m_networkManager;
+    ClockSync *m_clockSync;
     QTimer *m_statusTimer;
     
     // State variables
@@ -104,6 +114,8 @@ private:
     bool m_isExposing;
     bool m_imageReady;
     QImage m_lastImage;
+    qint64 m_exposureStartMs;
+    TelescopeData m_exposureTelemetry;
     int m_nextSequenceId;
     
     // Current telescope status
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+
+/**
+ * @brief Run body(begin, end) over [0, count) in bands spread across the global thread pool
+ *
+ * Bands are handed out from a shared counter, so uneven bands balance
+ * themselves. The calling thread works too, and helpers are only started
+ * on pool threads that are free right now (tryStart), so a parallelFor
+ * issued from inside a pool task cannot deadlock waiting for threads
+ * that are themselves waiting.
+ *
+ * @param count Number of items, e.g. image rows
+ * @param body Called with half-open ranges of items; must be safe to run concurrently
+ * @param grain Items per band; 0 picks about four bands per core
+ */
+inline void parallelFor(int count, const std::function<void(int, int)> &body, int grain = 0)
+{
+    if (count <= 0) return;
+    if (grain <= 0) grain = qMax(1, count / (QThread::idealThreadCount() * 4));
+
+    const int bands = (count + grain - 1) / grain;
+    std::atomic<int> next(0);
+    auto work = [&]() {
+        for (int band = next.fetch_add(1); band < bands; band = next.fetch_add(1)) {
+            int begin = band * grain;
+            body(begin, qMin(count, begin + grain));
+        }
+    };
+
+    QThreadPool *pool = QThreadPool::globalInstance();
+    QSemaphore done;
+    int helpers = 0;
+    for (int i = 1; i < bands && i < pool->maxThreadCount(); i++) {
+        if (!pool->tryStart([&work, &done]() {
+                work();
+                done.release();
+            })) {
+            break;
+        }
+        helpers++;
+    }
+
+    work();
+    done.acquire(helpers);
+}
@@ -0,0 +1,469 @@
+#include "PlateSolver.hpp"
+#include "BackgroundModel.hpp"
+#include "SimdUtils.hpp"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <complex>
+
+namespace {
+    typedef std::complex<double> Point;
+
+    // The image quad code and catalogue code must agree this closely
+    const double CODE_TOLERANCE = 0.015;
+
+    // Quads are made from the brightest stars, the rest only help verification
+    const int QUAD_STARS = 25;
+
+    // Two stars farther apart than the others in a quad, as a fraction of the image's short side
+    const double MIN_QUAD_SIZE = 0.1;
+    const double MAX_QUAD_SIZE = 0.45;
+
+    // Stars inside a quad's circle that take part in it, brightest first
+    const int QUAD_INSIDE = 4;
+
+    // A match is conclusive long before this many stars by chance alone
+    const int MIN_MATCHES = 8;
+
+    // Image and catalogue positions must agree within this many pixels to count as matched
+    const double MATCH_PIXELS = 3.0;
+
+    const int STAMP_RADIUS = 3;
+
+    struct Quad {
+        int star[4];        // A and B span the quad, C and D are inside its circle
+        double code[4];     // (xC, yC, xD, yD) with A at (0,0) and B at (1,1)
+    };
+
+    struct Similarity {
+        Point scale;        // Rotation and scale
+        Point offset;
+        Point map(Point z) const { return scale * z + offset; }
+    };
+
+    /** Value below which `fraction` of the histogram's samples fall */
+    int histogramQuantile(const QVector<qint64> &histogram, qint64 total, double fraction)
+    {
+        qint64 target = qint64(total * fraction);
+        qint64 seen = 0;
+        for (int i = 0; i < histogram.size(); i++) {
+            seen += histogram[i];
+            if (seen > target) return i;
+        }
+        return histogram.size() - 1;
+    }
+
+    // Gnomonic projection onto the plane tangent at (ra0, dec0); false on the far hemisphere
+    bool project(double ra0, double dec0, double ra, double dec, double &x, double &y)
+    {
+        double cosC = std::sin(dec0) * std::sin(dec) + std::cos(dec0) * std::cos(dec) * std::cos(ra - ra0);
+        if (cosC <= 0.0) return false;
+        x = std::cos(dec) * std::sin(ra - ra0) / cosC;
+        y = (std::cos(dec0) * std::sin(dec) - std::sin(dec0) * std::cos(dec) * std::cos(ra - ra0)) / cosC;
+        return true;
+    }
+
+    void deproject(double ra0, double dec0, double x, double y, double &ra, double &dec)
+    {
+        double rho = std::sqrt(x * x + y * y);
+        if (rho == 0.0) {
+            ra = ra0;
+            dec = dec0;
+            return;
+        }
+        double c = std::atan(rho);
+        dec = std::asin(std::cos(c) * std::sin(dec0) + y * std::sin(c) * std::cos(dec0) / rho);
+        ra = ra0 + std::atan2(x * std::sin(c), rho * std::cos(dec0) * std::cos(c) - y * std::sin(dec0) * std::sin(c));
+    }
+
+    // Code of the quad spanned by its first two stars, reordering the stars canonically
+    void quadCode(const QVector<Point> &points, Quad &quad)
+    {
+        Point a = points[quad.star[0]];
+        Point b = points[quad.star[1]];
+        Point frame = Point(1.0, 1.0) / (b - a);
+        Point c = (points[quad.star[2]] - a) * frame;
+        Point d = (points[quad.star[3]] - a) * frame;
+
+        // Order A/B and C/D the same way whichever star was found first
+        if (c.real() + d.real() > 1.0) {
+            std::swap(quad.star[0], quad.star[1]);
+            c = Point(1.0, 1.0) - c;
+            d = Point(1.0, 1.0) - d;
+        }
+        if (c.real() > d.real()) {
+            std::swap(quad.star[2], quad.star[3]);
+            std::swap(c, d);
+        }
+
+        quad.code[0] = c.real();
+        quad.code[1] = c.imag();
+        quad.code[2] = d.real();
+        quad.code[3] = d.imag();
+    }
+
+    /**
+     * Quads whose spanning pair is between minSize and maxSize apart. Points
+     * are brightest first, so the stars taken inside each circle are the
+     * brightest there, in the image and the catalogue alike.
+     */
+    QVector<Quad> buildQuads(const QVector<Point> &points, double minSize, double maxSize)
+    {
+        QVector<int> byX(points.size());
+        for (int i = 0; i < byX.size(); i++) byX[i] = i;
+        std::sort(byX.begin(), byX.end(), [&](int i, int j) { return points[i].real() < points[j].real(); });
+
+        QVector<Quad> quads;
+        QVector<int> inside;
+        for (int i = 0; i < points.size(); i++) {
+            for (int j = i + 1; j < points.size(); j++) {
+                double size = std::abs(points[j] - points[i]);
+                if (size < minSize || size > maxSize) continue;
+
+                Point centre = (points[i] + points[j]) / 2.0;
+                double radius = size / 2;
+                auto first = std::lower_bound(byX.begin(), byX.end(), centre.real() - radius,
+                                              [&](int k, double x) { return points[k].real() < x; });
+                inside.clear();
+                for (auto it = first; it != byX.end() && points[*it].real() <= centre.real() + radius; ++it) {
+                    if (*it != i && *it != j && std::abs(points[*it] - centre) < radius) inside.append(*it);
+                }
+                std::sort(inside.begin(), inside.end());
+                if (inside.size() > QUAD_INSIDE) inside.resize(QUAD_INSIDE);
+
+                for (int c = 0; c < inside.size(); c++) {
+                    for (int d = c + 1; d < inside.size(); d++) {
+                        Quad quad = {{i, j, inside[c], inside[d]}, {}};
+                        quadCode(points, quad);
+                        quads.append(quad);
+                    }
+                }
+            }
+        }
+        return quads;
+    }
+
+    // Least-squares similarity taking each z to its w
+    Similarity fitSimilarity(const QVector<Point> &z, const QVector<Point> &w)
+    {
+        Point zMean, wMean;
+        for (int i = 0; i < z.size(); i++) {
+            zMean += z[i];
+            wMean += w[i];
+        }
+        zMean /= double(z.size());
+        wMean /= double(z.size());
+
+        Point cross;
+        double norm = 0.0;
+        for (int i = 0; i < z.size(); i++) {
+            cross += (w[i] - wMean) * std::conj(z[i] - zMean);
+            norm += std::norm(z[i] - zMean);
+        }
+
+        Similarity transform;
+        transform.scale = norm > 0.0 ? cross / norm : Point();
+        transform.offset = wMean - transform.scale * zMean;
+        return transform;
+    }
+
+    /** Catalogue points sorted by x, for nearest-star lookups */
+    struct StarLookup {
+        QVector<Point> points;
+
+        explicit StarLookup(QVector<Point> catalogue)
+            : points(std::move(catalogue))
+        {
+            std::sort(points.begin(), points.end(), [](const Point &a, const Point &b) { return a.real() < b.real(); });
+        }
+
+        // Index of the nearest star within radius, or -1
+        int nearest(Point w, double radius) const
+        {
+            auto first = std::lower_bound(points.begin(), points.end(), w.real() - radius,
+                                          [](const Point &p, double x) { return p.real() < x; });
+            int best = -1;
+            double bestDistance = radius;
+            for (auto it = first; it != points.end() && it->real() <= w.real() + radius; ++it) {
+                double distance = std::abs(*it - w);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = int(it - points.begin());
+                }
+            }
+            return best;
+        }
+    };
+
+    // Image stars that land on a catalogue star, as (image, catalogue) pairs
+    int countMatches(const Similarity &transform, const QVector<Point> &image, const StarLookup &catalogue,
+                     double radius, QVector<Point> *matchedImage = nullptr, QVector<Point> *matchedSky = nullptr)
+    {
+        int matches = 0;
+        for (const Point &z : image) {
+            int star = catalogue.nearest(transform.map(z), radius);
+            if (star < 0) continue;
+            matches++;
+            if (matchedImage) matchedImage->append(z);
+            if (matchedSky) matchedSky->append(catalogue.points[star]);
+        }
+        return matches;
+    }
+}
+
+double PlateSolver::separation(double ra1, double dec1, double ra2, double dec2)
+{
+    double cosDistance = std::sin(dec1) * std::sin(dec2) + std::cos(dec1) * std::cos(dec2) * std::cos(ra1 - ra2);
+    return std::acos(qBound(-1.0, cosDistance, 1.0));
+}
+
+QVector<PlateSolver::ImageStar> PlateSolver::detectStars(const QImage &source, int maxStars)
+{
+    QVector<ImageStar> stars;
+    if (source.isNull()) return stars;
+
+    QImage image = source;
+    double factor = 1.0;
+    if (qMax(image.width(), image.height()) > MAX_DIMENSION) {
+        image = image.scaled(MAX_DIMENSION, MAX_DIMENSION, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        factor = double(source.width()) / image.width();
+    }
+    image = BackgroundModel::subtract(image.convertToFormat(QImage::Format_Grayscale16));
+
+    const int w = image.width();
+    const int h = image.height();
+    const int R = STAMP_RADIUS;
+    if (w <= 2 * R || h <= 2 * R) return stars;
+
+    // Sky level and noise from every fourth row; stars barely move a median
+    QVector<qint64> histogram(65536, 0);
+    qint64 total = 0;
+    for (int y = 0; y < h; y += 4) {
+        const quint16 *line = reinterpret_cast<const quint16*>(image.constScanLine(y));
+        for (int x = 0; x < w; x++) histogram[line[x]]++;
+        total += w;
+    }
+    const int median = histogramQuantile(histogram, total, 0.5);
+    QVector<qint64> deviations(65536, 0);
+    for (int i = 0; i < 65536; i++) {
+        if (histogram[i]) deviations[std::abs(i - median)] += histogram[i];
+    }
+    const double sigma = qMax(1.4826 * histogramQuantile(deviations, total, 0.5), 1.0);
+    const quint16 threshold = quint16(qMin(65534.0, median + 5.0 * sigma));
+
+    // Local maxima above the threshold; the vector scan skips the dark sky between them
+    struct Peak {
+        quint16 value;
+        int x;
+        int y;
+    };
+    QVector<Peak> peaks;
+    for (int y = R; y < h - R; y++) {
+        const quint16 *prev = reinterpret_cast<const quint16*>(image.constScanLine(y - 1));
+        const quint16 *line = reinterpret_cast<const quint16*>(image.constScanLine(y));
+        const quint16 *next = reinterpret_cast<const quint16*>(image.constScanLine(y + 1));
+        for (int x = R; ; x++) {
+            x += SimdUtils::firstAbove(line + x, w - R - x, threshold);
+            if (x >= w - R) break;
+            quint16 v = line[x];
+            // Strict on one side, non-strict on the other so flat-topped stars yield one peak
+            if (v > line[x - 1] && v >= line[x + 1] &&
+                v > prev[x - 1] && v > prev[x] && v > prev[x + 1] &&
+                v >= next[x - 1] && v >= next[x] && v >= next[x + 1]) {
+                peaks.append({v, x, y});
+            }
+        }
+    }
+    std::sort(peaks.begin(), peaks.end(), [](const Peak &a, const Peak &b) { return a.value > b.value; });
+
+    // Centroids of the brightest isolated peaks
+    for (const Peak &peak : peaks) {
+        if (stars.size() >= 2 * maxStars) break;
+
+        bool crowded = false;
+        for (const ImageStar &star : stars) {
+            if (std::abs(star.x - peak.x) <= 2 * R && std::abs(star.y - peak.y) <= 2 * R) {
+                crowded = true;
+                break;
+            }
+        }
+        if (crowded) continue;
+
+        double flux = 0.0, sx = 0.0, sy = 0.0;
+        int litPixels = 0;
+        for (int dy = -R; dy <= R; dy++) {
+            const quint16 *line = reinterpret_cast<const quint16*>(image.constScanLine(peak.y + dy));
+            for (int dx = -R; dx <= R; dx++) {
+                double f = line[peak.x + dx] - median;
+                if (f <= 0) continue;
+                flux += f;
+                sx += f * dx;
+                sy += f * dy;
+                if (line[peak.x + dx] > threshold) litPixels++;
+            }
+        }
+        // Single hot pixels and cosmic rays are not stars
+        if (flux <= 0.0 || litPixels < 2) continue;
+
+        ImageStar star;
+        star.x = peak.x + sx / flux;
+        star.y = peak.y + sy / flux;
+        star.flux = flux;
+        stars.append(star);
+    }
+
+    std::sort(stars.begin(), stars.end(), [](const ImageStar &a, const ImageStar &b) { return a.flux > b.flux; });
+    if (stars.size() > maxStars) stars.resize(maxStars);
+    for (ImageStar &star : stars) {
+        star.x = (star.x + 0.5) * factor - 0.5;
+        star.y = (star.y + 0.5) * factor - 0.5;
+    }
+    return stars;
+}
+
+PlateSolver::Solution PlateSolver::solve(const QImage &image, const Hint &hint) const
+{
+    QElapsedTimer timer;
+    timer.start();
+    Solution solution = solve(detectStars(image), image.width(), image.height(), hint);
+    solution.elapsedMs = timer.elapsed();
+    return solution;
+}
+
+PlateSolver::Solution PlateSolver::solve(const QVector<ImageStar> &stars, int width, int height,
+                                         const Hint &hint) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    Solution solution;
+    solution.imageStars = stars.size();
+    if (!m_index || m_index->isEmpty()) {
+        solution.error = "No star index loaded";
+        return solution;
+    }
+    if (hint.fovX <= 0.0 || hint.fovY <= 0.0 || width <= 0 || height <= 0) {
+        solution.error = "No field of view to scale the search";
+        return solution;
+    }
+    if (stars.size() < MIN_MATCHES) {
+        solution.error = QString("Only %1 stars detected").arg(stars.size());
+        return solution;
+    }
+
+    // Catalogue stars around the hint, as deep as the image: about as many
+    // per image area as were detected, with some to spare
+    const double hintScale = hint.fovX / width;
+    const double radius = hint.searchRadius + std::hypot(hint.fovX, hint.fovY) / 2;
+    const double areaRatio = M_PI * radius * radius / (hint.fovX * hint.fovY);
+    const int quadStars = qMin(stars.size(), QUAD_STARS);
+    const int catalogueQuadStars = qBound(quadStars, int(1.5 * quadStars * areaRatio), 1500);
+    const int catalogueStars = qBound(stars.size(), int(2.0 * stars.size() * areaRatio), 5000);
+    QVector<StarIndex::Star> catalogue = m_index->starsWithin(hint.ra, hint.dec, radius, catalogueStars);
+
+    QVector<Point> sky;
+    for (const StarIndex::Star &star : catalogue) {
+        double x, y;
+        if (project(hint.ra, hint.dec, star.ra, star.dec, x, y)) sky.append(Point(x, y));
+    }
+    if (sky.size() < MIN_MATCHES) {
+        solution.error = "Too few catalogue stars near the hint";
+        return solution;
+    }
+
+    const double shortSide = qMin(width, height);
+    const double minScale = hintScale * (1.0 - hint.scaleTolerance);
+    const double maxScale = hintScale * (1.0 + hint.scaleTolerance);
+    QVector<Quad> skyQuads = buildQuads(sky.mid(0, catalogueQuadStars),
+                                        MIN_QUAD_SIZE * shortSide * minScale, MAX_QUAD_SIZE * shortSide * maxScale);
+    std::sort(skyQuads.begin(), skyQuads.end(), [](const Quad &a, const Quad &b) { return a.code[0] < b.code[0]; });
+    const StarLookup lookup(sky);
+
+    Similarity best;
+    int bestMatches = 0;
+    bool bestMirrored = false;
+    QVector<Point> image(stars.size());
+    for (int mirrored = 0; mirrored < 2 && bestMatches < qMax(MIN_MATCHES, stars.size() / 2); mirrored++) {
+        // A mirrored frame is solved as its reflection, which has the sky's handedness
+        for (int i = 0; i < stars.size(); i++) {
+            image[i] = Point(stars[i].x, mirrored ? -stars[i].y : stars[i].y);
+        }
+        QVector<Quad> imageQuads = buildQuads(image.mid(0, quadStars),
+                                              MIN_QUAD_SIZE * shortSide, MAX_QUAD_SIZE * shortSide);
+
+        for (const Quad &quad : imageQuads) {
+            auto first = std::lower_bound(skyQuads.begin(), skyQuads.end(), quad.code[0] - CODE_TOLERANCE,
+                                          [](const Quad &q, double code) { return q.code[0] < code; });
+            for (auto it = first; it != skyQuads.end() && it->code[0] <= quad.code[0] + CODE_TOLERANCE; ++it) {
+                double distance = 0.0;
+                for (int k = 0; k < 4; k++) distance += (it->code[k] - quad.code[k]) * (it->code[k] - quad.code[k]);
+                if (distance > CODE_TOLERANCE * CODE_TOLERANCE) continue;
+
+                QVector<Point> z, w;
+                for (int k = 0; k < 4; k++) {
+                    z.append(image[quad.star[k]]);
+                    w.append(sky[it->star[k]]);
+                }
+                Similarity transform = fitSimilarity(z, w);
+                double scale = std::abs(transform.scale);
+                if (scale < minScale || scale > maxScale) continue;
+
+                int matches = countMatches(transform, image, lookup, MATCH_PIXELS * scale);
+                if (matches > bestMatches) {
+                    bestMatches = matches;
+                    best = transform;
+                    bestMirrored = mirrored;
+                }
+            }
+            if (bestMatches >= qMax(MIN_MATCHES, stars.size() / 2)) break;
+        }
+    }
+
+    if (bestMatches < MIN_MATCHES) {
+        solution.error = QString("No match (best %1 of %2 stars)").arg(bestMatches).arg(stars.size());
+        solution.elapsedMs = timer.elapsed();
+        return solution;
+    }
+
+    // Refine on every matched star, re-matching with the improved transform
+    for (int i = 0; i < stars.size(); i++) {
+        image[i] = Point(stars[i].x, bestMirrored ? -stars[i].y : stars[i].y);
+    }
+    QVector<Point> matchedImage, matchedSky;
+    for (int pass = 0; pass < 3; pass++) {
+        matchedImage.clear();
+        matchedSky.clear();
+        bestMatches = countMatches(best, image, lookup, MATCH_PIXELS * std::abs(best.scale), &matchedImage, &matchedSky);
+        if (bestMatches < MIN_MATCHES) break;
+        best = fitSimilarity(matchedImage, matchedSky);
+    }
+
+    double squared = 0.0;
+    for (int i = 0; i < matchedImage.size(); i++) squared += std::norm(best.map(matchedImage[i]) - matchedSky[i]);
+    const double scale = std::abs(best.scale);
+
+    Point centre = best.map(Point((width - 1) / 2.0, bestMirrored ? -(height - 1) / 2.0 : (height - 1) / 2.0));
+    deproject(hint.ra, hint.dec, centre.real(), centre.imag(), solution.ra, solution.dec);
+    solution.ra = std::fmod(solution.ra + 2 * M_PI, 2 * M_PI);
+
+    // Position angle of a point just above the centre, as seen from the centre: north on the
+    // hint's tangent plane is not quite north at the centre
+    Point up = centre + best.scale * Point(0.0, bestMirrored ? 100.0 : -100.0);
+    double upRa, upDec;
+    deproject(hint.ra, hint.dec, up.real(), up.imag(), upRa, upDec);
+    const double dRa = upRa - solution.ra;
+    solution.orientation = std::atan2(std::sin(dRa) * std::cos(upDec),
+                                      std::cos(solution.dec) * std::sin(upDec)
+                                      - std::sin(solution.dec) * std::cos(upDec) * std::cos(dRa));
+    solution.orientation = std::fmod(solution.orientation + 2 * M_PI, 2 * M_PI);
+
+    solution.solved = true;
+    solution.mirrored = bestMirrored;
+    solution.pixelScale = scale;
+    solution.fovX = scale * width;
+    solution.fovY = scale * height;
+    solution.matchedStars = bestMatches;
+    solution.rmsPixels = matchedImage.isEmpty() ? 0.0 : std::sqrt(squared / matchedImage.size()) / scale;
+    solution.elapsedMs = timer.elapsed();
+    return solution;
+}
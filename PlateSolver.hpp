@@ -0,0 +1,100 @@
+#pragma once
+
+#include <QImage>
+#include <QString>
+#include <QVector>
+#include <cmath>
+#include "StarIndex.hpp"
+
+/**
+ * @brief Offline plate solver seeded by the telescope's own pointing
+ *
+ * The Origin reports a centre, orientation and field of view with every
+ * image (ImageInfo). That hint bounds the solve: only catalogue stars
+ * within a few degrees of the reported centre are considered, and only
+ * quads whose size matches the reported pixel scale are hashed, so a
+ * solve needs neither a sky-wide quad index nor a network connection.
+ *
+ * 1. Stars are detected on the gradient-flattened frame with a SIMD scan
+ *    for pixels above the noise threshold, then centroided.
+ * 2. Quads of four stars are hashed geometrically: with the two stars
+ *    farthest apart mapped to (0,0) and (1,1), the positions of the other
+ *    two form a code that does not change with shift, rotation or scale.
+ *    Both the brightest image stars and the catalogue stars near the hint,
+ *    projected onto the tangent plane, are hashed this way.
+ * 3. Every image quad whose code matches a catalogue quad proposes a
+ *    similarity transform, which is verified by counting how many of the
+ *    image stars land on a catalogue star. A confirmed match is refined by
+ *    least squares over all matched stars.
+ *
+ * Both parities are tried, so mirrored frames solve too. All angles are
+ * in radians.
+ */
+class PlateSolver
+{
+public:
+    /** @brief Where to look; normally the frame's ImageInfo */
+    struct Hint {
+        double ra = 0.0;
+        double dec = 0.0;
+        double fovX = 0.0;              // Field of view across the image width
+        double fovY = 0.0;
+        double searchRadius = 2.0 * M_PI / 180.0;   // How far the true centre may be from the hint
+        double scaleTolerance = 0.15;   // Relative error allowed in the pixel scale from fovX
+    };
+
+    /** @brief A detected star in image pixels */
+    struct ImageStar {
+        double x = 0.0;
+        double y = 0.0;
+        double flux = 0.0;
+    };
+
+    struct Solution {
+        bool solved = false;
+        QString error;
+        double ra = 0.0;                // Image centre
+        double dec = 0.0;
+        double orientation = 0.0;       // Position angle of the image's up direction, north through east
+        double pixelScale = 0.0;        // Radians per pixel
+        double fovX = 0.0;
+        double fovY = 0.0;
+        bool mirrored = false;
+        int imageStars = 0;
+        int matchedStars = 0;
+        double rmsPixels = 0.0;         // Residual of the matched stars
+        qint64 elapsedMs = 0;
+    };
+
+    /** @param index The catalogue; must outlive the solver */
+    explicit PlateSolver(const StarIndex *index) : m_index(index) {}
+
+    /**
+     * @brief Find and centroid the brightest stars
+     * @param image Any format; colour is collapsed to luminance
+     * @param maxStars Only the brightest this many are returned
+     * @return Stars in the image's own pixel coordinates, brightest first
+     */
+    static QVector<ImageStar> detectStars(const QImage &image, int maxStars = MAX_IMAGE_STARS);
+
+    /** @brief Solve an image */
+    Solution solve(const QImage &image, const Hint &hint) const;
+
+    /**
+     * @brief Solve from already detected stars
+     * @param stars Brightest first
+     * @param width Image width
+     * @param height Image height
+     * @param hint Where to look
+     */
+    Solution solve(const QVector<ImageStar> &stars, int width, int height, const Hint &hint) const;
+
+    /** @brief Angular distance between two positions */
+    static double separation(double ra1, double dec1, double ra2, double dec2);
+
+private:
+    static const int MAX_IMAGE_STARS = 50;
+    static const int MAX_DIMENSION = 4096;    // The Origin's full frames are solved at full resolution
+
+    const StarIndex *m_index;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QtGlobal>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ORIGIN_SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ORIGIN_SIMD_NEON 1
+#endif
+
+/**
+ * @brief Small vector kernels on 16-bit pixel rows
+ *
+ * SSE2 on x86-64 and NEON on Apple silicon/ARM, with a scalar tail and a
+ * scalar fallback elsewhere. The results are identical on every path.
+ */
+namespace SimdUtils {
+
+/**
+ * @brief Rounded average of two rows: out[i] = (a[i] + b[i] + 1) / 2
+ *
+ * out may alias a or b.
+ */
+inline void average(const quint16 *a, const quint16 *b, quint16 *out, int count)
+{
+    int i = 0;
+#if defined(ORIGIN_SIMD_SSE2)
+    for (; i + 8 <= count; i += 8) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_avg_epu16(va, vb));
+    }
+#elif defined(ORIGIN_SIMD_NEON)
+    for (; i + 8 <= count; i += 8) {
+        vst1q_u16(out + i, vrhaddq_u16(vld1q_u16(a + i), vld1q_u16(b + i)));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = quint16((quint32(a[i]) + b[i] + 1) >> 1);
+    }
+}
+
+/**
+ * @brief Index of the first value above a threshold, or count if there is none
+ *
+ * Lets scans for stars skip the dark sky eight pixels at a time.
+ */
+inline int firstAbove(const quint16 *row, int count, quint16 threshold)
+{
+    int i = 0;
+#if defined(ORIGIN_SIMD_SSE2)
+    // SSE2 only compares signed 16-bit values; flipping the sign bit preserves unsigned order
+    const __m128i bias = _mm_set1_epi16(short(0x8000));
+    const __m128i limit = _mm_xor_si128(_mm_set1_epi16(short(threshold)), bias);
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)), bias);
+        if (_mm_movemask_epi8(_mm_cmpgt_epi16(v, limit))) break;
+    }
+#elif defined(ORIGIN_SIMD_NEON) && defined(__aarch64__)
+    const uint16x8_t limit = vdupq_n_u16(threshold);
+    for (; i + 8 <= count; i += 8) {
+        if (vmaxvq_u16(vcgtq_u16(vld1q_u16(row + i), limit))) break;
+    }
+#endif
+    for (; i < count; i++) {
+        if (row[i] > threshold) return i;
+    }
+    return count;
+}
+
+}
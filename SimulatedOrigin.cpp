@@ -0,0 +1,347 @@
+#include "SimulatedOrigin.hpp"
+#include <QDebug>
+#include <QDateTime>
+#include <QBuffer>
+#include <QImage>
+#include <QRandomGenerator>
+#include <QUrl>
+#include <cmath>
+
+namespace {
+// Nominal cadences of the real scope, in simulated seconds
+const double STATUS_PERIOD_S = 2.0;
+const double FRAME_PERIOD_S = 10.0;
+const int FRAMES_PER_SESSION = 180;        // 30 minutes of 10 s subs
+const qint64 BYTES_PER_FRAME = 25LL * 1024 * 1024;
+}
+
+SimulatedOrigin::SimulatedOrigin(double acceleration, QObject *parent)
+    : QObject(parent)
+    , m_wsServer(new QWebSocketServer("SimulatedOrigin", QWebSocketServer::NonSecureMode, this))
+    , m_acceleration(acceleration > 0.0 ? acceleration : 1.0)
+    , m_startMs(0)
+    , m_frameCounter(0)
+    , m_nextSequenceId(5000)
+    , m_diskFreeBytes(48LL * 1024 * 1024 * 1024)
+{
+    connect(&m_tcpServer, &QTcpServer::newConnection, this, &SimulatedOrigin::onTcpConnection);
+    connect(m_wsServer, &QWebSocketServer::newConnection, this, &SimulatedOrigin::onNewConnection);
+
+    m_statusTimer.setTimerType(Qt::PreciseTimer);
+    m_statusTimer.setInterval(qMax(5, int(STATUS_PERIOD_S * 1000.0 / m_acceleration)));
+    connect(&m_statusTimer, &QTimer::timeout, this, &SimulatedOrigin::emitStatusNotifications);
+
+    m_imageTimer.setTimerType(Qt::PreciseTimer);
+    m_imageTimer.setInterval(qMax(5, int(FRAME_PERIOD_S * 1000.0 / m_acceleration)));
+    connect(&m_imageTimer, &QTimer::timeout, this, &SimulatedOrigin::emitNewImage);
+}
+
+SimulatedOrigin::~SimulatedOrigin()
+{
+    stop();
+}
+
+bool SimulatedOrigin::start(quint16 port)
+{
+    if (!m_tcpServer.listen(QHostAddress::LocalHost, port)) {
+        qWarning() << "SimulatedOrigin failed to listen:" << m_tcpServer.errorString();
+        return false;
+    }
+
+    m_startMs = QDateTime::currentMSecsSinceEpoch();
+    m_directories.append(QString("Session_%1").arg(m_directories.size() + 1, 3, 10, QChar('0')));
+    m_statusTimer.start();
+    m_imageTimer.start();
+
+    qDebug() << "SimulatedOrigin listening on port" << this->port()
+             << "at" << m_acceleration << "x real time";
+    return true;
+}
+
+void SimulatedOrigin::stop()
+{
+    m_statusTimer.stop();
+    m_imageTimer.stop();
+
+    for (QWebSocket *client : m_clients) {
+        client->close();
+        client->deleteLater();
+    }
+    m_clients.clear();
+
+    if (m_tcpServer.isListening()) {
+        m_tcpServer.close();
+    }
+}
+
+quint16 SimulatedOrigin::port() const
+{
+    return m_tcpServer.serverPort();
+}
+
+double SimulatedOrigin::simulatedSeconds() const
+{
+    return (QDateTime::currentMSecsSinceEpoch() - m_startMs) * m_acceleration / 1000.0;
+}
+
+void SimulatedOrigin::onTcpConnection()
+{
+    while (QTcpSocket *socket = m_tcpServer.nextPendingConnection()) {
+        connect(socket, &QTcpSocket::readyRead, this, &SimulatedOrigin::onTcpReadyRead);
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+void SimulatedOrigin::onTcpReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket) return;
+
+    // Wait until the request headers are complete before deciding
+    QByteArray head = socket->peek(8192);
+    if (!head.contains("\r\n\r\n")) {
+        return;
+    }
+
+    disconnect(socket, &QTcpSocket::readyRead, this, &SimulatedOrigin::onTcpReadyRead);
+
+    if (head.toLower().contains("upgrade: websocket")) {
+        disconnect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        m_wsServer->handleConnection(socket);
+    } else {
+        serveHttp(socket, socket->readAll());
+    }
+}
+
+void SimulatedOrigin::serveHttp(QTcpSocket *socket, const QByteArray &request)
+{
+    // Request line: GET /SmartScope-1.0/dev2/<path> HTTP/1.1
+    QList<QByteArray> requestLine = request.left(request.indexOf("\r\n")).split(' ');
+    QString path = requestLine.size() >= 2 ? QUrl::fromPercentEncoding(requestLine[1]) : QString();
+
+    QByteArray body;
+    QByteArray status = "404 Not Found";
+    if (path.startsWith("/SmartScope-1.0/dev2/") &&
+        (path.endsWith(".jpg") || path.endsWith(".tiff") || path.endsWith(".tif"))) {
+        body = previewJpeg();
+        status = "200 OK";
+    }
+
+    QByteArray response = "HTTP/1.1 " + status + "\r\n"
+                          "Content-Type: application/octet-stream\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          "Connection: close\r\n\r\n";
+    socket->write(response);
+    socket->write(body);
+    socket->disconnectFromHost();
+}
+
+void SimulatedOrigin::onNewConnection()
+{
+    while (QWebSocket *client = m_wsServer->nextPendingConnection()) {
+        connect(client, &QWebSocket::textMessageReceived, this, &SimulatedOrigin::onTextMessageReceived);
+        connect(client, &QWebSocket::disconnected, this, &SimulatedOrigin::onClientDisconnected);
+        m_clients.append(client);
+    }
+}
+
+void SimulatedOrigin::onClientDisconnected()
+{
+    QWebSocket *client = qobject_cast<QWebSocket*>(sender());
+    if (!client) return;
+
+    m_clients.removeAll(client);
+    client->deleteLater();
+}
+
+void SimulatedOrigin::onTextMessageReceived(const QString &message)
+{
+    QWebSocket *client = qobject_cast<QWebSocket*>(sender());
+    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8());
+    if (!client || !doc.isObject()) return;
+
+    QJsonObject command = doc.object();
+    QString name = command["Command"].toString();
+    QString destination = command["Destination"].toString();
+
+    emit commandReceived(name, destination);
+
+    QJsonObject response;
+    if (name == "GetStatus" || name == "GetCaptureParameters") {
+        response = statusFor(destination == "System" ? "Mount" : destination);
+    } else if (name == "GetListOfAvailableDirectories") {
+        response["DirectoryList"] = QJsonArray::fromStringList(m_directories);
+    } else if (name == "GetDirectoryContents") {
+        // Each session holds the frames captured while it was the newest
+        QString directory = command["Directory"].toString().section('/', -1);
+        QStringList files = {"FinalStackedMaster.tiff"};
+        for (int i = 1; i <= m_sessionFrames.value(directory); i++) {
+            files.append(QString("frame_%1.jpg").arg(i, 4, 10, QChar('0')));
+        }
+        response["FileList"] = QJsonArray::fromStringList(files);
+    }
+
+    response["Command"] = name;
+    response["Destination"] = command["Source"];
+    response["Source"] = destination;
+    response["SequenceID"] = command["SequenceID"];
+    response["Type"] = "Response";
+    response["ErrorCode"] = 0;
+    response["ErrorMessage"] = "";
+
+    client->sendTextMessage(QJsonDocument(response).toJson(QJsonDocument::Compact));
+}
+
+void SimulatedOrigin::emitStatusNotifications()
+{
+    static const char *sources[] = {"Mount", "Environment", "Focuser", "Disk", "DewHeater", "OrientationSensor"};
+    for (const char *source : sources) {
+        QJsonObject obj = statusFor(source);
+        obj["Command"] = "GetStatus";
+        obj["Destination"] = "All";
+        obj["Source"] = source;
+        obj["SequenceID"] = m_nextSequenceId++;
+        obj["Type"] = "Notification";
+        broadcast(obj);
+    }
+}
+
+void SimulatedOrigin::emitNewImage()
+{
+    m_frameCounter++;
+    m_diskFreeBytes = qMax<qint64>(0, m_diskFreeBytes - BYTES_PER_FRAME);
+    m_sessionFrames[m_directories.last()]++;
+
+    if (m_frameCounter % FRAMES_PER_SESSION == 0) {
+        m_directories.append(QString("Session_%1").arg(m_directories.size() + 1, 3, 10, QChar('0')));
+    }
+
+    double t = simulatedSeconds();
+    QJsonObject obj;
+    obj["Command"] = "NewImageReady";
+    obj["Destination"] = "All";
+    obj["Source"] = "ImageServer";
+    obj["SequenceID"] = m_nextSequenceId++;
+    obj["Type"] = "Notification";
+    obj["FileLocation"] = QString("Images/Temp/%1.jpg").arg(m_frameCounter % 10);
+    obj["ImageType"] = "LIVE";
+    obj["Ra"] = std::fmod(3.53 + t * 7.2921e-5, 2.0 * M_PI);
+    obj["Dec"] = 0.824;
+    obj["Orientation"] = 0.12;
+    obj["FovX"] = 0.0222;
+    obj["FovY"] = 0.0148;
+    broadcast(obj);
+}
+
+void SimulatedOrigin::broadcast(const QJsonObject &obj)
+{
+    QString message = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    for (QWebSocket *client : m_clients) {
+        client->sendTextMessage(message);
+    }
+}
+
+QJsonObject SimulatedOrigin::statusFor(const QString &source) const
+{
+    double t = simulatedSeconds();
+    double hours = t / 3600.0;
+    QJsonObject obj;
+
+    if (source == "Mount") {
+        QDateTime now = QDateTime::currentDateTimeUtc().addMSecs(qint64(t * 1000.0));
+        obj["BatteryLevel"] = hours < 10.0 ? "High" : "Low";
+        obj["BatteryVoltage"] = 12.6 - 0.05 * hours;
+        obj["ChargerStatus"] = "Discharging";
+        obj["Date"] = now.toString("dd MM yyyy");
+        obj["Time"] = now.toString("HH:mm:ss");
+        obj["TimeZone"] = "UTC";
+        obj["Latitude"] = 0.9118493267600084;
+        obj["Longitude"] = 0.0013880067713051129;
+        obj["IsAligned"] = true;
+        obj["IsGotoOver"] = true;
+        obj["IsTracking"] = true;
+        obj["NumAlignRefs"] = 3;
+        obj["Enc0"] = std::fmod(t * 7.2921e-5, 2.0 * M_PI);
+        obj["Enc1"] = 0.824;
+    } else if (source == "Camera") {
+        obj["Binning"] = 1;
+        obj["BitDepth"] = 16;
+        obj["ColorRBalance"] = 1.9;
+        obj["ColorGBalance"] = 1.0;
+        obj["ColorBBalance"] = 1.6;
+        obj["Exposure"] = FRAME_PERIOD_S;
+        obj["ISO"] = 200;
+        obj["Offset"] = 10;
+    } else if (source == "Focuser") {
+        obj["Backlash"] = 40;
+        obj["CalibrationLowerLimit"] = 1000;
+        obj["CalibrationUpperLimit"] = 39000;
+        obj["IsCalibrationComplete"] = true;
+        obj["IsMoveToOver"] = true;
+        obj["NeedAutoFocus"] = false;
+        obj["PercentageCalibrationComplete"] = 100;
+        obj["Position"] = 20000 + int(10.0 * std::sin(hours));
+        obj["RequiresCalibration"] = false;
+        obj["Velocity"] = 0.0;
+    } else if (source == "Environment") {
+        double ambient = 12.0 - 0.6 * hours;
+        obj["AmbientTemperature"] = ambient;
+        obj["CameraTemperature"] = ambient + 8.0;
+        obj["CpuFanOn"] = true;
+        obj["CpuTemperature"] = 45.0 + 2.0 * std::sin(hours);
+        obj["DewPoint"] = ambient - 3.0 + 0.2 * hours;
+        obj["FrontCellTemperature"] = ambient - 0.5;
+        obj["Humidity"] = 70.0 + 2.0 * hours;
+        obj["OtaFanOn"] = false;
+        obj["Recalibrating"] = false;
+    } else if (source == "Disk") {
+        obj["Capacity"] = 64LL * 1024 * 1024 * 1024;
+        obj["FreeBytes"] = m_diskFreeBytes;
+        obj["Level"] = m_diskFreeBytes < 4LL * 1024 * 1024 * 1024 ? "Warning" : "OK";
+    } else if (source == "DewHeater") {
+        obj["Aggression"] = 5;
+        obj["HeaterLevel"] = 0.3;
+        obj["ManualPowerLevel"] = 0.0;
+        obj["Mode"] = "Auto";
+    } else if (source == "OrientationSensor") {
+        obj["Altitude"] = 45;
+    }
+
+    return obj;
+}
+
+const QByteArray &SimulatedOrigin::previewJpeg()
+{
+    if (!m_previewJpeg.isEmpty()) {
+        return m_previewJpeg;
+    }
+
+    // A fixed, reproducible star field: sky glow, read noise and Gaussian stars
+    QImage image(640, 480, QImage::Format_Grayscale8);
+    QRandomGenerator rng(42);
+    for (int y = 0; y < image.height(); y++) {
+        uchar *line = image.scanLine(y);
+        for (int x = 0; x < image.width(); x++) {
+            line[x] = uchar(20 + x / 64 + rng.bounded(6));
+        }
+    }
+    for (int s = 0; s < 120; s++) {
+        int cx = rng.bounded(image.width());
+        int cy = rng.bounded(image.height());
+        double peak = 40.0 + rng.bounded(200);
+        for (int dy = -4; dy <= 4; dy++) {
+            for (int dx = -4; dx <= 4; dx++) {
+                int x = cx + dx, y = cy + dy;
+                if (x < 0 || y < 0 || x >= image.width() || y >= image.height()) continue;
+                uchar *p = image.scanLine(y) + x;
+                int v = *p + int(peak * std::exp(-(dx * dx + dy * dy) / 3.0));
+                *p = uchar(qMin(255, v));
+            }
+        }
+    }
+
+    QBuffer buffer(&m_previewJpeg);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "JPEG", 85);
+    return m_previewJpeg;
+}
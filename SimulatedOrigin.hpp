@@ -0,0 +1,109 @@
+#pragma once
+
+#include <QObject>
+#include <QWebSocketServer>
+#include <QWebSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QHash>
+#include <QList>
+
+/**
+ * @brief Local stand-in for a Celestron Origin telescope
+ *
+ * Serves the mountControlEndpoint WebSocket protocol and the dev2 HTTP
+ * file tree on localhost so the full stack can be exercised without a
+ * scope. All notification periods are divided by an acceleration factor
+ * so a whole night can be replayed in a fraction of the wall-clock time.
+ */
+class SimulatedOrigin : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor
+     * @param acceleration How many simulated seconds pass per real second
+     * @param parent The parent QObject
+     */
+    explicit SimulatedOrigin(double acceleration = 1.0, QObject *parent = nullptr);
+    ~SimulatedOrigin();
+
+    /**
+     * @brief Start listening for WebSocket and HTTP clients
+     *
+     * Like the real scope, both protocols share one port: each new TCP
+     * connection is peeked and either upgraded to a WebSocket or answered
+     * as a plain HTTP file request.
+     * @param port The port to serve both protocols on (0 picks a free port)
+     * @return true if the listeners were started
+     */
+    bool start(quint16 port = 0);
+
+    /**
+     * @brief Stop all listeners and drop connected clients
+     */
+    void stop();
+
+    /**
+     * @brief Get the port the simulator is listening on
+     * @return The HTTP/WebSocket port
+     */
+    quint16 port() const;
+
+    /**
+     * @brief Get the number of simulated seconds elapsed since start()
+     * @return Simulated time in seconds
+     */
+    double simulatedSeconds() const;
+
+    /** @brief Number of frames announced via NewImageReady so far */
+    int framesCaptured() const { return m_frameCounter; }
+
+    /** @brief Number of WebSocket clients currently connected */
+    int clientCount() const { return m_clients.size(); }
+
+signals:
+    /** Signal emitted whenever a command is received from a client */
+    void commandReceived(const QString &command, const QString &destination);
+
+private slots:
+    void onTcpConnection();
+    void onTcpReadyRead();
+    void onNewConnection();
+    void onClientDisconnected();
+    void onTextMessageReceived(const QString &message);
+    void emitStatusNotifications();
+    void emitNewImage();
+
+private:
+    /** @brief Send a packet to every connected client */
+    void broadcast(const QJsonObject &obj);
+
+    /** @brief Answer a plain HTTP GET for a file under dev2 */
+    void serveHttp(QTcpSocket *socket, const QByteArray &request);
+
+    /** @brief Build the body of a status packet for a subsystem */
+    QJsonObject statusFor(const QString &source) const;
+
+    /** @brief Lazily render a synthetic star field preview */
+    const QByteArray &previewJpeg();
+
+    QWebSocketServer *m_wsServer;
+    QTcpServer m_tcpServer;
+    QList<QWebSocket*> m_clients;
+    QTimer m_statusTimer;
+    QTimer m_imageTimer;
+
+    double m_acceleration;
+    qint64 m_startMs;
+    int m_frameCounter;
+    int m_nextSequenceId;
+    qint64 m_diskFreeBytes;
+    QStringList m_directories;
+    QHash<QString, int> m_sessionFrames;
+    QByteArray m_previewJpeg;
+};
@@ -0,0 +1,292 @@
+#include "SkyCoverageIndex.hpp"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QStandardPaths>
+#include <cmath>
+
+namespace {
+    // Spread the bits of v so they occupy the even positions
+    quint32 spreadBits(quint32 v)
+    {
+        v = (v | (v << 8)) & 0x00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    }
+
+    // Gnomonic projection onto the plane tangent at (ra0, dec0); false on the far hemisphere
+    bool project(double ra0, double dec0, double ra, double dec, double &x, double &y)
+    {
+        double cosC = std::sin(dec0) * std::sin(dec) + std::cos(dec0) * std::cos(dec) * std::cos(ra - ra0);
+        if (cosC <= 0.0) return false;
+        x = std::cos(dec) * std::sin(ra - ra0) / cosC;
+        y = (std::cos(dec0) * std::sin(dec) - std::sin(dec0) * std::cos(dec) * std::cos(ra - ra0)) / cosC;
+        return true;
+    }
+
+    void deproject(double ra0, double dec0, double x, double y, double &ra, double &dec)
+    {
+        double rho = std::sqrt(x * x + y * y);
+        if (rho == 0.0) {
+            ra = ra0;
+            dec = dec0;
+            return;
+        }
+        double c = std::atan(rho);
+        dec = std::asin(std::cos(c) * std::sin(dec0) + y * std::sin(c) * std::cos(dec0) / rho);
+        ra = ra0 + std::atan2(x * std::sin(c), rho * std::cos(dec0) * std::cos(c) - y * std::sin(dec0) * std::sin(c));
+    }
+
+    // Approximate cell width; samples are spaced at half of it so no touched cell is missed
+    const double CELL_SIZE = std::sqrt(4.0 * M_PI / (12.0 * SkyCoverageIndex::NSIDE * SkyCoverageIndex::NSIDE));
+}
+
+bool SkyCoverageIndex::Frame::contains(double pointRa, double pointDec) const
+{
+    double x, y;
+    if (!project(ra, dec, pointRa, pointDec, x, y)) return false;
+
+    // Rotate into the frame's axes; the sign of the orientation only matters for non-square frames
+    double u = x * std::cos(orientation) + y * std::sin(orientation);
+    double v = -x * std::sin(orientation) + y * std::cos(orientation);
+    return std::fabs(u) <= std::tan(fovX / 2) && std::fabs(v) <= std::tan(fovY / 2);
+}
+
+SkyCoverageIndex::SkyCoverageIndex(const QString &directory)
+    : m_directory(directory)
+    , m_lastTimestampMs(0)
+    , m_loaded(false)
+{
+    if (m_directory.isEmpty()) {
+        m_directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/sky";
+    }
+    QDir().mkpath(m_directory);
+}
+
+void SkyCoverageIndex::ensureLoaded() const
+{
+    if (m_loaded) return;
+    m_loaded = true;
+
+    QFile file(m_directory + "/frames.jsonl");
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QHash<qint64, int> byTime;
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty()) continue;
+
+        QJsonObject obj = QJsonDocument::fromJson(line).object();
+        if (obj.isEmpty()) {
+            qWarning() << "Skipping unreadable line in" << file.fileName();
+            continue;
+        }
+
+        // Location records name the archive file of a frame recorded earlier
+        if (obj.contains("loc")) {
+            auto it = byTime.constFind(qint64(obj["loc"].toDouble()));
+            if (it != byTime.constEnd()) {
+                m_frames[*it].file = obj["file"].toString();
+            }
+            continue;
+        }
+
+        Frame frame;
+        frame.timestampMs = qint64(obj["t"].toDouble());
+        frame.ra = obj["ra"].toDouble();
+        frame.dec = obj["dec"].toDouble();
+        frame.orientation = obj["rot"].toDouble();
+        frame.fovX = obj["fx"].toDouble();
+        frame.fovY = obj["fy"].toDouble();
+        frame.exposure = obj["exp"].toDouble();
+
+        m_frames.append(frame);
+        byTime.insert(frame.timestampMs, m_frames.size() - 1);
+        index(m_frames.size() - 1);
+    }
+}
+
+quint32 SkyCoverageIndex::cellOf(double ra, double dec, int order)
+{
+    const int nside = 1 << order;
+
+    // ang2pix_nest from the HEALPix reference implementation
+    double z = std::sin(dec);
+    double za = std::fabs(z);
+    double tt = std::fmod(ra, 2 * M_PI);
+    if (tt < 0) tt += 2 * M_PI;
+    tt *= 2.0 / M_PI;   // in [0, 4)
+
+    int face, ix, iy;
+    if (za <= 2.0 / 3.0) {
+        double temp1 = nside * (0.5 + tt);
+        double temp2 = nside * (z * 0.75);
+        int jp = int(temp1 - temp2);
+        int jm = int(temp1 + temp2);
+        int ifp = jp >> order;
+        int ifm = jm >> order;
+        face = ifp == ifm ? (ifp | 4) : (ifp < ifm ? ifp : ifm + 8);
+        ix = jm & (nside - 1);
+        iy = nside - (jp & (nside - 1)) - 1;
+    } else {
+        int ntt = qMin(3, int(tt));
+        double tp = tt - ntt;
+        double tmp = nside * std::sqrt(3 * (1 - za));
+        int jp = qMin(nside - 1, int(tp * tmp));
+        int jm = qMin(nside - 1, int((1.0 - tp) * tmp));
+        if (z >= 0) {
+            face = ntt;
+            ix = nside - jm - 1;
+            iy = nside - jp - 1;
+        } else {
+            face = ntt + 8;
+            ix = jp;
+            iy = jm;
+        }
+    }
+    return (quint32(face) << (2 * order)) + spreadBits(ix) + (spreadBits(iy) << 1);
+}
+
+void SkyCoverageIndex::forEachSample(double ra, double dec, double width, double height, double orientation,
+                                     const std::function<void(double, double)> &visit)
+{
+    double halfU = std::tan(width / 2);
+    double halfV = std::tan(height / 2);
+    int stepsU = qMax(1, int(std::ceil(2 * halfU / (CELL_SIZE / 2))));
+    int stepsV = qMax(1, int(std::ceil(2 * halfV / (CELL_SIZE / 2))));
+
+    for (int i = 0; i <= stepsU; i++) {
+        double u = -halfU + 2 * halfU * i / stepsU;
+        for (int j = 0; j <= stepsV; j++) {
+            double v = -halfV + 2 * halfV * j / stepsV;
+            double x = u * std::cos(orientation) - v * std::sin(orientation);
+            double y = u * std::sin(orientation) + v * std::cos(orientation);
+            double pointRa, pointDec;
+            deproject(ra, dec, x, y, pointRa, pointDec);
+            visit(pointRa, pointDec);
+        }
+    }
+}
+
+void SkyCoverageIndex::index(int frameIndex) const
+{
+    const Frame &frame = m_frames[frameIndex];
+    QSet<quint32> cells;
+    forEachSample(frame.ra, frame.dec, frame.fovX, frame.fovY, frame.orientation,
+                  [&cells](double ra, double dec) { cells.insert(cellOf(ra, dec)); });
+
+    // A cell the frame only clips is credited with the whole exposure
+    for (quint32 cell : cells) {
+        m_cells[cell].append(frameIndex);
+        m_integration[cell] += frame.exposure;
+    }
+}
+
+bool SkyCoverageIndex::addFrame(const Frame &frame)
+{
+    if (frame.fovX <= 0.0 || frame.fovY <= 0.0) return false;
+    if (frame.timestampMs == m_lastTimestampMs) return false;
+    m_lastTimestampMs = frame.timestampMs;
+
+    QJsonObject obj;
+    obj["t"] = double(frame.timestampMs);
+    obj["ra"] = frame.ra;
+    obj["dec"] = frame.dec;
+    obj["rot"] = frame.orientation;
+    obj["fx"] = frame.fovX;
+    obj["fy"] = frame.fovY;
+    obj["exp"] = frame.exposure;
+    append(obj);
+
+    // Not loaded yet: the frame is read back with the rest
+    if (m_loaded) {
+        m_frames.append(frame);
+        index(m_frames.size() - 1);
+    }
+    return true;
+}
+
+void SkyCoverageIndex::locateFrame(qint64 timestampMs, const QString &file)
+{
+    QJsonObject obj;
+    obj["loc"] = double(timestampMs);
+    obj["file"] = file;
+    append(obj);
+
+    if (!m_loaded) return;
+    for (int i = m_frames.size() - 1; i >= 0; i--) {
+        if (m_frames[i].timestampMs == timestampMs) {
+            m_frames[i].file = file;
+            return;
+        }
+    }
+}
+
+void SkyCoverageIndex::append(const QJsonObject &obj)
+{
+    QFile file(m_directory + "/frames.jsonl");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed to append to sky coverage index:" << file.fileName();
+        return;
+    }
+    file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact) + "\n");
+}
+
+bool SkyCoverageIndex::findFrame(const QString &fileName, Frame *frame) const
+{
+    ensureLoaded();
+
+    // Archive names are only unique within their observation
+    QFileInfo info(fileName);
+    const QString suffix = "/" + info.dir().dirName() + "/" + info.completeBaseName();
+    for (int i = m_frames.size() - 1; i >= 0; i--) {
+        if (!m_frames[i].file.isEmpty() && m_frames[i].file.endsWith(suffix)) {
+            *frame = m_frames[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+QVector<SkyCoverageIndex::Frame> SkyCoverageIndex::framesCovering(double ra, double dec) const
+{
+    ensureLoaded();
+    QVector<Frame> result;
+    for (int frameIndex : m_cells.value(cellOf(ra, dec))) {
+        if (m_frames[frameIndex].contains(ra, dec)) {
+            result.append(m_frames[frameIndex]);
+        }
+    }
+    return result;
+}
+
+SkyCoverageIndex::Coverage SkyCoverageIndex::coverage(double ra, double dec, double width, double height,
+                                                      double orientation, double targetSeconds) const
+{
+    ensureLoaded();
+    Coverage result;
+    result.minSeconds = -1.0;
+    QSet<quint32> seen;
+    forEachSample(ra, dec, width, height, orientation, [&](double pointRa, double pointDec) {
+        quint32 cell = cellOf(pointRa, pointDec);
+        if (seen.contains(cell)) return;
+        seen.insert(cell);
+
+        double seconds = m_integration.value(cell);
+        result.cells++;
+        if (result.minSeconds < 0 || seconds < result.minSeconds) result.minSeconds = seconds;
+        if (seconds > 0 && seconds >= targetSeconds) {
+            result.coveredCells++;
+        } else {
+            result.gaps.append(qMakePair(pointRa, pointDec));
+        }
+    });
+    if (result.minSeconds < 0) result.minSeconds = 0.0;
+    return result;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <QHash>
+#include <QJsonObject>
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+/**
+ * @brief Persistent index of every captured frame's footprint on the sky
+ *
+ * Each frame reported by NewImageReady is appended to frames.jsonl with its
+ * capture time, centre, orientation, field of view and exposure; its archive
+ * path follows in a later line once the downloader has located it. In memory
+ * the sky is cut into HEALPix cells (nested scheme, order 8: about 0.23°
+ * across) and every cell lists the frames whose footprint touches it along
+ * with the total integration it has received, so point and region queries
+ * never scan the frame list.
+ *
+ * The file is only read and rasterised on the first query, so recording
+ * frames costs an append and an unused index costs nothing at start-up.
+ *
+ * All angles are in radians, as the telescope reports them.
+ */
+class SkyCoverageIndex
+{
+public:
+    struct Frame {
+        qint64 timestampMs = 0;     // exposure start, identifies the frame
+        double ra = 0.0;
+        double dec = 0.0;
+        double orientation = 0.0;
+        double fovX = 0.0;
+        double fovY = 0.0;
+        double exposure = 0.0;      // seconds
+        QString file;               // archive path without suffix, empty until located
+
+        /** @brief Whether a sky position falls inside the footprint */
+        bool contains(double ra, double dec) const;
+    };
+
+    /** @brief Result of a region query */
+    struct Coverage {
+        int cells = 0;
+        int coveredCells = 0;
+        double minSeconds = 0.0;                    // least integration of any cell in the region
+        QVector<QPair<double, double>> gaps;        // (ra, dec) of samples in cells below the target
+    };
+
+    static const int ORDER = 8;
+    static const int NSIDE = 1 << ORDER;
+
+    /**
+     * @brief Constructor; the existing index is loaded when first needed
+     * @param directory Where frames.jsonl is kept; defaults to sky/ under the app data location
+     */
+    explicit SkyCoverageIndex(const QString &directory = QString());
+
+    /** @brief HEALPix nested cell containing a position, at this index's order or another */
+    static quint32 cellOf(double ra, double dec, int order = ORDER);
+
+    /**
+     * @brief Record a frame and index its footprint
+     * @param frame The frame; ignored if it has no field of view or repeats the last frame's capture time
+     * @return True if the frame was added
+     */
+    bool addFrame(const Frame &frame);
+
+    /**
+     * @brief Record where on the telescope a frame was archived
+     * @param timestampMs The frame's capture time, as passed to addFrame()
+     * @param file Its archive path without suffix, e.g. Images/Astrophotography/<observation>/<frame>
+     */
+    void locateFrame(qint64 timestampMs, const QString &file);
+
+    /** @brief Number of frames indexed */
+    int frameCount() const { ensureLoaded(); return m_frames.size(); }
+
+    /**
+     * @brief The most recent frame archived as a file
+     * @param fileName The archive path or a downloaded copy; matched on observation directory and base name
+     * @param frame Receives the frame
+     */
+    bool findFrame(const QString &fileName, Frame *frame) const;
+
+    /** @brief Frames whose footprint contains a position, oldest first */
+    QVector<Frame> framesCovering(double ra, double dec) const;
+
+    /** @brief Total exposure in seconds of every cell that has any */
+    const QHash<quint32, double> &integrationPerCell() const { ensureLoaded(); return m_integration; }
+
+    /**
+     * @brief How well a rectangular region, e.g. a planned mosaic, is covered
+     * @param ra Region centre
+     * @param dec Region centre
+     * @param width Region width
+     * @param height Region height
+     * @param orientation Position angle of the region's width axis
+     * @param targetSeconds Integration a cell needs to count as covered
+     */
+    Coverage coverage(double ra, double dec, double width, double height, double orientation,
+                      double targetSeconds) const;
+
+private:
+    /** @brief Visit sample points spaced well inside a cell across a rectangle on the sky */
+    static void forEachSample(double ra, double dec, double width, double height, double orientation,
+                              const std::function<void(double, double)> &visit);
+
+    /** @brief Read frames.jsonl and rasterise every frame, once */
+    void ensureLoaded() const;
+
+    void index(int frameIndex) const;
+
+    /** @brief Append one record to frames.jsonl */
+    void append(const QJsonObject &obj);
+
+    QString m_directory;
+    qint64 m_lastTimestampMs;
+
+    // Built from frames.jsonl on first use
+    mutable bool m_loaded;
+    mutable QVector<Frame> m_frames;
+
+    /** Cell -> indices of the frames touching it */
+    mutable QHash<quint32, QVector<int>> m_cells;
+
+    /** Cell -> total exposure in seconds */
+    mutable QHash<quint32, double> m_integration;
+};
@@ -0,0 +1,129 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDir>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTimer>
+#include "AlpacaServer.hpp"
+#include "AutoDownloader.hpp"
+#include "OriginBackend.hpp"
+#include "SimulatedOrigin.hpp"
+#include "SoakMonitor.hpp"
+#include "TelescopeLink.hpp"
+
+/**
+ * @brief Overnight soak test
+ *
+ * Runs the backend, the Alpaca server and the auto downloader against a
+ * SimulatedOrigin for a whole simulated night, then fails (exit code 1)
+ * if memory, handle count, event-loop latency, endpoint latency or the
+ * pending-command map trend upward faster than the configured limits.
+ *
+ * Example: SoakTest --hours 10 --accel 60 --output soak.csv
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("OriginSoakTest");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Soak test the Origin monitor stack against a simulated telescope");
+    parser.addHelpOption();
+    QCommandLineOption hoursOption("hours", "Simulated hours to run (default 10).", "hours", "10");
+    QCommandLineOption accelOption("accel", "Simulated seconds per real second (default 60).", "factor", "60");
+    QCommandLineOption outputOption("output", "CSV file for samples.", "file", "soak.csv");
+    QCommandLineOption alpacaPortOption("alpaca-port", "Port for the Alpaca server (default 11112).", "port", "11112");
+    QCommandLineOption rssOption("max-rss-growth", "Allowed RSS growth in MB per hour.", "mb", "2");
+    QCommandLineOption handlesOption("max-handle-growth", "Allowed handle growth per hour.", "count", "1");
+    QCommandLineOption latencyOption("max-latency-growth", "Allowed endpoint latency growth in ms per hour.", "ms", "2");
+    parser.addOptions({hoursOption, accelOption, outputOption, alpacaPortOption,
+                       rssOption, handlesOption, latencyOption});
+    parser.process(app);
+
+    double hours = parser.value(hoursOption).toDouble();
+    double acceleration = parser.value(accelOption).toDouble();
+    if (hours <= 0.0 || acceleration <= 0.0) {
+        qCritical() << "--hours and --accel must be positive";
+        return 2;
+    }
+
+    // Simulated telescope
+    SimulatedOrigin origin(acceleration);
+    if (!origin.start()) {
+        qCritical() << "Failed to start simulated Origin";
+        return 2;
+    }
+    qDebug() << "Simulated Origin listening on port" << origin.port();
+
+    // Backend polling the simulator, scaled to the simulated clock
+    OriginBackend backend;
+    backend.setStatusPollInterval(qMax(10, int(2000 / acceleration)));
+    if (!backend.connectToTelescope("127.0.0.1", origin.port())) {
+        qCritical() << "Backend failed to connect to simulated Origin";
+        return 2;
+    }
+
+    // Alpaca server in front of the backend, as in AlpacaMain
+    AlpacaServer alpaca;
+    alpaca.setTelescopeBackend(&backend);
+    int alpacaPort = parser.value(alpacaPortOption).toInt();
+    if (!alpaca.start(alpacaPort)) {
+        qCritical() << "Failed to start Alpaca server on port" << alpacaPort;
+        return 2;
+    }
+
+    // Auto downloader on its own connection, writing to a scratch directory
+    QTemporaryDir downloadDir;
+    TelescopeLink downloaderLink;
+    AutoDownloader downloader(&downloaderLink, QString("127.0.0.1:%1").arg(origin.port()),
+                              downloadDir.path());
+    downloaderLink.open("127.0.0.1", origin.port());
+
+    // Re-run the downloader every simulated 30 minutes, like a user leaving it on
+    QTimer downloadTimer;
+    QObject::connect(&downloadTimer, &QTimer::timeout, &downloader, &AutoDownloader::startDownload);
+    downloadTimer.start(qMax(100, int(30 * 60 * 1000 / acceleration)));
+
+    SoakMonitor::Limits limits;
+    limits.rssMBPerHour = parser.value(rssOption).toDouble();
+    limits.handlesPerHour = parser.value(handlesOption).toDouble();
+    limits.endpointLatencyMsPerHour = parser.value(latencyOption).toDouble();
+
+    SoakMonitor monitor(acceleration);
+    monitor.setLimits(limits);
+    if (!monitor.setOutputFile(parser.value(outputOption))) {
+        return 2;
+    }
+    monitor.addCounter("pending_commands", [&backend]() { return double(backend.pendingCommandCount()); });
+    monitor.addCounter("ws_clients", [&origin]() { return double(origin.clientCount()); });
+
+    QString alpacaBase = QString("http://127.0.0.1:%1/api/v1").arg(alpacaPort);
+    monitor.addEndpoint("alpaca_altitude", QUrl(alpacaBase + "/telescope/0/altitude"));
+    monitor.addEndpoint("alpaca_camerastate", QUrl(alpacaBase + "/camera/0/camerastate"));
+    monitor.addEndpoint("alpaca_configureddevices", QUrl(QString("http://127.0.0.1:%1/management/v1/configureddevices").arg(alpacaPort)));
+    monitor.addEndpoint("origin_preview", QUrl(QString("http://127.0.0.1:%1/SmartScope-1.0/dev2/Images/Temp/0.jpg").arg(origin.port())));
+
+    monitor.start();
+
+    int runMs = int(hours * 3600.0 * 1000.0 / acceleration);
+    qDebug() << "Soaking for" << hours << "simulated hours (" << runMs / 1000 << "s real time)";
+
+    int exitCode = 0;
+    QTimer::singleShot(runMs, &app, [&]() {
+        monitor.stop();
+        downloadTimer.stop();
+        downloader.stopDownload();
+
+        qDebug() << "Frames captured:" << origin.framesCaptured();
+        exitCode = monitor.evaluate() ? 0 : 1;
+        qDebug() << (exitCode == 0 ? "Soak test PASSED" : "Soak test FAILED");
+
+        backend.disconnectFromTelescope();
+        alpaca.stop();
+        origin.stop();
+        app.exit(exitCode);
+    });
+
+    return app.exec();
+}
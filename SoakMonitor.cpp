@@ -0,0 +1,248 @@
+#include "SoakMonitor.hpp"
+#include <QDebug>
+#include <QDir>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <algorithm>
+
+#if defined(Q_OS_MACOS)
+#include <mach/mach.h>
+#include <libproc.h>
+#include <unistd.h>
+#elif defined(Q_OS_LINUX)
+#include <unistd.h>
+#endif
+
+SoakMonitor::SoakMonitor(double acceleration, QObject *parent)
+    : QObject(parent)
+    , m_acceleration(acceleration > 0.0 ? acceleration : 1.0)
+    , m_lastLoopTick(0)
+    , m_loopIntervalMs(20)
+    , m_maxLoopLatencyMs(0.0)
+    , m_headerWritten(false)
+{
+    m_loopTimer.setTimerType(Qt::PreciseTimer);
+    m_loopTimer.setInterval(m_loopIntervalMs);
+    connect(&m_loopTimer, &QTimer::timeout, this, &SoakMonitor::onLoopTick);
+    connect(&m_sampleTimer, &QTimer::timeout, this, &SoakMonitor::onSample);
+    connect(&m_pollTimer, &QTimer::timeout, this, &SoakMonitor::onPoll);
+}
+
+bool SoakMonitor::setOutputFile(const QString &path)
+{
+    m_outputFile.setFileName(path);
+    if (!m_outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qWarning() << "Failed to open soak output file:" << path;
+        return false;
+    }
+    m_output.setDevice(&m_outputFile);
+    return true;
+}
+
+void SoakMonitor::addCounter(const QString &name, std::function<double()> probe)
+{
+    m_counters[name] = probe;
+}
+
+void SoakMonitor::addEndpoint(const QString &name, const QUrl &url)
+{
+    EndpointStats stats;
+    stats.url = url;
+    m_endpoints[name] = stats;
+}
+
+void SoakMonitor::start(double sampleEverySimSeconds, int pollEveryMs)
+{
+    m_runClock.start();
+    m_loopClock.start();
+    m_lastLoopTick = 0;
+
+    m_loopTimer.start();
+    m_sampleTimer.start(qMax(10, int(sampleEverySimSeconds * 1000.0 / m_acceleration)));
+    m_pollTimer.start(pollEveryMs);
+}
+
+void SoakMonitor::stop()
+{
+    m_loopTimer.stop();
+    m_sampleTimer.stop();
+    m_pollTimer.stop();
+
+    if (m_outputFile.isOpen()) {
+        m_output.flush();
+        m_outputFile.close();
+    }
+}
+
+void SoakMonitor::onLoopTick()
+{
+    // Lateness of this tick relative to its schedule is the time the event
+    // loop was busy with something else
+    qint64 now = m_loopClock.elapsed();
+    if (m_lastLoopTick > 0) {
+        double latency = qMax<qint64>(0, now - m_lastLoopTick - m_loopIntervalMs);
+        m_loopLatencies.append(latency);
+        m_maxLoopLatencyMs = qMax(m_maxLoopLatencyMs, latency);
+    }
+    m_lastLoopTick = now;
+}
+
+void SoakMonitor::onPoll()
+{
+    for (auto it = m_endpoints.begin(); it != m_endpoints.end(); ++it) {
+        // One request in flight per endpoint, like a well-behaved client
+        if (it->inFlight) continue;
+
+        const QString name = it.key();
+        QElapsedTimer *clock = new QElapsedTimer();
+        clock->start();
+        it->inFlight = true;
+
+        QNetworkReply *reply = m_networkManager.get(QNetworkRequest(it->url));
+        connect(reply, &QNetworkReply::finished, this, [this, reply, clock, name]() {
+            EndpointStats &stats = m_endpoints[name];
+            double ms = clock->nsecsElapsed() / 1.0e6;
+            delete clock;
+
+            stats.inFlight = false;
+            if (reply->error() == QNetworkReply::NoError) {
+                stats.count++;
+                stats.totalMs += ms;
+                stats.maxMs = qMax(stats.maxMs, ms);
+            } else {
+                stats.failures++;
+            }
+            reply->deleteLater();
+        });
+    }
+}
+
+void SoakMonitor::onSample()
+{
+    double simHours = m_runClock.elapsed() * m_acceleration / 3.6e6;
+
+    // Event-loop latency as the 99th percentile over the window
+    double loopP99 = 0.0;
+    if (!m_loopLatencies.isEmpty()) {
+        std::sort(m_loopLatencies.begin(), m_loopLatencies.end());
+        loopP99 = m_loopLatencies[int((m_loopLatencies.size() - 1) * 0.99)];
+    }
+
+    QStringList names;
+    QVector<double> values;
+
+    names << "rss_mb" << "handles" << "loop_p99_ms" << "loop_max_ms";
+    values << residentSetBytes() / (1024.0 * 1024.0) << openHandleCount() << loopP99 << m_maxLoopLatencyMs;
+    record("rss_mb", simHours, values[0], m_limits.rssMBPerHour);
+    record("handles", simHours, values[1], m_limits.handlesPerHour);
+    record("loop_p99_ms", simHours, values[2], m_limits.loopLatencyMsPerHour);
+
+    for (auto it = m_counters.constBegin(); it != m_counters.constEnd(); ++it) {
+        double value = it.value()();
+        names << it.key();
+        values << value;
+        record(it.key(), simHours, value, m_limits.counterPerHour);
+    }
+
+    for (auto it = m_endpoints.begin(); it != m_endpoints.end(); ++it) {
+        double mean = it->count > 0 ? it->totalMs / it->count : 0.0;
+        names << it.key() + "_mean_ms" << it.key() + "_max_ms" << it.key() + "_failures";
+        values << mean << it->maxMs << it->failures;
+        if (it->count > 0) {
+            record(it.key() + "_mean_ms", simHours, mean, m_limits.endpointLatencyMsPerHour);
+        }
+        it->count = 0;
+        it->totalMs = 0.0;
+        it->maxMs = 0.0;
+    }
+
+    m_loopLatencies.clear();
+    m_maxLoopLatencyMs = 0.0;
+
+    if (m_outputFile.isOpen()) {
+        if (!m_headerWritten) {
+            m_output << "sim_hours," << names.join(',') << "\n";
+            m_headerWritten = true;
+        }
+        m_output << QString::number(simHours, 'f', 4);
+        for (double value : values) {
+            m_output << "," << QString::number(value, 'f', 3);
+        }
+        m_output << "\n";
+        m_output.flush();
+    }
+}
+
+void SoakMonitor::record(const QString &name, double hours, double value, double limitPerHour)
+{
+    Series &series = m_series[name];
+    series.hours.append(hours);
+    series.values.append(value);
+    series.limitPerHour = limitPerHour;
+}
+
+bool SoakMonitor::evaluate()
+{
+    bool passed = true;
+
+    for (auto it = m_series.constBegin(); it != m_series.constEnd(); ++it) {
+        const Series &series = it.value();
+
+        // Skip the warm-up: caches and pools legitimately fill at start
+        int first = int(series.hours.size() * m_limits.warmupFraction);
+        int n = series.hours.size() - first;
+        if (n < 3) continue;
+
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (int i = first; i < series.hours.size(); i++) {
+            double x = series.hours[i], y = series.values[i];
+            sx += x; sy += y; sxx += x * x; sxy += x * y;
+        }
+        double denominator = n * sxx - sx * sx;
+        double slope = denominator != 0.0 ? (n * sxy - sx * sy) / denominator : 0.0;
+
+        bool ok = slope <= series.limitPerHour;
+        passed = passed && ok;
+
+        qInfo().noquote() << QString("%1 %2: trend %3/h (limit %4/h), last %5")
+                                 .arg(ok ? "PASS" : "FAIL", -5)
+                                 .arg(it.key(), -28)
+                                 .arg(slope, 0, 'f', 3)
+                                 .arg(series.limitPerHour, 0, 'f', 3)
+                                 .arg(series.values.last(), 0, 'f', 3);
+    }
+
+    return passed;
+}
+
+qint64 SoakMonitor::residentSetBytes()
+{
+#if defined(Q_OS_MACOS)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                  reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS) {
+        return qint64(info.resident_size);
+    }
+    return 0;
+#elif defined(Q_OS_LINUX)
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly)) return 0;
+    QList<QByteArray> fields = statm.readAll().split(' ');
+    return fields.size() > 1 ? fields[1].toLongLong() * sysconf(_SC_PAGESIZE) : 0;
+#else
+    return 0;
+#endif
+}
+
+int SoakMonitor::openHandleCount()
+{
+#if defined(Q_OS_MACOS)
+    int bytes = proc_pidinfo(getpid(), PROC_PIDLISTFDS, 0, nullptr, 0);
+    return bytes > 0 ? bytes / int(sizeof(proc_fdinfo)) : 0;
+#elif defined(Q_OS_LINUX)
+    return QDir("/proc/self/fd").entryList(QDir::NoDotAndDotDot | QDir::AllEntries | QDir::System).size();
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QVector>
+#include <QFile>
+#include <QTextStream>
+#include <QNetworkAccessManager>
+#include <QUrl>
+#include <functional>
+
+/**
+ * @brief Records resource and latency metrics over a long soak run
+ *
+ * Samples process RSS, open handle count, event-loop latency and the
+ * latency of every polled HTTP endpoint at a fixed simulated interval,
+ * writes them to a CSV file, and at the end fits a least-squares trend
+ * to each series so slow leaks fail the run instead of surfacing after
+ * a real night at the telescope.
+ */
+class SoakMonitor : public QObject {
+    Q_OBJECT
+
+public:
+    /** Growth limits per simulated hour; a series fails if its trend exceeds its limit */
+    struct Limits {
+        double rssMBPerHour = 2.0;
+        double handlesPerHour = 1.0;
+        double loopLatencyMsPerHour = 1.0;
+        double endpointLatencyMsPerHour = 2.0;
+        double counterPerHour = 5.0;
+        double warmupFraction = 0.1;
+    };
+
+    /**
+     * @brief Constructor
+     * @param acceleration How many simulated seconds pass per real second
+     * @param parent The parent QObject
+     */
+    explicit SoakMonitor(double acceleration, QObject *parent = nullptr);
+
+    /**
+     * @brief Set the CSV file to stream samples into
+     * @param path Output file path
+     * @return true if the file could be opened
+     */
+    bool setOutputFile(const QString &path);
+
+    /** @brief Replace the default growth limits */
+    void setLimits(const Limits &limits) { m_limits = limits; }
+
+    /**
+     * @brief Track an application counter (e.g. pending command map size)
+     * @param name Column name in the CSV
+     * @param probe Callable returning the current value
+     */
+    void addCounter(const QString &name, std::function<double()> probe);
+
+    /**
+     * @brief Poll an HTTP endpoint and record its latency
+     * @param name Column name in the CSV
+     * @param url URL to GET
+     */
+    void addEndpoint(const QString &name, const QUrl &url);
+
+    /**
+     * @brief Begin sampling
+     * @param sampleEverySimSeconds Sampling period in simulated seconds
+     * @param pollEveryMs Real-time period between endpoint polls
+     */
+    void start(double sampleEverySimSeconds = 60.0, int pollEveryMs = 1000);
+
+    /** @brief Stop sampling and close the CSV */
+    void stop();
+
+    /**
+     * @brief Fit trends over all recorded series and print a report
+     * @return true if every series stayed within its limit
+     */
+    bool evaluate();
+
+    /** @brief Current resident set size of this process in bytes */
+    static qint64 residentSetBytes();
+
+    /** @brief Current number of open file descriptors / handles */
+    static int openHandleCount();
+
+private slots:
+    void onLoopTick();
+    void onSample();
+    void onPoll();
+
+private:
+    struct Series {
+        QVector<double> hours;
+        QVector<double> values;
+        double limitPerHour = 0.0;
+    };
+
+    struct EndpointStats {
+        QUrl url;
+        bool inFlight = false;
+        int count = 0;
+        double totalMs = 0.0;
+        double maxMs = 0.0;
+        int failures = 0;
+    };
+
+    void record(const QString &name, double hours, double value, double limitPerHour);
+
+    double m_acceleration;
+    Limits m_limits;
+
+    QTimer m_loopTimer;
+    QTimer m_sampleTimer;
+    QTimer m_pollTimer;
+    QElapsedTimer m_loopClock;
+    QElapsedTimer m_runClock;
+    qint64 m_lastLoopTick;
+    int m_loopIntervalMs;
+    double m_maxLoopLatencyMs;
+    QVector<double> m_loopLatencies;
+
+    QNetworkAccessManager m_networkManager;
+    QMap<QString, EndpointStats> m_endpoints;
+    QMap<QString, std::function<double()>> m_counters;
+    QMap<QString, Series> m_series;
+
+    QFile m_outputFile;
+    QTextStream m_output;
+    bool m_headerWritten;
+};
@@ -0,0 +1,47 @@
+QT += core gui network websockets httpserver
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = SoakTest
+TEMPLATE = app
+
+# Overnight soak harness: runs the backend, Alpaca server and auto
+# downloader against a simulated Origin and fails on resource growth.
+# Usage: SoakTest --hours 10 --accel 60 --output soak.csv
+
+SOURCES += \
+    SoakMain.cpp \
+    SoakMonitor.cpp \
+    SimulatedOrigin.cpp \
+    OriginBackend.cpp \
+    AlpacaServer.cpp \
+    AutoDownloader.cpp \
+    BackgroundModel.cpp \
+    ClockSync.cpp \
+    FitsWriter.cpp \
+    FrameQualityAnalyzer.cpp \
+    MjpegStreamer.cpp \
+    TelescopeDataProcessor.cpp \
+    TelescopeLink.cpp
+
+HEADERS += \
+    SoakMonitor.hpp \
+    SimulatedOrigin.hpp \
+    OriginBackend.hpp \
+    AlpacaServer.hpp \
+    AutoDownloader.hpp \
+    BackgroundModel.hpp \
+    ClockSync.hpp \
+    FitsWriter.hpp \
+    FrameQualityAnalyzer.hpp \
+    MjpegStreamer.hpp \
+    ParallelFor.hpp \
+    TelescopeDataProcessor.hpp \
+    TelescopeData.hpp \
+    TelescopeLink.hpp \
+    SpscQueue.hpp
+
+macx {
+    QMAKE_MACOSX_DEPLOYMENT_TARGET = 10.14
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Bounded lock-free single-producer/single-consumer ring buffer
+ *
+ * Exactly one thread may call push() and exactly one other thread may call
+ * pop(). The head and tail indices live on separate cache lines so the two
+ * sides do not false-share.
+ */
+template <typename T>
+class SpscQueue {
+public:
+    /**
+     * @brief Constructor
+     * @param capacity Maximum number of queued items (rounded up to a power of two)
+     */
+    explicit SpscQueue(size_t capacity = 1024)
+    {
+        size_t size = 2;
+        while (size < capacity + 1) size <<= 1;
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * @brief Append an item (producer thread only)
+     * @param item The item to move into the queue
+     * @return false if the queue is full; item is left untouched
+     */
+    bool push(T &item)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t next = (tail + 1) & m_mask;
+        if (next == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        m_slots[tail] = std::move(item);
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest item (consumer thread only)
+     * @param item Receives the item
+     * @return false if the queue is empty
+     */
+    bool pop(T &item)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(m_slots[head]);
+        m_slots[head] = T();
+        m_head.store((head + 1) & m_mask, std::memory_order_release);
+        return true;
+    }
+
+    /** @brief Whether the queue is empty (approximate from the producer side) */
+    bool isEmpty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> m_slots;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+};
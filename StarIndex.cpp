@@ -0,0 +1,164 @@
+#include "StarIndex.hpp"
+#include "SkyCoverageIndex.hpp"
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const quint32 MAGIC = 0x4f534958;  // "OSIX"
+    const quint32 VERSION = 1;
+
+    // Approximate cell width; samples are spaced at half of it so no touched cell is missed
+    const double CELL_SIZE = std::sqrt(4.0 * M_PI / StarIndex::CELLS);
+
+    void deproject(double ra0, double dec0, double x, double y, double &ra, double &dec)
+    {
+        double rho = std::sqrt(x * x + y * y);
+        if (rho == 0.0) {
+            ra = ra0;
+            dec = dec0;
+            return;
+        }
+        double c = std::atan(rho);
+        dec = std::asin(std::cos(c) * std::sin(dec0) + y * std::sin(c) * std::cos(dec0) / rho);
+        ra = ra0 + std::atan2(x * std::sin(c), rho * std::cos(dec0) * std::cos(c) - y * std::sin(dec0) * std::sin(c));
+    }
+}
+
+QString StarIndex::defaultPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/stars.idx";
+}
+
+StarIndex::PackedStar StarIndex::pack(const Star &star)
+{
+    double ra = std::fmod(star.ra, 2 * M_PI);
+    if (ra < 0) ra += 2 * M_PI;
+
+    PackedStar packed;
+    packed.ra = quint32(qMin(4294967295.0, std::round(ra / (2 * M_PI) * 4294967296.0)));
+    packed.dec = qint32(qBound(-2147483647.0, std::round(star.dec / M_PI * 2147483648.0), 2147483647.0));
+    packed.mag = qint16(qBound(-32768.0, std::round(star.mag * 1000.0), 32767.0));
+    return packed;
+}
+
+StarIndex::Star StarIndex::unpack(const PackedStar &packed)
+{
+    Star star;
+    star.ra = packed.ra / 4294967296.0 * 2 * M_PI;
+    star.dec = packed.dec / 2147483648.0 * M_PI;
+    star.mag = packed.mag / 1000.0f;
+    return star;
+}
+
+void StarIndex::build(const QVector<Star> &stars, int perCell)
+{
+    QVector<QVector<PackedStar>> cells(CELLS);
+    for (const Star &star : stars) {
+        cells[SkyCoverageIndex::cellOf(star.ra, star.dec, ORDER)].append(pack(star));
+    }
+
+    m_cellStart.resize(CELLS + 1);
+    m_stars.clear();
+    for (int c = 0; c < CELLS; c++) {
+        QVector<PackedStar> &cell = cells[c];
+        std::sort(cell.begin(), cell.end(), [](const PackedStar &a, const PackedStar &b) { return a.mag < b.mag; });
+        m_cellStart[c] = quint32(m_stars.size());
+        m_stars += cell.mid(0, perCell);
+        cell = QVector<PackedStar>();
+    }
+    m_cellStart[CELLS] = quint32(m_stars.size());
+}
+
+bool StarIndex::save(const QString &path) const
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write star index:" << path << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream << MAGIC << VERSION << quint32(ORDER) << quint32(m_stars.size());
+    for (quint32 start : m_cellStart) stream << start;
+    for (const PackedStar &star : m_stars) stream << star.ra << star.dec << star.mag;
+
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        qWarning() << "Failed to write star index:" << path << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool StarIndex::load(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open star index:" << path << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0, version = 0, order = 0, count = 0;
+    stream >> magic >> version >> order >> count;
+    if (magic != MAGIC || version != VERSION || order != quint32(ORDER)) {
+        qWarning() << "Not a star index of this version:" << path;
+        return false;
+    }
+
+    QVector<quint32> cellStart(CELLS + 1);
+    for (quint32 &start : cellStart) stream >> start;
+    QVector<PackedStar> stars(count);
+    for (PackedStar &star : stars) stream >> star.ra >> star.dec >> star.mag;
+
+    if (stream.status() != QDataStream::Ok || cellStart[CELLS] != count) {
+        qWarning() << "Corrupt star index:" << path;
+        return false;
+    }
+
+    m_cellStart = cellStart;
+    m_stars = stars;
+    qDebug() << "Loaded" << count << "stars from" << path;
+    return true;
+}
+
+QVector<StarIndex::Star> StarIndex::starsWithin(double ra, double dec, double radius, int maxStars) const
+{
+    QVector<Star> result;
+    if (m_stars.isEmpty()) return result;
+
+    // Cells touched by the disc, from samples on the tangent plane
+    QSet<quint32> cells;
+    const double half = std::tan(qMin(radius + CELL_SIZE / 2, 1.4));
+    const int steps = qMax(1, int(std::ceil(2 * half / (CELL_SIZE / 2))));
+    for (int i = 0; i <= steps; i++) {
+        for (int j = 0; j <= steps; j++) {
+            double pointRa, pointDec;
+            deproject(ra, dec, -half + 2 * half * i / steps, -half + 2 * half * j / steps, pointRa, pointDec);
+            cells.insert(SkyCoverageIndex::cellOf(pointRa, pointDec, ORDER));
+        }
+    }
+
+    const double cosRadius = std::cos(radius);
+    const double sinDec = std::sin(dec);
+    const double cosDec = std::cos(dec);
+    for (quint32 cell : cells) {
+        for (quint32 i = m_cellStart[cell]; i < m_cellStart[cell + 1]; i++) {
+            Star star = unpack(m_stars[i]);
+            double cosDistance = sinDec * std::sin(star.dec) + cosDec * std::cos(star.dec) * std::cos(star.ra - ra);
+            if (cosDistance >= cosRadius) result.append(star);
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const Star &a, const Star &b) { return a.mag < b.mag; });
+    if (result.size() > maxStars) result.resize(maxStars);
+    return result;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief Compact all-sky star catalogue for offline plate solving
+ *
+ * Stars are grouped by HEALPix cell (nested scheme, order 6: about 0.9°
+ * across) and sorted by magnitude within each cell, so a query around a
+ * position reads a handful of cells and stops at the magnitude it needs.
+ * Only the brightest stars of each cell are kept, which gives an even
+ * density over the sky without spending space on the Milky Way.
+ *
+ * A star takes 10 bytes: RA and Dec as fixed-point 32-bit angles and the
+ * magnitude in millimag, about 0.005" resolution. The file is written by
+ * StarIndexTool from a catalogue in CSV form (e.g. Tycho-2 or a Gaia
+ * extract); none is shipped with the application.
+ *
+ * All angles are in radians.
+ */
+class StarIndex
+{
+public:
+    struct Star {
+        double ra = 0.0;
+        double dec = 0.0;
+        float mag = 0.0f;
+    };
+
+    static const int ORDER = 6;
+    static const int CELLS = 12 << (2 * ORDER);
+
+    /** @brief stars.idx in the application data directory */
+    static QString defaultPath();
+
+    /**
+     * @brief Build the index from a catalogue
+     * @param stars Every star, in any order
+     * @param perCell Number of the brightest stars kept in each cell
+     */
+    void build(const QVector<Star> &stars, int perCell);
+
+    bool load(const QString &path);
+    bool save(const QString &path) const;
+
+    bool isEmpty() const { return m_stars.isEmpty(); }
+    int size() const { return m_stars.size(); }
+
+    /**
+     * @brief Stars within a radius of a position, brightest first
+     * @param ra Centre
+     * @param dec Centre
+     * @param radius Search radius
+     * @param maxStars Only the brightest this many are returned
+     */
+    QVector<Star> starsWithin(double ra, double dec, double radius, int maxStars) const;
+
+private:
+    struct PackedStar {
+        quint32 ra;     // 2^32 per turn
+        qint32 dec;     // 2^31 per half turn
+        qint16 mag;     // millimag
+    };
+
+    static PackedStar pack(const Star &star);
+    static Star unpack(const PackedStar &packed);
+
+    /** Cell c holds m_stars[m_cellStart[c]] up to m_stars[m_cellStart[c + 1]] */
+    QVector<quint32> m_cellStart;
+    QVector<PackedStar> m_stars;
+};
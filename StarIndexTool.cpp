@@ -0,0 +1,139 @@
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QFile>
+#include <QGuiApplication>
+#include <QImage>
+#include <QRegularExpression>
+#include "PlateSolver.hpp"
+#include "StarIndex.hpp"
+
+namespace {
+    const double DEGREES = M_PI / 180.0;
+
+    int buildIndex(const QString &catalogPath, const QString &indexPath, int perCell, double maxMag,
+                   const QList<int> &columns)
+    {
+        QFile catalog(catalogPath);
+        if (!catalog.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            qCritical() << "Cannot open" << catalogPath << catalog.errorString();
+            return 2;
+        }
+
+        // Comma, semicolon, pipe or whitespace separated; lines that do not parse (headers) are skipped
+        const QRegularExpression separator("[,;|\\s]+");
+        const int needed = qMax(columns[0], qMax(columns[1], columns[2])) + 1;
+        QVector<StarIndex::Star> stars;
+        qint64 skipped = 0;
+        while (!catalog.atEnd()) {
+            const QStringList fields = QString::fromUtf8(catalog.readLine()).trimmed()
+                                       .split(separator, Qt::SkipEmptyParts);
+            bool okRa = false, okDec = false, okMag = false;
+            StarIndex::Star star;
+            if (fields.size() >= needed) {
+                star.ra = fields[columns[0]].toDouble(&okRa) * DEGREES;
+                star.dec = fields[columns[1]].toDouble(&okDec) * DEGREES;
+                star.mag = fields[columns[2]].toFloat(&okMag);
+            }
+            if (!okRa || !okDec || !okMag) {
+                skipped++;
+                continue;
+            }
+            if (star.mag <= maxMag) stars.append(star);
+        }
+        qDebug() << "Read" << stars.size() << "stars from" << catalogPath << "(" << skipped << "lines skipped)";
+
+        StarIndex index;
+        index.build(stars, perCell);
+        if (!index.save(indexPath)) return 2;
+        qDebug() << "Wrote" << index.size() << "stars to" << indexPath;
+        return 0;
+    }
+
+    int solveImage(const QString &imagePath, const QString &indexPath, const QStringList &hintValues)
+    {
+        StarIndex index;
+        if (!index.load(indexPath)) return 2;
+
+        QImage image(imagePath);
+        if (image.isNull()) {
+            qCritical() << "Cannot read" << imagePath;
+            return 2;
+        }
+        if (hintValues.size() != 4) {
+            qCritical() << "--hint needs ra,dec,fovx,fovy in degrees";
+            return 2;
+        }
+
+        PlateSolver::Hint hint;
+        hint.ra = hintValues[0].toDouble() * DEGREES;
+        hint.dec = hintValues[1].toDouble() * DEGREES;
+        hint.fovX = hintValues[2].toDouble() * DEGREES;
+        hint.fovY = hintValues[3].toDouble() * DEGREES;
+
+        PlateSolver::Solution solution = PlateSolver(&index).solve(image, hint);
+        if (!solution.solved) {
+            qCritical() << "Not solved:" << solution.error << "in" << solution.elapsedMs << "ms";
+            return 1;
+        }
+        qDebug().noquote() << QString("RA %1 Dec %2 PA %3 scale %4\"/px%5, %6 of %7 stars matched, rms %8 px, %9 ms")
+                              .arg(solution.ra / DEGREES, 0, 'f', 5)
+                              .arg(solution.dec / DEGREES, 0, 'f', 5)
+                              .arg(solution.orientation / DEGREES, 0, 'f', 2)
+                              .arg(solution.pixelScale / DEGREES * 3600.0, 0, 'f', 3)
+                              .arg(solution.mirrored ? QString(" mirrored") : QString())
+                              .arg(solution.matchedStars).arg(solution.imageStars)
+                              .arg(solution.rmsPixels, 0, 'f', 2)
+                              .arg(solution.elapsedMs);
+        return 0;
+    }
+}
+
+/**
+ * @brief Builds the plate solver's star index from a catalogue, and solves images with it
+ *
+ * The catalogue is a text file with RA and Dec in degrees and a magnitude
+ * on each line, e.g. an export of Tycho-2 or a Gaia query down to mag 12
+ * or so. Copy the result to the application data directory as stars.idx.
+ *
+ * Examples:
+ *   StarIndexTool --catalog tycho2.csv --columns 0,1,2 --output stars.idx
+ *   StarIndexTool --index stars.idx --solve frame.jpg --hint 83.82,-5.39,1.27,0.85
+ */
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName("StarIndexTool");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Build the plate solver's star index, or solve an image with it");
+    parser.addHelpOption();
+    QCommandLineOption catalogOption("catalog", "Catalogue to index: RA, Dec (degrees) and magnitude per line.", "file");
+    QCommandLineOption columnsOption("columns", "Zero-based RA,Dec,magnitude columns (default 0,1,2).", "list", "0,1,2");
+    QCommandLineOption outputOption("output", "Index file to write (default stars.idx).", "file", "stars.idx");
+    QCommandLineOption perCellOption("per-cell", "Brightest stars kept per 0.9 degree cell (default 60).", "count", "60");
+    QCommandLineOption maxMagOption("max-mag", "Faintest magnitude indexed (default 13).", "mag", "13");
+    QCommandLineOption indexOption("index", "Index file to solve with (default stars.idx).", "file", "stars.idx");
+    QCommandLineOption solveOption("solve", "Image to plate solve.", "file");
+    QCommandLineOption hintOption("hint", "Approximate ra,dec,fovx,fovy in degrees.", "list");
+    parser.addOptions({catalogOption, columnsOption, outputOption, perCellOption, maxMagOption,
+                       indexOption, solveOption, hintOption});
+    parser.process(app);
+
+    if (parser.isSet(solveOption)) {
+        return solveImage(parser.value(solveOption), parser.value(indexOption),
+                          parser.value(hintOption).split(','));
+    }
+
+    if (!parser.isSet(catalogOption)) {
+        parser.showHelp(2);
+    }
+
+    QList<int> columns;
+    for (const QString &column : parser.value(columnsOption).split(',')) columns.append(column.toInt());
+    if (columns.size() != 3) {
+        qCritical() << "--columns needs three column numbers";
+        return 2;
+    }
+    return buildIndex(parser.value(catalogOption), parser.value(outputOption),
+                      parser.value(perCellOption).toInt(), parser.value(maxMagOption).toDouble(), columns);
+}
@@ -0,0 +1,31 @@
+QT += core gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = StarIndexTool
+TEMPLATE = app
+
+# Builds the plate solver's star index from a catalogue, and solves
+# images with it from the command line.
+# Usage: StarIndexTool --catalog tycho2.csv --output stars.idx
+#        StarIndexTool --index stars.idx --solve frame.jpg --hint ra,dec,fovx,fovy
+
+SOURCES += \
+    StarIndexTool.cpp \
+    StarIndex.cpp \
+    PlateSolver.cpp \
+    BackgroundModel.cpp \
+    SkyCoverageIndex.cpp
+
+HEADERS += \
+    StarIndex.hpp \
+    PlateSolver.hpp \
+    BackgroundModel.hpp \
+    ParallelFor.hpp \
+    SimdUtils.hpp \
+    SkyCoverageIndex.hpp
+
+macx {
+    QMAKE_MACOSX_DEPLOYMENT_TARGET = 10.14
+}
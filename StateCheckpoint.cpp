@@ -0,0 +1,117 @@
+#include "StateCheckpoint.hpp"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+    const quint32 MAGIC = 0x4f4d4350;  // "OMCP"
+    // Bump whenever the layout below changes; older files are then ignored
+    const quint32 VERSION = 1;
+
+    // Every member, in declaration order; shared by reading and writing
+    template <typename Stream, typename Data>
+    void dataFields(Stream &s, Data &d)
+    {
+        s & d.mount.batteryLevel & d.mount.batteryVoltage & d.mount.chargerStatus & d.mount.date
+          & d.mount.time & d.mount.timeZone & d.mount.latitude & d.mount.longitude & d.mount.isAligned
+          & d.mount.isGotoOver & d.mount.isTracking & d.mount.numAlignRefs & d.mount.enc0 & d.mount.enc1;
+        s & d.camera.binning & d.camera.bitDepth & d.camera.colorBBalance & d.camera.colorGBalance
+          & d.camera.colorRBalance & d.camera.exposure & d.camera.iso & d.camera.offset;
+        s & d.focuser.backlash & d.focuser.calibrationLowerLimit & d.focuser.calibrationUpperLimit
+          & d.focuser.isCalibrationComplete & d.focuser.isMoveToOver & d.focuser.needAutoFocus
+          & d.focuser.percentageCalibrationComplete & d.focuser.position & d.focuser.requiresCalibration
+          & d.focuser.velocity;
+        s & d.environment.ambientTemperature & d.environment.cameraTemperature & d.environment.cpuFanOn
+          & d.environment.cpuTemperature & d.environment.dewPoint & d.environment.frontCellTemperature
+          & d.environment.humidity & d.environment.otaFanOn & d.environment.recalibrating;
+        s & d.lastImage.fileLocation & d.lastImage.imageType & d.lastImage.dec & d.lastImage.ra
+          & d.lastImage.orientation & d.lastImage.fovX & d.lastImage.fovY;
+        s & d.disk.capacity & d.disk.freeBytes & d.disk.level & d.disk.fillRate & d.disk.secondsToFull;
+        s & d.dewHeater.aggression & d.dewHeater.heaterLevel & d.dewHeater.manualPowerLevel & d.dewHeater.mode;
+        s & d.orientation.altitude;
+        s & d.mountLastUpdate & d.cameraLastUpdate & d.focuserLastUpdate & d.environmentLastUpdate
+          & d.imageLastUpdate & d.diskLastUpdate & d.dewHeaterLastUpdate & d.orientationLastUpdate;
+    }
+
+    template <typename Stream, typename State>
+    void stateFields(Stream &s, State &state)
+    {
+        s & state.savedMs;
+        dataFields(s, state.data);
+        s & state.telescopes & state.telescopeAddresses & state.connectedAddress
+          & state.downloadPath & state.archive & state.downloadQueue;
+    }
+
+    // Lets the field lists above drive both directions
+    struct Writer {
+        QDataStream &stream;
+        template <typename T> Writer &operator&(const T &value) { stream << value; return *this; }
+    };
+
+    struct Reader {
+        QDataStream &stream;
+        template <typename T> Reader &operator&(T &value) { stream >> value; return *this; }
+    };
+}
+
+QString StateCheckpoint::defaultPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/checkpoint.bin";
+}
+
+bool StateCheckpoint::save(State state, const QString &path)
+{
+    state.savedMs = QDateTime::currentMSecsSinceEpoch();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    // Written aside and renamed into place, so a crash mid-write leaves the previous checkpoint
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write checkpoint:" << path << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << MAGIC << VERSION;
+    Writer writer{stream};
+    stateFields(writer, state);
+
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        qWarning() << "Failed to write checkpoint:" << path << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool StateCheckpoint::load(State *state, const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    if (magic != MAGIC || version != VERSION) {
+        qDebug() << "Ignoring checkpoint from another version:" << path;
+        return false;
+    }
+
+    State loaded;
+    Reader reader{stream};
+    stateFields(reader, loaded);
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "Corrupt checkpoint:" << path;
+        return false;
+    }
+
+    *state = loaded;
+    return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include "TelescopeData.hpp"
+
+/**
+ * @brief Last-known application state, saved so a restart shows it at once
+ *
+ * The GUI saves a checkpoint periodically and on exit, and restores it at
+ * launch before the telescope has been found again: the displays show the
+ * last telemetry (its update times make the age plain), the discovery
+ * list is filled, the archive grid comes back from cached thumbnails, and
+ * unfinished downloads resume once the link is up.
+ *
+ * The file is a versioned QDataStream of a few kB, written atomically with
+ * QSaveFile; a file from an incompatible version is ignored.
+ */
+class StateCheckpoint
+{
+public:
+    struct State {
+        /** When the checkpoint was written, ms since epoch */
+        qint64 savedMs = 0;
+        TelescopeData data;
+        /** Discovery list entries, "address - model" */
+        QStringList telescopes;
+        QStringList telescopeAddresses;
+        /** The telescope connected when the checkpoint was written, if any */
+        QString connectedAddress;
+        QString downloadPath;
+        /** Observation directories shown in the archive grid */
+        QStringList archive;
+        /** Observations queued or in progress in the downloader */
+        QStringList downloadQueue;
+    };
+
+    /** @brief checkpoint.bin in the application data directory */
+    static QString defaultPath();
+
+    /**
+     * @brief Write a checkpoint
+     * @param state The state; savedMs is set to the current time
+     * @param path The file
+     */
+    static bool save(State state, const QString &path = defaultPath());
+
+    /**
+     * @brief Read a checkpoint
+     * @param state Receives the state
+     * @param path The file
+     * @return False if there is no checkpoint or it cannot be read
+     */
+    static bool load(State *state, const QString &path = defaultPath());
+};
@@ -0,0 +1,96 @@
+#include "TelemetryFields.hpp"
+#include <QHash>
+
+namespace TelemetryFields {
+
+namespace {
+    // In Field order; descriptor() indexes this table directly
+    const Descriptor descriptors[FieldCount] = {
+        {MountBatteryVoltage, Mount, "Mount.BatteryVoltage", "V", [](const TelescopeData &d) { return d.mount.batteryVoltage; }},
+        {MountLatitude, Mount, "Mount.Latitude", "rad", [](const TelescopeData &d) { return d.mount.latitude; }},
+        {MountLongitude, Mount, "Mount.Longitude", "rad", [](const TelescopeData &d) { return d.mount.longitude; }},
+        {MountIsAligned, Mount, "Mount.IsAligned", "", [](const TelescopeData &d) { return d.mount.isAligned ? 1.0 : 0.0; }},
+        {MountIsGotoOver, Mount, "Mount.IsGotoOver", "", [](const TelescopeData &d) { return d.mount.isGotoOver ? 1.0 : 0.0; }},
+        {MountIsTracking, Mount, "Mount.IsTracking", "", [](const TelescopeData &d) { return d.mount.isTracking ? 1.0 : 0.0; }},
+        {MountNumAlignRefs, Mount, "Mount.NumAlignRefs", "", [](const TelescopeData &d) { return double(d.mount.numAlignRefs); }},
+        {MountEnc0, Mount, "Mount.Enc0", "", [](const TelescopeData &d) { return d.mount.enc0; }},
+        {MountEnc1, Mount, "Mount.Enc1", "", [](const TelescopeData &d) { return d.mount.enc1; }},
+
+        {CameraBinning, Camera, "Camera.Binning", "", [](const TelescopeData &d) { return double(d.camera.binning); }},
+        {CameraBitDepth, Camera, "Camera.BitDepth", "bit", [](const TelescopeData &d) { return double(d.camera.bitDepth); }},
+        {CameraColorBBalance, Camera, "Camera.ColorBBalance", "", [](const TelescopeData &d) { return d.camera.colorBBalance; }},
+        {CameraColorGBalance, Camera, "Camera.ColorGBalance", "", [](const TelescopeData &d) { return d.camera.colorGBalance; }},
+        {CameraColorRBalance, Camera, "Camera.ColorRBalance", "", [](const TelescopeData &d) { return d.camera.colorRBalance; }},
+        {CameraExposure, Camera, "Camera.Exposure", "s", [](const TelescopeData &d) { return d.camera.exposure; }},
+        {CameraIso, Camera, "Camera.Iso", "", [](const TelescopeData &d) { return double(d.camera.iso); }},
+        {CameraOffset, Camera, "Camera.Offset", "", [](const TelescopeData &d) { return double(d.camera.offset); }},
+
+        {FocuserBacklash, Focuser, "Focuser.Backlash", "", [](const TelescopeData &d) { return double(d.focuser.backlash); }},
+        {FocuserCalibrationLowerLimit, Focuser, "Focuser.CalibrationLowerLimit", "", [](const TelescopeData &d) { return double(d.focuser.calibrationLowerLimit); }},
+        {FocuserCalibrationUpperLimit, Focuser, "Focuser.CalibrationUpperLimit", "", [](const TelescopeData &d) { return double(d.focuser.calibrationUpperLimit); }},
+        {FocuserIsCalibrationComplete, Focuser, "Focuser.IsCalibrationComplete", "", [](const TelescopeData &d) { return d.focuser.isCalibrationComplete ? 1.0 : 0.0; }},
+        {FocuserIsMoveToOver, Focuser, "Focuser.IsMoveToOver", "", [](const TelescopeData &d) { return d.focuser.isMoveToOver ? 1.0 : 0.0; }},
+        {FocuserNeedAutoFocus, Focuser, "Focuser.NeedAutoFocus", "", [](const TelescopeData &d) { return d.focuser.needAutoFocus ? 1.0 : 0.0; }},
+        {FocuserPercentageCalibrationComplete, Focuser, "Focuser.PercentageCalibrationComplete", "%", [](const TelescopeData &d) { return double(d.focuser.percentageCalibrationComplete); }},
+        {FocuserPosition, Focuser, "Focuser.Position", "", [](const TelescopeData &d) { return double(d.focuser.position); }},
+        {FocuserRequiresCalibration, Focuser, "Focuser.RequiresCalibration", "", [](const TelescopeData &d) { return d.focuser.requiresCalibration ? 1.0 : 0.0; }},
+        {FocuserVelocity, Focuser, "Focuser.Velocity", "", [](const TelescopeData &d) { return d.focuser.velocity; }},
+
+        {EnvironmentAmbientTemperature, Environment, "Environment.AmbientTemperature", "°C", [](const TelescopeData &d) { return d.environment.ambientTemperature; }},
+        {EnvironmentCameraTemperature, Environment, "Environment.CameraTemperature", "°C", [](const TelescopeData &d) { return d.environment.cameraTemperature; }},
+        {EnvironmentCpuFanOn, Environment, "Environment.CpuFanOn", "", [](const TelescopeData &d) { return d.environment.cpuFanOn ? 1.0 : 0.0; }},
+        {EnvironmentCpuTemperature, Environment, "Environment.CpuTemperature", "°C", [](const TelescopeData &d) { return d.environment.cpuTemperature; }},
+        {EnvironmentDewPoint, Environment, "Environment.DewPoint", "°C", [](const TelescopeData &d) { return d.environment.dewPoint; }},
+        {EnvironmentFrontCellTemperature, Environment, "Environment.FrontCellTemperature", "°C", [](const TelescopeData &d) { return d.environment.frontCellTemperature; }},
+        {EnvironmentHumidity, Environment, "Environment.Humidity", "%", [](const TelescopeData &d) { return d.environment.humidity; }},
+        {EnvironmentOtaFanOn, Environment, "Environment.OtaFanOn", "", [](const TelescopeData &d) { return d.environment.otaFanOn ? 1.0 : 0.0; }},
+        {EnvironmentRecalibrating, Environment, "Environment.Recalibrating", "", [](const TelescopeData &d) { return d.environment.recalibrating ? 1.0 : 0.0; }},
+
+        {ImageDec, Image, "Image.Dec", "rad", [](const TelescopeData &d) { return d.lastImage.dec; }},
+        {ImageRa, Image, "Image.Ra", "rad", [](const TelescopeData &d) { return d.lastImage.ra; }},
+        {ImageOrientation, Image, "Image.Orientation", "rad", [](const TelescopeData &d) { return d.lastImage.orientation; }},
+        {ImageFovX, Image, "Image.FovX", "rad", [](const TelescopeData &d) { return d.lastImage.fovX; }},
+        {ImageFovY, Image, "Image.FovY", "rad", [](const TelescopeData &d) { return d.lastImage.fovY; }},
+
+        {DiskCapacity, Disk, "Disk.Capacity", "B", [](const TelescopeData &d) { return double(d.disk.capacity); }},
+        {DiskFreeBytes, Disk, "Disk.FreeBytes", "B", [](const TelescopeData &d) { return double(d.disk.freeBytes); }},
+        {DiskFillRate, Disk, "Disk.FillRate", "B/s", [](const TelescopeData &d) { return d.disk.fillRate; }},
+
+        {DewHeaterAggression, DewHeater, "DewHeater.Aggression", "", [](const TelescopeData &d) { return double(d.dewHeater.aggression); }},
+        {DewHeaterHeaterLevel, DewHeater, "DewHeater.HeaterLevel", "", [](const TelescopeData &d) { return d.dewHeater.heaterLevel; }},
+        {DewHeaterManualPowerLevel, DewHeater, "DewHeater.ManualPowerLevel", "", [](const TelescopeData &d) { return d.dewHeater.manualPowerLevel; }},
+
+        {OrientationAltitude, Orientation, "Orientation.Altitude", "°", [](const TelescopeData &d) { return double(d.orientation.altitude); }}
+    };
+}
+
+const Descriptor &descriptor(Field field)
+{
+    return descriptors[field];
+}
+
+const QVector<Field> &fieldsInGroup(Group group)
+{
+    static const QVector<QVector<Field>> groups = []() {
+        QVector<QVector<Field>> result(Orientation + 1);
+        for (const Descriptor &d : descriptors) {
+            result[d.group].append(d.field);
+        }
+        return result;
+    }();
+    return groups[group];
+}
+
+Field fromName(const QString &name)
+{
+    static const QHash<QString, Field> byName = []() {
+        QHash<QString, Field> result;
+        for (const Descriptor &d : descriptors) {
+            result.insert(QString::fromLatin1(d.name), d.field);
+        }
+        return result;
+    }();
+    return byName.value(name, FieldCount);
+}
+
+}
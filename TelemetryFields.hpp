@@ -0,0 +1,111 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include "TelescopeData.hpp"
+
+/**
+ * @brief The numeric TelescopeData fields recorded as telemetry
+ *
+ * Field ids are written to disk; append new fields before FieldCount and
+ * never renumber existing ones. Booleans are stored as 0/1. Free-text
+ * fields (battery level, charger status, disk level, heater mode, file
+ * locations) are not time series and are not recorded.
+ */
+namespace TelemetryFields {
+
+enum Group {
+    Mount,
+    Camera,
+    Focuser,
+    Environment,
+    Image,
+    Disk,
+    DewHeater,
+    Orientation
+};
+
+enum Field {
+    MountBatteryVoltage = 0,
+    MountLatitude,
+    MountLongitude,
+    MountIsAligned,
+    MountIsGotoOver,
+    MountIsTracking,
+    MountNumAlignRefs,
+    MountEnc0,
+    MountEnc1,
+
+    CameraBinning,
+    CameraBitDepth,
+    CameraColorBBalance,
+    CameraColorGBalance,
+    CameraColorRBalance,
+    CameraExposure,
+    CameraIso,
+    CameraOffset,
+
+    FocuserBacklash,
+    FocuserCalibrationLowerLimit,
+    FocuserCalibrationUpperLimit,
+    FocuserIsCalibrationComplete,
+    FocuserIsMoveToOver,
+    FocuserNeedAutoFocus,
+    FocuserPercentageCalibrationComplete,
+    FocuserPosition,
+    FocuserRequiresCalibration,
+    FocuserVelocity,
+
+    EnvironmentAmbientTemperature,
+    EnvironmentCameraTemperature,
+    EnvironmentCpuFanOn,
+    EnvironmentCpuTemperature,
+    EnvironmentDewPoint,
+    EnvironmentFrontCellTemperature,
+    EnvironmentHumidity,
+    EnvironmentOtaFanOn,
+    EnvironmentRecalibrating,
+
+    ImageDec,
+    ImageRa,
+    ImageOrientation,
+    ImageFovX,
+    ImageFovY,
+
+    DiskCapacity,
+    DiskFreeBytes,
+    DiskFillRate,
+
+    DewHeaterAggression,
+    DewHeaterHeaterLevel,
+    DewHeaterManualPowerLevel,
+
+    OrientationAltitude,
+
+    FieldCount
+};
+
+/**
+ * @brief How to name and read one field
+ */
+struct Descriptor {
+    Field field;
+    Group group;
+    const char *name;      // Stable identifier, e.g. "Environment.DewPoint"
+    const char *unit;      // Display unit, empty if dimensionless
+    double (*read)(const TelescopeData &data);
+};
+
+/** @brief The descriptor of a field */
+const Descriptor &descriptor(Field field);
+
+/** @brief All fields updated together by one status notification */
+const QVector<Field> &fieldsInGroup(Group group);
+
+/**
+ * @brief Look a field up by its stable name
+ * @return The field, or FieldCount if the name is unknown
+ */
+Field fromName(const QString &name);
+
+}
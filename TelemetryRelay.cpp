@@ -0,0 +1,262 @@
+#include "TelemetryRelay.hpp"
+#include "TelescopeLink.hpp"
+#include <QDateTime>
+#include <QDebug>
+#include <QJsonDocument>
+#include <QWebSocket>
+#include <QWebSocketServer>
+#include <limits>
+
+namespace {
+    // Relayed commands get SequenceIDs from here up, clear of the monitor's own
+    const int FIRST_SEQUENCE_ID = 1000000;
+    // A client this far behind gets coalesced notifications...
+    const qint64 HIGH_WATER_BYTES = 1024 * 1024;
+    // ...until it has drained to here
+    const qint64 LOW_WATER_BYTES = 256 * 1024;
+    // How long a shared query's answer is reused
+    const qint64 ANSWER_REUSE_MS = 500;
+    // Commands without a response by then are forgotten
+    const qint64 COMMAND_TIMEOUT_MS = 30000;
+
+    QString queryKey(const QJsonObject &command)
+    {
+        if (!command["Command"].toString().startsWith("Get")) return QString();
+
+        // Everything but the per-request fields identifies the query
+        QJsonObject key = command;
+        key.remove("SequenceID");
+        key.remove("Source");
+        return QString::fromUtf8(QJsonDocument(key).toJson(QJsonDocument::Compact));
+    }
+}
+
+TelemetryRelay::TelemetryRelay(TelescopeLink *link, QObject *parent)
+    : QObject(parent)
+    , m_link(link)
+    , m_server(new QWebSocketServer("OriginMonitor relay", QWebSocketServer::NonSecureMode, this))
+    , m_nextSequenceId(FIRST_SEQUENCE_ID)
+{
+    connect(m_server, &QWebSocketServer::newConnection, this, &TelemetryRelay::onNewConnection);
+    connect(m_link, &TelescopeLink::messageReceived, this, &TelemetryRelay::onUpstreamMessage);
+
+    m_expiryTimer.setInterval(5000);
+    connect(&m_expiryTimer, &QTimer::timeout, this, &TelemetryRelay::expirePending);
+}
+
+TelemetryRelay::~TelemetryRelay()
+{
+    stop();
+}
+
+bool TelemetryRelay::start(int port)
+{
+    if (m_server->isListening()) return true;
+
+    if (!m_server->listen(QHostAddress::Any, port)) {
+        qWarning() << "Relay cannot listen on port" << port << m_server->errorString();
+        return false;
+    }
+    m_expiryTimer.start();
+    qDebug() << "Relaying the telescope connection on port" << port;
+    return true;
+}
+
+void TelemetryRelay::stop()
+{
+    m_server->close();
+    m_expiryTimer.stop();
+
+    for (Client *client : m_clients) {
+        client->socket->disconnect(this);
+        client->socket->close();
+        client->socket->deleteLater();
+        delete client;
+    }
+    bool hadClients = !m_clients.isEmpty();
+    m_clients.clear();
+    m_pending.clear();
+    m_queriesInFlight.clear();
+    m_answers.clear();
+    if (hadClients) emit clientCountChanged(0);
+}
+
+bool TelemetryRelay::isRunning() const
+{
+    return m_server->isListening();
+}
+
+void TelemetryRelay::onNewConnection()
+{
+    while (QWebSocket *socket = m_server->nextPendingConnection()) {
+        Client *client = new Client;
+        client->socket = socket;
+        socket->setParent(this);
+
+        connect(socket, &QWebSocket::textMessageReceived, this, [this, client](const QString &text) {
+            onClientMessage(client, text);
+        });
+        connect(socket, &QWebSocket::bytesWritten, this, [this, client](qint64 bytes) {
+            onBytesWritten(client, bytes);
+        });
+        connect(socket, &QWebSocket::disconnected, this, [this, client]() { removeClient(client); });
+
+        m_clients.append(client);
+        qDebug() << "Relay client connected from" << socket->peerAddress().toString()
+                 << "-" << m_clients.size() << "connected";
+        emit clientCountChanged(m_clients.size());
+    }
+}
+
+void TelemetryRelay::removeClient(Client *client)
+{
+    if (!m_clients.removeOne(client)) return;
+
+    // Its outstanding commands no longer have anyone to answer
+    for (auto it = m_pending.begin(); it != m_pending.end(); ++it) {
+        QList<Waiter> &waiters = it->waiters;
+        for (int i = waiters.size() - 1; i >= 0; i--) {
+            if (waiters[i].client == client) waiters.removeAt(i);
+        }
+    }
+
+    client->socket->deleteLater();
+    delete client;
+    emit clientCountChanged(m_clients.size());
+}
+
+void TelemetryRelay::onClientMessage(Client *client, const QString &text)
+{
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(text.toUtf8(), &error);
+    if (!document.isObject() || !document.object().contains("Command")) {
+        qWarning() << "Relay ignoring a message that is not a command:" << text.left(200);
+        return;
+    }
+
+    QJsonObject command = document.object();
+    Waiter waiter{client, command["SequenceID"].toInt(), command["Source"].toString()};
+
+    if (!m_link->isConnected()) {
+        QJsonObject response;
+        response["Command"] = command["Command"];
+        response["Source"] = command["Destination"];
+        response["Type"] = "Response";
+        response["ErrorCode"] = -1;
+        response["ErrorMessage"] = "The relay is not connected to a telescope";
+        answer(waiter, response);
+        return;
+    }
+
+    // A query someone else just asked, or is asking now, is not sent again
+    const QString key = queryKey(command);
+    if (!key.isEmpty()) {
+        auto cached = m_answers.constFind(key);
+        if (cached != m_answers.constEnd() && QDateTime::currentMSecsSinceEpoch() - cached->first < ANSWER_REUSE_MS) {
+            m_stats.queriesShared++;
+            answer(waiter, cached->second);
+            return;
+        }
+        auto inFlight = m_queriesInFlight.constFind(key);
+        if (inFlight != m_queriesInFlight.constEnd() && m_pending.contains(*inFlight)) {
+            m_stats.queriesShared++;
+            m_pending[*inFlight].waiters.append(waiter);
+            return;
+        }
+    }
+
+    const int sequenceId = m_nextSequenceId++;
+    if (m_nextSequenceId == std::numeric_limits<int>::max()) m_nextSequenceId = FIRST_SEQUENCE_ID;
+
+    PendingCommand &pending = m_pending[sequenceId];
+    pending.waiters.append(waiter);
+    pending.queryKey = key;
+    pending.sentMs = QDateTime::currentMSecsSinceEpoch();
+    if (!key.isEmpty()) m_queriesInFlight.insert(key, sequenceId);
+
+    command["SequenceID"] = sequenceId;
+    m_link->sendJson(command);
+    m_stats.commandsForwarded++;
+}
+
+void TelemetryRelay::onUpstreamMessage(const QJsonObject &obj, const QString &text, qint64 receivedMs)
+{
+    if (m_clients.isEmpty() && m_pending.isEmpty()) return;
+
+    if (obj["Type"].toString() == "Response") {
+        // Only responses to relayed commands go downstream, and only to whoever sent them
+        auto it = m_pending.find(obj["SequenceID"].toInt());
+        if (it == m_pending.end()) return;
+
+        PendingCommand pending = it.value();
+        m_pending.erase(it);
+        if (!pending.queryKey.isEmpty()) {
+            m_queriesInFlight.remove(pending.queryKey);
+            m_answers.insert(pending.queryKey, qMakePair(receivedMs, obj));
+        }
+        for (const Waiter &waiter : pending.waiters) {
+            answer(waiter, obj);
+        }
+        return;
+    }
+
+    // Notifications are state; a client that is behind only needs the newest of each
+    const QString key = obj["Source"].toString() + "/" + obj["Command"].toString();
+    for (Client *client : m_clients) {
+        deliver(client, text, key);
+    }
+    m_stats.notificationsRelayed++;
+}
+
+void TelemetryRelay::answer(const Waiter &waiter, QJsonObject response)
+{
+    if (!m_clients.contains(waiter.client)) return;
+
+    response["SequenceID"] = waiter.sequenceId;
+    if (!waiter.source.isEmpty()) response["Destination"] = waiter.source;
+    deliver(waiter.client, QString::fromUtf8(QJsonDocument(response).toJson(QJsonDocument::Compact)), QString());
+}
+
+void TelemetryRelay::deliver(Client *client, const QString &text, const QString &coalesceKey)
+{
+    if (!coalesceKey.isEmpty() && (client->pendingBytes > HIGH_WATER_BYTES || !client->coalesced.isEmpty())) {
+        if (client->coalesced.contains(coalesceKey)) m_stats.notificationsCoalesced++;
+        client->coalesced.insert(coalesceKey, text);
+        return;
+    }
+    client->pendingBytes += client->socket->sendTextMessage(text);
+}
+
+void TelemetryRelay::onBytesWritten(Client *client, qint64 bytes)
+{
+    // Frame headers make the written count slightly larger than what was queued
+    client->pendingBytes = qMax<qint64>(0, client->pendingBytes - bytes);
+
+    if (client->pendingBytes < LOW_WATER_BYTES && !client->coalesced.isEmpty()) {
+        const QHash<QString, QString> coalesced = client->coalesced;
+        client->coalesced.clear();
+        for (const QString &text : coalesced) {
+            client->pendingBytes += client->socket->sendTextMessage(text);
+        }
+    }
+}
+
+void TelemetryRelay::expirePending()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (auto it = m_pending.begin(); it != m_pending.end();) {
+        if (now - it->sentMs > COMMAND_TIMEOUT_MS) {
+            if (!it->queryKey.isEmpty()) m_queriesInFlight.remove(it->queryKey);
+            it = m_pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = m_answers.begin(); it != m_answers.end();) {
+        if (now - it->first > ANSWER_REUSE_MS) {
+            it = m_answers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+class QWebSocket;
+class QWebSocketServer;
+class TelescopeLink;
+
+/**
+ * @brief Re-serves one telescope connection to any number of WebSocket clients
+ *
+ * The Origin copes badly with several WebSocket clients at once. In relay
+ * mode the monitor keeps its single mountControlEndpoint connection and
+ * other monitors or apps connect to us instead, so the load on the scope
+ * stays the same however many observers there are.
+ *
+ * Notifications are passed on as the raw text received. A client whose
+ * socket is more than a high-water mark behind stops getting a queue of
+ * stale updates: notifications for it are coalesced to the newest per
+ * source and command, and sent once it has drained below a low-water mark.
+ *
+ * Commands from clients are forwarded with their SequenceID remapped to a
+ * range of our own, so they cannot collide with the monitor's commands or
+ * each other's, and the response goes back to the sender alone with its
+ * own SequenceID restored. Identical Get* queries are shared: one in
+ * flight serves every client that asks meanwhile, and its answer is
+ * reused for a short while, so status polling by many clients costs the
+ * scope one query.
+ *
+ * Images and files are still fetched from the telescope's HTTP server.
+ */
+class TelemetryRelay : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int DEFAULT_PORT = 8090;
+
+    struct Stats {
+        qint64 notificationsRelayed = 0;
+        qint64 notificationsCoalesced = 0;
+        qint64 commandsForwarded = 0;
+        qint64 queriesShared = 0;
+    };
+
+    explicit TelemetryRelay(TelescopeLink *link, QObject *parent = nullptr);
+    ~TelemetryRelay();
+
+    bool start(int port = DEFAULT_PORT);
+    void stop();
+    bool isRunning() const;
+    int clientCount() const { return m_clients.size(); }
+    Stats stats() const { return m_stats; }
+
+signals:
+    void clientCountChanged(int count);
+
+private:
+    struct Client {
+        QWebSocket *socket = nullptr;
+        qint64 pendingBytes = 0;
+        QHash<QString, QString> coalesced;  // Newest notification per source/command while behind
+    };
+
+    struct Waiter {
+        Client *client;
+        int sequenceId;                     // The client's own SequenceID
+        QString source;
+    };
+
+    struct PendingCommand {
+        QList<Waiter> waiters;
+        QString queryKey;                   // Set for shareable queries
+        qint64 sentMs = 0;
+    };
+
+    void onNewConnection();
+    void onClientMessage(Client *client, const QString &text);
+    void onUpstreamMessage(const QJsonObject &obj, const QString &text, qint64 receivedMs);
+    void answer(const Waiter &waiter, QJsonObject response);
+    void deliver(Client *client, const QString &text, const QString &coalesceKey);
+    void onBytesWritten(Client *client, qint64 bytes);
+    void removeClient(Client *client);
+    void expirePending();
+
+    TelescopeLink *m_link;
+    QWebSocketServer *m_server;
+    QList<Client*> m_clients;
+    QHash<int, PendingCommand> m_pending;               // By upstream SequenceID
+    QHash<QString, int> m_queriesInFlight;              // Query key -> upstream SequenceID
+    QHash<QString, QPair<qint64, QJsonObject>> m_answers;   // Query key -> (received ms, response)
+    int m_nextSequenceId;
+    QTimer m_expiryTimer;
+    Stats m_stats;
+};
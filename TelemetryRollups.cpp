@@ -0,0 +1,324 @@
+#include "TelemetryRollups.hpp"
+#include <QDate>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    qint64 floorDiv(qint64 value, qint64 divisor)
+    {
+        return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+    }
+
+    /** Sort by start and fold together pieces of the same bucket */
+    void normalize(QVector<TelemetryRollups::Bucket> &buckets)
+    {
+        std::stable_sort(buckets.begin(), buckets.end(),
+                         [](const TelemetryRollups::Bucket &a, const TelemetryRollups::Bucket &b) {
+                             return a.startMs < b.startMs;
+                         });
+        int out = 0;
+        for (int i = 0; i < buckets.size(); i++) {
+            if (out > 0 && buckets[out - 1].startMs == buckets[i].startMs) {
+                buckets[out - 1].merge(buckets[i]);
+            } else {
+                buckets[out++] = buckets[i];
+            }
+        }
+        buckets.resize(out);
+    }
+
+    double getDouble(const uchar *src)
+    {
+        quint64 bits = qFromLittleEndian<quint64>(src);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    void putDouble(uchar *dst, double value)
+    {
+        quint64 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        qToLittleEndian(bits, dst);
+    }
+}
+
+void TelemetryRollups::Bucket::add(double value)
+{
+    if (count == 0) {
+        min = max = value;
+    } else {
+        min = qMin(min, value);
+        max = qMax(max, value);
+    }
+    sum += value;
+    last = value;
+    count++;
+}
+
+void TelemetryRollups::Bucket::merge(const Bucket &other)
+{
+    if (other.count == 0) return;
+    if (count == 0) {
+        // Keep our own start: the total of a range starts where the range does
+        qint64 start = startMs;
+        *this = other;
+        startMs = start;
+        return;
+    }
+    min = qMin(min, other.min);
+    max = qMax(max, other.max);
+    sum += other.sum;
+    count += other.count;
+    last = other.last;
+}
+
+TelemetryRollups::TelemetryRollups(const QString &directory)
+    : m_directory(directory)
+    , m_open(LevelCount, QVector<Bucket>(TelemetryFields::FieldCount))
+    , m_recent(TelemetryFields::FieldCount)
+{
+}
+
+qint64 TelemetryRollups::resolutionMs(Level level)
+{
+    switch (level) {
+    case TenSeconds: return 10 * 1000;
+    case OneMinute: return 60 * 1000;
+    default: return 60 * 60 * 1000;
+    }
+}
+
+QString TelemetryRollups::dayPath(Level level, qint64 day) const
+{
+    return QString("%1/rollup-%2s/%3.r").arg(m_directory).arg(resolutionMs(level) / 1000)
+                                        .arg(QDate(1970, 1, 1).addDays(day).toString("yyyyMMdd"));
+}
+
+void TelemetryRollups::add(TelemetryFields::Field field, qint64 timestampMs, double value)
+{
+    for (int level = 0; level < LevelCount; level++) {
+        qint64 resolution = resolutionMs(Level(level));
+        qint64 start = floorDiv(timestampMs, resolution) * resolution;
+
+        Bucket &open = m_open[level][field];
+        if (open.count > 0 && open.startMs != start) {
+            close(Level(level), field);
+        }
+        if (open.count == 0) {
+            open.startMs = start;
+        }
+        open.add(value);
+    }
+}
+
+void TelemetryRollups::close(Level level, TelemetryFields::Field field)
+{
+    Bucket bucket = m_open[level][field];
+    m_open[level][field] = Bucket();
+    if (bucket.count == 0) return;
+
+    if (level == TenSeconds) {
+        BucketList &recent = m_recent[field];
+        recent.append(bucket);
+        int expired = 0;
+        while (expired < recent.size() && recent[expired].startMs < bucket.startMs - MEMORY_SPAN_MS) {
+            expired++;
+        }
+        if (expired > 0) recent.remove(0, expired);
+        return;
+    }
+
+    write(level, field, bucket);
+}
+
+void TelemetryRollups::write(Level level, TelemetryFields::Field field, const Bucket &bucket) const
+{
+    qint64 day = floorDiv(bucket.startMs, DAY_MS);
+
+    uchar record[RECORD_SIZE] = {};
+    qToLittleEndian(quint16(field), record);
+    qToLittleEndian(bucket.count, record + 4);
+    qToLittleEndian(bucket.startMs, record + 8);
+    putDouble(record + 16, bucket.min);
+    putDouble(record + 24, bucket.max);
+    putDouble(record + 32, bucket.sum);
+    putDouble(record + 40, bucket.last);
+
+    QString path = dayPath(level, day);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed to write telemetry rollup:" << path;
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(record), RECORD_SIZE);
+
+    // Keep an already loaded day current
+    auto cached = m_dayCache.find(day * LevelCount + level);
+    if (cached != m_dayCache.end()) {
+        BucketList &list = cached.value()[field];
+        if (!list.isEmpty() && list.last().startMs == bucket.startMs) {
+            list.last().merge(bucket);
+        } else {
+            list.append(bucket);
+            if (list.size() > 1 && list[list.size() - 2].startMs > bucket.startMs) normalize(list);
+        }
+    }
+}
+
+void TelemetryRollups::flush()
+{
+    // Persist partial buckets; the rest of each interval is written as a
+    // second piece and merged when the day is read back
+    for (int level = OneMinute; level < LevelCount; level++) {
+        for (int field = 0; field < TelemetryFields::FieldCount; field++) {
+            close(Level(level), TelemetryFields::Field(field));
+        }
+    }
+}
+
+const QHash<int, TelemetryRollups::BucketList> &TelemetryRollups::dayBuckets(Level level, qint64 day) const
+{
+    qint64 key = day * LevelCount + level;
+    auto cached = m_dayCache.constFind(key);
+    if (cached != m_dayCache.constEnd()) return cached.value();
+
+    QHash<int, BucketList> byField;
+    QFile file(dayPath(level, day));
+    if (file.open(QIODevice::ReadOnly)) {
+        QByteArray raw = file.readAll();
+        const uchar *p = reinterpret_cast<const uchar*>(raw.constData());
+        for (int i = 0; i + RECORD_SIZE <= raw.size(); i += RECORD_SIZE) {
+            int field = qFromLittleEndian<quint16>(p + i);
+            if (field >= TelemetryFields::FieldCount) continue;
+
+            Bucket bucket;
+            bucket.count = qFromLittleEndian<quint32>(p + i + 4);
+            bucket.startMs = qFromLittleEndian<qint64>(p + i + 8);
+            bucket.min = getDouble(p + i + 16);
+            bucket.max = getDouble(p + i + 24);
+            bucket.sum = getDouble(p + i + 32);
+            bucket.last = getDouble(p + i + 40);
+            byField[field].append(bucket);
+        }
+        for (auto it = byField.begin(); it != byField.end(); ++it) {
+            normalize(it.value());
+        }
+    }
+
+    return *m_dayCache.insert(key, byField);
+}
+
+TelemetryRollups::BucketList TelemetryRollups::buckets(Level level, TelemetryFields::Field field,
+                                                       qint64 fromMs, qint64 toMs) const
+{
+    BucketList result;
+    if (fromMs >= toMs) return result;
+
+    auto inRange = [fromMs, toMs](const Bucket &bucket) {
+        return bucket.startMs >= fromMs && bucket.startMs < toMs;
+    };
+
+    if (level == TenSeconds) {
+        const BucketList &recent = m_recent[field];
+        auto first = std::lower_bound(recent.begin(), recent.end(), fromMs,
+                                      [](const Bucket &bucket, qint64 t) { return bucket.startMs < t; });
+        for (auto it = first; it != recent.end() && it->startMs < toMs; ++it) {
+            result.append(*it);
+        }
+    } else {
+        qint64 lastDay = floorDiv(toMs - 1, DAY_MS);
+        for (qint64 day = floorDiv(fromMs, DAY_MS); day <= lastDay; day++) {
+            const BucketList list = dayBuckets(level, day).value(field);
+            auto first = std::lower_bound(list.begin(), list.end(), fromMs,
+                                          [](const Bucket &bucket, qint64 t) { return bucket.startMs < t; });
+            for (auto it = first; it != list.end() && it->startMs < toMs; ++it) {
+                result.append(*it);
+            }
+        }
+    }
+
+    const Bucket &open = m_open[level][field];
+    if (open.count > 0 && inRange(open)) {
+        if (!result.isEmpty() && result.last().startMs == open.startMs) {
+            result.last().merge(open);
+        } else {
+            result.append(open);
+        }
+    }
+    return result;
+}
+
+bool TelemetryRollups::holdsRecent(TelemetryFields::Field field, qint64 fromMs) const
+{
+    const BucketList &recent = m_recent[field];
+    if (!recent.isEmpty()) return fromMs >= recent.first().startMs;
+
+    const Bucket &open = m_open[TenSeconds][field];
+    return open.count > 0 && fromMs >= open.startMs;
+}
+
+QVector<TelemetryRollups::Bucket> TelemetryRollups::series(TelemetryFields::Field field, qint64 fromMs,
+                                                           qint64 toMs, int maxPoints) const
+{
+    if (field < 0 || field >= TelemetryFields::FieldCount || fromMs >= toMs) return BucketList();
+
+    for (int level = 0; level < LevelCount; level++) {
+        // 10 s buckets only exist for the last few hours
+        if (level == TenSeconds && !holdsRecent(field, fromMs)) continue;
+
+        qint64 resolution = resolutionMs(Level(level));
+        if ((toMs - fromMs) / resolution <= maxPoints || level == OneHour) {
+            qint64 alignedFrom = floorDiv(fromMs, resolution) * resolution;
+            return buckets(Level(level), field, alignedFrom, toMs);
+        }
+    }
+    return BucketList();
+}
+
+void TelemetryRollups::cover(Level level, TelemetryFields::Field field, qint64 fromMs, qint64 toMs,
+                             Bucket &total) const
+{
+    if (fromMs >= toMs) return;
+
+    Level finest = holdsRecent(field, fromMs) ? TenSeconds : OneMinute;
+
+    if (level == finest) {
+        // Partial buckets at the ends count by their start time
+        for (const Bucket &bucket : buckets(level, field, fromMs, toMs)) {
+            total.merge(bucket);
+        }
+        return;
+    }
+
+    qint64 resolution = resolutionMs(level);
+    qint64 first = floorDiv(fromMs + resolution - 1, resolution) * resolution;
+    qint64 end = floorDiv(toMs, resolution) * resolution;
+    if (first >= end) {
+        cover(Level(level - 1), field, fromMs, toMs, total);
+        return;
+    }
+
+    // Whole coarse buckets in the middle, finer ones at the ends, folded in time order
+    cover(Level(level - 1), field, fromMs, first, total);
+    for (const Bucket &bucket : buckets(level, field, first, end)) {
+        total.merge(bucket);
+    }
+    cover(Level(level - 1), field, end, toMs, total);
+}
+
+TelemetryRollups::Bucket TelemetryRollups::aggregate(TelemetryFields::Field field, qint64 fromMs, qint64 toMs) const
+{
+    Bucket total;
+    total.startMs = fromMs;
+    if (field < 0 || field >= TelemetryFields::FieldCount) return total;
+
+    cover(OneHour, field, fromMs, toMs, total);
+    return total;
+}
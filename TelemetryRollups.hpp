@@ -0,0 +1,118 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include "TelemetryFields.hpp"
+
+/**
+ * @brief Downsampled telemetry maintained incrementally as samples arrive
+ *
+ * Every sample updates the open bucket of each level (10 s, 1 min, 1 h)
+ * for its field; when a bucket's interval ends it is closed. Minute and
+ * hour buckets are appended to one file per level per UTC day under
+ * rollup-<seconds>s/ in the telemetry directory; 10 s buckets are kept in
+ * memory for the last few hours only.
+ *
+ * A long chart reads the coarsest level that still gives enough points,
+ * and an average over a window is assembled from whole coarse buckets
+ * with finer buckets only at the two ends.
+ */
+class TelemetryRollups
+{
+public:
+    enum Level {
+        TenSeconds,
+        OneMinute,
+        OneHour,
+        LevelCount
+    };
+
+    struct Bucket {
+        qint64 startMs = 0;
+        quint32 count = 0;
+        double min = 0.0;
+        double max = 0.0;
+        double sum = 0.0;
+        double last = 0.0;
+
+        double mean() const { return count ? sum / count : 0.0; }
+
+        /** @brief Fold in one sample */
+        void add(double value);
+
+        /** @brief Fold in a later bucket (or a later piece of the same bucket) */
+        void merge(const Bucket &other);
+    };
+
+    /**
+     * @brief Constructor
+     * @param directory The telemetry directory; rollup files live in subdirectories of it
+     */
+    explicit TelemetryRollups(const QString &directory);
+
+    /** @brief Bucket width of a level in ms */
+    static qint64 resolutionMs(Level level);
+
+    /**
+     * @brief Fold a sample into every level
+     * @param field The field
+     * @param timestampMs Sample time in ms since epoch
+     * @param value The value
+     */
+    void add(TelemetryFields::Field field, qint64 timestampMs, double value);
+
+    /** @brief Write the open minute and hour buckets; later pieces of them merge on load */
+    void flush();
+
+    /**
+     * @brief Buckets covering a range from the coarsest level that still gives enough detail
+     * @param field The field
+     * @param fromMs Start of the range
+     * @param toMs End of the range
+     * @param maxPoints Upper bound on the number of buckets wanted, e.g. a chart's pixel width
+     * @return Buckets in time order, including the open one
+     */
+    QVector<Bucket> series(TelemetryFields::Field field, qint64 fromMs, qint64 toMs, int maxPoints) const;
+
+    /**
+     * @brief Summary over a range, accurate to the finest level held for it
+     * @param field The field
+     * @param fromMs Start of the range, inclusive
+     * @param toMs End of the range, exclusive
+     * @return The combined bucket; count is 0 if there is no data
+     */
+    Bucket aggregate(TelemetryFields::Field field, qint64 fromMs, qint64 toMs) const;
+
+private:
+    typedef QVector<Bucket> BucketList;
+
+    /** @brief Buckets of one level in [fromMs, toMs), closed and open */
+    BucketList buckets(Level level, TelemetryFields::Field field, qint64 fromMs, qint64 toMs) const;
+
+    /** @brief Closed buckets of a persisted level for one day, loaded on first use */
+    const QHash<int, BucketList> &dayBuckets(Level level, qint64 day) const;
+
+    /** @brief Whether 10 s buckets reach back to fromMs for this field */
+    bool holdsRecent(TelemetryFields::Field field, qint64 fromMs) const;
+
+    void close(Level level, TelemetryFields::Field field);
+    void write(Level level, TelemetryFields::Field field, const Bucket &bucket) const;
+    void cover(Level level, TelemetryFields::Field field, qint64 fromMs, qint64 toMs, Bucket &total) const;
+    QString dayPath(Level level, qint64 day) const;
+
+    static const int RECORD_SIZE = 48;
+    static const qint64 DAY_MS = 24 * 60 * 60 * 1000;
+    static const qint64 MEMORY_SPAN_MS = 6 * 60 * 60 * 1000;   // 10 s buckets kept this long
+
+    QString m_directory;
+
+    /** Open bucket per level per field */
+    QVector<QVector<Bucket>> m_open;
+
+    /** Closed 10 s buckets per field, oldest first */
+    QVector<BucketList> m_recent;
+
+    /** (level, day) -> field -> closed buckets */
+    mutable QHash<qint64, QHash<int, BucketList>> m_dayCache;
+};
@@ -0,0 +1,227 @@
+#include "TelemetryShmPublisher.hpp"
+#include <QDebug>
+#include <cerrno>
+#include <cstring>
+#include <signal.h>
+#include <sys/stat.h>
+
+namespace {
+    template <size_t N>
+    void copyString(char (&destination)[N], const QString &source)
+    {
+        qstrncpy(destination, source.toUtf8().constData(), N);
+    }
+
+    qint64 updateTime(const QDateTime &time)
+    {
+        return time.isValid() ? time.toMSecsSinceEpoch() : 0;
+    }
+}
+
+TelemetryShmPublisher::TelemetryShmPublisher(const QString &name)
+    : m_name(name)
+    , m_shm(nullptr)
+{
+    std::memset(&m_snapshot, 0, sizeof(m_snapshot));
+}
+
+TelemetryShmPublisher::~TelemetryShmPublisher()
+{
+    close();
+}
+
+bool TelemetryShmPublisher::open()
+{
+    if (m_shm) return true;
+
+#ifdef Q_OS_UNIX
+    // The GUI and the standalone Alpaca server both publish under the same
+    // name; whichever starts first owns the segment
+    const QByteArray name = m_name.toUtf8();
+    bool created = true;
+    int fd = shm_open(name.constData(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0 && errno == EEXIST) {
+        created = false;
+        fd = shm_open(name.constData(), O_RDWR, S_IRUSR | S_IWUSR);
+    }
+    if (fd < 0) {
+        qWarning() << "Cannot create telemetry shared memory" << m_name << std::strerror(errno);
+        return false;
+    }
+    if (ftruncate(fd, sizeof(origin_telemetry_shm)) != 0) {
+        qWarning() << "Cannot size telemetry shared memory" << m_name << std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    void *mapping = mmap(nullptr, sizeof(origin_telemetry_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        qWarning() << "Cannot map telemetry shared memory" << m_name << std::strerror(errno);
+        return false;
+    }
+
+    // A segment left by a crashed run is taken over; one whose writer is alive is not ours
+    origin_telemetry_shm *shm = static_cast<origin_telemetry_shm *>(mapping);
+    pid_t writer = pid_t(shm->writer_pid);
+    if (!created && writer > 0 && writer != getpid() && (kill(writer, 0) == 0 || errno == EPERM)) {
+        qWarning() << "Telemetry shared memory" << m_name << "is already published by process" << writer;
+        munmap(mapping, sizeof(origin_telemetry_shm));
+        return false;
+    }
+
+    // Readers see the segment dead until the first commit
+    m_shm = shm;
+    __atomic_store_n(&m_shm->magic, 0u, __ATOMIC_RELAXED);
+    m_shm->version = ORIGIN_TELEMETRY_VERSION;
+    m_shm->size = sizeof(origin_telemetry_snapshot);
+    m_shm->sequence &= ~1u;
+    m_shm->writer_pid = getpid();
+    qDebug() << "Publishing telemetry to shared memory" << m_name;
+    return true;
+#else
+    qWarning() << "Telemetry shared memory is only supported on Unix";
+    return false;
+#endif
+}
+
+void TelemetryShmPublisher::close()
+{
+    if (!m_shm) return;
+
+#ifdef Q_OS_UNIX
+    // A process that took the segment over after us now owns it
+    bool owner = m_shm->writer_pid == getpid();
+    if (owner) {
+        __atomic_store_n(&m_shm->magic, 0u, __ATOMIC_RELEASE);
+    }
+    munmap(m_shm, sizeof(origin_telemetry_shm));
+    if (owner) {
+        shm_unlink(m_name.toUtf8().constData());
+    }
+#endif
+    m_shm = nullptr;
+}
+
+void TelemetryShmPublisher::publish(const TelescopeData &data, qint64 timestampMs)
+{
+    if (!m_shm) return;
+
+    origin_telemetry_mount &mount = m_snapshot.mount;
+    mount.updated_ms = updateTime(data.mountLastUpdate);
+    mount.latitude = data.mount.latitude;
+    mount.longitude = data.mount.longitude;
+    mount.enc0 = data.mount.enc0;
+    mount.enc1 = data.mount.enc1;
+    mount.battery_voltage = data.mount.batteryVoltage;
+    mount.is_aligned = data.mount.isAligned;
+    mount.is_goto_over = data.mount.isGotoOver;
+    mount.is_tracking = data.mount.isTracking;
+    mount.num_align_refs = data.mount.numAlignRefs;
+    copyString(mount.battery_level, data.mount.batteryLevel);
+    copyString(mount.charger_status, data.mount.chargerStatus);
+    copyString(mount.date, data.mount.date);
+    copyString(mount.time, data.mount.time);
+    copyString(mount.time_zone, data.mount.timeZone);
+
+    origin_telemetry_camera &camera = m_snapshot.camera;
+    camera.updated_ms = updateTime(data.cameraLastUpdate);
+    camera.exposure = data.camera.exposure;
+    camera.color_r_balance = data.camera.colorRBalance;
+    camera.color_g_balance = data.camera.colorGBalance;
+    camera.color_b_balance = data.camera.colorBBalance;
+    camera.binning = data.camera.binning;
+    camera.bit_depth = data.camera.bitDepth;
+    camera.iso = data.camera.iso;
+    camera.offset = data.camera.offset;
+
+    origin_telemetry_focuser &focuser = m_snapshot.focuser;
+    focuser.updated_ms = updateTime(data.focuserLastUpdate);
+    focuser.velocity = data.focuser.velocity;
+    focuser.position = data.focuser.position;
+    focuser.backlash = data.focuser.backlash;
+    focuser.calibration_lower_limit = data.focuser.calibrationLowerLimit;
+    focuser.calibration_upper_limit = data.focuser.calibrationUpperLimit;
+    focuser.percentage_calibration_complete = data.focuser.percentageCalibrationComplete;
+    focuser.is_calibration_complete = data.focuser.isCalibrationComplete;
+    focuser.is_move_to_over = data.focuser.isMoveToOver;
+    focuser.need_auto_focus = data.focuser.needAutoFocus;
+    focuser.requires_calibration = data.focuser.requiresCalibration;
+
+    origin_telemetry_environment &environment = m_snapshot.environment;
+    environment.updated_ms = updateTime(data.environmentLastUpdate);
+    environment.ambient_temperature = data.environment.ambientTemperature;
+    environment.camera_temperature = data.environment.cameraTemperature;
+    environment.cpu_temperature = data.environment.cpuTemperature;
+    environment.front_cell_temperature = data.environment.frontCellTemperature;
+    environment.dew_point = data.environment.dewPoint;
+    environment.humidity = data.environment.humidity;
+    environment.cpu_fan_on = data.environment.cpuFanOn;
+    environment.ota_fan_on = data.environment.otaFanOn;
+    environment.recalibrating = data.environment.recalibrating;
+
+    origin_telemetry_image &image = m_snapshot.image;
+    image.updated_ms = updateTime(data.imageLastUpdate);
+    image.ra = data.lastImage.ra;
+    image.dec = data.lastImage.dec;
+    image.orientation = data.lastImage.orientation;
+    image.fov_x = data.lastImage.fovX;
+    image.fov_y = data.lastImage.fovY;
+    copyString(image.file_location, data.lastImage.fileLocation);
+    copyString(image.image_type, data.lastImage.imageType);
+
+    origin_telemetry_disk &disk = m_snapshot.disk;
+    disk.updated_ms = updateTime(data.diskLastUpdate);
+    disk.capacity = data.disk.capacity;
+    disk.free_bytes = data.disk.freeBytes;
+    disk.seconds_to_full = data.disk.secondsToFull;
+    disk.fill_rate = data.disk.fillRate;
+    copyString(disk.level, data.disk.level);
+
+    origin_telemetry_dew_heater &dewHeater = m_snapshot.dew_heater;
+    dewHeater.updated_ms = updateTime(data.dewHeaterLastUpdate);
+    dewHeater.heater_level = data.dewHeater.heaterLevel;
+    dewHeater.manual_power_level = data.dewHeater.manualPowerLevel;
+    dewHeater.aggression = data.dewHeater.aggression;
+    copyString(dewHeater.mode, data.dewHeater.mode);
+
+    m_snapshot.orientation.updated_ms = updateTime(data.orientationLastUpdate);
+    m_snapshot.orientation.altitude = data.orientation.altitude;
+
+    commit(timestampMs);
+}
+
+void TelemetryShmPublisher::publish(const OriginBackend::TelescopeStatus &status, qint64 timestampMs)
+{
+    if (!m_shm) return;
+
+    origin_telemetry_status &out = m_snapshot.status;
+    out.updated_ms = timestampMs;
+    out.alt_degrees = status.altPosition;
+    out.az_degrees = status.azPosition;
+    out.ra_hours = status.raPosition;
+    out.dec_degrees = status.decPosition;
+    out.temperature = status.temperature;
+    out.is_connected = status.isConnected;
+    out.is_slewing = status.isSlewing;
+    out.is_tracking = status.isTracking;
+    out.is_parked = status.isParked;
+    out.is_aligned = status.isAligned;
+    copyString(out.current_operation, status.currentOperation);
+
+    commit(timestampMs);
+}
+
+void TelemetryShmPublisher::commit(qint64 timestampMs)
+{
+    m_snapshot.published_ms = timestampMs;
+
+#ifdef Q_OS_UNIX
+    // Sequence lock: odd while writing, readers retry if it moved under them
+    uint32_t sequence = m_shm->sequence;
+    __atomic_store_n(&m_shm->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    std::memcpy(&m_shm->snapshot, &m_snapshot, sizeof(m_snapshot));
+    __atomic_store_n(&m_shm->sequence, sequence + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&m_shm->magic, ORIGIN_TELEMETRY_MAGIC, __ATOMIC_RELEASE);
+#endif
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QString>
+#include "OriginBackend.hpp"
+#include "TelescopeData.hpp"
+#include "origin_telemetry_shm.h"
+
+/**
+ * @brief Publishes the live telemetry snapshot into POSIX shared memory
+ *
+ * Local co-processes map the segment described in origin_telemetry_shm.h
+ * and read it without talking to us or the telescope. Publishing converts
+ * the snapshot into the fixed C layout off to the side and then copies it
+ * into the segment under the sequence lock, so the segment is only
+ * inconsistent for the duration of one memcpy and readers simply retry.
+ *
+ * One process publishes under a name at a time: open() fails while the
+ * recorded writer is alive, and close() removes the segment only if this
+ * process is still that writer.
+ *
+ * Only available on Unix; open() fails elsewhere and publish() is a no-op.
+ */
+class TelemetryShmPublisher
+{
+public:
+    explicit TelemetryShmPublisher(const QString &name = ORIGIN_TELEMETRY_SHM_NAME);
+    ~TelemetryShmPublisher();
+
+    /**
+     * @brief Create the segment, or take over one whose writer has exited, readable by this user only
+     * @return False, with a warning, if shared memory is unavailable or another live process publishes it
+     */
+    bool open();
+
+    /** @brief Mark the segment dead for readers and remove it, unless another process has taken it over */
+    void close();
+
+    bool isOpen() const { return m_shm != nullptr; }
+    QString name() const { return m_name; }
+
+    /** @brief Publish every group of the telescope state */
+    void publish(const TelescopeData &data, qint64 timestampMs);
+
+    /** @brief Publish the Alpaca backend's status summary */
+    void publish(const OriginBackend::TelescopeStatus &status, qint64 timestampMs);
+
+private:
+    void commit(qint64 timestampMs);
+
+    QString m_name;
+    origin_telemetry_shm *m_shm;
+    origin_telemetry_snapshot m_snapshot;
+};
@@ -0,0 +1,428 @@
+#include "TelemetryStore.hpp"
+#include <QDate>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    quint64 toBits(double value)
+    {
+        quint64 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    double fromBits(quint64 bits)
+    {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    qint64 dayOf(qint64 timestampMs, qint64 dayMs)
+    {
+        // Floor division so pre-1970 timestamps do not share day 0
+        return timestampMs >= 0 ? timestampMs / dayMs : -((-timestampMs + dayMs - 1) / dayMs);
+    }
+
+    /** MSB-first reader over a compressed block */
+    class BitReader {
+    public:
+        BitReader(const uchar *data, quint32 length)
+            : m_data(data), m_bitLength(quint64(length) * 8), m_position(0) {}
+
+        bool read(int bitCount, quint64 *value)
+        {
+            if (m_position + bitCount > m_bitLength) return false;
+            quint64 result = 0;
+            for (int i = 0; i < bitCount; i++) {
+                quint64 bit = (m_data[m_position >> 3] >> (7 - (m_position & 7))) & 1;
+                result = (result << 1) | bit;
+                m_position++;
+            }
+            *value = result;
+            return true;
+        }
+
+    private:
+        const uchar *m_data;
+        quint64 m_bitLength;
+        quint64 m_position;
+    };
+
+    // Little-endian field access for headers and index entries
+    template <typename T> void put(uchar *dst, T value) { qToLittleEndian(value, dst); }
+    template <typename T> T get(const uchar *src) { return qFromLittleEndian<T>(src); }
+}
+
+TelemetryStore::TelemetryStore(const QString &directory, QObject *parent)
+    : QObject(parent)
+    , m_directory(directory.isEmpty() ? defaultDirectory() : directory)
+    , m_open(TelemetryFields::FieldCount)
+    , m_rollups(m_directory)
+{
+    QDir().mkpath(m_directory);
+
+    // Bound what a crash can lose without writing tiny blocks
+    m_flushTimer.setInterval(FLUSH_INTERVAL_MS);
+    connect(&m_flushTimer, &QTimer::timeout, this, &TelemetryStore::flush);
+    m_flushTimer.start();
+}
+
+TelemetryStore::~TelemetryStore()
+{
+    flush();
+}
+
+QString TelemetryStore::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/telemetry";
+}
+
+QString TelemetryStore::segmentPath(qint64 day) const
+{
+    return m_directory + "/" + QDate(1970, 1, 1).addDays(day).toString("yyyyMMdd") + ".seg";
+}
+
+QString TelemetryStore::indexPath(qint64 day) const
+{
+    return m_directory + "/" + QDate(1970, 1, 1).addDays(day).toString("yyyyMMdd") + ".idx";
+}
+
+void TelemetryStore::record(const TelescopeData &data, TelemetryFields::Group group, qint64 timestampMs)
+{
+    for (TelemetryFields::Field field : TelemetryFields::fieldsInGroup(group)) {
+        append(field, timestampMs, TelemetryFields::descriptor(field).read(data));
+    }
+}
+
+void TelemetryStore::append(TelemetryFields::Field field, qint64 timestampMs, double value)
+{
+    m_rollups.add(field, timestampMs, value);
+
+    OpenBlock &block = m_open[field];
+    qint64 day = dayOf(timestampMs, DAY_MS);
+
+    if (block.count > 0 &&
+        (day != block.day || block.count >= MAX_BLOCK_SAMPLES ||
+         timestampMs - block.firstMs > MAX_BLOCK_SPAN_MS || timestampMs < block.lastMs)) {
+        seal(field);
+    }
+
+    auto writeBits = [&block](quint64 bits, int bitCount) {
+        for (int i = bitCount - 1; i >= 0; i--) {
+            if ((block.bitCount & 7) == 0) block.bits.append('\0');
+            if ((bits >> i) & 1) {
+                block.bits[block.bitCount >> 3] = char(block.bits[block.bitCount >> 3] | (0x80 >> (block.bitCount & 7)));
+            }
+            block.bitCount++;
+        }
+    };
+
+    quint64 bits = toBits(value);
+
+    if (block.count == 0) {
+        // First sample: timestamp goes in the block header, value verbatim
+        block.day = day;
+        block.firstMs = timestampMs;
+        block.lastMs = timestampMs;
+        block.lastDelta = 0;
+        block.lastValue = bits;
+        block.leadingZeros = -1;
+        writeBits(bits, 64);
+        block.count = 1;
+        return;
+    }
+
+    // Timestamp: delta of deltas in variable-width buckets
+    qint64 delta = timestampMs - block.lastMs;
+    qint64 deltaOfDelta = delta - block.lastDelta;
+    if (deltaOfDelta == 0) {
+        writeBits(0, 1);
+    } else if (deltaOfDelta >= -63 && deltaOfDelta <= 64) {
+        writeBits(0x2, 2);
+        writeBits(quint64(deltaOfDelta + 63), 7);
+    } else if (deltaOfDelta >= -255 && deltaOfDelta <= 256) {
+        writeBits(0x6, 3);
+        writeBits(quint64(deltaOfDelta + 255), 9);
+    } else if (deltaOfDelta >= -2047 && deltaOfDelta <= 2048) {
+        writeBits(0xe, 4);
+        writeBits(quint64(deltaOfDelta + 2047), 12);
+    } else {
+        writeBits(0xf, 4);
+        writeBits(quint64(quint32(qint32(deltaOfDelta))), 32);
+    }
+    block.lastDelta = delta;
+    block.lastMs = timestampMs;
+
+    // Value: XOR with the previous one, reusing the last window of meaningful bits
+    quint64 xorValue = bits ^ block.lastValue;
+    if (xorValue == 0) {
+        writeBits(0, 1);
+    } else {
+        writeBits(1, 1);
+        int leading = qMin(int(qCountLeadingZeroBits(xorValue)), 31);
+        int trailing = int(qCountTrailingZeroBits(xorValue));
+        if (block.leadingZeros >= 0 && leading >= block.leadingZeros && trailing >= block.trailingZeros) {
+            writeBits(0, 1);
+            writeBits(xorValue >> block.trailingZeros, 64 - block.leadingZeros - block.trailingZeros);
+        } else {
+            int meaningful = 64 - leading - trailing;
+            writeBits(1, 1);
+            writeBits(quint64(leading), 5);
+            writeBits(quint64(meaningful & 63), 6);    // 64 is stored as 0
+            writeBits(xorValue >> trailing, meaningful);
+            block.leadingZeros = leading;
+            block.trailingZeros = trailing;
+        }
+    }
+    block.lastValue = bits;
+    block.count++;
+}
+
+void TelemetryStore::seal(TelemetryFields::Field field)
+{
+    OpenBlock &block = m_open[field];
+    if (block.count == 0) return;
+
+    uchar header[BLOCK_HEADER_SIZE] = {};
+    put<quint32>(header, BLOCK_MAGIC);
+    put<quint16>(header + 4, quint16(field));
+    put<quint32>(header + 8, block.count);
+    put<quint32>(header + 12, quint32(block.bits.size()));
+    put<qint64>(header + 16, block.firstMs);
+    put<qint64>(header + 24, block.lastMs);
+
+    QFile segment(segmentPath(block.day));
+    if (!segment.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed to open telemetry segment:" << segment.fileName();
+        block = OpenBlock();
+        return;
+    }
+
+    IndexEntry entry;
+    entry.field = quint16(field);
+    entry.count = block.count;
+    entry.firstMs = block.firstMs;
+    entry.lastMs = block.lastMs;
+    entry.offset = quint64(segment.size());
+    entry.length = quint32(block.bits.size());
+
+    segment.write(reinterpret_cast<const char*>(header), BLOCK_HEADER_SIZE);
+    segment.write(block.bits);
+    segment.close();
+
+    uchar raw[INDEX_ENTRY_SIZE] = {};
+    put<quint16>(raw, entry.field);
+    put<quint32>(raw + 4, entry.count);
+    put<qint64>(raw + 8, entry.firstMs);
+    put<qint64>(raw + 16, entry.lastMs);
+    put<quint64>(raw + 24, entry.offset);
+    put<quint32>(raw + 32, entry.length);
+
+    // A missing or short index is rebuilt from the segment on the next read
+    QFile index(indexPath(block.day));
+    if (index.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        index.write(reinterpret_cast<const char*>(raw), INDEX_ENTRY_SIZE);
+    }
+
+    auto cached = m_indexCache.find(block.day);
+    if (cached != m_indexCache.end()) {
+        cached.value().append(entry);
+    }
+
+    block = OpenBlock();
+}
+
+void TelemetryStore::flush()
+{
+    for (int field = 0; field < TelemetryFields::FieldCount; field++) {
+        seal(TelemetryFields::Field(field));
+    }
+    m_rollups.flush();
+}
+
+const QVector<TelemetryStore::IndexEntry> &TelemetryStore::indexFor(qint64 day) const
+{
+    auto cached = m_indexCache.constFind(day);
+    if (cached != m_indexCache.constEnd()) return cached.value();
+
+    QVector<IndexEntry> entries;
+    QFile index(indexPath(day));
+    qint64 segmentSize = QFileInfo(segmentPath(day)).size();
+
+    if (index.open(QIODevice::ReadOnly)) {
+        QByteArray raw = index.readAll();
+        const uchar *p = reinterpret_cast<const uchar*>(raw.constData());
+        for (int i = 0; i + INDEX_ENTRY_SIZE <= raw.size(); i += INDEX_ENTRY_SIZE) {
+            IndexEntry entry;
+            entry.field = get<quint16>(p + i);
+            entry.count = get<quint32>(p + i + 4);
+            entry.firstMs = get<qint64>(p + i + 8);
+            entry.lastMs = get<qint64>(p + i + 16);
+            entry.offset = get<quint64>(p + i + 24);
+            entry.length = get<quint32>(p + i + 32);
+            entries.append(entry);
+        }
+    }
+
+    // The index must account for the whole segment, otherwise a write was cut short
+    qint64 covered = entries.isEmpty() ? 0 : qint64(entries.last().offset + BLOCK_HEADER_SIZE + entries.last().length);
+    if (covered != segmentSize) {
+        qWarning() << "Rebuilding telemetry index for" << segmentPath(day);
+        entries = rebuildIndex(segmentPath(day));
+    }
+
+    return *m_indexCache.insert(day, entries);
+}
+
+QVector<TelemetryStore::IndexEntry> TelemetryStore::rebuildIndex(const QString &path)
+{
+    QVector<IndexEntry> entries;
+    QFile segment(path);
+    if (!segment.open(QIODevice::ReadOnly) || segment.size() == 0) return entries;
+
+    const uchar *data = segment.map(0, segment.size());
+    if (!data) return entries;
+
+    quint64 offset = 0;
+    quint64 size = quint64(segment.size());
+    while (offset + BLOCK_HEADER_SIZE <= size) {
+        const uchar *header = data + offset;
+        if (get<quint32>(header) != BLOCK_MAGIC) break;
+
+        IndexEntry entry;
+        entry.field = get<quint16>(header + 4);
+        entry.count = get<quint32>(header + 8);
+        entry.length = get<quint32>(header + 12);
+        entry.firstMs = get<qint64>(header + 16);
+        entry.lastMs = get<qint64>(header + 24);
+        entry.offset = offset;
+        if (offset + BLOCK_HEADER_SIZE + entry.length > size) break;    // Torn final write
+
+        entries.append(entry);
+        offset += BLOCK_HEADER_SIZE + entry.length;
+    }
+
+    segment.unmap(const_cast<uchar*>(data));
+    return entries;
+}
+
+void TelemetryStore::decodeBlock(const uchar *payload, quint32 length, quint32 count, qint64 firstMs,
+                                 qint64 fromMs, qint64 toMs, QVector<Sample> &out)
+{
+    BitReader reader(payload, length);
+    quint64 bits = 0;
+    if (count == 0 || !reader.read(64, &bits)) return;
+
+    qint64 timestamp = firstMs;
+    qint64 delta = 0;
+    quint64 value = bits;
+    int leadingZeros = 0;
+    int trailingZeros = 0;
+
+    for (quint32 i = 0; ; i++) {
+        if (timestamp > toMs) return;
+        if (timestamp >= fromMs) out.append({timestamp, fromBits(value)});
+        if (i + 1 >= count) return;
+
+        // Timestamp bucket: count leading 1 bits, at most four
+        int ones = 0;
+        while (ones < 4) {
+            if (!reader.read(1, &bits)) return;
+            if (bits == 0) break;
+            ones++;
+        }
+        qint64 deltaOfDelta = 0;
+        switch (ones) {
+        case 0:
+            break;
+        case 1:
+            if (!reader.read(7, &bits)) return;
+            deltaOfDelta = qint64(bits) - 63;
+            break;
+        case 2:
+            if (!reader.read(9, &bits)) return;
+            deltaOfDelta = qint64(bits) - 255;
+            break;
+        case 3:
+            if (!reader.read(12, &bits)) return;
+            deltaOfDelta = qint64(bits) - 2047;
+            break;
+        default:
+            if (!reader.read(32, &bits)) return;
+            deltaOfDelta = qint32(quint32(bits));
+            break;
+        }
+        delta += deltaOfDelta;
+        timestamp += delta;
+
+        // Value
+        if (!reader.read(1, &bits)) return;
+        if (bits) {
+            if (!reader.read(1, &bits)) return;
+            if (bits) {
+                quint64 leading, meaningful;
+                if (!reader.read(5, &leading) || !reader.read(6, &meaningful)) return;
+                if (meaningful == 0) meaningful = 64;
+                leadingZeros = int(leading);
+                trailingZeros = 64 - leadingZeros - int(meaningful);
+            }
+            quint64 xorValue;
+            if (!reader.read(64 - leadingZeros - trailingZeros, &xorValue)) return;
+            value ^= xorValue << trailingZeros;
+        }
+    }
+}
+
+QVector<TelemetryStore::Sample> TelemetryStore::query(TelemetryFields::Field field, qint64 fromMs, qint64 toMs) const
+{
+    QVector<Sample> samples;
+    if (field < 0 || field >= TelemetryFields::FieldCount || fromMs > toMs) return samples;
+
+    const OpenBlock &open = m_open[field];
+    qint64 lastDay = dayOf(toMs, DAY_MS);
+    for (qint64 day = dayOf(fromMs, DAY_MS); day <= lastDay; day++) {
+        if (!QFileInfo::exists(segmentPath(day))) continue;
+
+        const QVector<IndexEntry> &entries = indexFor(day);
+        QFile segment(segmentPath(day));
+        const uchar *data = nullptr;
+
+        for (const IndexEntry &entry : entries) {
+            if (entry.field != field || entry.lastMs < fromMs || entry.firstMs > toMs) continue;
+
+            // Map lazily: most days of a long query hold no blocks for this range
+            if (!data) {
+                if (!segment.open(QIODevice::ReadOnly)) break;
+                data = segment.map(0, segment.size());
+                if (!data) break;
+            }
+            if (entry.offset + BLOCK_HEADER_SIZE + entry.length > quint64(segment.size())) continue;
+
+            decodeBlock(data + entry.offset + BLOCK_HEADER_SIZE, entry.length, entry.count,
+                        entry.firstMs, fromMs, toMs, samples);
+        }
+
+        if (data) segment.unmap(const_cast<uchar*>(data));
+    }
+
+    // Samples still being encoded in memory
+    if (open.count > 0 && open.lastMs >= fromMs && open.firstMs <= toMs) {
+        decodeBlock(reinterpret_cast<const uchar*>(open.bits.constData()), quint32(open.bits.size()),
+                    open.count, open.firstMs, fromMs, toMs, samples);
+    }
+
+    // Blocks are written in time order unless the clock was set back
+    if (!std::is_sorted(samples.begin(), samples.end(),
+                        [](const Sample &a, const Sample &b) { return a.timestampMs < b.timestampMs; })) {
+        std::stable_sort(samples.begin(), samples.end(),
+                         [](const Sample &a, const Sample &b) { return a.timestampMs < b.timestampMs; });
+    }
+    return samples;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QTimer>
+#include <QVector>
+#include "TelemetryFields.hpp"
+#include "TelemetryRollups.hpp"
+
+/**
+ * @brief Append-only on-disk time series of every numeric telemetry field
+ *
+ * Samples are compressed per field with Gorilla-style encoding: timestamps
+ * as delta-of-deltas, values as the XOR with the previous value, so a
+ * steady reading costs a couple of bits. Compressed blocks are appended to
+ * one segment file per UTC day (yyyyMMdd.seg) with a sparse index beside
+ * it (yyyyMMdd.idx) giving each block's field, time span and offset.
+ *
+ * Queries read the index, map the segment with QFile::map and decode only
+ * the blocks that overlap the requested range. Recording just appends bits
+ * to an in-memory block; disk is touched when a block fills, spans too long,
+ * or at the periodic flush. Every sample also feeds TelemetryRollups, which
+ * answers charts and averages over long windows without touching raw data.
+ */
+class TelemetryStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Sample {
+        qint64 timestampMs;
+        double value;
+    };
+
+    /**
+     * @brief Constructor
+     * @param directory Where segments are kept; defaults to telemetry/ under the app data location
+     * @param parent The parent QObject
+     */
+    explicit TelemetryStore(const QString &directory = QString(), QObject *parent = nullptr);
+    ~TelemetryStore();
+
+    /** @brief The directory holding the segments */
+    QString directory() const { return m_directory; }
+
+    /**
+     * @brief Record every field of a group from the current telescope state
+     * @param data The telescope state just updated
+     * @param group Which status notification updated it
+     * @param timestampMs Sample time in ms since epoch
+     */
+    void record(const TelescopeData &data, TelemetryFields::Group group, qint64 timestampMs);
+
+    /**
+     * @brief Record one sample
+     * @param field The field
+     * @param timestampMs Sample time in ms since epoch; must not go backwards per field
+     * @param value The value
+     */
+    void append(TelemetryFields::Field field, qint64 timestampMs, double value);
+
+    /**
+     * @brief Read a field's history, including samples not yet flushed
+     * @param field The field
+     * @param fromMs Start of the range, inclusive
+     * @param toMs End of the range, inclusive
+     * @return Samples in time order
+     */
+    QVector<Sample> query(TelemetryFields::Field field, qint64 fromMs, qint64 toMs) const;
+
+    /** @brief Downsampled history of every field */
+    const TelemetryRollups &rollups() const { return m_rollups; }
+
+    /** @brief Seal and write every open block */
+    void flush();
+
+private:
+    /** On-disk index entry; one per sealed block */
+    struct IndexEntry {
+        quint16 field;
+        quint32 count;
+        qint64 firstMs;
+        qint64 lastMs;
+        quint64 offset;
+        quint32 length;
+    };
+
+    /** Gorilla encoder state for the open block of one field */
+    struct OpenBlock {
+        QByteArray bits;
+        int bitCount = 0;
+        quint32 count = 0;
+        qint64 day = -1;
+        qint64 firstMs = 0;
+        qint64 lastMs = 0;
+        qint64 lastDelta = 0;
+        quint64 lastValue = 0;
+        int leadingZeros = -1;
+        int trailingZeros = 0;
+    };
+
+    void seal(TelemetryFields::Field field);
+    QString segmentPath(qint64 day) const;
+    QString indexPath(qint64 day) const;
+    const QVector<IndexEntry> &indexFor(qint64 day) const;
+    static QVector<IndexEntry> rebuildIndex(const QString &segmentPath);
+    static void decodeBlock(const uchar *payload, quint32 length, quint32 count, qint64 firstMs,
+                            qint64 fromMs, qint64 toMs, QVector<Sample> &out);
+
+    static const quint32 BLOCK_MAGIC = 0x3142544f;         // "OTB1"
+    static const int BLOCK_HEADER_SIZE = 32;
+    static const int INDEX_ENTRY_SIZE = 40;
+    static const quint32 MAX_BLOCK_SAMPLES = 1024;
+    static const qint64 MAX_BLOCK_SPAN_MS = 60 * 60 * 1000;
+    static const int FLUSH_INTERVAL_MS = 10 * 60 * 1000;
+    static const qint64 DAY_MS = 24 * 60 * 60 * 1000;
+
+    static QString defaultDirectory();
+
+    QString m_directory;
+    QVector<OpenBlock> m_open;
+    TelemetryRollups m_rollups;
+    QTimer m_flushTimer;
+    mutable QHash<qint64, QVector<IndexEntry>> m_indexCache;
+};
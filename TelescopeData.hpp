@@ -71,6 +71,8 @@ struct DiskStatus {
     qint64 capacity = 0;
     qint64 freeBytes = 0;
     QString level;
+    double fillRate = 0.0;       // Smoothed bytes/s being consumed, derived from successive reports
+    qint64 secondsToFull = -1;   // At the current fill rate, -1 while the disk is not filling
 };
 
 struct DewHeaterStatus {
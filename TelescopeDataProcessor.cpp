@@ -11,6 +11,16 @@ void TelescopeDataProcessor::reset() {
     telescopeData = TelescopeData();
 }
 
+void TelescopeDataProcessor::restore(const TelescopeData &data) {
+    telescopeData = data;
+    
+    // The fill rate is derived from successive reports of one session; one
+    // from before the restart would average the whole gap into the first rate
+    telescopeData.diskLastUpdate = QDateTime();
+    telescopeData.disk.fillRate = 0.0;
+    telescopeData.disk.secondsToFull = -1;
+}
+
 bool TelescopeDataProcessor::processJsonPacket(const QByteArray &jsonData) {
     QJsonDocument doc = QJsonDocument::fromJson(jsonData);
     if (!doc.isObject()) {
@@ -18,7 +28,12 @@ bool TelescopeDataProcessor::processJsonPacket(const QByteArray &jsonData) {
         return false;
     }
     
-    QJsonObject obj = doc.object();
+    return processJsonObject(doc.object());
+}
+
+bool TelescopeDataProcessor::processJsonObject(const QJsonObject &obj, qint64 timestampMs) {
+    // Everything the packet updates is stamped with the same time
+    packetTimeMs = timestampMs > 0 ? timestampMs : QDateTime::currentMSecsSinceEpoch();
     
     // Get common fields
     QString source = obj["Source"].toString();
@@ -72,6 +87,10 @@ const TelescopeData& TelescopeDataProcessor::getData() const {
     return telescopeData;
 }
 
+qint64 TelescopeDataProcessor::lastPacketTimeMs() const {
+    return packetTimeMs;
+}
+
 void TelescopeDataProcessor::updateMountStatus(const QJsonObject &obj) {
     telescopeData.mount.batteryLevel = obj["BatteryLevel"].toString();
     telescopeData.mount.batteryVoltage = obj["BatteryVoltage"].toDouble();
@@ -88,7 +107,7 @@ void TelescopeDataProcessor::updateMountStatus(const QJsonObject &obj) {
     telescopeData.mount.enc0 = obj["Enc0"].toDouble();
     telescopeData.mount.enc1 = obj["Enc1"].toDouble();
     
-    telescopeData.mountLastUpdate = QDateTime::currentDateTime();
+    telescopeData.mountLastUpdate = QDateTime::fromMSecsSinceEpoch(packetTimeMs);
 }
 
 void TelescopeDataProcessor::updateCameraStatus(const QJsonObject &obj) {
@@ -101,7 +120,7 @@ void TelescopeDataProcessor::updateCameraStatus(const QJsonObject &obj) {
     telescopeData.camera.iso = obj["ISO"].toInt();
     telescopeData.camera.offset = obj["Offset"].toInt();
     
-    telescopeData.cameraLastUpdate = QDateTime::currentDateTime();
+    telescopeData.cameraLastUpdate = QDateTime::fromMSecsSinceEpoch(packetTimeMs);
 }
 
 void TelescopeDataProcessor::updateFocuserStatus(const QJsonObject &obj) {
@@ -116,7 +135,7 @@ void TelescopeDataProcessor::updateFocuserStatus(const QJsonObject &obj) {
     telescopeData.focuser.requiresCalibration = obj["RequiresCalibration"].toBool();
     telescopeData.focuser.velocity = obj["Velocity"].toDouble();
     
-    telescopeData.focuserLastUpdate = QDateTime::currentDateTime();
+    telescopeData.focuserLastUpdate = QDateTime::fromMSecsSinceEpoch(packetTimeMs);
 }
 
 void TelescopeDataProcessor::updateEnvironmentStatus(const QJsonObject &obj) {
@@ -130,7 +149,7 @@ void TelescopeDataProcessor::updateEnvironmentStatus(const QJsonObject &obj) {
     telescopeData.environment.otaFanOn = obj["OtaFanOn"].toBool();
     telescopeData.environment.recalibrating = obj["Recalibrating"].toBool();
     
-    telescopeData.environmentLastUpdate = QDateTime::currentDateTime();
+    telescopeData.environmentLastUpdate = QDateTime::fromMSecsSinceEpoch(packetTimeMs);
 }
 
 void TelescopeDataProcessor::updateImageInfo(const QJsonObject &obj) {
@@ -142,15 +161,33 @@ void TelescopeDataProcessor::updateImageInfo(const QJsonObject &obj) {
     telescopeData.lastImage.fovX = obj["FovX"].toDouble();
     telescopeData.lastImage.fovY = obj["FovY"].toDouble();
     
-    telescopeData.imageLastUpdate = QDateTime::currentDateTime();
+    telescopeData.imageLastUpdate = QDateTime::fromMSecsSinceEpoch(packetTimeMs);
 }
 
 void TelescopeDataProcessor::updateDiskStatus(const QJsonObject &obj) {
-    telescopeData.disk.capacity = obj["Capacity"].toVariant().toLongLong();
-    telescopeData.disk.freeBytes = obj["FreeBytes"].toVariant().toLongLong();
-    telescopeData.disk.level = obj["Level"].toString();
+    DiskStatus &disk = telescopeData.disk;
+    qint64 previousFree = disk.freeBytes;
+    QDateTime previousUpdate = telescopeData.diskLastUpdate;
+    QDateTime now = QDateTime::fromMSecsSinceEpoch(packetTimeMs);
+    
+    disk.capacity = obj["Capacity"].toVariant().toLongLong();
+    disk.freeBytes = obj["FreeBytes"].toVariant().toLongLong();
+    disk.level = obj["Level"].toString();
+    
+    // Fill rate from successive reports; frames land in bursts, so smooth it
+    double elapsed = previousUpdate.isValid() ? previousUpdate.msecsTo(now) / 1000.0 : 0.0;
+    if (previousFree > 0 && elapsed > 0.0) {
+        double rate = (previousFree - disk.freeBytes) / elapsed;
+        if (rate < 0.0) {
+            // Space was freed (files deleted); start the estimate again
+            disk.fillRate = 0.0;
+        } else {
+            disk.fillRate = DISK_RATE_SMOOTHING * rate + (1.0 - DISK_RATE_SMOOTHING) * disk.fillRate;
+        }
+    }
+    disk.secondsToFull = disk.fillRate > 1.0 ? qint64(disk.freeBytes / disk.fillRate) : -1;
     
-    telescopeData.diskLastUpdate = QDateTime::currentDateTime();
+    telescopeData.diskLastUpdate = now;
 }
 
 void TelescopeDataProcessor::updateDewHeaterStatus(const QJsonObject &obj) {
@@ -159,11 +196,11 @@ void TelescopeDataProcessor::updateDewHeaterStatus(const QJsonObject &obj) {
     telescopeData.dewHeater.manualPowerLevel = obj["ManualPowerLevel"].toDouble();
     telescopeData.dewHeater.mode = obj["Mode"].toString();
     
-    telescopeData.dewHeaterLastUpdate = QDateTime::currentDateTime();
+    telescopeData.dewHeaterLastUpdate = QDateTime::fromMSecsSinceEpoch(packetTimeMs);
 }
 
 void TelescopeDataProcessor::updateOrientationStatus(const QJsonObject &obj) {
     telescopeData.orientation.altitude = obj["Altitude"].toInt();
     
-    telescopeData.orientationLastUpdate = QDateTime::currentDateTime();
+    telescopeData.orientationLastUpdate = QDateTime::fromMSecsSinceEpoch(packetTimeMs);
 }
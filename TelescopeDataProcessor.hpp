@@ -26,6 +26,15 @@ public:
      */
     void reset();
     
+    /**
+     * @brief Replace all data, e.g. with a checkpoint from the last run
+     * 
+     * No update signals are emitted: restored values are not new telemetry.
+     * The disk fill rate starts over, as it cannot span the gap.
+     * @param data The data to show until the telescope reports again
+     */
+    void restore(const TelescopeData &data);
+    
     /**
      * @brief Process a JSON packet from the telescope
      * @param jsonData The JSON data to process
@@ -33,12 +42,26 @@ public:
      */
     bool processJsonPacket(const QByteArray &jsonData);
     
+    /**
+     * @brief Process a packet that has already been decoded
+     * @param obj The decoded JSON object
+     * @param timestampMs When the packet left the telescope in ms since epoch, 0 for now
+     * @return true if the packet was processed successfully, false otherwise
+     */
+    bool processJsonObject(const QJsonObject &obj, qint64 timestampMs = 0);
+    
     /**
      * @brief Get the current telescope data
      * @return A reference to the telescope data
      */
     const TelescopeData& getData() const;
     
+    /**
+     * @brief Get the time the last processed packet was stamped with
+     * @return ms since epoch
+     */
+    qint64 lastPacketTimeMs() const;
+    
 signals:
     /** Signal emitted when mount status is updated */
     void mountStatusUpdated();
@@ -65,9 +88,15 @@ signals:
     void orientationStatusUpdated();
     
 private:
+    /** Weight of the newest sample in the disk fill-rate average */
+    static constexpr double DISK_RATE_SMOOTHING = 0.2;
+    
     /** The telescope data */
     TelescopeData telescopeData;
     
+    /** Time stamp of the packet being processed, ms since epoch */
+    qint64 packetTimeMs = 0;
+    
     /**
      * @brief Update mount status from JSON
      * @param obj The JSON object containing mount data
@@ -1,9 +1,27 @@
 #include "TelescopeGUI.hpp"
 #include "CommandInterface.hpp"
 #include "AlpacaServer.hpp"
+#include "IndiServer.hpp"
+#include "TelemetryRelay.hpp"
+#include "ClockSync.hpp"
+#include "FitsWriter.hpp"
 #include "OriginBackend.hpp"
+#include "WebSocketLogViewer.hpp"
+#include <QApplication>
+#include <QFileInfo>
+#include <QPointer>
+#include <QSet>
+#include <QStandardPaths>
+#include <QThreadPool>
 #include <cmath>
 
+namespace {
+    // SequenceIDs of one-off commands the GUI sends itself, kept clear of the
+    // command interface and downloader counters, which count up from 1001
+    const int APPLY_EXPOSURE_SEQUENCE_ID = 900;
+    const int ALERT_ACTION_SEQUENCE_ID = 901;
+}
+
 TelescopeGUI::TelescopeGUI(QWidget *parent) : QMainWindow(parent) {
     setWindowTitle("Celestron Origin Monitor");
     resize(900, 700);
@@ -16,35 +34,118 @@ TelescopeGUI::TelescopeGUI(QWidget *parent) : QMainWindow(parent) {
     connect(dataProcessor, &TelescopeDataProcessor::focuserStatusUpdated, this, &TelescopeGUI::updateFocuserDisplay);
     connect(dataProcessor, &TelescopeDataProcessor::environmentStatusUpdated, this, &TelescopeGUI::updateEnvironmentDisplay);
     connect(dataProcessor, &TelescopeDataProcessor::newImageAvailable, this, &TelescopeGUI::updateImageDisplay);
+    
+    // Previews are fetched whether or not the Image tab is open: the exposure advisor measures every one
+    connect(dataProcessor, &TelescopeDataProcessor::newImageAvailable, this, [this]() {
+        const QString &fileLocation = dataProcessor->getData().lastImage.fileLocation;
+        if (isConnected && !fileLocation.isEmpty()) {
+            requestImage(fileLocation);
+        }
+    });
     connect(dataProcessor, &TelescopeDataProcessor::diskStatusUpdated, this, &TelescopeGUI::updateDiskDisplay);
     connect(dataProcessor, &TelescopeDataProcessor::dewHeaterStatusUpdated, this, &TelescopeGUI::updateDewHeaterDisplay);
     connect(dataProcessor, &TelescopeDataProcessor::orientationStatusUpdated, this, &TelescopeGUI::updateOrientationDisplay);
-
-    // NEW: Initialize Alpaca components
-    originBackend = new OriginBackend(this);
-    alpacaServer = new AlpacaServer(this);
-    alpacaServer->setTelescopeBackend(originBackend);
     
-    // Connect Alpaca server signals
-    connect(alpacaServer, &AlpacaServer::serverStarted, this, &TelescopeGUI::onAlpacaServerStarted);
-    connect(alpacaServer, &AlpacaServer::serverStopped, this, &TelescopeGUI::onAlpacaServerStopped);
-    connect(alpacaServer, &AlpacaServer::requestReceived, this, &TelescopeGUI::onAlpacaRequestReceived);
+    // Every status update is also appended to the on-disk telemetry history
+    telemetryStore = new TelemetryStore(QString(), this);
+    
+    // ...and checked against the alert rules, which only re-evaluate rules whose inputs changed
+    alertEngine = new AlertEngine(this);
+    alertEngine->loadRules(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/alerts.json");
+    connect(alertEngine, &AlertEngine::alertRaised, this, &TelescopeGUI::onAlertRaised);
+    connect(alertEngine, &AlertEngine::alertCleared, this, &TelescopeGUI::onAlertCleared);
+    connect(alertEngine, &AlertEngine::actionRequested, this, &TelescopeGUI::onAlertAction);
+    
+    // ...and published to shared memory for guiding and sequencing tools on this machine,
+    // unless a standalone Alpaca server already publishes there
+    telemetryShm.open();
+    
+    // Stamped with when the packet left the telescope, in our clock
+    auto recordGroup = [this](TelemetryFields::Group group) {
+        qint64 now = dataProcessor->lastPacketTimeMs();
+        telemetryStore->record(dataProcessor->getData(), group, now);
+        telemetryShm.publish(dataProcessor->getData(), now);
+        alertEngine->update(dataProcessor->getData(), group, now);
+        updateAlertsDisplay();
+    };
+    connect(dataProcessor, &TelescopeDataProcessor::mountStatusUpdated, this, [recordGroup]() { recordGroup(TelemetryFields::Mount); });
+    connect(dataProcessor, &TelescopeDataProcessor::cameraStatusUpdated, this, [recordGroup]() { recordGroup(TelemetryFields::Camera); });
+    connect(dataProcessor, &TelescopeDataProcessor::focuserStatusUpdated, this, [recordGroup]() { recordGroup(TelemetryFields::Focuser); });
+    connect(dataProcessor, &TelescopeDataProcessor::environmentStatusUpdated, this, [recordGroup]() { recordGroup(TelemetryFields::Environment); });
+    connect(dataProcessor, &TelescopeDataProcessor::newImageAvailable, this, [recordGroup]() { recordGroup(TelemetryFields::Image); });
+    connect(dataProcessor, &TelescopeDataProcessor::diskStatusUpdated, this, [recordGroup]() { recordGroup(TelemetryFields::Disk); });
+    connect(dataProcessor, &TelescopeDataProcessor::dewHeaterStatusUpdated, this, [recordGroup]() { recordGroup(TelemetryFields::DewHeater); });
+    connect(dataProcessor, &TelescopeDataProcessor::orientationStatusUpdated, this, [recordGroup]() { recordGroup(TelemetryFields::Orientation); });
+    
+    // Previews are white balanced with the camera's own gains
+    connect(dataProcessor, &TelescopeDataProcessor::cameraStatusUpdated, this, [this]() {
+        const CameraStatus &camera = dataProcessor->getData().camera;
+        colorBalance.setWhiteBalance(camera.colorRBalance, camera.colorGBalance, camera.colorBBalance);
+    });
     
-    // Connect Origin backend signals
-    connect(originBackend, &OriginBackend::connected, this, [this]() {
-        alpacaLogTextEdit->append(QString("[%1] Origin telescope connected")
-                                 .arg(QTime::currentTime().toString()));
+    // Every frame's footprint goes into the sky coverage index, identified by its exposure
+    // start like its FITS metadata, so the downloader can later say where it was archived
+    connect(dataProcessor, &TelescopeDataProcessor::newImageAvailable, this, [this]() {
+        const TelescopeData &data = dataProcessor->getData();
+        SkyCoverageIndex::Frame frame;
+        frame.timestampMs = dataProcessor->lastPacketTimeMs() - qint64(data.camera.exposure * 1000.0);
+        frame.ra = data.lastImage.ra;
+        frame.dec = data.lastImage.dec;
+        frame.orientation = data.lastImage.orientation;
+        frame.fovX = data.lastImage.fovX;
+        frame.fovY = data.lastImage.fovY;
+        frame.exposure = data.camera.exposure;
+        skyCoverage.addFrame(frame);
     });
     
-    connect(originBackend, &OriginBackend::disconnected, this, [this]() {
-        alpacaLogTextEdit->append(QString("[%1] Origin telescope disconnected")
-                                 .arg(QTime::currentTime().toString()));
+    // Frames are remembered with the telemetry of their exposure so their downloads can be
+    // written as FITS; until a downloader exists they are kept here and handed over to it
+    connect(dataProcessor, &TelescopeDataProcessor::newImageAvailable, this, [this]() {
+        const TelescopeData &data = dataProcessor->getData();
+        if (data.lastImage.fileLocation.isEmpty()) return;
+        
+        // NewImageReady follows readout, one exposure after the frame began
+        qint64 startMs = dataProcessor->lastPacketTimeMs() - qint64(data.camera.exposure * 1000.0);
+        FitsWriter::Metadata metadata = FitsWriter::metadataFrom(data, startMs);
+        if (bayerPatternComboBox) {
+            metadata.bayerPattern = bayerPatternComboBox->currentText();
+        }
+        if (autoDownloader) {
+            autoDownloader->recordFrameMetadata(metadata);
+        } else {
+            pendingFrameMetadata.append(metadata);
+            if (pendingFrameMetadata.size() > AutoDownloader::MAX_FRAME_METADATA) {
+                pendingFrameMetadata.removeFirst();
+            }
+        }
     });
     
+    // The downloader schedules around the telescope's disk even when the Disk tab is not open;
+    // a critical disk needs draining even if no download was ever started
+    connect(dataProcessor, &TelescopeDataProcessor::diskStatusUpdated, this, [this]() {
+        const DiskStatus &disk = dataProcessor->getData().disk;
+        if (!autoDownloader && isConnected && AutoDownloader::isDiskCritical(disk)) {
+            // The warning and the drain are reported on the Download tab
+            ensureTabBuilt(downloadTabIndex);
+            ensureAutoDownloader(downloadPathEdit->text());
+        } else if (autoDownloader) {
+            autoDownloader->updateTelescopeDisk(disk);
+        }
+    });
+
+    // The Origin backend and Alpaca server are created on first use, see ensureAlpacaServer()
+    
     setupUI();
     setupWebSocket();
     setupDiscovery();
     
+    // Show what was known at the last exit straight away, then keep that checkpoint current
+    restoreCheckpoint();
+    QTimer *checkpointTimer = new QTimer(this);
+    connect(checkpointTimer, &QTimer::timeout, this, &TelescopeGUI::saveCheckpoint);
+    checkpointTimer->start(60000);
+    connect(qApp, &QCoreApplication::aboutToQuit, this, &TelescopeGUI::saveCheckpoint);
+    
     // Update time display every second
     QTimer *timer = new QTimer(this);
     connect(timer, &QTimer::timeout, this, &TelescopeGUI::updateTimeDisplay);
@@ -53,24 +154,19 @@ TelescopeGUI::TelescopeGUI(QWidget *parent) : QMainWindow(parent) {
 
 void TelescopeGUI::startDiscovery() {
     statusLabel->setText("Discovering telescopes...");
-    telescopeListWidget->clear();
-    telescopeAddresses.clear();
     
-    // Close existing socket if it's open
-    if (udpSocket->state() != QAbstractSocket::UnconnectedState) {
-        udpSocket->close();
+    // Telescopes remembered from the last run stay listed while they are found again
+    if (!showingCheckpoint) {
+        telescopeListWidget->clear();
+        telescopeAddresses.clear();
     }
     
-    // Bind to port 55555 on all interfaces
-    bool success = udpSocket->bind(QHostAddress::AnyIPv4, 55555, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint);
-    
-    if (success) {
-        // Enable broadcast reception
-        udpSocket->setSocketOption(QAbstractSocket::SocketOption(5), 1); // BroadcastOption
-        
-        // Connect to the readyRead signal
-        connect(udpSocket, &QUdpSocket::readyRead, this, &TelescopeGUI::processPendingDatagrams);
-        
+    // Bind to port 55555 on all interfaces; the result arrives via onDiscoveryStateChanged
+    link->startDiscovery(55555);
+}
+
+void TelescopeGUI::onDiscoveryStateChanged(bool listening, const QString &error) {
+    if (listening) {
         statusLabel->setText("Listening for telescope broadcasts...");
         
         // Auto-stop discovery after 30 seconds if nothing found
@@ -80,73 +176,57 @@ void TelescopeGUI::startDiscovery() {
                 statusLabel->setText("No telescopes found. Discovery stopped.");
             }
         });
-    } else {
-        statusLabel->setText(QString("Failed to bind to port 55555: %1").arg(udpSocket->errorString()));
+    } else if (!error.isEmpty()) {
+        statusLabel->setText(QString("Failed to bind to port 55555: %1").arg(error));
     }
 }
 
 void TelescopeGUI::stopDiscovery() {
-    // Disconnect signals and close socket
-    if (udpSocket->state() != QAbstractSocket::UnconnectedState) {
-        disconnect(udpSocket, &QUdpSocket::readyRead, this, &TelescopeGUI::processPendingDatagrams);
-        udpSocket->close();
-    }
+    link->stopDiscovery();
     
     statusLabel->setText("Discovery stopped");
 }
 
-void TelescopeGUI::processPendingDatagrams() {
-    // Read all available datagrams
-    while (udpSocket->hasPendingDatagrams()) {
-        QByteArray datagram;
-        datagram.resize(udpSocket->pendingDatagramSize());
-        QHostAddress sender;
-        quint16 senderPort;
+void TelescopeGUI::onDatagramReceived(const QString &datagramStr, const QString &sender) {
+    qDebug() << "Received UDP broadcast from" << sender << ":" << datagramStr;
+    
+    // Check if this looks like a telescope broadcast
+    if (datagramStr.contains("Origin", Qt::CaseInsensitive) && 
+        datagramStr.contains("IP Address", Qt::CaseInsensitive)) {
         
-        // Read the datagram
-        udpSocket->readDatagram(datagram.data(), datagram.size(), &sender, &senderPort);
+        // Extract the telescope model
+        QString telescopeModel;
+        if (datagramStr.contains("Identity:")) {
+            int identityStart = datagramStr.indexOf("Identity:");
+            int identityEnd = datagramStr.indexOf(" ", identityStart + 9);
+            if (identityEnd > identityStart) {
+                telescopeModel = datagramStr.mid(identityStart + 9, identityEnd - identityStart - 9);
+            }
+        }
         
-        QString datagramStr = QString::fromUtf8(datagram);
-        qDebug() << "Received UDP broadcast from" << sender.toString() << ":" << datagramStr;
+        // Extract the IP address
+        QString telescopeIP;
+        QRegularExpression ipRegex("\\b(?:\\d{1,3}\\.){3}\\d{1,3}\\b");
+        QRegularExpressionMatch match = ipRegex.match(datagramStr);
         
-        // Check if this looks like a telescope broadcast
-        if (datagramStr.contains("Origin", Qt::CaseInsensitive) && 
-            datagramStr.contains("IP Address", Qt::CaseInsensitive)) {
+        if (match.hasMatch()) {
+            telescopeIP = match.captured(0);
             
-            // Extract the telescope model
-            QString telescopeModel;
-            if (datagramStr.contains("Identity:")) {
-                int identityStart = datagramStr.indexOf("Identity:");
-                int identityEnd = datagramStr.indexOf(" ", identityStart + 9);
-                if (identityEnd > identityStart) {
-                    telescopeModel = datagramStr.mid(identityStart + 9, identityEnd - identityStart - 9);
-                }
-            }
-            
-            // Extract the IP address
-            QString telescopeIP;
-            QRegularExpression ipRegex("\\b(?:\\d{1,3}\\.){3}\\d{1,3}\\b");
-            QRegularExpressionMatch match = ipRegex.match(datagramStr);
-            
-            if (match.hasMatch()) {
-                telescopeIP = match.captured(0);
+            // Add to our list if not already there
+            if (!telescopeAddresses.contains(telescopeIP)) {
+                telescopeAddresses.append(telescopeIP);
                 
-                // Add to our list if not already there
-                if (!telescopeAddresses.contains(telescopeIP)) {
-                    telescopeAddresses.append(telescopeIP);
-                    
-                    // Add to the UI list
-                    QString displayText;
-                    if (!telescopeModel.isEmpty()) {
-                        displayText = QString("%1 - %2").arg(telescopeIP, telescopeModel);
-                    } else {
-                        displayText = QString("%1 - Celestron Origin Telescope").arg(telescopeIP);
-                    }
-                    
-                    telescopeListWidget->addItem(displayText);
-                    
-                    statusLabel->setText(QString("Found Celestron Origin telescope at %1").arg(telescopeIP));
+                // Add to the UI list
+                QString displayText;
+                if (!telescopeModel.isEmpty()) {
+                    displayText = QString("%1 - %2").arg(telescopeIP, telescopeModel);
+                } else {
+                    displayText = QString("%1 - Celestron Origin Telescope").arg(telescopeIP);
                 }
+                
+                telescopeListWidget->addItem(displayText);
+                
+                statusLabel->setText(QString("Found Celestron Origin telescope at %1").arg(telescopeIP));
             }
         }
     }
@@ -155,7 +235,7 @@ void TelescopeGUI::processPendingDatagrams() {
 void TelescopeGUI::connectToSelectedTelescope() {
     if (isConnected) {
         // Disconnect if already connected
-        webSocket->close();
+        link->close();
         return;
     }
     
@@ -179,8 +259,7 @@ void TelescopeGUI::connectToSelectedTelescope() {
     statusLabel->setText(QString("Connecting to telescope at %1...").arg(ipAddress));
     
     // Connect to the telescope via WebSocket using the correct endpoint
-    QString url = QString("ws://%1:80/SmartScope-1.0/mountControlEndpoint").arg(ipAddress);
-    webSocket->open(QUrl(url));
+    link->open(ipAddress, 80);
     
     // Store the currently connected IP
     connectedIpAddress = ipAddress;
@@ -200,6 +279,19 @@ void TelescopeGUI::onWebSocketConnected() {
     command["Type"] = "Command";
     
     sendJsonMessage(command);
+    
+    // Downloads that were unfinished when the app last exited
+    if (!resumeDownloads.isEmpty()) {
+        // Its progress is reported on the Download tab, so that must exist first
+        ensureTabBuilt(downloadTabIndex);
+        ensureAutoDownloader(downloadPathEdit->text());
+        for (const QString &directory : resumeDownloads) {
+            autoDownloader->fetchDirectory(directory);
+        }
+        downloadLogList->addItem(QString("Resuming %1 unfinished downloads").arg(resumeDownloads.size()));
+        downloadLogList->scrollToBottom();
+        resumeDownloads.clear();
+    }
 }
 
 void TelescopeGUI::onWebSocketDisconnected() {
@@ -209,15 +301,77 @@ void TelescopeGUI::onWebSocketDisconnected() {
     connectedIpAddress = "";
 }
 
-void TelescopeGUI::onTextMessageReceived(const QString &message) {
+void TelescopeGUI::onMessageReceived(const QJsonObject &obj, const QString &message, qint64 receivedMs) {
     // Log the received message
     logJsonPacket(message, true);
     
-    // Process the received message
-    dataProcessor->processJsonPacket(message.toUtf8());
+    // Process the received message (already decoded on the I/O thread),
+    // back-dated by the network delay
+    if (!obj.isEmpty()) {
+        dataProcessor->processJsonObject(obj, clockSync->eventTimeMs(receivedMs));
+    }
+    
+    if (showingCheckpoint) {
+        showingCheckpoint = false;
+        statusLabel->setText(QString("Connected to telescope at %1, live").arg(connectedIpAddress));
+    }
+}
+
+void TelescopeGUI::restoreCheckpoint() {
+    StateCheckpoint::State state;
+    if (!StateCheckpoint::load(&state)) return;
+    
+    // Not re-emitted as updates: the telemetry history and alerts only see live data
+    dataProcessor->restore(state.data);
+    telescopeListWidget->addItems(state.telescopes);
+    telescopeAddresses = state.telescopeAddresses;
+    restoredDownloadPath = state.downloadPath;
+    restoredArchive = state.archive;
+    resumeDownloads = state.downloadQueue;
+    showingCheckpoint = true;
+    refreshDisplays();
+    
+    QString saved = QDateTime::fromMSecsSinceEpoch(state.savedMs).toString("yyyy-MM-dd HH:mm");
+    if (state.connectedAddress.isEmpty()) {
+        statusLabel->setText(QString("Showing stale state from %1").arg(saved));
+        return;
+    }
+    
+    int row = telescopeAddresses.indexOf(state.connectedAddress);
+    if (row >= 0 && row < telescopeListWidget->count()) {
+        telescopeListWidget->setCurrentRow(row);
+    }
+    statusLabel->setText(QString("Showing stale state from %1, reconnecting to %2...")
+                         .arg(saved, state.connectedAddress));
+    connectedIpAddress = state.connectedAddress;
+    link->open(state.connectedAddress, 80);
+}
+
+void TelescopeGUI::saveCheckpoint() {
+    StateCheckpoint::State state;
+    state.data = dataProcessor->getData();
+    for (int i = 0; i < telescopeListWidget->count(); i++) {
+        state.telescopes.append(telescopeListWidget->item(i)->text());
+    }
+    state.telescopeAddresses = telescopeAddresses;
+    state.connectedAddress = connectedIpAddress;
+    state.downloadPath = downloadPathEdit ? downloadPathEdit->text() : restoredDownloadPath;
+    
+    if (archiveGrid) {
+        for (int i = 0; i < archiveGrid->count(); i++) {
+            state.archive.append(archiveGrid->item(i)->data(Qt::UserRole).toString());
+        }
+    } else {
+        state.archive = restoredArchive;
+    }
+    state.downloadQueue = autoDownloader ? autoDownloader->pendingDirectories() : resumeDownloads;
+    
+    StateCheckpoint::save(state);
 }
 
 void TelescopeGUI::updateMountDisplay() {
+    if (!mountBatteryLevelLabel) return; // Tab not built yet
+    
     const TelescopeData &data = dataProcessor->getData();
     mountBatteryLevelLabel->setText(data.mount.batteryLevel);
     mountBatteryVoltageLabel->setText(QString::number(data.mount.batteryVoltage, 'f', 2) + " V");
@@ -225,6 +379,7 @@ void TelescopeGUI::updateMountDisplay() {
     mountTimeLabel->setText(data.mount.time);
     mountDateLabel->setText(data.mount.date);
     mountTimeZoneLabel->setText(data.mount.timeZone);
+    updateClockSyncDisplay();
     
     mountLatitudeLabel->setText(QString::number(data.mount.latitude * 180.0 / M_PI, 'f', 1) + "° +/- 0.05");
     mountLongitudeLabel->setText(QString::number(data.mount.longitude * 180.0 / M_PI, 'f', 1) + "° +/- 0.05");
@@ -235,7 +390,25 @@ void TelescopeGUI::updateMountDisplay() {
     mountNumAlignRefsLabel->setText(QString::number(data.mount.numAlignRefs));
 }
 
+void TelescopeGUI::updateClockSyncDisplay() {
+    if (!mountClockOffsetLabel) return; // Tab not built yet
+    
+    ClockSync::Estimate estimate = clockSync->estimate();
+    if (!estimate.valid) {
+        mountClockOffsetLabel->setText("Measuring...");
+        return;
+    }
+    
+    mountClockOffsetLabel->setText(QString("%1 ms +/- %2 ms, drift %3 ppm, round trip %4 ms")
+                                   .arg(estimate.offsetMs, 0, 'f', 1)
+                                   .arg(estimate.uncertaintyMs, 0, 'f', 1)
+                                   .arg(estimate.driftPpm, 0, 'f', 1)
+                                   .arg(estimate.minRoundTripMs));
+}
+
 void TelescopeGUI::updateCameraDisplay() {
+    if (!cameraBinningLabel) return; // Tab not built yet
+    
     const TelescopeData &data = dataProcessor->getData();
     cameraBinningLabel->setText(QString::number(data.camera.binning));
     cameraBitDepthLabel->setText(QString::number(data.camera.bitDepth));
@@ -248,7 +421,56 @@ void TelescopeGUI::updateCameraDisplay() {
     cameraBlueBalanceLabel->setText(QString::number(data.camera.colorBBalance, 'f', 1));
 }
 
+void TelescopeGUI::updateExposureAdvice() {
+    if (!advisorSubLabel) return; // Tab not built yet
+    
+    ExposureAdvisor::Advice advice = exposureAdvisor.advice();
+    applyExposureButton->setEnabled(advice.valid && isConnected);
+    if (!advice.valid) return;
+    
+    advisorSkyLabel->setText(QString("%1 ADU above offset, noise %2 ADU (%3 frames)")
+                             .arg(advice.skyAdu, 0, 'f', 0)
+                             .arg(advice.skyNoiseAdu, 0, 'f', 1)
+                             .arg(advice.frames));
+    advisorFluxLabel->setText(QString("%1 e-/s/px at %2 e-/ADU")
+                              .arg(advice.skyFlux, 0, 'f', 2)
+                              .arg(advice.electronsPerAdu, 0, 'f', 2));
+    
+    QString sub = QString("%1 s").arg(advice.subExposure, 0, 'f', 1);
+    if (durationSpinBox && advice.subExposure > 0.0) {
+        sub += QString(" (%1 subs in the imaging duration)").arg(int(durationSpinBox->value() / advice.subExposure));
+    }
+    advisorSubLabel->setText(sub);
+    advisorPenaltyLabel->setText(QString("%1 s, read noise adds %2% to the noise")
+                                 .arg(advice.currentExposure, 0, 'f', 1)
+                                 .arg(advice.readNoisePenalty * 100.0, 0, 'f', 1));
+}
+
+void TelescopeGUI::applyRecommendedExposure() {
+    ExposureAdvisor::Advice advice = exposureAdvisor.advice();
+    if (!advice.valid || !isConnected) return;
+    
+    // The other capture parameters are sent back unchanged
+    const CameraStatus &camera = dataProcessor->getData().camera;
+    QJsonObject command;
+    command["Command"] = "SetCaptureParameters";
+    command["Destination"] = "Camera";
+    command["Exposure"] = std::round(advice.subExposure * 10.0) / 10.0;
+    command["ISO"] = camera.iso;
+    command["Binning"] = camera.binning;
+    command["Offset"] = camera.offset;
+    command["SequenceID"] = APPLY_EXPOSURE_SEQUENCE_ID;
+    command["Source"] = "QtApp";
+    command["Type"] = "Command";
+    sendJsonMessage(command);
+    
+    // Previews at the old exposure no longer describe the new settings' sky level
+    exposureAdvisor.clear();
+}
+
 void TelescopeGUI::updateFocuserDisplay() {
+    if (!focuserPositionLabel) return; // Tab not built yet
+    
     const TelescopeData &data = dataProcessor->getData();
     focuserPositionLabel->setText(QString::number(data.focuser.position));
     focuserBacklashLabel->setText(QString::number(data.focuser.backlash));
@@ -261,6 +483,8 @@ void TelescopeGUI::updateFocuserDisplay() {
 }
 
 void TelescopeGUI::updateEnvironmentDisplay() {
+    if (!envAmbientTempLabel) return; // Tab not built yet
+    
     const TelescopeData &data = dataProcessor->getData();
     envAmbientTempLabel->setText(QString::number(data.environment.ambientTemperature, 'f', 1) + " °C");
     envCameraTempLabel->setText(QString::number(data.environment.cameraTemperature, 'f', 1) + " °C");
@@ -270,9 +494,25 @@ void TelescopeGUI::updateEnvironmentDisplay() {
     envDewPointLabel->setText(QString::number(data.environment.dewPoint, 'f', 1) + " °C");
     envCpuFanLabel->setText(data.environment.cpuFanOn ? "On" : "Off");
     envOtaFanLabel->setText(data.environment.otaFanOn ? "On" : "Off");
+    
+    // A handful of hour/minute/10 s buckets rather than an hour of raw samples
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (auto it = envHourLabels.constBegin(); it != envHourLabels.constEnd(); ++it) {
+        TelemetryFields::Field field = TelemetryFields::Field(it.key());
+        TelemetryRollups::Bucket hour = telemetryStore->rollups().aggregate(field, now - 3600 * 1000, now + 1);
+        if (hour.count == 0) continue;
+        
+        int precision = field == TelemetryFields::EnvironmentHumidity ? 0 : 1;
+        it.value()->setText(QString("%1 / %2 / %3 %4").arg(hour.min, 0, 'f', precision)
+                                                       .arg(hour.mean(), 0, 'f', precision)
+                                                       .arg(hour.max, 0, 'f', precision)
+                                                       .arg(QString::fromUtf8(TelemetryFields::descriptor(field).unit)));
+    }
 }
 
 void TelescopeGUI::updateImageDisplay() {
+    if (!imageFileLabel) return; // Tab not built yet
+    
     const TelescopeData &data = dataProcessor->getData();
     imageFileLabel->setText(data.lastImage.fileLocation);
     imageTypeLabel->setText(data.lastImage.imageType);
@@ -281,14 +521,11 @@ void TelescopeGUI::updateImageDisplay() {
     imageOrientationLabel->setText(QString::number(data.lastImage.orientation * 180.0 / M_PI, 'f', 2) + "°");
     imageFovXLabel->setText(QString::number(data.lastImage.fovX * 180.0 / M_PI, 'f', 4) + "°");
     imageFovYLabel->setText(QString::number(data.lastImage.fovY * 180.0 / M_PI, 'f', 4) + "°");
-    
-    // Request image from the telescope if connected
-    if (isConnected && !data.lastImage.fileLocation.isEmpty()) {
-        requestImage(data.lastImage.fileLocation);
-    }
 }
 
 void TelescopeGUI::updateDiskDisplay() {
+    if (!diskCapacityLabel) return; // Tab not built yet
+    
     const TelescopeData &data = dataProcessor->getData();
     
     // Calculate values in GB
@@ -304,9 +541,21 @@ void TelescopeGUI::updateDiskDisplay() {
     // Update progress bar
     int usagePercent = (int)((usedGB / totalGB) * 100.0);
     diskUsageBar->setValue(usagePercent);
+    
+    // Fill rate and time to full from successive reports
+    diskFillRateLabel->setText(QString::number(data.disk.fillRate * 3600.0 / (1024.0 * 1024.0 * 1024.0), 'f', 2) + " GB/h");
+    if (data.disk.secondsToFull < 0) {
+        diskTimeToFullLabel->setText("Not filling");
+    } else {
+        diskTimeToFullLabel->setText(QString("%1 h %2 min").arg(data.disk.secondsToFull / 3600)
+                                                          .arg((data.disk.secondsToFull % 3600) / 60));
+    }
+    diskTimeToFullLabel->setStyleSheet(AutoDownloader::isDiskCritical(data.disk) ? "color: red; font-weight: bold;" : "");
 }
 
 void TelescopeGUI::updateDewHeaterDisplay() {
+    if (!dewHeaterModeLabel) return; // Tab not built yet
+    
     const TelescopeData &data = dataProcessor->getData();
     dewHeaterModeLabel->setText(data.dewHeater.mode);
     dewHeaterAggressionLabel->setText(QString::number(data.dewHeater.aggression));
@@ -319,6 +568,8 @@ void TelescopeGUI::updateDewHeaterDisplay() {
 }
 
 void TelescopeGUI::updateOrientationDisplay() {
+    if (!orientationAltitudeLabel) return; // Tab not built yet
+    
     const TelescopeData &data = dataProcessor->getData();
     orientationAltitudeLabel->setText(QString::number(data.orientation.altitude) + "°");
 }
@@ -326,8 +577,8 @@ void TelescopeGUI::updateOrientationDisplay() {
 void TelescopeGUI::updateTimeDisplay() {
     QDateTime now = QDateTime::currentDateTime();
     
-    // Update connection status time
-    if (isConnected) {
+    // Update connection status time; checkpointed data shows its age the same way
+    if (isConnected || showingCheckpoint) {
         const TelescopeData &data = dataProcessor->getData();
         
         // Calculate time since last update for each component
@@ -374,26 +625,80 @@ void TelescopeGUI::setupUI() {
     
     mainLayout->addWidget(discoveryBox);
     
-    // Tab widget for different categories
-    QTabWidget *tabWidget = new QTabWidget(centralWidget);
-    
-    // Create tabs
-    tabWidget->addTab(createMountTab(), "Mount");
-    tabWidget->addTab(createCameraTab(), "Camera");
-    tabWidget->addTab(createFocuserTab(), "Focuser");
-    tabWidget->addTab(createEnvironmentTab(), "Environment");
-    tabWidget->addTab(createImageTab(), "Image");
-    tabWidget->addTab(createDiskTab(), "Disk");
-    tabWidget->addTab(createDewHeaterTab(), "Dew Heater");
-    tabWidget->addTab(createOrientationTab(), "Orientation");
-    tabWidget->addTab(createCommandTab(), "Commands");
-    tabWidget->addTab(createSlewAndImageTab(), "Slew && Image");   
-    tabWidget->addTab(createDownloadTab(), "Auto Download");
-    tabWidget->addTab(createAlpacaTab(), "Alpaca Server");  // NEW TAB
+    // Tab widget for different categories. Tabs are only placeholders until
+    // first shown; the data processor keeps the model live behind them.
+    tabWidget = new QTabWidget(centralWidget);
+    
+    addLazyTab(&TelescopeGUI::createMountTab, "Mount");
+    addLazyTab(&TelescopeGUI::createCameraTab, "Camera");
+    addLazyTab(&TelescopeGUI::createFocuserTab, "Focuser");
+    addLazyTab(&TelescopeGUI::createEnvironmentTab, "Environment");
+    imageTabIndex = addLazyTab(&TelescopeGUI::createImageTab, "Image");
+    addLazyTab(&TelescopeGUI::createDiskTab, "Disk");
+    addLazyTab(&TelescopeGUI::createDewHeaterTab, "Dew Heater");
+    addLazyTab(&TelescopeGUI::createOrientationTab, "Orientation");
+    addLazyTab(&TelescopeGUI::createCommandTab, "Commands");
+    addLazyTab(&TelescopeGUI::createSlewAndImageTab, "Slew && Image");
+    downloadTabIndex = addLazyTab(&TelescopeGUI::createDownloadTab, "Auto Download");
+    addLazyTab(&TelescopeGUI::createAlertsTab, "Alerts");
+    addLazyTab(&TelescopeGUI::createLogViewerTab, "WebSocket Log");
+    addLazyTab(&TelescopeGUI::createAlpacaTab, "Alpaca Server");
+    
+    connect(tabWidget, &QTabWidget::currentChanged, this, &TelescopeGUI::onCurrentTabChanged);
+    ensureTabBuilt(tabWidget->currentIndex());
     
     mainLayout->addWidget(tabWidget);
 }
 
+int TelescopeGUI::addLazyTab(TabFactory factory, const QString &title) {
+    QWidget *page = new QWidget();
+    QVBoxLayout *layout = new QVBoxLayout(page);
+    layout->setContentsMargins(0, 0, 0, 0);
+    
+    tabFactories.append(factory);
+    return tabWidget->addTab(page, title);
+}
+
+void TelescopeGUI::ensureTabBuilt(int index) {
+    if (index < 0 || index >= tabFactories.size() || !tabFactories[index]) {
+        return;
+    }
+    
+    TabFactory factory = tabFactories[index];
+    tabFactories[index] = nullptr;
+    
+    QWidget *page = tabWidget->widget(index);
+    page->layout()->addWidget((this->*factory)());
+    
+    // Populate the new widgets from data received while the tab was hidden
+    refreshDisplays();
+    
+    // The preview is re-rendered from memory, never fetched again
+    if (index == imageTabIndex && !lastBalancedPreview.isNull()) {
+        imagePreviewLabel->setPixmap(QPixmap::fromImage(
+            lastBalancedPreview.scaled(imagePreviewLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation)));
+    }
+}
+
+void TelescopeGUI::onCurrentTabChanged(int index) {
+    ensureTabBuilt(index);
+}
+
+void TelescopeGUI::refreshDisplays() {
+    // Each update method returns early for tabs that have not been built
+    updateMountDisplay();
+    updateCameraDisplay();
+    updateFocuserDisplay();
+    updateEnvironmentDisplay();
+    updateImageDisplay();
+    updateDiskDisplay();
+    updateDewHeaterDisplay();
+    updateOrientationDisplay();
+    updateTimeDisplay();
+    updateAlertsDisplay();
+    if (mountStatusLabel) checkMountStatus();
+}
+
 QWidget* TelescopeGUI::createMountTab() {
     QWidget *tab = new QWidget();
     QGridLayout *layout = new QGridLayout(tab);
@@ -425,6 +730,11 @@ QWidget* TelescopeGUI::createMountTab() {
     mountTimeZoneLabel = new QLabel("-", tab);
     layout->addWidget(mountTimeZoneLabel, row++, 1);
     
+    layout->addWidget(new QLabel("Clock Offset:"), row, 0);
+    mountClockOffsetLabel = new QLabel("-", tab);
+    mountClockOffsetLabel->setToolTip("Telescope clock minus this computer's, estimated from timed status requests");
+    layout->addWidget(mountClockOffsetLabel, row++, 1);
+    
     layout->addWidget(new QLabel("Latitude:"), row, 0);
     mountLatitudeLabel = new QLabel("-", tab);
     layout->addWidget(mountLatitudeLabel, row++, 1);
@@ -497,6 +807,61 @@ QWidget* TelescopeGUI::createCameraTab() {
     
     layout->addWidget(colorBalanceGroup, row++, 0, 1, 2);
     
+    // Sub length that makes the sky, not the read noise, dominate
+    QGroupBox *advisorGroup = new QGroupBox("Exposure Advisor", tab);
+    QGridLayout *advisorLayout = new QGridLayout(advisorGroup);
+    
+    advisorLayout->addWidget(new QLabel("Sky Background:"), 0, 0);
+    advisorSkyLabel = new QLabel("Waiting for previews", advisorGroup);
+    advisorLayout->addWidget(advisorSkyLabel, 0, 1);
+    
+    advisorLayout->addWidget(new QLabel("Sky Flux:"), 1, 0);
+    advisorFluxLabel = new QLabel("-", advisorGroup);
+    advisorLayout->addWidget(advisorFluxLabel, 1, 1);
+    
+    advisorLayout->addWidget(new QLabel("Recommended Sub:"), 2, 0);
+    advisorSubLabel = new QLabel("-", advisorGroup);
+    advisorSubLabel->setStyleSheet("font-weight: bold;");
+    advisorLayout->addWidget(advisorSubLabel, 2, 1);
+    
+    advisorLayout->addWidget(new QLabel("Current Exposure:"), 3, 0);
+    advisorPenaltyLabel = new QLabel("-", advisorGroup);
+    advisorLayout->addWidget(advisorPenaltyLabel, 3, 1);
+    
+    advisorLayout->addWidget(new QLabel("Sky Noise / Read Noise:"), 4, 0);
+    swampFactorSpinBox = new QDoubleSpinBox(advisorGroup);
+    swampFactorSpinBox->setRange(1.0, 10.0);
+    swampFactorSpinBox->setSingleStep(0.5);
+    swampFactorSpinBox->setValue(exposureAdvisor.swampFactor());
+    swampFactorSpinBox->setToolTip("3 keeps read noise under 5% of the total; higher only lengthens subs");
+    advisorLayout->addWidget(swampFactorSpinBox, 4, 1);
+    
+    advisorLayout->addWidget(new QLabel("Read Noise:"), 5, 0);
+    readNoiseSpinBox = new QDoubleSpinBox(advisorGroup);
+    readNoiseSpinBox->setRange(0.5, 20.0);
+    readNoiseSpinBox->setSingleStep(0.1);
+    readNoiseSpinBox->setSuffix(" e-");
+    readNoiseSpinBox->setValue(exposureAdvisor.sensor().readNoise);
+    advisorLayout->addWidget(readNoiseSpinBox, 5, 1);
+    
+    applyExposureButton = new QPushButton("Use Recommended Exposure", advisorGroup);
+    applyExposureButton->setEnabled(false);
+    advisorLayout->addWidget(applyExposureButton, 6, 0, 1, 2);
+    
+    connect(swampFactorSpinBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, [this](double factor) {
+        exposureAdvisor.setSwampFactor(factor);
+        updateExposureAdvice();
+    });
+    connect(readNoiseSpinBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, [this](double noise) {
+        ExposureAdvisor::Sensor sensor = exposureAdvisor.sensor();
+        sensor.readNoise = noise;
+        exposureAdvisor.setSensor(sensor);
+        updateExposureAdvice();
+    });
+    connect(applyExposureButton, &QPushButton::clicked, this, &TelescopeGUI::applyRecommendedExposure);
+    
+    layout->addWidget(advisorGroup, row++, 0, 1, 2);
+    
     layout->addWidget(new QLabel("Last Update:"), row, 0);
     cameraLastUpdateLabel = new QLabel("-", tab);
     layout->addWidget(cameraLastUpdateLabel, row++, 1);
@@ -551,28 +916,44 @@ QWidget* TelescopeGUI::createEnvironmentTab() {
     
     int row = 0;
     
+    // Column for the last hour's range, answered from telemetry rollups
+    QLabel *hourHeader = new QLabel("Last hour (min / mean / max)", tab);
+    hourHeader->setStyleSheet("font-weight: bold;");
+    layout->addWidget(hourHeader, row++, 2);
+    auto addHourLabel = [this, tab, layout](int row, TelemetryFields::Field field) {
+        QLabel *label = new QLabel("-", tab);
+        layout->addWidget(label, row, 2);
+        envHourLabels.insert(field, label);
+    };
+    
     layout->addWidget(new QLabel("Ambient Temperature:"), row, 0);
     envAmbientTempLabel = new QLabel("-", tab);
+    addHourLabel(row, TelemetryFields::EnvironmentAmbientTemperature);
     layout->addWidget(envAmbientTempLabel, row++, 1);
     
     layout->addWidget(new QLabel("Camera Temperature:"), row, 0);
     envCameraTempLabel = new QLabel("-", tab);
+    addHourLabel(row, TelemetryFields::EnvironmentCameraTemperature);
     layout->addWidget(envCameraTempLabel, row++, 1);
     
     layout->addWidget(new QLabel("CPU Temperature:"), row, 0);
     envCpuTempLabel = new QLabel("-", tab);
+    addHourLabel(row, TelemetryFields::EnvironmentCpuTemperature);
     layout->addWidget(envCpuTempLabel, row++, 1);
     
     layout->addWidget(new QLabel("Front Cell Temperature:"), row, 0);
     envFrontCellTempLabel = new QLabel("-", tab);
+    addHourLabel(row, TelemetryFields::EnvironmentFrontCellTemperature);
     layout->addWidget(envFrontCellTempLabel, row++, 1);
     
     layout->addWidget(new QLabel("Humidity:"), row, 0);
     envHumidityLabel = new QLabel("-", tab);
+    addHourLabel(row, TelemetryFields::EnvironmentHumidity);
     layout->addWidget(envHumidityLabel, row++, 1);
     
     layout->addWidget(new QLabel("Dew Point:"), row, 0);
     envDewPointLabel = new QLabel("-", tab);
+    addHourLabel(row, TelemetryFields::EnvironmentDewPoint);
     layout->addWidget(envDewPointLabel, row++, 1);
     
     layout->addWidget(new QLabel("CPU Fan:"), row, 0);
@@ -637,6 +1018,61 @@ QWidget* TelescopeGUI::createImageTab() {
     imageLastUpdateLabel = new QLabel("-", infoPanel);
     infoLayout->addWidget(imageLastUpdateLabel, row++, 1);
     
+    // Raw colour subframes are Bayer mosaics; demosaic them for viewing
+    infoLayout->addWidget(new QLabel("Bayer Pattern:"), row, 0);
+    bayerPatternComboBox = new QComboBox(infoPanel);
+    for (Debayer::Pattern pattern : {Debayer::RGGB, Debayer::BGGR, Debayer::GRBG, Debayer::GBRG}) {
+        bayerPatternComboBox->addItem(Debayer::patternName(pattern), pattern);
+    }
+    infoLayout->addWidget(bayerPatternComboBox, row++, 1);
+    
+    infoLayout->addWidget(new QLabel("Demosaic:"), row, 0);
+    debayerMethodComboBox = new QComboBox(infoPanel);
+    debayerMethodComboBox->addItem("Bilinear (fast)", Debayer::Bilinear);
+    debayerMethodComboBox->addItem("Edge-aware", Debayer::EdgeAware);
+    infoLayout->addWidget(debayerMethodComboBox, row++, 1);
+    
+    // Colour stage applied to every preview
+    removeGradientCheckBox = new QCheckBox("Remove sky gradient", infoPanel);
+    removeGradientCheckBox->setChecked(true);
+    infoLayout->addWidget(removeGradientCheckBox, row++, 0, 1, 2);
+    
+    whiteBalanceCheckBox = new QCheckBox("Camera white balance", infoPanel);
+    whiteBalanceCheckBox->setChecked(true);
+    connect(whiteBalanceCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        colorBalance.setWhiteBalanceEnabled(checked);
+    });
+    infoLayout->addWidget(whiteBalanceCheckBox, row++, 0, 1, 2);
+    
+    neutralizeBackgroundCheckBox = new QCheckBox("Neutralise sky background", infoPanel);
+    neutralizeBackgroundCheckBox->setChecked(true);
+    connect(neutralizeBackgroundCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        colorBalance.setNeutralizeBackground(checked);
+    });
+    infoLayout->addWidget(neutralizeBackgroundCheckBox, row++, 0, 1, 2);
+    
+    QPushButton *openRawButton = new QPushButton("Open Raw Frame...", infoPanel);
+    connect(openRawButton, &QPushButton::clicked, this, &TelescopeGUI::openRawFrame);
+    infoLayout->addWidget(openRawButton, row++, 0, 1, 2);
+    
+    // Check the reported pointing against the stars themselves
+    QGroupBox *solveGroup = new QGroupBox("Plate Solve", infoPanel);
+    QGridLayout *solveLayout = new QGridLayout(solveGroup);
+    solvePreviewButton = new QPushButton("Solve Preview", solveGroup);
+    connect(solvePreviewButton, &QPushButton::clicked, this, &TelescopeGUI::solvePreview);
+    solveLayout->addWidget(solvePreviewButton, 0, 0);
+    solveFileButton = new QPushButton("Solve File...", solveGroup);
+    connect(solveFileButton, &QPushButton::clicked, this, &TelescopeGUI::solveFile);
+    solveLayout->addWidget(solveFileButton, 0, 1);
+    QPushButton *starIndexButton = new QPushButton("Star Index...", solveGroup);
+    connect(starIndexButton, &QPushButton::clicked, this, &TelescopeGUI::chooseStarIndex);
+    solveLayout->addWidget(starIndexButton, 0, 2);
+    plateSolveLabel = new QLabel(QFileInfo::exists(starIndexPath) ? "-" : "No star index: build one with StarIndexTool",
+                                 solveGroup);
+    plateSolveLabel->setWordWrap(true);
+    solveLayout->addWidget(plateSolveLabel, 1, 0, 1, 3);
+    infoLayout->addWidget(solveGroup, row++, 0, 1, 2);
+    
     // Add vertical space at the bottom
     infoLayout->setRowStretch(row, 1);
     
@@ -687,6 +1123,14 @@ QWidget* TelescopeGUI::createDiskTab() {
     diskUsageBar->setValue(0);
     layout->addWidget(diskUsageBar, row++, 1);
     
+    layout->addWidget(new QLabel("Fill Rate:"), row, 0);
+    diskFillRateLabel = new QLabel("-", tab);
+    layout->addWidget(diskFillRateLabel, row++, 1);
+    
+    layout->addWidget(new QLabel("Time to Full:"), row, 0);
+    diskTimeToFullLabel = new QLabel("-", tab);
+    layout->addWidget(diskTimeToFullLabel, row++, 1);
+    
     layout->addWidget(new QLabel("Last Update:"), row, 0);
     diskLastUpdateLabel = new QLabel("-", tab);
     layout->addWidget(diskLastUpdateLabel, row++, 1);
@@ -749,22 +1193,143 @@ QWidget* TelescopeGUI::createOrientationTab() {
     return tab;
 }
 
+QWidget* TelescopeGUI::createAlertsTab() {
+    QWidget *tab = new QWidget();
+    QVBoxLayout *layout = new QVBoxLayout(tab);
+    
+    QGroupBox *rulesGroup = new QGroupBox("Rules", tab);
+    QVBoxLayout *rulesLayout = new QVBoxLayout(rulesGroup);
+    rulesLayout->addWidget(new QLabel(QString("Edit %1 and restart to change the rules")
+                                      .arg(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/alerts.json"), rulesGroup));
+    alertRulesList = new QListWidget(rulesGroup);
+    rulesLayout->addWidget(alertRulesList);
+    layout->addWidget(rulesGroup);
+    
+    QGroupBox *logGroup = new QGroupBox("Alert Log", tab);
+    QVBoxLayout *logLayout = new QVBoxLayout(logGroup);
+    alertLogList = new QListWidget(logGroup);
+    alertLogList->addItems(alertLog);
+    alertLogList->scrollToBottom();
+    logLayout->addWidget(alertLogList);
+    layout->addWidget(logGroup);
+    
+    return tab;
+}
+
+QWidget* TelescopeGUI::createLogViewerTab() {
+    return new WebSocketLogViewer();
+}
+
+void TelescopeGUI::updateAlertsDisplay() {
+    if (!alertRulesList) return;
+    
+    const QVector<AlertEngine::Rule> &rules = alertEngine->rules();
+    if (alertRulesList->count() != rules.size()) {
+        alertRulesList->clear();
+        for (int i = 0; i < rules.size(); i++) alertRulesList->addItem(QString());
+    }
+    
+    for (int i = 0; i < rules.size(); i++) {
+        const AlertEngine::Rule &rule = rules[i];
+        QString value = rule.rate ? QString("%1 /min").arg(rule.lastRate, 0, 'f', 2)
+                                  : QString::number(rule.lastInput, 'g', 4);
+        QListWidgetItem *item = alertRulesList->item(i);
+        item->setText(QString("%1 %2: %3 %4 %5 (now %6)")
+                      .arg(rule.active ? "FIRING" : "ok", rule.name, rule.input,
+                           rule.below ? "<" : ">", QString::number(rule.threshold))
+                      .arg(value));
+        item->setForeground(rule.active ? QBrush(Qt::red) : QBrush());
+    }
+}
+
+void TelescopeGUI::logAlert(const QString &message) {
+    QString line = QDateTime::currentDateTime().toString("HH:mm:ss ") + message;
+    alertLog.append(line);
+    if (alertLog.size() > 500) alertLog.removeFirst();
+    
+    if (alertLogList) {
+        alertLogList->addItem(line);
+        if (alertLogList->count() > 500) delete alertLogList->takeItem(0);
+        alertLogList->scrollToBottom();
+    }
+}
+
+void TelescopeGUI::onAlertRaised(const AlertEngine::Rule &rule, double value) {
+    bool notify = false;
+    for (const QJsonValue &action : rule.actions) {
+        if (action.toObject()["type"].toString() == "notify") notify = true;
+    }
+    
+    QString message = QString("[%1] %2 (%3)").arg(rule.severity, rule.name).arg(value, 0, 'g', 4);
+    logAlert(message);
+    if (notify) {
+        statusLabel->setText(message);
+        QApplication::alert(this);
+    }
+}
+
+void TelescopeGUI::onAlertCleared(const AlertEngine::Rule &rule, double value) {
+    logAlert(QString("Cleared: %1 (%2)").arg(rule.name).arg(value, 0, 'g', 4));
+}
+
+void TelescopeGUI::onAlertAction(const AlertEngine::Rule &rule, const QJsonObject &action) {
+    QString type = action["type"].toString();
+    if (type == "notify") {
+        return;  // handled in onAlertRaised
+    }
+    
+    if (type == "dewHeaterAggression") {
+        if (!isConnected) return;
+        
+        int current = dataProcessor->getData().dewHeater.aggression;
+        int target = qMin(current + action["step"].toInt(1), action["max"].toInt(10));
+        if (target <= current) return;
+        
+        // Same field names the DewHeater reports in its status
+        QJsonObject command;
+        command["Command"] = "SetMode";
+        command["Destination"] = "DewHeater";
+        command["Mode"] = "Auto";
+        command["Aggression"] = target;
+        command["SequenceID"] = ALERT_ACTION_SEQUENCE_ID;
+        command["Source"] = "QtApp";
+        command["Type"] = "Command";
+        sendJsonMessage(command);
+        
+        logAlert(QString("%1: dew heater aggression %2 -> %3").arg(rule.name).arg(current).arg(target));
+        return;
+    }
+    
+    qWarning() << "Unknown alert action" << type << "in rule" << rule.id;
+}
+
 QWidget* TelescopeGUI::createCommandTab() {
-    CommandInterface *commandInterface = new CommandInterface(this, this);
+    commandInterface = new CommandInterface(this, this);
+    // Responses for the history and the script runner
+    connect(link, &TelescopeLink::messageReceived, commandInterface, &CommandInterface::handleMessage);
     return commandInterface;
 }
 
 void TelescopeGUI::setupWebSocket() {
-    webSocket = new QWebSocket("", QWebSocketProtocol::VersionLatest, this);
-    
-    connect(webSocket, &QWebSocket::connected, this, &TelescopeGUI::onWebSocketConnected);
-    connect(webSocket, &QWebSocket::disconnected, this, &TelescopeGUI::onWebSocketDisconnected);
-    connect(webSocket, &QWebSocket::textMessageReceived, this, &TelescopeGUI::onTextMessageReceived);
+    // The WebSocket, discovery socket and image fetches run on the I/O thread
+    link = new TelescopeLink(this);
+    
+    // Created first so it has the estimate current before anyone stamps a message
+    clockSync = new ClockSync(link, "QtApp", this);
+    connect(clockSync, &ClockSync::estimateUpdated, this, &TelescopeGUI::updateClockSyncDisplay);
+    
+    connect(link, &TelescopeLink::connected, this, &TelescopeGUI::onWebSocketConnected);
+    connect(link, &TelescopeLink::disconnected, this, &TelescopeGUI::onWebSocketDisconnected);
+    connect(link, &TelescopeLink::messageReceived, this, &TelescopeGUI::onMessageReceived);
+    connect(link, &TelescopeLink::imageFetched, this, &TelescopeGUI::onImageFetched);
+    connect(link, &TelescopeLink::imageFetchFailed, this, [](const QString &url, const QString &error) {
+        qDebug() << "Error fetching image:" << url << error;
+    });
 }
 
 void TelescopeGUI::setupDiscovery() {
-    // UDP socket for discovery
-    udpSocket = new QUdpSocket(this);
+    connect(link, &TelescopeLink::datagramReceived, this, &TelescopeGUI::onDatagramReceived);
+    connect(link, &TelescopeLink::discoveryStateChanged, this, &TelescopeGUI::onDiscoveryStateChanged);
     
     // Start discovery automatically
     QTimer::singleShot(500, this, &TelescopeGUI::startDiscovery);
@@ -777,9 +1342,9 @@ void TelescopeGUI::sendJsonMessage(const QJsonObject &obj) {
     // Log the outgoing message
     logJsonPacket(message, false);
     
-    // Send via WebSocket
-    if (webSocket->isValid() && webSocket->state() == QAbstractSocket::ConnectedState) {
-        webSocket->sendTextMessage(message);
+    // Send via WebSocket on the I/O thread
+    if (link->isConnected()) {
+        link->sendText(message);
     }
 }
 
@@ -799,62 +1364,236 @@ void TelescopeGUI::logJsonPacket(const QString &message, bool incoming) {
 void TelescopeGUI::requestImage(const QString &filePath) {
     if (connectedIpAddress.isEmpty()) return;
     
-    // Construct the proper URL path
-    // The telescope is sending just the relative path like "Images/Temp/4.jpg"
-    // We need to prepend the proper API path
-    QString fullPath = QString("http://%1/SmartScope-1.0/dev2/%2").arg(connectedIpAddress, filePath);
-    QUrl url(fullPath);
-    QNetworkRequest request(url);
+    // The telescope is sending just the relative path like "Images/Temp/4.jpg";
+    // the link prepends the API path, fetches and decodes off the GUI thread
+    QUrl url = link->fileUrl(filePath);
+    qDebug() << "Requesting image from:" << url.toString();
+    previewUrl = url.toString();
+    
+    link->fetchImage(url);
+}
+
+void TelescopeGUI::onImageFetched(const QString &url, const QImage &image) {
+    // The downloader shares the link and fetches previews of its own
+    if (url != previewUrl) return;
+    
+    // Measuring and rendering a full-size frame takes long enough to stall
+    // the GUI, so it runs on the thread pool with a snapshot of the settings
+    ProcessedPreview preview;
+    preview.raw = image;
+    preview.camera = dataProcessor->getData().camera;
+    const bool removeGradient = !removeGradientCheckBox || removeGradientCheckBox->isChecked();
+    const ColorBalance balance = colorBalance;
+    preview.scaledFor = imagePreviewLabel ? imagePreviewLabel->size() : QSize();
+    const int generation = ++previewGeneration;
+    
+    QPointer<TelescopeGUI> self(this);
+    QThreadPool::globalInstance()->start([self, generation, preview, removeGradient, balance]() mutable {
+        // The raw preview, gradient included: light pollution is sky the sub has to swamp
+        preview.measured = ExposureAdvisor::measure(preview.raw, &preview.skyLevel, &preview.skySigma);
+        
+        // Gradient removal first so background neutralisation sees a flat sky
+        QImage flattened = removeGradient ? BackgroundModel::subtract(preview.raw) : preview.raw;
+        preview.balanced = balance.apply(flattened);
+        if (preview.scaledFor.isValid()) {
+            preview.scaled = preview.balanced.scaled(preview.scaledFor, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        }
+        preview.focus = focusScore(flattened);
+        
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, generation, preview]() {
+            if (self) {
+                self->onPreviewProcessed(generation, preview);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void TelescopeGUI::onPreviewProcessed(int generation, const ProcessedPreview &preview) {
+    if (preview.measured && exposureAdvisor.addMeasurement(preview.skyLevel, preview.skySigma, preview.camera)) {
+        updateExposureAdvice();
+    }
+    
+    // A newer preview overtook this one
+    if (generation != previewGeneration) return;
     
-    // Set appropriate headers for the request
-    request.setRawHeader("Cache-Control", "no-cache");
-    request.setRawHeader("Accept", "*/*");
-    request.setRawHeader("User-Agent", "CelestronOriginMonitor Qt Application");
-    request.setRawHeader("Connection", "keep-alive");
+    lastPreview = preview.raw;
+    lastBalancedPreview = preview.balanced;
+    if (preview.focus >= 0.0) {
+        qDebug() << "Focus quality score (contrast):" << preview.focus;
+    }
     
-    qDebug() << "Requesting image from:" << fullPath;
+    // Remote viewers of the Alpaca server's live view see the same preview
+    if (alpacaServer) {
+        alpacaServer->publishLiveFrame(preview.balanced);
+    }
     
-    QNetworkAccessManager *manager = new QNetworkAccessManager(this);
-    QNetworkReply *reply = manager->get(request);
+    if (!imagePreviewLabel) return; // Tab not built yet
     
-    connect(reply, &QNetworkReply::finished, this, [this, reply, manager, filePath]() {
-        if (reply->error() == QNetworkReply::NoError) {
-            // Read the image data
-            QByteArray imageData = reply->readAll();
-            
-            qDebug() << "Received image data, size:" << imageData.size() << "bytes";
-            
-            // Create a QPixmap from the data
-            QPixmap pixmap;
-            if (pixmap.loadFromData(imageData)) {
-                // Scale to fit the label while preserving aspect ratio
-                pixmap = pixmap.scaled(imagePreviewLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
-                
-                // Display the image
-                imagePreviewLabel->setPixmap(pixmap);
-                
-                // Analyze image for focus quality (optional)
-                analyzeImageForFocus(imageData);
-            } else {
-                qDebug() << "Failed to load image from data";
+    // Scaled on the pool for the label as it was; rescaled here only if it has changed since
+    QImage scaled = preview.scaled;
+    if (scaled.isNull() || preview.scaledFor != imagePreviewLabel->size()) {
+        scaled = preview.balanced.scaled(imagePreviewLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    imagePreviewLabel->setPixmap(QPixmap::fromImage(scaled));
+}
+
+void TelescopeGUI::openRawFrame() {
+    QString fileName = QFileDialog::getOpenFileName(this, "Open Raw Frame", QString(),
+                                                    "Raw frames (*.tiff *.tif *.png);;All files (*)");
+    if (fileName.isEmpty()) return;
+    
+    // Decoding and demosaicing a full-size frame takes long enough to stall
+    // the GUI, so it runs on the thread pool with a snapshot of the settings
+    const Debayer::Pattern pattern = Debayer::Pattern(bayerPatternComboBox->currentData().toInt());
+    const Debayer::Method method = Debayer::Method(debayerMethodComboBox->currentData().toInt());
+    const bool removeGradient = removeGradientCheckBox->isChecked();
+    const ColorBalance balance = colorBalance;
+    const QSize scaledFor = imagePreviewLabel->size();
+    imageFileLabel->setText(QFileInfo(fileName).fileName() + " (loading...)");
+    
+    QPointer<TelescopeGUI> self(this);
+    QThreadPool::globalInstance()->start([self, fileName, pattern, method, removeGradient, balance, scaledFor]() {
+        QImage mosaic(fileName);
+        QImage scaled;
+        if (!mosaic.isNull()) {
+            QImage rgb = Debayer::demosaic(mosaic, pattern, method);
+            if (rgb.isNull()) {
+                // Already colour, or not a single-channel mosaic; show it as it is
+                rgb = mosaic;
             }
-        } else {
-            qDebug() << "Error fetching image:" << reply->errorString();
+            rgb = rgb.convertToFormat(QImage::Format_RGB32);
+            if (removeGradient) rgb = BackgroundModel::subtract(rgb);
+            rgb = balance.apply(rgb);
+            scaled = rgb.scaled(scaledFor, Qt::KeepAspectRatio, Qt::SmoothTransformation);
         }
         
-        // Clean up
-        reply->deleteLater();
-        manager->deleteLater();
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, fileName, scaled]() {
+            if (!self) return;
+            if (scaled.isNull()) {
+                self->imageFileLabel->setText(QString());
+                QMessageBox::warning(self, "Error", "Could not read " + fileName);
+                return;
+            }
+            self->imageFileLabel->setText(QFileInfo(fileName).fileName());
+            self->imagePreviewLabel->setPixmap(QPixmap::fromImage(scaled));
+        }, Qt::QueuedConnection);
     });
 }
 
-// Add a new method to analyze focus quality
-void TelescopeGUI::analyzeImageForFocus(const QByteArray &imageData) {
-    QImage image;
-    if (!image.loadFromData(imageData)) {
+void TelescopeGUI::solvePreview() {
+    const ImageInfo &info = dataProcessor->getData().lastImage;
+    if (lastPreview.isNull()) {
+        plateSolveLabel->setText("No preview to solve yet");
         return;
     }
     
+    PlateSolver::Hint hint;
+    hint.ra = info.ra;
+    hint.dec = info.dec;
+    hint.fovX = info.fovX;
+    hint.fovY = info.fovY;
+    startPlateSolve(lastPreview, hint, QFileInfo(info.fileLocation).fileName());
+}
+
+void TelescopeGUI::solveFile() {
+    QString fileName = QFileDialog::getOpenFileName(this, "Plate Solve Frame",
+                                                    downloadPathEdit ? downloadPathEdit->text() : QString(),
+                                                    "Images (*.jpg *.jpeg *.png *.tif *.tiff);;All files (*)");
+    if (fileName.isEmpty()) return;
+    
+    QImage image(fileName);
+    if (image.isNull()) {
+        QMessageBox::warning(this, "Error", "Could not read " + fileName);
+        return;
+    }
+    
+    // The pointing the telescope reported when it captured this frame, else where it points now
+    SkyCoverageIndex::Frame frame;
+    PlateSolver::Hint hint;
+    if (skyCoverage.findFrame(fileName, &frame)) {
+        hint.ra = frame.ra;
+        hint.dec = frame.dec;
+        hint.fovX = frame.fovX;
+        hint.fovY = frame.fovY;
+    } else {
+        const ImageInfo &info = dataProcessor->getData().lastImage;
+        hint.ra = info.ra;
+        hint.dec = info.dec;
+        hint.fovX = info.fovX;
+        hint.fovY = info.fovY;
+        hint.searchRadius *= 3;
+    }
+    startPlateSolve(image, hint, QFileInfo(fileName).fileName());
+}
+
+void TelescopeGUI::chooseStarIndex() {
+    QString fileName = QFileDialog::getOpenFileName(this, "Star Index", QFileInfo(starIndexPath).absolutePath(),
+                                                    "Star index (*.idx);;All files (*)");
+    if (fileName.isEmpty()) return;
+    
+    starIndexPath = fileName;
+    starIndex.reset();
+    plateSolveLabel->setText("Star index: " + QFileInfo(fileName).fileName());
+}
+
+void TelescopeGUI::startPlateSolve(const QImage &image, const PlateSolver::Hint &hint, const QString &name) {
+    if (plateSolving) return;
+    if (hint.fovX <= 0.0) {
+        plateSolveLabel->setText("No pointing reported for " + name + " to start from");
+        return;
+    }
+    
+    plateSolving = true;
+    solvePreviewButton->setEnabled(false);
+    solveFileButton->setEnabled(false);
+    plateSolveLabel->setText("Solving " + name + "...");
+    
+    // The index is loaded with the first solve, off the GUI thread like the solve itself
+    std::shared_ptr<StarIndex> index = starIndex;
+    QString indexPath = starIndexPath;
+    QPointer<TelescopeGUI> self(this);
+    QThreadPool::globalInstance()->start([self, index, indexPath, image, hint, name]() mutable {
+        if (!index) {
+            index = std::make_shared<StarIndex>();
+            index->load(indexPath);
+        }
+        PlateSolver::Solution solution = PlateSolver(index.get()).solve(image, hint);
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, index, hint, name, solution]() {
+            if (!self) return;
+            self->plateSolving = false;
+            self->starIndex = index;
+            self->solvePreviewButton->setEnabled(true);
+            self->solveFileButton->setEnabled(true);
+            
+            if (!solution.solved) {
+                self->plateSolveLabel->setText(QString("%1: not solved (%2)").arg(name, solution.error));
+                return;
+            }
+            
+            double offset = PlateSolver::separation(solution.ra, solution.dec, hint.ra, hint.dec);
+            self->plateSolveLabel->setText(
+                QString("%1: RA %2° Dec %3°, PA %4°, %5\"/px%6\n"
+                        "%7' from the reported centre; %8 of %9 stars matched, %10 px rms, %11 ms")
+                .arg(name)
+                .arg(solution.ra * 180.0 / M_PI, 0, 'f', 4)
+                .arg(solution.dec * 180.0 / M_PI, 0, 'f', 4)
+                .arg(solution.orientation * 180.0 / M_PI, 0, 'f', 1)
+                .arg(solution.pixelScale * 180.0 / M_PI * 3600.0, 0, 'f', 2)
+                .arg(solution.mirrored ? QString(", mirrored") : QString())
+                .arg(offset * 180.0 / M_PI * 60.0, 0, 'f', 1)
+                .arg(solution.matchedStars).arg(solution.imageStars)
+                .arg(solution.rmsPixels, 0, 'f', 2)
+                .arg(solution.elapsedMs));
+        }, Qt::QueuedConnection);
+    });
+}
+
+// Add a new method to analyze focus quality
+double TelescopeGUI::focusScore(const QImage &image) {
+    if (image.isNull()) {
+        return -1.0;
+    }
+    
     // Convert to grayscale
     QImage grayImage = image.convertToFormat(QImage::Format_Grayscale8);
     
@@ -881,16 +1620,14 @@ void TelescopeGUI::analyzeImageForFocus(const QByteArray &imageData) {
         }
     }
     
-    double contrastScore = sqrt(totalVariance / totalPixels);
-    
-    // Store this score somewhere (member variable or display in UI)
-    qDebug() << "Focus quality score (contrast):" << contrastScore;
-    
     // You could update a label in the UI to show this
     // focusQualityLabel->setText(QString("Focus Quality: %1").arg(contrastScore, 0, 'f', 2));
+    return sqrt(totalVariance / totalPixels);
 }
 
 void TelescopeGUI::updateLastUpdateLabel(QLabel *label, const QDateTime &lastUpdate) {
+    if (!label) return;
+    
     if (lastUpdate.isValid()) {
         QDateTime now = QDateTime::currentDateTime();
         qint64 secsAgo = lastUpdate.secsTo(now);
@@ -917,7 +1654,8 @@ QWidget* TelescopeGUI::createDownloadTab() {
     QGroupBox *pathGroup = new QGroupBox("Download Path", tab);
     QHBoxLayout *pathLayout = new QHBoxLayout(pathGroup);
     
-    downloadPathEdit = new QLineEdit(QDir::homePath() + "/CelestronOriginDownloads", pathGroup);
+    downloadPathEdit = new QLineEdit(restoredDownloadPath.isEmpty() ? QDir::homePath() + "/CelestronOriginDownloads"
+                                                                    : restoredDownloadPath, pathGroup);
     pathLayout->addWidget(downloadPathEdit);
     
     browseButton = new QPushButton("Browse", pathGroup);
@@ -934,6 +1672,38 @@ QWidget* TelescopeGUI::createDownloadTab() {
     
     mainLayout->addWidget(pathGroup);
     
+    // Storage limits on both ends of the link
+    QGroupBox *storageGroup = new QGroupBox("Storage", tab);
+    QGridLayout *storageLayout = new QGridLayout(storageGroup);
+    
+    storageLayout->addWidget(new QLabel("Keep free locally:", storageGroup), 0, 0);
+    localReserveSpinBox = new QDoubleSpinBox(storageGroup);
+    localReserveSpinBox->setRange(0.0, 10000.0);
+    localReserveSpinBox->setSuffix(" GB");
+    localReserveSpinBox->setValue(5.0);
+    storageLayout->addWidget(localReserveSpinBox, 0, 1);
+    
+    storageLayout->addWidget(new QLabel("Download quota:", storageGroup), 0, 2);
+    localQuotaSpinBox = new QDoubleSpinBox(storageGroup);
+    localQuotaSpinBox->setRange(0.0, 100000.0);
+    localQuotaSpinBox->setSuffix(" GB");
+    localQuotaSpinBox->setSpecialValueText("No quota");
+    storageLayout->addWidget(localQuotaSpinBox, 0, 3);
+    
+    autoDrainCheckBox = new QCheckBox("Start downloading automatically when the telescope disk is nearly full", storageGroup);
+    autoDrainCheckBox->setChecked(true);
+    storageLayout->addWidget(autoDrainCheckBox, 1, 0, 1, 4);
+    
+    writeFitsCheckBox = new QCheckBox("Also write FITS copies with telescope headers", storageGroup);
+    connect(writeFitsCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        if (autoDownloader) {
+            autoDownloader->setWriteFits(checked);
+        }
+    });
+    storageLayout->addWidget(writeFitsCheckBox, 2, 0, 1, 4);
+    
+    mainLayout->addWidget(storageGroup);
+    
     // Control buttons
     QHBoxLayout *controlLayout = new QHBoxLayout();
     
@@ -948,6 +1718,79 @@ QWidget* TelescopeGUI::createDownloadTab() {
     
     mainLayout->addLayout(controlLayout);
     
+    // Subframe mirror: judge each frame on its preview before paying for the transfer
+    QGroupBox *mirrorGroup = new QGroupBox("Subframe Mirror", tab);
+    QGridLayout *mirrorLayout = new QGridLayout(mirrorGroup);
+    FrameQualityThresholds defaults;
+    
+    mirrorSubframesCheckBox = new QCheckBox("Mirror all subframes (not only the stacked master)", mirrorGroup);
+    mirrorLayout->addWidget(mirrorSubframesCheckBox, 0, 0, 1, 4);
+    
+    mirrorLayout->addWidget(new QLabel("Min stars:", mirrorGroup), 1, 0);
+    minStarsSpinBox = new QSpinBox(mirrorGroup);
+    minStarsSpinBox->setRange(0, 1000);
+    minStarsSpinBox->setValue(defaults.minStars);
+    mirrorLayout->addWidget(minStarsSpinBox, 1, 1);
+    
+    mirrorLayout->addWidget(new QLabel("Max HFR (px):", mirrorGroup), 1, 2);
+    maxHfrSpinBox = new QDoubleSpinBox(mirrorGroup);
+    maxHfrSpinBox->setRange(0.5, 50.0);
+    maxHfrSpinBox->setSingleStep(0.5);
+    maxHfrSpinBox->setValue(defaults.maxHfr);
+    mirrorLayout->addWidget(maxHfrSpinBox, 1, 3);
+    
+    mirrorLayout->addWidget(new QLabel("Max background:", mirrorGroup), 2, 0);
+    maxBackgroundSpinBox = new QSpinBox(mirrorGroup);
+    maxBackgroundSpinBox->setRange(1, 100);
+    maxBackgroundSpinBox->setSuffix("%");
+    maxBackgroundSpinBox->setValue(int(defaults.maxBackground * 100));
+    mirrorLayout->addWidget(maxBackgroundSpinBox, 2, 1);
+    
+    rejectTrailedCheckBox = new QCheckBox("Reject trailed frames", mirrorGroup);
+    rejectTrailedCheckBox->setChecked(defaults.rejectTrailed);
+    mirrorLayout->addWidget(rejectTrailedCheckBox, 2, 2, 1, 2);
+    
+    mirrorLayout->addWidget(new QLabel("Rejected frames:", mirrorGroup), 3, 0);
+    rejectedFramesComboBox = new QComboBox(mirrorGroup);
+    rejectedFramesComboBox->addItem("Skip");
+    rejectedFramesComboBox->addItem("Download last");
+    mirrorLayout->addWidget(rejectedFramesComboBox, 3, 1);
+    
+    mainLayout->addWidget(mirrorGroup);
+    
+    // Archive browser: thumbnails only, full resolution on double-click or star
+    QGroupBox *archiveGroup = new QGroupBox("Archive", tab);
+    QVBoxLayout *archiveLayout = new QVBoxLayout(archiveGroup);
+    
+    QHBoxLayout *archiveButtons = new QHBoxLayout();
+    browseArchiveButton = new QPushButton("Browse Thumbnails", archiveGroup);
+    connect(browseArchiveButton, &QPushButton::clicked, this, &TelescopeGUI::browseArchive);
+    archiveButtons->addWidget(browseArchiveButton);
+    
+    starButton = new QPushButton("Star / Unstar", archiveGroup);
+    connect(starButton, &QPushButton::clicked, this, &TelescopeGUI::toggleStarSelected);
+    archiveButtons->addWidget(starButton);
+    archiveButtons->addStretch();
+    archiveLayout->addLayout(archiveButtons);
+    
+    archiveGrid = new QListWidget(archiveGroup);
+    archiveGrid->setViewMode(QListView::IconMode);
+    archiveGrid->setIconSize(QSize(160, 160));
+    archiveGrid->setGridSize(QSize(180, 190));
+    archiveGrid->setResizeMode(QListView::Adjust);
+    archiveGrid->setMovement(QListView::Static);
+    archiveGrid->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    archiveGrid->setWordWrap(true);
+    connect(archiveGrid, &QListWidget::itemDoubleClicked, this, &TelescopeGUI::onArchiveItemActivated);
+    archiveLayout->addWidget(archiveGrid);
+    
+    // The archive as last seen, from the thumbnail cache, until it is browsed again
+    for (const QString &directory : restoredArchive) {
+        onThumbnailReady(directory, QImage(AutoDownloader::thumbnailPath(downloadPathEdit->text(), directory)));
+    }
+    
+    mainLayout->addWidget(archiveGroup);
+    
     // Progress display
     QGroupBox *progressGroup = new QGroupBox("Download Progress", tab);
     QVBoxLayout *progressLayout = new QVBoxLayout(progressGroup);
@@ -1004,27 +1847,21 @@ void TelescopeGUI::startAutomaticDownload() {
         }
     }
     
-    // Create auto downloader if needed
-    if (!autoDownloader) {
-        autoDownloader = new AutoDownloader(webSocket, connectedIpAddress, downloadPath, this);
-        
-        // Connect signals
-        connect(autoDownloader, &AutoDownloader::directoryDownloadStarted, 
-                this, &TelescopeGUI::onDirectoryDownloadStarted);
-        connect(autoDownloader, &AutoDownloader::fileDownloadStarted, 
-                this, &TelescopeGUI::onFileDownloadStarted);
-        connect(autoDownloader, &AutoDownloader::fileDownloaded, 
-                this, &TelescopeGUI::onFileDownloaded);
-        connect(autoDownloader, &AutoDownloader::directoryDownloaded, 
-                this, &TelescopeGUI::onDirectoryDownloaded);
-        connect(autoDownloader, &AutoDownloader::allDownloadsComplete, 
-                this, &TelescopeGUI::onAllDownloadsComplete);
-        connect(autoDownloader, &AutoDownloader::downloadProgress, 
-                this, &TelescopeGUI::updateDownloadProgress);
-    } else {
-        // Update download path
-        autoDownloader->setDownloadPath(downloadPath);
-    }
+    ensureAutoDownloader(downloadPath);
+    
+    // Apply the mirror settings
+    FrameQualityThresholds thresholds;
+    thresholds.minStars = minStarsSpinBox->value();
+    thresholds.maxHfr = maxHfrSpinBox->value();
+    thresholds.maxBackground = maxBackgroundSpinBox->value() / 100.0;
+    thresholds.rejectTrailed = rejectTrailedCheckBox->isChecked();
+    autoDownloader->setMirrorSubframes(mirrorSubframesCheckBox->isChecked());
+    autoDownloader->setQualityThresholds(thresholds);
+    autoDownloader->setSkipRejectedFrames(rejectedFramesComboBox->currentIndex() == 0);
+    
+    const double GB = 1024.0 * 1024.0 * 1024.0;
+    autoDownloader->setLocalLimits(qint64(localReserveSpinBox->value() * GB),
+                                   qint64(localQuotaSpinBox->value() * GB));
     
     // Start download
     isDownloading = true;
@@ -1050,6 +1887,139 @@ void TelescopeGUI::startAutomaticDownload() {
     autoDownloader->startDownload();
 }
 
+void TelescopeGUI::ensureAutoDownloader(const QString &downloadPath) {
+    if (autoDownloader) {
+        // Update download path
+        autoDownloader->setDownloadPath(downloadPath);
+        return;
+    }
+    
+    autoDownloader = new AutoDownloader(link, connectedIpAddress, downloadPath, this);
+    autoDownloader->setWriteFits(writeFitsCheckBox && writeFitsCheckBox->isChecked());
+    for (const auto &metadata : pendingFrameMetadata) {
+        autoDownloader->recordFrameMetadata(metadata);
+    }
+    pendingFrameMetadata.clear();
+    
+    // Connect signals
+    connect(autoDownloader, &AutoDownloader::frameLocated, this, [this](const QString &filePath, qint64 dateObsMs) {
+        skyCoverage.locateFrame(dateObsMs, filePath);
+    });
+    connect(autoDownloader, &AutoDownloader::directoryDownloadStarted, 
+            this, &TelescopeGUI::onDirectoryDownloadStarted);
+    connect(autoDownloader, &AutoDownloader::fileDownloadStarted, 
+            this, &TelescopeGUI::onFileDownloadStarted);
+    connect(autoDownloader, &AutoDownloader::fileDownloaded, 
+            this, &TelescopeGUI::onFileDownloaded);
+    connect(autoDownloader, &AutoDownloader::directoryDownloaded, 
+            this, &TelescopeGUI::onDirectoryDownloaded);
+    connect(autoDownloader, &AutoDownloader::allDownloadsComplete, 
+            this, &TelescopeGUI::onAllDownloadsComplete);
+    connect(autoDownloader, &AutoDownloader::downloadProgress, 
+            this, &TelescopeGUI::updateDownloadProgress);
+    connect(autoDownloader, &AutoDownloader::frameRejected, 
+            this, &TelescopeGUI::onFrameRejected);
+    connect(autoDownloader, &AutoDownloader::thumbnailReady, 
+            this, &TelescopeGUI::onThumbnailReady);
+    connect(autoDownloader, &AutoDownloader::telescopeDiskCritical, 
+            this, &TelescopeGUI::onTelescopeDiskCritical);
+    connect(autoDownloader, &AutoDownloader::downloadDeferred, 
+            this, &TelescopeGUI::onDownloadDeferred);
+    connect(autoDownloader, &AutoDownloader::localSpaceExhausted, 
+            this, &TelescopeGUI::onLocalSpaceExhausted);
+    
+    // Disk reports from before the downloader existed still count
+    if (dataProcessor->getData().diskLastUpdate.isValid()) {
+        autoDownloader->updateTelescopeDisk(dataProcessor->getData().disk);
+    }
+}
+
+void TelescopeGUI::onTelescopeDiskCritical(qint64 freeBytes, qint64 secondsToFull) {
+    QString message = QString("Telescope disk nearly full: %1 MB free").arg(freeBytes / (1024 * 1024));
+    if (secondsToFull >= 0) {
+        message += QString(", about %1 min to full").arg(secondsToFull / 60);
+    }
+    downloadLogList->addItem(message);
+    downloadLogList->scrollToBottom();
+    statusLabel->setText(message);
+    
+    // Get the night's data off the scope so it can be cleared before imaging aborts
+    if (!isDownloading && autoDrainCheckBox->isChecked()) {
+        startAutomaticDownload();
+    }
+}
+
+void TelescopeGUI::onDownloadDeferred(const QString &fileName, const QString &reason) {
+    downloadLogList->addItem(QString("Deferred %1: %2").arg(fileName, reason));
+    downloadLogList->scrollToBottom();
+}
+
+void TelescopeGUI::onLocalSpaceExhausted(const QString &reason) {
+    downloadLogList->addItem(QString("Download stopped: %1").arg(reason));
+    downloadLogList->scrollToBottom();
+    
+    // Update UI
+    isDownloading = false;
+    startDownloadButton->setEnabled(true);
+    stopDownloadButton->setEnabled(false);
+    browseButton->setEnabled(true);
+    downloadPathEdit->setEnabled(true);
+}
+
+void TelescopeGUI::browseArchive() {
+    if (!isConnected) {
+        QMessageBox::warning(this, "Not Connected", "Please connect to a telescope first");
+        return;
+    }
+    
+    ensureAutoDownloader(downloadPathEdit->text());
+    archiveGrid->clear();
+    autoDownloader->startBrowse();
+}
+
+void TelescopeGUI::onThumbnailReady(const QString &directory, const QImage &thumbnail) {
+    if (!archiveGrid) return;
+    
+    // Replace the entry if the observation is already shown
+    QListWidgetItem *item = nullptr;
+    for (int i = 0; i < archiveGrid->count(); i++) {
+        if (archiveGrid->item(i)->data(Qt::UserRole).toString() == directory) {
+            item = archiveGrid->item(i);
+            break;
+        }
+    }
+    if (!item) {
+        item = new QListWidgetItem(archiveGrid);
+        item->setData(Qt::UserRole, directory);
+    }
+    
+    bool starred = autoDownloader && autoDownloader->isStarred(directory);
+    item->setText(starred ? QString(QChar(0x2605)) + " " + directory : directory);
+    if (!thumbnail.isNull()) {
+        item->setIcon(QIcon(QPixmap::fromImage(thumbnail)));
+    }
+}
+
+void TelescopeGUI::onArchiveItemActivated(QListWidgetItem *item) {
+    if (!autoDownloader || !item) return;
+    
+    QString directory = item->data(Qt::UserRole).toString();
+    downloadLogList->addItem(QString("Fetching full resolution: %1").arg(directory));
+    downloadLogList->scrollToBottom();
+    autoDownloader->fetchDirectory(directory);
+}
+
+void TelescopeGUI::toggleStarSelected() {
+    if (!autoDownloader) return;
+    
+    for (QListWidgetItem *item : archiveGrid->selectedItems()) {
+        QString directory = item->data(Qt::UserRole).toString();
+        bool starred = !autoDownloader->isStarred(directory);
+        autoDownloader->setStarred(directory, starred);
+        item->setText(starred ? QString(QChar(0x2605)) + " " + directory : directory);
+    }
+}
+
 // Add the implementation of stopAutomaticDownload()
 void TelescopeGUI::stopAutomaticDownload() {
     if (!isDownloading || !autoDownloader) {
@@ -1117,6 +2087,13 @@ void TelescopeGUI::onDirectoryDownloaded(const QString &directory) {
     downloadLogList->scrollToBottom();
 }
 
+void TelescopeGUI::onFrameRejected(const QString &fileName, const QString &reason, bool skipped) {
+    QString action = skipped ? "Skipped" : "Deferred";
+    QListWidgetItem *item = new QListWidgetItem(QString("%1 %2: %3").arg(action, fileName, reason));
+    downloadLogList->addItem(item);
+    downloadLogList->scrollToBottom();
+}
+
 void TelescopeGUI::onAllDownloadsComplete() {
     QListWidgetItem *item = new QListWidgetItem("All downloads complete!");
     downloadLogList->addItem(item);
@@ -1189,6 +2166,12 @@ QWidget* TelescopeGUI::createSlewAndImageTab() {
     targetComboBox->addItem("Virgo - Supercluster", "12h24m36.0s +8°0'00\"");
     targetComboBox->addItem("Virgo - Galaxy1", "12h24m12.0s +7°57'07\"");
     
+    // Solar system bodies, positioned from the ephemeris when selected
+    for (int body = Ephemeris::Moon; body < Ephemeris::BodyCount; body++) {
+        targetComboBox->addItem(Ephemeris::name(Ephemeris::Body(body)) + " - Solar System",
+                                QString("body:%1").arg(body));
+    }
+    
     targetLayout->addWidget(targetComboBox, 0, 1);
     
     // Custom coordinates for when "Custom Coordinates" is selected
@@ -1217,6 +2200,7 @@ QWidget* TelescopeGUI::createSlewAndImageTab() {
         customNameEdit->setEnabled(isCustom);
         customRaEdit->setEnabled(isCustom);
         customDecEdit->setEnabled(isCustom);
+        updateMoonInfo();
     });
     
     // Initially disable custom fields if not on custom option
@@ -1227,6 +2211,24 @@ QWidget* TelescopeGUI::createSlewAndImageTab() {
     
     targetLayout->addWidget(customGroup, 1, 0, 1, 2);
     
+    // Keep away from the Moon's glare
+    targetLayout->addWidget(new QLabel("Min Moon separation:"), 2, 0);
+    moonSeparationSpinBox = new QDoubleSpinBox(targetGroup);
+    moonSeparationSpinBox->setRange(0.0, 180.0);
+    moonSeparationSpinBox->setDecimals(0);
+    moonSeparationSpinBox->setValue(30.0);
+    moonSeparationSpinBox->setSuffix("°");
+    connect(moonSeparationSpinBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+            this, &TelescopeGUI::updateMoonInfo);
+    targetLayout->addWidget(moonSeparationSpinBox, 2, 1);
+    
+    moonInfoLabel = new QLabel("-", targetGroup);
+    moonInfoLabel->setWordWrap(true);
+    targetLayout->addWidget(moonInfoLabel, 3, 0, 1, 2);
+    connect(customRaEdit, &QLineEdit::editingFinished, this, &TelescopeGUI::updateMoonInfo);
+    connect(customDecEdit, &QLineEdit::editingFinished, this, &TelescopeGUI::updateMoonInfo);
+    updateMoonInfo();
+    
     // Duration section
     QGroupBox *durationGroup = new QGroupBox("Imaging Duration", tab);
     QHBoxLayout *durationLayout = new QHBoxLayout(durationGroup);
@@ -1262,11 +2264,46 @@ QWidget* TelescopeGUI::createSlewAndImageTab() {
     slewProgressBar->setValue(0);
     statusGroupLayout->addWidget(slewProgressBar);
     
+    // Coverage of the selected target from every frame captured so far
+    QGroupBox *coverageGroup = new QGroupBox("Sky Coverage", tab);
+    QGridLayout *coverageLayout = new QGridLayout(coverageGroup);
+    
+    coverageLayout->addWidget(new QLabel("Mosaic size:"), 0, 0);
+    mosaicWidthSpinBox = new QDoubleSpinBox(coverageGroup);
+    mosaicWidthSpinBox->setRange(0.0, 20.0);
+    mosaicWidthSpinBox->setDecimals(2);
+    mosaicWidthSpinBox->setSingleStep(0.25);
+    mosaicWidthSpinBox->setSuffix("° wide");
+    coverageLayout->addWidget(mosaicWidthSpinBox, 0, 1);
+    
+    mosaicHeightSpinBox = new QDoubleSpinBox(coverageGroup);
+    mosaicHeightSpinBox->setRange(0.0, 20.0);
+    mosaicHeightSpinBox->setDecimals(2);
+    mosaicHeightSpinBox->setSingleStep(0.25);
+    mosaicHeightSpinBox->setSuffix("° high");
+    coverageLayout->addWidget(mosaicHeightSpinBox, 0, 2);
+    
+    coverageLayout->addWidget(new QLabel("Target per cell:"), 1, 0);
+    mosaicTargetSpinBox = new QSpinBox(coverageGroup);
+    mosaicTargetSpinBox->setRange(1, 100000);
+    mosaicTargetSpinBox->setValue(600);
+    mosaicTargetSpinBox->setSuffix(" s");
+    coverageLayout->addWidget(mosaicTargetSpinBox, 1, 1);
+    
+    QPushButton *coverageButton = new QPushButton("Check Coverage", coverageGroup);
+    connect(coverageButton, &QPushButton::clicked, this, &TelescopeGUI::checkTargetCoverage);
+    coverageLayout->addWidget(coverageButton, 1, 2);
+    
+    coverageResultLabel = new QLabel("-", coverageGroup);
+    coverageResultLabel->setWordWrap(true);
+    coverageLayout->addWidget(coverageResultLabel, 2, 0, 1, 3);
+    
     // Add all components to main layout
     mainLayout->addWidget(targetGroup);
     mainLayout->addWidget(durationGroup);
     mainLayout->addLayout(buttonLayout);
     mainLayout->addWidget(statusGroup);
+    mainLayout->addWidget(coverageGroup);
     
     // Add a spacer to push everything up
     mainLayout->addStretch(1);
@@ -1324,6 +2361,11 @@ QWidget* TelescopeGUI::createAlpacaTab()
     alpacaDiscoveryCheckBox->setChecked(true);
     controlLayout->addWidget(alpacaDiscoveryCheckBox, 3, 0, 1, 2);
     
+    // FITS output, headed with the telemetry at the start of each exposure
+    alpacaFitsCheckBox = new QCheckBox("Save captured frames as FITS", controlGroup);
+    connect(alpacaFitsCheckBox, &QCheckBox::toggled, this, &TelescopeGUI::applyAlpacaFitsDirectory);
+    controlLayout->addWidget(alpacaFitsCheckBox, 4, 0, 1, 2);
+    
     // Control buttons
     QHBoxLayout *buttonLayout = new QHBoxLayout();
     alpacaStartButton = new QPushButton("Start Server", controlGroup);
@@ -1337,10 +2379,42 @@ QWidget* TelescopeGUI::createAlpacaTab()
     buttonLayout->addWidget(alpacaStopButton);
     buttonLayout->addStretch();
     
-    controlLayout->addLayout(buttonLayout, 4, 0, 1, 2);
+    controlLayout->addLayout(buttonLayout, 5, 0, 1, 2);
     
     mainLayout->addWidget(controlGroup);
     
+    // INDI clients (KStars/Ekos) are served natively from the same backend
+    QGroupBox *indiGroup = new QGroupBox("INDI Server", tab);
+    QGridLayout *indiLayout = new QGridLayout(indiGroup);
+    
+    indiEnableCheckBox = new QCheckBox("Serve INDI on port", indiGroup);
+    indiLayout->addWidget(indiEnableCheckBox, 0, 0);
+    indiPortSpinBox = new QSpinBox(indiGroup);
+    indiPortSpinBox->setRange(1024, 65535);
+    indiPortSpinBox->setValue(IndiServer::DEFAULT_PORT);
+    indiLayout->addWidget(indiPortSpinBox, 0, 1);
+    indiStatusLabel = new QLabel("Stopped", indiGroup);
+    indiLayout->addWidget(indiStatusLabel, 1, 0, 1, 2);
+    connect(indiEnableCheckBox, &QCheckBox::toggled, this, &TelescopeGUI::toggleIndiServer);
+    
+    mainLayout->addWidget(indiGroup);
+    
+    // Other monitors and apps share this app's one connection to the scope
+    QGroupBox *relayGroup = new QGroupBox("Telescope Relay", tab);
+    QGridLayout *relayLayout = new QGridLayout(relayGroup);
+    
+    relayEnableCheckBox = new QCheckBox("Relay the telescope connection on port", relayGroup);
+    relayLayout->addWidget(relayEnableCheckBox, 0, 0);
+    relayPortSpinBox = new QSpinBox(relayGroup);
+    relayPortSpinBox->setRange(1024, 65535);
+    relayPortSpinBox->setValue(TelemetryRelay::DEFAULT_PORT);
+    relayLayout->addWidget(relayPortSpinBox, 0, 1);
+    relayStatusLabel = new QLabel("Stopped", relayGroup);
+    relayLayout->addWidget(relayStatusLabel, 1, 0, 1, 2);
+    connect(relayEnableCheckBox, &QCheckBox::toggled, this, &TelescopeGUI::toggleTelemetryRelay);
+    
+    mainLayout->addWidget(relayGroup);
+    
     // Status Section
     QGroupBox *statusGroup = new QGroupBox("Server Status", tab);
     QGridLayout *statusLayout = new QGridLayout(statusGroup);
@@ -1419,8 +2493,57 @@ QWidget* TelescopeGUI::createAlpacaTab()
 
 // Add these slot implementations to TelescopeGUI.cpp:
 
+void TelescopeGUI::ensureAlpacaServer()
+{
+    if (alpacaServer) {
+        return;
+    }
+    
+    originBackend = new OriginBackend(this);
+    alpacaServer = new AlpacaServer(this);
+    alpacaServer->setTelescopeBackend(originBackend);
+    applyAlpacaFitsDirectory();
+    
+    // Connect Alpaca server signals
+    connect(alpacaServer, &AlpacaServer::serverStarted, this, &TelescopeGUI::onAlpacaServerStarted);
+    connect(alpacaServer, &AlpacaServer::serverStopped, this, &TelescopeGUI::onAlpacaServerStopped);
+    connect(alpacaServer, &AlpacaServer::requestReceived, this, &TelescopeGUI::onAlpacaRequestReceived);
+    
+    // Connect Origin backend signals
+    connect(originBackend, &OriginBackend::connected, this, [this]() {
+        alpacaLogTextEdit->append(QString("[%1] Origin telescope connected")
+                                 .arg(QTime::currentTime().toString()));
+    });
+    
+    connect(originBackend, &OriginBackend::disconnected, this, [this]() {
+        alpacaLogTextEdit->append(QString("[%1] Origin telescope disconnected")
+                                 .arg(QTime::currentTime().toString()));
+    });
+    
+    connect(originBackend, &OriginBackend::statusUpdated, this, [this]() {
+        telemetryShm.publish(originBackend->status(), QDateTime::currentMSecsSinceEpoch());
+    });
+}
+
+void TelescopeGUI::applyAlpacaFitsDirectory()
+{
+    if (!alpacaServer) return; // Applied when the server is created
+    
+    QString directory;
+    if (alpacaFitsCheckBox && alpacaFitsCheckBox->isChecked()) {
+        directory = QStandardPaths::writableLocation(QStandardPaths::PicturesLocation) + "/Origin Alpaca";
+    }
+    alpacaServer->setFitsDirectory(directory);
+    if (!directory.isEmpty() && alpacaLogTextEdit) {
+        alpacaLogTextEdit->append(QString("[%1] Saving frames as FITS in %2")
+                                 .arg(QTime::currentTime().toString(), directory));
+    }
+}
+
 void TelescopeGUI::startAlpacaServer()
 {
+    ensureAlpacaServer();
+    
     int port = alpacaPortSpinBox->value();
     
     alpacaLogTextEdit->append(QString("[%1] Starting Alpaca server on port %2...")
@@ -1436,8 +2559,89 @@ void TelescopeGUI::startAlpacaServer()
     }
 }
 
+void TelescopeGUI::toggleIndiServer(bool enabled)
+{
+    if (!enabled) {
+        if (indiServer) indiServer->stop();
+        indiStatusLabel->setText("Stopped");
+        indiPortSpinBox->setEnabled(true);
+        return;
+    }
+    
+    ensureAlpacaServer();
+    if (!indiServer) {
+        indiServer = new IndiServer(originBackend, this);
+        connect(indiServer, &IndiServer::clientCountChanged, this, [this](int count) {
+            indiStatusLabel->setText(QString("Running, %1 client(s)").arg(count));
+        });
+    }
+    
+    int port = indiPortSpinBox->value();
+    if (indiServer->start(port)) {
+        indiStatusLabel->setText(QString("Running, %1 client(s)").arg(indiServer->clientCount()));
+        indiPortSpinBox->setEnabled(false);
+        alpacaLogTextEdit->append(QString("[%1] INDI server listening on port %2")
+                                 .arg(QTime::currentTime().toString())
+                                 .arg(port));
+    } else {
+        indiStatusLabel->setText(QString("Cannot listen on port %1").arg(port));
+        indiEnableCheckBox->blockSignals(true);
+        indiEnableCheckBox->setChecked(false);
+        indiEnableCheckBox->blockSignals(false);
+    }
+}
+
+void TelescopeGUI::toggleTelemetryRelay(bool enabled)
+{
+    if (!enabled) {
+        if (telemetryRelay) telemetryRelay->stop();
+        relayStatusLabel->setText("Stopped");
+        relayPortSpinBox->setEnabled(true);
+        return;
+    }
+    
+    if (!telemetryRelay) {
+        telemetryRelay = new TelemetryRelay(link, this);
+        connect(telemetryRelay, &TelemetryRelay::clientCountChanged, this, &TelescopeGUI::updateRelayStatus);
+        // The counters move with every notification; a slow refresh is plenty
+        QTimer *relayStatusTimer = new QTimer(telemetryRelay);
+        connect(relayStatusTimer, &QTimer::timeout, this, &TelescopeGUI::updateRelayStatus);
+        relayStatusTimer->start(2000);
+    }
+    
+    int port = relayPortSpinBox->value();
+    if (telemetryRelay->start(port)) {
+        relayPortSpinBox->setEnabled(false);
+        updateRelayStatus();
+        alpacaLogTextEdit->append(QString("[%1] Relaying the telescope connection on port %2")
+                                 .arg(QTime::currentTime().toString())
+                                 .arg(port));
+    } else {
+        relayStatusLabel->setText(QString("Cannot listen on port %1").arg(port));
+        relayEnableCheckBox->blockSignals(true);
+        relayEnableCheckBox->setChecked(false);
+        relayEnableCheckBox->blockSignals(false);
+    }
+}
+
+void TelescopeGUI::updateRelayStatus()
+{
+    if (!telemetryRelay || !telemetryRelay->isRunning()) return;
+    
+    TelemetryRelay::Stats stats = telemetryRelay->stats();
+    relayStatusLabel->setText(QString("%1 client(s); %2 notifications relayed, %3 coalesced; "
+                                      "%4 commands forwarded, %5 answered from shared queries")
+                              .arg(telemetryRelay->clientCount())
+                              .arg(stats.notificationsRelayed).arg(stats.notificationsCoalesced)
+                              .arg(stats.commandsForwarded).arg(stats.queriesShared));
+}
+
 void TelescopeGUI::stopAlpacaServer()
 {
+    if (!alpacaServer) {
+        return;
+    }
+    
     alpacaLogTextEdit->append(QString("[%1] Stopping Alpaca server...")
                              .arg(QTime::currentTime().toString()));
     
@@ -1518,42 +2722,36 @@ void TelescopeGUI::saveAlpacaLog()
     }
 }
 
-void TelescopeGUI::startSlewAndImage() {
-    if (!isConnected) {
-        QMessageBox::warning(this, "Not Connected", "Please connect to a telescope first");
-        return;
-    }
-    
-    if (isSlewingAndImaging) {
-        return;
-    }
-    
-    // Get the target information
-    QString targetName;
-    double ra = 0.0;
-    double dec = 0.0;
-    
+bool TelescopeGUI::selectedTarget(QString *name, double *raHours, double *decDegrees) {
     if (targetComboBox->currentIndex() == 0) {
         // Custom coordinates
-        targetName = customNameEdit->text().trimmed();
-        if (targetName.isEmpty()) {
+        *name = customNameEdit->text().trimmed();
+        if (name->isEmpty()) {
             QMessageBox::warning(this, "Missing Target Name", "Please enter a target name");
-            return;
+            return false;
         }
         
         bool raOk = false;
         bool decOk = false;
-        ra = customRaEdit->text().toDouble(&raOk);
-        dec = customDecEdit->text().toDouble(&decOk);
+        *raHours = customRaEdit->text().toDouble(&raOk);
+        *decDegrees = customDecEdit->text().toDouble(&decOk);
         
-        if (!raOk || !decOk || ra < 0 || ra >= 24 || dec < -90 || dec > 90) {
+        if (!raOk || !decOk || *raHours < 0 || *raHours >= 24 || *decDegrees < -90 || *decDegrees > 90) {
             QMessageBox::warning(this, "Invalid Coordinates", 
                                 "Please enter valid coordinates:\n- RA between 0 and 24 hours\n- Dec between -90 and +90 degrees");
-            return;
+            return false;
         }
+    } else if (targetComboBox->currentData().toString().startsWith("body:")) {
+        // Solar system body, where it is now
+        *name = targetComboBox->currentText().split(" - ").at(0);
+        Ephemeris::Position position = targetBodyPosition(
+            Ephemeris::Body(targetComboBox->currentData().toString().mid(5).toInt()),
+            QDateTime::currentMSecsSinceEpoch());
+        *raHours = position.ra * 12.0 / M_PI;
+        *decDegrees = position.dec * 180.0 / M_PI;
     } else {
         // Selected target
-        targetName = targetComboBox->currentText().split(" - ").at(0);
+        *name = targetComboBox->currentText().split(" - ").at(0);
         
         // Parse the coordinates from the data
         QString coords = targetComboBox->currentData().toString();
@@ -1567,7 +2765,7 @@ void TelescopeGUI::startSlewAndImage() {
             int minutes = raMatch.captured(2).toInt();
             double seconds = raMatch.captured(3).toDouble();
             
-            ra = hours + (minutes / 60.0) + (seconds / 3600.0);
+            *raHours = hours + (minutes / 60.0) + (seconds / 3600.0);
         }
         
         // Convert Dec from DD:MM:SS format to decimal degrees
@@ -1579,8 +2777,180 @@ void TelescopeGUI::startSlewAndImage() {
             int minutes = decMatch.captured(2).toInt();
             double seconds = decMatch.captured(3).toDouble();
             
-            dec = abs(degrees) + (minutes / 60.0) + (seconds / 3600.0);
-            if (degrees < 0) dec = -dec;
+            *decDegrees = abs(degrees) + (minutes / 60.0) + (seconds / 3600.0);
+            if (degrees < 0) *decDegrees = -*decDegrees;
+        }
+    }
+    
+    return true;
+}
+
+Ephemeris::Position TelescopeGUI::targetBodyPosition(Ephemeris::Body body, qint64 ms) {
+    // From the observer when the mount has reported where it is; the Moon shifts by up to a degree
+    const MountStatus &mount = dataProcessor->getData().mount;
+    if (mount.latitude != 0.0 || mount.longitude != 0.0) {
+        return ephemeris.topocentric(body, ms, mount.latitude, mount.longitude);
+    }
+    return ephemeris.position(body, ms);
+}
+
+double TelescopeGUI::moonSeparation(double raHours, double decDegrees, QString *description) {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    Ephemeris::Position moon = targetBodyPosition(Ephemeris::Moon, now);
+    double separation = Ephemeris::separation(raHours * M_PI / 12.0, decDegrees * M_PI / 180.0,
+                                              moon.ra, moon.dec) * 180.0 / M_PI;
+    
+    if (description) {
+        *description = QString("Moon %1% lit, %2° from target")
+                       .arg(ephemeris.moonIllumination(now) * 100.0, 0, 'f', 0)
+                       .arg(separation, 0, 'f', 1);
+        const MountStatus &mount = dataProcessor->getData().mount;
+        if (mount.latitude != 0.0 || mount.longitude != 0.0) {
+            double altitude = Ephemeris::altitude(moon.ra, moon.dec, now, mount.latitude, mount.longitude);
+            *description += altitude > 0.0 ? QString(", %1° up").arg(altitude * 180.0 / M_PI, 0, 'f', 0)
+                                           : QString(", below the horizon");
+        }
+    }
+    return separation;
+}
+
+bool TelescopeGUI::moonIsUp() {
+    const MountStatus &mount = dataProcessor->getData().mount;
+    if (mount.latitude == 0.0 && mount.longitude == 0.0) {
+        return true;  // Unknown location, assume the worst
+    }
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    Ephemeris::Position moon = targetBodyPosition(Ephemeris::Moon, now);
+    return Ephemeris::altitude(moon.ra, moon.dec, now, mount.latitude, mount.longitude) > 0.0;
+}
+
+void TelescopeGUI::updateMoonInfo() {
+    if (!moonInfoLabel) return; // Tab not built yet
+    
+    // Quietly, unlike selectedTarget: custom coordinates may be half typed
+    double ra = 0.0;
+    double dec = 0.0;
+    QString data = targetComboBox->currentData().toString();
+    if (targetComboBox->currentIndex() == 0) {
+        bool raOk = false;
+        bool decOk = false;
+        ra = customRaEdit->text().toDouble(&raOk);
+        dec = customDecEdit->text().toDouble(&decOk);
+        if (!raOk || !decOk) {
+            qint64 now = QDateTime::currentMSecsSinceEpoch();
+            moonInfoLabel->setText(QString("Moon %1% lit")
+                                   .arg(ephemeris.moonIllumination(now) * 100.0, 0, 'f', 0));
+            return;
+        }
+    } else {
+        QString name;
+        if (!selectedTarget(&name, &ra, &dec)) return;
+        if (data == QString("body:%1").arg(Ephemeris::Moon)) {
+            qint64 now = QDateTime::currentMSecsSinceEpoch();
+            moonInfoLabel->setText(QString("Moon %1% lit, RA %2h, Dec %3°")
+                                   .arg(ephemeris.moonIllumination(now) * 100.0, 0, 'f', 0)
+                                   .arg(ra, 0, 'f', 3).arg(dec, 0, 'f', 2));
+            return;
+        }
+    }
+    
+    QString description;
+    double separation = moonSeparation(ra, dec, &description);
+    if (separation < moonSeparationSpinBox->value() && moonIsUp()) {
+        description = "<b>" + description + "</b> (closer than the limit)";
+    }
+    moonInfoLabel->setText(description);
+}
+
+void TelescopeGUI::checkTargetCoverage() {
+    QString targetName;
+    double ra = 0.0;
+    double dec = 0.0;
+    if (!selectedTarget(&targetName, &ra, &dec)) {
+        return;
+    }
+    double raRadians = ra * M_PI / 12.0;
+    double decRadians = dec * M_PI / 180.0;
+    
+    // Frames on the target itself
+    QVector<SkyCoverageIndex::Frame> frames = skyCoverage.framesCovering(raRadians, decRadians);
+    double seconds = 0.0;
+    QSet<QDate> nights;
+    for (const SkyCoverageIndex::Frame &frame : frames) {
+        seconds += frame.exposure;
+        // Frames before noon belong to the previous night
+        nights.insert(QDateTime::fromMSecsSinceEpoch(frame.timestampMs).addSecs(-12 * 3600).date());
+    }
+    QString text = QString("%1: %2 frames, %3 min over %4 nights")
+                   .arg(targetName).arg(frames.size())
+                   .arg(seconds / 60.0, 0, 'f', 1).arg(nights.size());
+    
+    // Cells of the planned mosaic still short of the target integration
+    double width = mosaicWidthSpinBox->value() * M_PI / 180.0;
+    double height = mosaicHeightSpinBox->value() * M_PI / 180.0;
+    if (width > 0.0 && height > 0.0) {
+        SkyCoverageIndex::Coverage coverage = skyCoverage.coverage(raRadians, decRadians, width, height, 0.0,
+                                                                   mosaicTargetSpinBox->value());
+        text += QString("\nMosaic: %1 of %2 cells reach %3 s (least %4 s)")
+                .arg(coverage.coveredCells).arg(coverage.cells)
+                .arg(mosaicTargetSpinBox->value()).arg(coverage.minSeconds, 0, 'f', 0);
+        
+        if (!coverage.gaps.isEmpty()) {
+            // Centre of the short cells, a first guess at where the next panel goes
+            double x = 0.0, y = 0.0, z = 0.0;
+            for (const auto &gap : coverage.gaps) {
+                x += std::cos(gap.second) * std::cos(gap.first);
+                y += std::cos(gap.second) * std::sin(gap.first);
+                z += std::sin(gap.second);
+            }
+            double gapRa = std::atan2(y, x);
+            if (gapRa < 0) gapRa += 2 * M_PI;
+            double gapDec = std::atan2(z, std::sqrt(x * x + y * y));
+            text += QString("\nGaps centred on RA %1h, Dec %2°")
+                    .arg(gapRa * 12.0 / M_PI, 0, 'f', 3).arg(gapDec * 180.0 / M_PI, 0, 'f', 2);
+        }
+    }
+    
+    if (targetComboBox->currentData().toString() != QString("body:%1").arg(Ephemeris::Moon)) {
+        QString moon;
+        moonSeparation(ra, dec, &moon);
+        text += "\n" + moon;
+    }
+    
+    coverageResultLabel->setText(text);
+}
+
+void TelescopeGUI::startSlewAndImage() {
+    if (!isConnected) {
+        QMessageBox::warning(this, "Not Connected", "Please connect to a telescope first");
+        return;
+    }
+    
+    if (isSlewingAndImaging) {
+        return;
+    }
+    
+    // Get the target information
+    QString targetName;
+    double ra = 0.0;
+    double dec = 0.0;
+    if (!selectedTarget(&targetName, &ra, &dec)) {
+        return;
+    }
+    
+    // Moonlight washes out faint targets near it
+    if (targetComboBox->currentData().toString() != QString("body:%1").arg(Ephemeris::Moon)) {
+        QString moon;
+        double separation = moonSeparation(ra, dec, &moon);
+        if (separation < moonSeparationSpinBox->value() && moonIsUp()) {
+            QMessageBox::StandardButton reply = QMessageBox::question(
+                this, "Target Near the Moon",
+                QString("%1 is closer to the Moon than %2°:\n%3\n\nImage it anyway?")
+                    .arg(targetName).arg(moonSeparationSpinBox->value(), 0, 'f', 0).arg(moon),
+                QMessageBox::Yes | QMessageBox::No);
+            if (reply != QMessageBox::Yes) {
+                return;
+            }
         }
     }
     
@@ -1592,6 +2962,9 @@ void TelescopeGUI::startSlewAndImage() {
     qDebug() << "RA (hours):" << ra << "Dec (degrees):" << dec;
     qDebug() << "RA (radians):" << raRadians << "Dec (radians):" << decRadians;
     
+    // A new target has its own sky background
+    exposureAdvisor.clear();
+    
     // Get the imaging duration
     int durationSeconds = durationSpinBox->value();
     imagingTimeRemaining = durationSeconds;
@@ -2,6 +2,9 @@
 
 class AlpacaServer;
 class OriginBackend;
+class IndiServer;
+class TelemetryRelay;
+class ClockSync;
 
 #include <QMainWindow>
 #include <QVBoxLayout>
@@ -30,12 +33,27 @@ class OriginBackend;
 #include <QSpinBox>
 #include <QTextEdit>
 #include <QCheckBox>
+#include <QComboBox>
+#include <QDoubleSpinBox>
 #include <QScrollBar>
 #include <QFileDialog>
 
 #include "TelescopeDataProcessor.hpp"
 #include "CommandInterface.hpp"
 #include "AutoDownloader.hpp"
+#include "TelescopeLink.hpp"
+#include "TelemetryStore.hpp"
+#include "AlertEngine.hpp"
+#include "SkyCoverageIndex.hpp"
+#include "Debayer.hpp"
+#include "ColorBalance.hpp"
+#include "BackgroundModel.hpp"
+#include "StateCheckpoint.hpp"
+#include "ExposureAdvisor.hpp"
+#include "PlateSolver.hpp"
+#include "Ephemeris.hpp"
+#include "TelemetryShmPublisher.hpp"
+#include <memory>
 
 /**
  * @brief Main application window for the telescope monitor
@@ -43,6 +61,19 @@ class OriginBackend;
 class TelescopeGUI : public QMainWindow {
     Q_OBJECT
     
+    /** A preview once the thread pool has measured and rendered it */
+    struct ProcessedPreview {
+        QImage raw;
+        QImage balanced;            // Gradient removed and colour balanced
+        QImage scaled;              // balanced, fitted to the preview label
+        QSize scaledFor;            // The label size it was fitted to
+        CameraStatus camera;        // Capture parameters when it arrived
+        bool measured = false;      // Whether skyLevel and skySigma are set
+        double skyLevel = 0.0;
+        double skySigma = 0.0;
+        double focus = -1.0;
+    };
+    
 public:
     /**
      * @brief Constructor
@@ -68,9 +99,18 @@ private slots:
     void stopDiscovery();
     
     /**
-     * @brief Process UDP broadcast datagrams
+     * @brief Process a UDP broadcast datagram
+     * @param datagramStr The datagram payload
+     * @param sender The sender address
+     */
+    void onDatagramReceived(const QString &datagramStr, const QString &sender);
+    
+    /**
+     * @brief Report whether the discovery socket could be bound
+     * @param listening Whether discovery is listening
+     * @param error The bind error, if any
      */
-    void processPendingDatagrams();
+    void onDiscoveryStateChanged(bool listening, const QString &error);
     
     /**
      * @brief Connect to the selected telescope
@@ -88,16 +128,68 @@ private slots:
     void onWebSocketDisconnected();
     
     /**
-     * @brief Slot called when a message is received from the WebSocket
-     * @param message The received message
+     * @brief Slot called when a message is received from the telescope
+     * @param obj The packet, already decoded on the I/O thread
+     * @param message The raw message text
+     * @param receivedMs Wall-clock receive time on the I/O thread
+     */
+    void onMessageReceived(const QJsonObject &obj, const QString &message, qint64 receivedMs);
+    
+    /**
+     * @brief Slot called when a preview image has been fetched and decoded
+     * @param url The image URL
+     * @param image The decoded image
+     */
+    void onImageFetched(const QString &url, const QImage &image);
+    
+    /**
+     * @brief Load a raw subframe from disk, demosaic it and show it in the preview
+     */
+    void openRawFrame();
+    
+    /**
+     * @brief Plate solve the latest preview, hinted by its ImageInfo
+     */
+    void solvePreview();
+    
+    /**
+     * @brief Plate solve a downloaded frame, hinted by the sky coverage record of its capture
      */
-    void onTextMessageReceived(const QString &message);
+    void solveFile();
+    
+    /**
+     * @brief Choose a star index other than the one in the application data directory
+     */
+    void chooseStarIndex();
+    
+    /**
+     * @brief Solve on the thread pool and show the result against the hint
+     * @param image The frame
+     * @param hint Where the telescope says it points
+     * @param name Shown with the result
+     */
+    void startPlateSolve(const QImage &image, const PlateSolver::Hint &hint, const QString &name);
+    
+    /**
+     * @brief Show the exposure advisor's current recommendation
+     */
+    void updateExposureAdvice();
+    
+    /**
+     * @brief Set the camera's exposure to the recommended sub length
+     */
+    void applyRecommendedExposure();
     
     /**
      * @brief Update the mount display
      */
     void updateMountDisplay();
     
+    /**
+     * @brief Show the telescope clock's offset and drift against ours
+     */
+    void updateClockSyncDisplay();
+    
     /**
      * @brief Update the camera display
      */
@@ -187,8 +279,76 @@ private slots:
      * @brief Handle when all downloads are complete
      */
     void onAllDownloadsComplete();
+    
+    /**
+     * @brief Handle a subframe that failed the mirror quality limits
+     * @param fileName The telescope file location
+     * @param reason Why it failed
+     * @param skipped Whether it was skipped or only moved to the end of the queue
+     */
+    void onFrameRejected(const QString &fileName, const QString &reason, bool skipped);
+    
+    /**
+     * @brief Fetch thumbnails of every observation into the archive grid
+     */
+    void browseArchive();
+    
+    /**
+     * @brief Show a browsed observation's thumbnail
+     * @param directory The observation directory
+     * @param thumbnail The thumbnail, null if there is no preview
+     */
+    void onThumbnailReady(const QString &directory, const QImage &thumbnail);
+    
+    /**
+     * @brief Fetch an observation at full resolution when activated in the grid
+     * @param item The grid item
+     */
+    void onArchiveItemActivated(QListWidgetItem *item);
+    
+    /**
+     * @brief Star or unstar the selected observations
+     */
+    void toggleStarSelected();
+    
+    /**
+     * @brief Warn, and start draining if enabled, when the telescope disk is nearly full
+     * @param freeBytes Free space left on the telescope
+     * @param secondsToFull Estimated time until full, -1 if unknown
+     */
+    void onTelescopeDiskCritical(qint64 freeBytes, qint64 secondsToFull);
+    
+    /**
+     * @brief Log a file left on the telescope because it would overrun local limits
+     */
+    void onDownloadDeferred(const QString &fileName, const QString &reason);
+    
+    /**
+     * @brief Stop the download UI when local limits are reached
+     */
+    void onLocalSpaceExhausted(const QString &reason);
+
+    /**
+     * @brief Report a rule that started firing
+     */
+    void onAlertRaised(const AlertEngine::Rule &rule, double value);
+
+    /**
+     * @brief Report a rule that stopped firing
+     */
+    void onAlertCleared(const AlertEngine::Rule &rule, double value);
+
+    /**
+     * @brief Carry out an automatic action of a firing rule
+     */
+    void onAlertAction(const AlertEngine::Rule &rule, const QJsonObject &action);
 
     void startSlewAndImage();
+    
+    /**
+     * @brief Report the frames and mosaic coverage of the selected target
+     */
+    void checkTargetCoverage();
     void cancelSlewAndImage();
     void slewAndImageTimerTimeout();
     void updateSlewAndImageStatus();
@@ -200,10 +360,19 @@ private slots:
     void stopAlpacaServer();
     void onAlpacaServerStarted();
     void onAlpacaServerStopped();
+    void toggleIndiServer(bool enabled);
+    void toggleTelemetryRelay(bool enabled);
+    void updateRelayStatus();
     void onAlpacaRequestReceived(const QString& method, const QString& path);
     void clearAlpacaLog();
     void saveAlpacaLog();
 
+    /**
+     * @brief Build a tab the first time it is shown
+     * @param index The index of the newly current tab
+     */
+    void onCurrentTabChanged(int index);
+
 private:
     /**
      * @brief Set up the UI elements
@@ -233,6 +402,22 @@ private:
      */
     void requestImage(const QString &filePath);
     
+    /**
+     * @brief Show the state saved by the last run and reconnect in the background
+     */
+    void restoreCheckpoint();
+    
+    /**
+     * @brief Save the current state for the next launch
+     */
+    void saveCheckpoint();
+    
+    /**
+     * @brief Create the auto downloader on first use, or point it at a new path
+     * @param downloadPath The download directory
+     */
+    void ensureAutoDownloader(const QString &downloadPath);
+    
     /**
      * @brief Update a "last update" label
      * @param label The label to update
@@ -240,8 +425,14 @@ private:
      */
     void updateLastUpdateLabel(QLabel *label, const QDateTime &lastUpdate);
 
-    // for future focus functionality
-    void analyzeImageForFocus(const QByteArray &imageData);
+    /**
+     * @brief Show a preview processed on the thread pool and feed its measurements to the advisor
+     * @param generation The preview's number; older ones are measured but not shown
+     */
+    void onPreviewProcessed(int generation, const ProcessedPreview &preview);
+
+    // for future focus functionality; safe to call off the GUI thread
+    static double focusScore(const QImage &image);
     // Optionally add a variable to store focus scores
     QList<double> focusScores;
 
@@ -257,150 +448,321 @@ private:
     QWidget* createCommandTab();
     QWidget* createDownloadTab();
     QWidget* createSlewAndImageTab();
+    QWidget* createAlertsTab();
+    QWidget* createLogViewerTab();
+
+    /**
+     * @brief Name and J2000 position of the target chosen on the Slew & Image tab
+     * @return False, after warning the user, if custom coordinates are invalid
+     */
+    bool selectedTarget(QString *name, double *raHours, double *decDegrees);
+
+    /**
+     * @brief Current position of a solar system body, from the mount's site when known
+     */
+    Ephemeris::Position targetBodyPosition(Ephemeris::Body body, qint64 ms);
+
+    /**
+     * @brief Degrees from a J2000 position to the Moon now
+     * @param description If given, receives the Moon's phase, distance and altitude
+     */
+    double moonSeparation(double raHours, double decDegrees, QString *description = nullptr);
+
+    /**
+     * @brief Whether the Moon is above the horizon, or the site is unknown
+     */
+    bool moonIsUp();
+
+    /**
+     * @brief Show the Moon's phase and distance from the selected target
+     */
+    void updateMoonInfo();
+
+    /**
+     * @brief Show each alert rule with its current input and state
+     */
+    void updateAlertsDisplay();
+
+    /**
+     * @brief Add a line to the alert log, kept while the Alerts tab is unbuilt
+     */
+    void logAlert(const QString &message);
+
+    typedef QWidget* (TelescopeGUI::*TabFactory)();
+
+    /**
+     * @brief Add a placeholder tab whose contents are built on first view
+     * @param factory The tab creation method
+     * @param title The tab title
+     * @return The tab index
+     */
+    int addLazyTab(TabFactory factory, const QString &title);
+
+    /**
+     * @brief Build the contents of a tab if that has not happened yet
+     * @param index The tab index
+     */
+    void ensureTabBuilt(int index);
+
+    /**
+     * @brief Refresh every built tab from the current telescope data
+     */
+    void refreshDisplays();
+
+    /**
+     * @brief Create the Origin backend and Alpaca server on first use
+     */
+    void ensureAlpacaServer();
+    
+    /**
+     * @brief Point the Alpaca server's FITS output at the pictures folder, or turn it off
+     */
+    void applyAlpacaFitsDirectory();
     
     // Class members
-    TelescopeDataProcessor *dataProcessor;
-    QWebSocket *webSocket;
-    QUdpSocket *udpSocket;
+    QTabWidget *tabWidget = nullptr;
+    QVector<TabFactory> tabFactories;
+    int downloadTabIndex = -1;  // The downloader's handlers need this tab built
+    int imageTabIndex = -1;     // Shows the cached preview when first built
+    TelescopeDataProcessor *dataProcessor = nullptr;
+    TelescopeLink *link = nullptr;
     
     // UI elements
-    QListWidget *telescopeListWidget;
-    QPushButton *connectButton;
-    QLabel *statusLabel;
+    QListWidget *telescopeListWidget = nullptr;
+    QPushButton *connectButton = nullptr;
+    QLabel *statusLabel = nullptr;
     
     // State variables
     QStringList telescopeAddresses;
     QString connectedIpAddress;
     bool isConnected = false;
     
+    /** Whether the displays still show checkpointed state rather than live telemetry */
+    bool showingCheckpoint = false;
+    
+    /** Checkpointed download directory, used until the Auto Download tab is built */
+    QString restoredDownloadPath;
+    
+    /** Checkpointed archive grid entries, shown when the Auto Download tab is built */
+    QStringList restoredArchive;
+    
+    /** Checkpointed downloads to resume once connected */
+    QStringList resumeDownloads;
+    
+    /** URL of the preview last requested for the Image tab */
+    QString previewUrl;
+    
     // Mount tab widgets
-    QLabel *mountBatteryLevelLabel;
-    QLabel *mountBatteryVoltageLabel;
-    QLabel *mountChargerStatusLabel;
-    QLabel *mountTimeLabel;
-    QLabel *mountDateLabel;
-    QLabel *mountTimeZoneLabel;
-    QLabel *mountLatitudeLabel;
-    QLabel *mountLongitudeLabel;
-    QLabel *mountIsAlignedLabel;
-    QLabel *mountIsTrackingLabel;
-    QLabel *mountIsGotoOverLabel;
-    QLabel *mountNumAlignRefsLabel;
-    QLabel *mountLastUpdateLabel;
+    QLabel *mountBatteryLevelLabel = nullptr;
+    QLabel *mountBatteryVoltageLabel = nullptr;
+    QLabel *mountChargerStatusLabel = nullptr;
+    QLabel *mountTimeLabel = nullptr;
+    QLabel *mountDateLabel = nullptr;
+    QLabel *mountTimeZoneLabel = nullptr;
+    QLabel *mountClockOffsetLabel = nullptr;
+    QLabel *mountLatitudeLabel = nullptr;
+    QLabel *mountLongitudeLabel = nullptr;
+    QLabel *mountIsAlignedLabel = nullptr;
+    QLabel *mountIsTrackingLabel = nullptr;
+    QLabel *mountIsGotoOverLabel = nullptr;
+    QLabel *mountNumAlignRefsLabel = nullptr;
+    QLabel *mountLastUpdateLabel = nullptr;
     
     // Camera tab widgets
-    QLabel *cameraBinningLabel;
-    QLabel *cameraBitDepthLabel;
-    QLabel *cameraExposureLabel;
-    QLabel *cameraISOLabel;
-    QLabel *cameraRedBalanceLabel;
-    QLabel *cameraGreenBalanceLabel;
-    QLabel *cameraBlueBalanceLabel;
-    QLabel *cameraLastUpdateLabel;
+    QLabel *cameraBinningLabel = nullptr;
+    QLabel *cameraBitDepthLabel = nullptr;
+    QLabel *cameraExposureLabel = nullptr;
+    QLabel *cameraISOLabel = nullptr;
+    QLabel *cameraRedBalanceLabel = nullptr;
+    QLabel *cameraGreenBalanceLabel = nullptr;
+    QLabel *cameraBlueBalanceLabel = nullptr;
+    QLabel *cameraLastUpdateLabel = nullptr;
+    QLabel *advisorSkyLabel = nullptr;
+    QLabel *advisorFluxLabel = nullptr;
+    QLabel *advisorSubLabel = nullptr;
+    QLabel *advisorPenaltyLabel = nullptr;
+    QDoubleSpinBox *swampFactorSpinBox = nullptr;
+    QDoubleSpinBox *readNoiseSpinBox = nullptr;
+    QPushButton *applyExposureButton = nullptr;
+    ExposureAdvisor exposureAdvisor;  // fed by every preview
     
     // Focuser tab widgets
-    QLabel *focuserPositionLabel;
-    QLabel *focuserBacklashLabel;
-    QLabel *focuserLowerLimitLabel;
-    QLabel *focuserUpperLimitLabel;
-    QLabel *focuserIsCalibrationCompleteLabel;
-    QProgressBar *focuserCalibrationProgressBar;
-    QLabel *focuserLastUpdateLabel;
+    QLabel *focuserPositionLabel = nullptr;
+    QLabel *focuserBacklashLabel = nullptr;
+    QLabel *focuserLowerLimitLabel = nullptr;
+    QLabel *focuserUpperLimitLabel = nullptr;
+    QLabel *focuserIsCalibrationCompleteLabel = nullptr;
+    QProgressBar *focuserCalibrationProgressBar = nullptr;
+    QLabel *focuserLastUpdateLabel = nullptr;
     
     // Environment tab widgets
-    QLabel *envAmbientTempLabel;
-    QLabel *envCameraTempLabel;
-    QLabel *envCpuTempLabel;
-    QLabel *envFrontCellTempLabel;
-    QLabel *envHumidityLabel;
-    QLabel *envDewPointLabel;
-    QLabel *envCpuFanLabel;
-    QLabel *envOtaFanLabel;
-    QLabel *environmentLastUpdateLabel;
+    QLabel *envAmbientTempLabel = nullptr;
+    QLabel *envCameraTempLabel = nullptr;
+    QLabel *envCpuTempLabel = nullptr;
+    QLabel *envFrontCellTempLabel = nullptr;
+    QLabel *envHumidityLabel = nullptr;
+    QLabel *envDewPointLabel = nullptr;
+    QLabel *envCpuFanLabel = nullptr;
+    QLabel *envOtaFanLabel = nullptr;
+    QLabel *environmentLastUpdateLabel = nullptr;
+    QHash<int, QLabel*> envHourLabels;  // TelemetryFields::Field -> last-hour min/mean/max
     
     // Image tab widgets
-    QLabel *imageFileLabel;
-    QLabel *imageTypeLabel;
-    QLabel *imageDecLabel;
-    QLabel *imageRaLabel;
-    QLabel *imageOrientationLabel;
-    QLabel *imageFovXLabel;
-    QLabel *imageFovYLabel;
-    QLabel *imageLastUpdateLabel;
-    QLabel *imagePreviewLabel;
+    QLabel *imageFileLabel = nullptr;
+    QLabel *imageTypeLabel = nullptr;
+    QLabel *imageDecLabel = nullptr;
+    QLabel *imageRaLabel = nullptr;
+    QLabel *imageOrientationLabel = nullptr;
+    QLabel *imageFovXLabel = nullptr;
+    QLabel *imageFovYLabel = nullptr;
+    QLabel *imageLastUpdateLabel = nullptr;
+    QLabel *imagePreviewLabel = nullptr;
+    QComboBox *bayerPatternComboBox = nullptr;
+    QComboBox *debayerMethodComboBox = nullptr;
+    QCheckBox *removeGradientCheckBox = nullptr;
+    QCheckBox *whiteBalanceCheckBox = nullptr;
+    QCheckBox *neutralizeBackgroundCheckBox = nullptr;
+    ColorBalance colorBalance;  // white balance follows the camera's status
+    QLabel *plateSolveLabel = nullptr;
+    QPushButton *solvePreviewButton = nullptr;
+    QPushButton *solveFileButton = nullptr;
+    QImage lastPreview;
+    QImage lastBalancedPreview;  // as shown, before scaling
+    int previewGeneration = 0;
+    QString starIndexPath = StarIndex::defaultPath();
+    std::shared_ptr<StarIndex> starIndex;   // loaded on the first solve
+    bool plateSolving = false;
     
     // Disk tab widgets
-    QLabel *diskCapacityLabel;
-    QLabel *diskFreeLabel;
-    QLabel *diskUsedLabel;
-    QLabel *diskLevelLabel;
-    QProgressBar *diskUsageBar;
-    QLabel *diskLastUpdateLabel;
+    QLabel *diskCapacityLabel = nullptr;
+    QLabel *diskFreeLabel = nullptr;
+    QLabel *diskUsedLabel = nullptr;
+    QLabel *diskLevelLabel = nullptr;
+    QProgressBar *diskUsageBar = nullptr;
+    QLabel *diskLastUpdateLabel = nullptr;
+    QLabel *diskFillRateLabel = nullptr;
+    QLabel *diskTimeToFullLabel = nullptr;
     
     // Dew Heater tab widgets
-    QLabel *dewHeaterModeLabel;
-    QLabel *dewHeaterAggressionLabel;
-    QLabel *dewHeaterLevelLabel;
-    QLabel *dewHeaterManualPowerLabel;
-    QProgressBar *dewHeaterLevelBar;
-    QLabel *dewHeaterLastUpdateLabel;
+    QLabel *dewHeaterModeLabel = nullptr;
+    QLabel *dewHeaterAggressionLabel = nullptr;
+    QLabel *dewHeaterLevelLabel = nullptr;
+    QLabel *dewHeaterManualPowerLabel = nullptr;
+    QProgressBar *dewHeaterLevelBar = nullptr;
+    QLabel *dewHeaterLastUpdateLabel = nullptr;
     
     // Orientation tab widgets
-    QLabel *orientationAltitudeLabel;
-    QLabel *orientationLastUpdateLabel;
+    QLabel *orientationAltitudeLabel = nullptr;
+    QLabel *orientationLastUpdateLabel = nullptr;
 
-    CommandInterface *commandInterface;
+    CommandInterface *commandInterface = nullptr;
 
    // Download tab widgets
-    QLineEdit *downloadPathEdit;
-    QPushButton *browseButton;
-    QPushButton *startDownloadButton;
-    QPushButton *stopDownloadButton;
-    QProgressBar *overallProgressBar;
-    QProgressBar *currentFileProgressBar;
-    QLabel *currentFileLabel;
-    QListWidget *downloadLogList;
+    QLineEdit *downloadPathEdit = nullptr;
+    QPushButton *browseButton = nullptr;
+    QPushButton *startDownloadButton = nullptr;
+    QPushButton *stopDownloadButton = nullptr;
+    QProgressBar *overallProgressBar = nullptr;
+    QProgressBar *currentFileProgressBar = nullptr;
+    QLabel *currentFileLabel = nullptr;
+    QListWidget *downloadLogList = nullptr;
+    QCheckBox *mirrorSubframesCheckBox = nullptr;
+    QSpinBox *minStarsSpinBox = nullptr;
+    QDoubleSpinBox *maxHfrSpinBox = nullptr;
+    QSpinBox *maxBackgroundSpinBox = nullptr;
+    QCheckBox *rejectTrailedCheckBox = nullptr;
+    QComboBox *rejectedFramesComboBox = nullptr;
+    QDoubleSpinBox *localReserveSpinBox = nullptr;
+    QDoubleSpinBox *localQuotaSpinBox = nullptr;
+    QCheckBox *autoDrainCheckBox = nullptr;
+    QCheckBox *writeFitsCheckBox = nullptr;
+    QPushButton *browseArchiveButton = nullptr;
+    QPushButton *starButton = nullptr;
+    QListWidget *archiveGrid = nullptr;
     
     // Auto downloader
-    AutoDownloader *autoDownloader;
+    AutoDownloader *autoDownloader = nullptr;
+    
+    // FITS header values of frames captured before the downloader was created
+    QVector<FitsWriter::Metadata> pendingFrameMetadata;
+    
+    // History of every status update, kept across sessions
+    TelemetryStore *telemetryStore = nullptr;
+    
+    // Latest snapshot for local co-processes, see origin_telemetry_shm.h
+    TelemetryShmPublisher telemetryShm;
+    
+    // Rules watched on every status update
+    AlertEngine *alertEngine = nullptr;
+    QListWidget *alertRulesList = nullptr;
+    QListWidget *alertLogList = nullptr;
+    QStringList alertLog;
+    
+    // Footprint of every frame ever captured
+    SkyCoverageIndex skyCoverage;
+    QDoubleSpinBox *mosaicWidthSpinBox = nullptr;
+    QDoubleSpinBox *mosaicHeightSpinBox = nullptr;
+    QSpinBox *mosaicTargetSpinBox = nullptr;
+    QLabel *coverageResultLabel = nullptr;
+    
+    // Sun, Moon and planets for targets and the Moon-separation limit
+    Ephemeris ephemeris;
+    QDoubleSpinBox *moonSeparationSpinBox = nullptr;
+    QLabel *moonInfoLabel = nullptr;
     bool isDownloading = false;
 
     // Add more private members for the new tab
-    QComboBox *targetComboBox;
-    QLineEdit *customRaEdit;
-    QLineEdit *customDecEdit;
-    QLineEdit *customNameEdit;
-    QSpinBox *durationSpinBox;
-    QPushButton *startSlewButton;
-    QPushButton *cancelSlewButton;
-    QProgressBar *slewProgressBar;
-    QLabel *slewStatusLabel;
-    QTimer *slewAndImageTimer;
-    QTimer *statusUpdateTimer;
+    QComboBox *targetComboBox = nullptr;
+    QLineEdit *customRaEdit = nullptr;
+    QLineEdit *customDecEdit = nullptr;
+    QLineEdit *customNameEdit = nullptr;
+    QSpinBox *durationSpinBox = nullptr;
+    QPushButton *startSlewButton = nullptr;
+    QPushButton *cancelSlewButton = nullptr;
+    QProgressBar *slewProgressBar = nullptr;
+    QLabel *slewStatusLabel = nullptr;
+    QTimer *slewAndImageTimer = nullptr;
+    QTimer *statusUpdateTimer = nullptr;
     bool isSlewingAndImaging = false;
     int imagingTimeRemaining = 0;
     QString currentImagingTargetUuid;
 
-    QLabel *alignmentStatusLabel;
-    QLabel *mountStatusLabel;
-    QPushButton *initializeButton;
-    QPushButton *autoAlignButton;
+    QLabel *alignmentStatusLabel = nullptr;
+    QLabel *mountStatusLabel = nullptr;
+    QPushButton *initializeButton = nullptr;
+    QPushButton *autoAlignButton = nullptr;
 
     // NEW: Alpaca server integration
-    AlpacaServer* alpacaServer;
-    OriginBackend* originBackend;
+    AlpacaServer* alpacaServer = nullptr;
+    OriginBackend* originBackend = nullptr;
     
     // Alpaca tab widgets
-    QPushButton* alpacaStartButton;
-    QPushButton* alpacaStopButton;
-    QLabel* alpacaStatusLabel;
-    QLabel* alpacaPortLabel;
-    QSpinBox* alpacaPortSpinBox;
-    QLineEdit* alpacaServerNameEdit;
-    QTextEdit* alpacaLogTextEdit;
-    QLabel* alpacaRequestCountLabel;
-    QCheckBox* alpacaAutoStartCheckBox;
-    QCheckBox* alpacaDiscoveryCheckBox;
+    QPushButton* alpacaStartButton = nullptr;
+    QPushButton* alpacaStopButton = nullptr;
+    QLabel* alpacaStatusLabel = nullptr;
+    QLabel* alpacaPortLabel = nullptr;
+    QSpinBox* alpacaPortSpinBox = nullptr;
+    QLineEdit* alpacaServerNameEdit = nullptr;
+    QTextEdit* alpacaLogTextEdit = nullptr;
+    QLabel* alpacaRequestCountLabel = nullptr;
+    QCheckBox* alpacaAutoStartCheckBox = nullptr;
+    QCheckBox* alpacaDiscoveryCheckBox = nullptr;
+    QCheckBox* alpacaFitsCheckBox = nullptr;
+    
+    // INDI server, sharing the Alpaca server's backend
+    IndiServer* indiServer = nullptr;
+    QCheckBox* indiEnableCheckBox = nullptr;
+    QSpinBox* indiPortSpinBox = nullptr;
+    QLabel* indiStatusLabel = nullptr;
+    
+    // Offset of the telescope's clock, for stamping telemetry and frames
+    ClockSync* clockSync = nullptr;
+    
+    // One telescope connection shared with other monitors and apps
+    TelemetryRelay* telemetryRelay = nullptr;
+    QCheckBox* relayEnableCheckBox = nullptr;
+    QSpinBox* relayPortSpinBox = nullptr;
+    QLabel* relayStatusLabel = nullptr;
 
     QWidget* createAlpacaTab();
     
@@ -0,0 +1,466 @@
+#include "TelescopeLink.hpp"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QNetworkRequest>
+
+namespace {
+    /** Display frame period: the GUI drains the queue at most this often */
+    const int FRAME_MS = 16;
+
+    /** Cap on events dispatched per frame so a flood cannot stall painting */
+    const int MAX_EVENTS_PER_FRAME = 512;
+
+    /** Minimum spacing of progress events per download */
+    const int PROGRESS_INTERVAL_MS = 100;
+
+    QNetworkRequest originRequest(const QUrl &url)
+    {
+        QNetworkRequest request(url);
+        request.setRawHeader("Cache-Control", "no-cache");
+        request.setRawHeader("Accept", "*/*");
+        request.setRawHeader("User-Agent", "CelestronOriginMonitor Qt Application");
+        request.setRawHeader("Connection", "keep-alive");
+        return request;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// TelescopeLinkWorker (I/O thread)
+// ---------------------------------------------------------------------------
+
+TelescopeLinkWorker::TelescopeLinkWorker(std::shared_ptr<LinkChannel> channel)
+    : QObject(nullptr)
+    , m_channel(channel)
+    , m_webSocket(nullptr)
+    , m_udpSocket(nullptr)
+    , m_networkManager(nullptr)
+    , m_backlogTimer(nullptr)
+{
+}
+
+void TelescopeLinkWorker::initialize()
+{
+    // Created here rather than in the constructor so they belong to the I/O thread
+    m_webSocket = new QWebSocket("", QWebSocketProtocol::VersionLatest, this);
+    m_udpSocket = new QUdpSocket(this);
+    m_networkManager = new QNetworkAccessManager(this);
+    m_backlogTimer = new QTimer(this);
+    m_backlogTimer->setInterval(5);
+    connect(m_backlogTimer, &QTimer::timeout, this, &TelescopeLinkWorker::flushBacklog);
+
+    connect(m_webSocket, &QWebSocket::connected, this, [this]() {
+        LinkEvent event;
+        event.kind = LinkEvent::Connected;
+        post(event);
+    });
+    connect(m_webSocket, &QWebSocket::disconnected, this, [this]() {
+        LinkEvent event;
+        event.kind = LinkEvent::Disconnected;
+        post(event);
+    });
+    connect(m_webSocket, &QWebSocket::textMessageReceived, this, &TelescopeLinkWorker::onTextMessageReceived);
+}
+
+void TelescopeLinkWorker::openSocket(const QUrl &url)
+{
+    m_webSocket->open(url);
+}
+
+void TelescopeLinkWorker::closeSocket()
+{
+    if (m_webSocket->state() != QAbstractSocket::UnconnectedState) {
+        m_webSocket->close();
+    }
+}
+
+void TelescopeLinkWorker::sendText(const QString &message)
+{
+    if (m_webSocket->isValid() && m_webSocket->state() == QAbstractSocket::ConnectedState) {
+        m_webSocket->sendTextMessage(message);
+    }
+}
+
+void TelescopeLinkWorker::onTextMessageReceived(const QString &message)
+{
+    LinkEvent event;
+    event.kind = LinkEvent::Message;
+    event.text = message;
+    event.receivedMs = QDateTime::currentMSecsSinceEpoch();
+
+    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8());
+    if (doc.isObject()) {
+        event.object = doc.object();
+    }
+
+    post(event);
+}
+
+void TelescopeLinkWorker::startDiscovery(quint16 port)
+{
+    if (m_udpSocket->state() != QAbstractSocket::UnconnectedState) {
+        m_udpSocket->close();
+    }
+
+    LinkEvent event;
+    event.kind = LinkEvent::DiscoveryState;
+    event.ok = m_udpSocket->bind(QHostAddress::AnyIPv4, port,
+                                 QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint);
+    if (event.ok) {
+        m_udpSocket->setSocketOption(QAbstractSocket::SocketOption(5), 1); // BroadcastOption
+        connect(m_udpSocket, &QUdpSocket::readyRead, this, &TelescopeLinkWorker::onPendingDatagrams,
+                Qt::UniqueConnection);
+    } else {
+        event.text = m_udpSocket->errorString();
+    }
+    post(event);
+}
+
+void TelescopeLinkWorker::stopDiscovery()
+{
+    if (m_udpSocket->state() != QAbstractSocket::UnconnectedState) {
+        disconnect(m_udpSocket, &QUdpSocket::readyRead, this, &TelescopeLinkWorker::onPendingDatagrams);
+        m_udpSocket->close();
+    }
+
+    LinkEvent event;
+    event.kind = LinkEvent::DiscoveryState;
+    event.ok = false;
+    post(event);
+}
+
+void TelescopeLinkWorker::onPendingDatagrams()
+{
+    while (m_udpSocket->hasPendingDatagrams()) {
+        QByteArray datagram;
+        datagram.resize(m_udpSocket->pendingDatagramSize());
+        QHostAddress sender;
+        quint16 senderPort;
+        m_udpSocket->readDatagram(datagram.data(), datagram.size(), &sender, &senderPort);
+
+        LinkEvent event;
+        event.kind = LinkEvent::Datagram;
+        event.text = QString::fromUtf8(datagram);
+        event.extra = sender.toString();
+        event.receivedMs = QDateTime::currentMSecsSinceEpoch();
+        post(event);
+    }
+}
+
+void TelescopeLinkWorker::fetchImage(const QUrl &url)
+{
+    const QString urlString = url.toString();
+    QNetworkReply *reply = m_networkManager->get(originRequest(url));
+    connect(reply, &QNetworkReply::finished, this, [this, reply, urlString]() {
+        LinkEvent event;
+        event.url = urlString;
+        event.receivedMs = QDateTime::currentMSecsSinceEpoch();
+
+        if (reply->error() == QNetworkReply::NoError) {
+            event.data = reply->readAll();
+            // Decoding a large JPEG is the expensive part; keep it off the GUI thread
+            if (event.image.loadFromData(event.data)) {
+                event.kind = LinkEvent::ImageFetched;
+                event.ok = true;
+            } else {
+                event.kind = LinkEvent::ImageFailed;
+                event.text = "Failed to decode image data";
+                event.data.clear();
+            }
+        } else {
+            event.kind = LinkEvent::ImageFailed;
+            event.text = reply->errorString();
+        }
+
+        reply->deleteLater();
+        post(event);
+    });
+}
+
+void TelescopeLinkWorker::download(const QUrl &url, const QString &localPath)
+{
+    QDir().mkpath(QFileInfo(localPath).absolutePath());
+
+    QFile *file = new QFile(localPath + ".part", this);
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        LinkEvent event;
+        event.kind = LinkEvent::DownloadFinished;
+        event.url = url.toString();
+        event.extra = localPath;
+        event.text = file->errorString();
+        delete file;
+        post(event);
+        return;
+    }
+
+    const QString urlString = url.toString();
+    QNetworkReply *reply = m_networkManager->get(originRequest(url));
+    DownloadState &state = m_downloads[reply];
+    state.file = file;
+    state.localPath = localPath;
+    state.progressClock.start();
+
+    // Stream to disk as data arrives instead of buffering whole TIFFs in memory
+    connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
+        auto it = m_downloads.find(reply);
+        if (it != m_downloads.end()) {
+            it->file->write(reply->readAll());
+        }
+    });
+
+    connect(reply, &QNetworkReply::downloadProgress, this, [this, reply, urlString](qint64 received, qint64 total) {
+        auto it = m_downloads.find(reply);
+        if (it == m_downloads.end() || it->progressClock.elapsed() < PROGRESS_INTERVAL_MS) return;
+        it->progressClock.restart();
+
+        LinkEvent event;
+        event.kind = LinkEvent::DownloadProgress;
+        event.url = urlString;
+        event.bytesReceived = received;
+        event.bytesTotal = total;
+        post(event);
+    });
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply, urlString]() {
+        DownloadState state = m_downloads.take(reply);
+        if (!state.file) return;
+
+        LinkEvent event;
+        event.kind = LinkEvent::DownloadFinished;
+        event.url = urlString;
+        event.extra = state.localPath;
+
+        if (reply->error() == QNetworkReply::NoError) {
+            state.file->write(reply->readAll());
+            state.file->close();
+            QFile::remove(state.localPath);
+            event.ok = state.file->rename(state.localPath);
+            if (!event.ok) event.text = state.file->errorString();
+        } else {
+            state.file->remove();
+            event.text = reply->errorString();
+        }
+
+        delete state.file;
+        reply->deleteLater();
+        post(event);
+    });
+}
+
+void TelescopeLinkWorker::abortDownloads()
+{
+    // abort() leads to finished(), which removes the partial file and the entry
+    const QList<QNetworkReply*> replies = m_downloads.keys();
+    for (QNetworkReply *reply : replies) {
+        reply->abort();
+    }
+}
+
+void TelescopeLinkWorker::post(LinkEvent &event)
+{
+    // Preserve ordering: once anything is in the backlog, everything goes there
+    if (!m_backlog.isEmpty() || !m_channel->queue.push(event)) {
+        m_backlog.enqueue(std::move(event));
+        if (!m_backlogTimer->isActive()) m_backlogTimer->start();
+    }
+
+    if (!m_channel->drainPending.exchange(true)) {
+        emit eventsPending();
+    }
+}
+
+void TelescopeLinkWorker::flushBacklog()
+{
+    while (!m_backlog.isEmpty() && m_channel->queue.push(m_backlog.head())) {
+        m_backlog.dequeue();
+    }
+    if (m_backlog.isEmpty()) {
+        m_backlogTimer->stop();
+    }
+    if (!m_channel->drainPending.exchange(true)) {
+        emit eventsPending();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// TelescopeLink (GUI thread)
+// ---------------------------------------------------------------------------
+
+QThread *TelescopeLink::ioThread()
+{
+    static QThread *thread = nullptr;
+    if (!thread) {
+        thread = new QThread();
+        thread->setObjectName("TelescopeIO");
+        thread->start();
+        QObject::connect(qApp, &QCoreApplication::aboutToQuit, []() {
+            thread->quit();
+            thread->wait();
+        });
+    }
+    return thread;
+}
+
+TelescopeLink::TelescopeLink(QObject *parent)
+    : QObject(parent)
+    , m_channel(std::make_shared<LinkChannel>())
+    , m_worker(new TelescopeLinkWorker(m_channel))
+    , m_port(80)
+    , m_connected(false)
+{
+    m_drainTimer.setSingleShot(true);
+    m_drainTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_drainTimer, &QTimer::timeout, this, &TelescopeLink::drain);
+    m_frameClock.start();
+
+    m_worker->moveToThread(ioThread());
+    connect(m_worker, &TelescopeLinkWorker::eventsPending, this, &TelescopeLink::scheduleDrain,
+            Qt::QueuedConnection);
+
+    TelescopeLinkWorker *worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker]() { worker->initialize(); }, Qt::QueuedConnection);
+}
+
+TelescopeLink::~TelescopeLink()
+{
+    // The worker and its sockets are destroyed on the I/O thread; the
+    // channel stays alive until the worker lets go of it
+    TelescopeLinkWorker *worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker]() {
+        worker->abortDownloads();
+        worker->closeSocket();
+    }, Qt::QueuedConnection);
+    m_worker->deleteLater();
+}
+
+void TelescopeLink::open(const QString &host, int port)
+{
+    m_host = host;
+    m_port = port;
+
+    QUrl url(QString("ws://%1:%2/SmartScope-1.0/mountControlEndpoint").arg(host).arg(port));
+    TelescopeLinkWorker *worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker, url]() { worker->openSocket(url); }, Qt::QueuedConnection);
+}
+
+void TelescopeLink::close()
+{
+    TelescopeLinkWorker *worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker]() { worker->closeSocket(); }, Qt::QueuedConnection);
+}
+
+QUrl TelescopeLink::fileUrl(const QString &relativePath) const
+{
+    QString hostPort = m_port == 80 ? m_host : QString("%1:%2").arg(m_host).arg(m_port);
+    return QUrl(QString("http://%1/SmartScope-1.0/dev2/%2").arg(hostPort, relativePath));
+}
+
+void TelescopeLink::sendText(const QString &message)
+{
+    TelescopeLinkWorker *worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker, message]() { worker->sendText(message); }, Qt::QueuedConnection);
+}
+
+QString TelescopeLink::sendJson(const QJsonObject &obj)
+{
+    QString message = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    sendText(message);
+    return message;
+}
+
+void TelescopeLink::startDiscovery(quint16 port)
+{
+    TelescopeLinkWorker *worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker, port]() { worker->startDiscovery(port); }, Qt::QueuedConnection);
+}
+
+void TelescopeLink::stopDiscovery()
+{
+    TelescopeLinkWorker *worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker]() { worker->stopDiscovery(); }, Qt::QueuedConnection);
+}
+
+void TelescopeLink::fetchImage(const QUrl &url)
+{
+    TelescopeLinkWorker *worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker, url]() { worker->fetchImage(url); }, Qt::QueuedConnection);
+}
+
+void TelescopeLink::download(const QUrl &url, const QString &localPath)
+{
+    TelescopeLinkWorker *worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker, url, localPath]() { worker->download(url, localPath); },
+                              Qt::QueuedConnection);
+}
+
+void TelescopeLink::abortDownloads()
+{
+    TelescopeLinkWorker *worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker]() { worker->abortDownloads(); }, Qt::QueuedConnection);
+}
+
+void TelescopeLink::scheduleDrain()
+{
+    if (m_drainTimer.isActive()) {
+        return;
+    }
+
+    // Align drains to the display frame: if we drained recently, wait for the next one
+    qint64 sinceLast = m_frameClock.elapsed();
+    m_drainTimer.start(sinceLast >= FRAME_MS ? 0 : int(FRAME_MS - sinceLast));
+}
+
+void TelescopeLink::drain()
+{
+    m_frameClock.restart();
+
+    // Clear first so a push racing with this drain schedules another one
+    m_channel->drainPending.store(false);
+
+    LinkEvent event;
+    int dispatched = 0;
+    while (dispatched < MAX_EVENTS_PER_FRAME && m_channel->queue.pop(event)) {
+        dispatched++;
+
+        switch (event.kind) {
+        case LinkEvent::Connected:
+            m_connected = true;
+            emit connected();
+            break;
+        case LinkEvent::Disconnected:
+            m_connected = false;
+            emit disconnected();
+            break;
+        case LinkEvent::Message:
+            emit messageReceived(event.object, event.text, event.receivedMs);
+            break;
+        case LinkEvent::ImageFetched:
+            emit imageFetched(event.url, event.image, event.data);
+            break;
+        case LinkEvent::ImageFailed:
+            emit imageFetchFailed(event.url, event.text);
+            break;
+        case LinkEvent::Datagram:
+            emit datagramReceived(event.text, event.extra);
+            break;
+        case LinkEvent::DiscoveryState:
+            emit discoveryStateChanged(event.ok, event.text);
+            break;
+        case LinkEvent::DownloadProgress:
+            emit downloadProgress(event.url, event.bytesReceived, event.bytesTotal);
+            break;
+        case LinkEvent::DownloadFinished:
+            emit downloadFinished(event.url, event.extra, event.ok, event.text);
+            break;
+        }
+    }
+
+    // Leftovers from a flood go out next frame
+    if (!m_channel->queue.isEmpty()) {
+        m_channel->drainPending.store(true);
+        m_drainTimer.start(FRAME_MS);
+    }
+}
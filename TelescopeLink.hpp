@@ -0,0 +1,227 @@
+#pragma once
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QWebSocket>
+#include <QUdpSocket>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QJsonObject>
+#include <QImage>
+#include <QQueue>
+#include <QHash>
+#include <QFile>
+#include <QUrl>
+#include <atomic>
+#include <memory>
+#include "SpscQueue.hpp"
+
+/**
+ * @brief One decoded network event handed from the I/O thread to the GUI thread
+ */
+struct LinkEvent {
+    enum Kind {
+        Connected,
+        Disconnected,
+        Message,
+        ImageFetched,
+        ImageFailed,
+        Datagram,
+        DiscoveryState,
+        DownloadProgress,
+        DownloadFinished
+    };
+
+    Kind kind = Message;
+    QJsonObject object;        // Message: decoded packet
+    QString text;              // Message: raw text, Datagram: payload, failures: error string
+    QString url;               // Image and download events
+    QString extra;             // Datagram: sender address, DownloadFinished: local path
+    QImage image;              // ImageFetched: decoded image
+    QByteArray data;           // ImageFetched: encoded bytes as received
+    qint64 bytesReceived = 0;
+    qint64 bytesTotal = 0;
+    bool ok = false;
+    qint64 receivedMs = 0;     // Wall-clock receive time on the I/O thread
+};
+
+/**
+ * @brief State shared between a TelescopeLink and its worker
+ */
+struct LinkChannel {
+    SpscQueue<LinkEvent> queue{4096};
+
+    /** Set by the producer when it has asked the GUI to drain, cleared by the consumer */
+    std::atomic<bool> drainPending{false};
+};
+
+/**
+ * @brief Owns the sockets of one TelescopeLink on the shared I/O thread
+ *
+ * All methods run on the I/O thread; they are only ever reached through
+ * queued invocations from TelescopeLink.
+ */
+class TelescopeLinkWorker : public QObject {
+    Q_OBJECT
+
+public:
+    explicit TelescopeLinkWorker(std::shared_ptr<LinkChannel> channel);
+
+    void initialize();
+    void openSocket(const QUrl &url);
+    void closeSocket();
+    void sendText(const QString &message);
+    void startDiscovery(quint16 port);
+    void stopDiscovery();
+    void fetchImage(const QUrl &url);
+    void download(const QUrl &url, const QString &localPath);
+    void abortDownloads();
+
+signals:
+    /** Emitted when the queue goes from drained to non-empty */
+    void eventsPending();
+
+private slots:
+    void onTextMessageReceived(const QString &message);
+    void onPendingDatagrams();
+    void flushBacklog();
+
+private:
+    struct DownloadState {
+        QFile *file = nullptr;
+        QString localPath;
+        QElapsedTimer progressClock;
+    };
+
+    /** @brief Queue an event for the GUI, spilling to the backlog if the ring is full */
+    void post(LinkEvent &event);
+
+    std::shared_ptr<LinkChannel> m_channel;
+    QWebSocket *m_webSocket;
+    QUdpSocket *m_udpSocket;
+    QNetworkAccessManager *m_networkManager;
+    QTimer *m_backlogTimer;
+    QQueue<LinkEvent> m_backlog;
+    QHash<QNetworkReply*, DownloadState> m_downloads;
+};
+
+/**
+ * @brief GUI-thread handle to the telescope's network endpoints
+ *
+ * The WebSocket, the discovery UDP socket and HTTP transfers live on a
+ * single I/O thread shared by all links, where packets are JSON-decoded
+ * and previews are image-decoded. Results come back through a lock-free
+ * SPSC queue that is drained at most once per display frame, so a busy
+ * GUI never delays socket reads and a burst of telemetry costs one wakeup.
+ */
+class TelescopeLink : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor
+     * @param parent The parent QObject
+     */
+    explicit TelescopeLink(QObject *parent = nullptr);
+    ~TelescopeLink();
+
+    /**
+     * @brief Open the mountControlEndpoint WebSocket
+     * @param host The telescope address
+     * @param port The telescope port
+     */
+    void open(const QString &host, int port = 80);
+
+    /** @brief Close the WebSocket */
+    void close();
+
+    /** @brief Whether the GUI has seen the link connect */
+    bool isConnected() const { return m_connected; }
+
+    /** @brief The host passed to open() */
+    QString host() const { return m_host; }
+
+    /** @brief The port passed to open() */
+    int port() const { return m_port; }
+
+    /**
+     * @brief Build the HTTP URL of a file the telescope serves under dev2
+     * @param relativePath Path as reported by the telescope, e.g. "Images/Temp/4.jpg"
+     */
+    QUrl fileUrl(const QString &relativePath) const;
+
+    /**
+     * @brief Send a text frame
+     * @param message The message to send
+     */
+    void sendText(const QString &message);
+
+    /**
+     * @brief Serialize and send a JSON packet
+     * @param obj The packet
+     * @return The serialized text that was queued, for logging
+     */
+    QString sendJson(const QJsonObject &obj);
+
+    /**
+     * @brief Listen for telescope UDP broadcasts
+     * @param port The broadcast port
+     */
+    void startDiscovery(quint16 port = 55555);
+
+    /** @brief Stop listening for broadcasts */
+    void stopDiscovery();
+
+    /**
+     * @brief Fetch and decode an image on the I/O thread
+     * @param url The image URL
+     */
+    void fetchImage(const QUrl &url);
+
+    /**
+     * @brief Stream a file to disk on the I/O thread
+     * @param url The file URL
+     * @param localPath Destination path; written as .part and renamed on success
+     */
+    void download(const QUrl &url, const QString &localPath);
+
+    /** @brief Abort all downloads started with download() */
+    void abortDownloads();
+
+    /** @brief The I/O thread shared by every link */
+    static QThread *ioThread();
+
+signals:
+    void connected();
+    void disconnected();
+
+    /**
+     * @brief A packet was received
+     * @param obj The decoded packet (empty if the text was not a JSON object)
+     * @param text The raw text
+     * @param receivedMs Wall-clock receive time in ms since epoch
+     */
+    void messageReceived(const QJsonObject &obj, const QString &text, qint64 receivedMs);
+
+    void imageFetched(const QString &url, const QImage &image, const QByteArray &data);
+    void imageFetchFailed(const QString &url, const QString &error);
+    void datagramReceived(const QString &text, const QString &sender);
+    void discoveryStateChanged(bool listening, const QString &error);
+    void downloadProgress(const QString &url, qint64 bytesReceived, qint64 bytesTotal);
+    void downloadFinished(const QString &url, const QString &localPath, bool success, const QString &error);
+
+private slots:
+    void scheduleDrain();
+    void drain();
+
+private:
+    std::shared_ptr<LinkChannel> m_channel;
+    TelescopeLinkWorker *m_worker;
+    QTimer m_drainTimer;
+    QElapsedTimer m_frameClock;
+    QString m_host;
+    int m_port;
+    bool m_connected;
+};
@@ -0,0 +1,329 @@
+#include "WebSocketLogIndex.hpp"
+#include "ParallelFor.hpp"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QThread>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    // Chunks parsed in parallel; small enough to balance, large enough that merging is cheap
+    const qint64 CHUNK_SIZE = 8 * 1024 * 1024;
+
+    const char *const KEYS[WebSocketLogIndex::FieldCount] = {"\"Source\"", "\"Command\"", "\"Type\""};
+
+    const int KEY_LENGTHS[WebSocketLogIndex::FieldCount] = {8, 9, 6};
+
+    // Days since 1970-01-01 of a civil date
+    qint64 daysFromCivil(int y, int m, int d)
+    {
+        y -= m <= 2;
+        const int era = (y >= 0 ? y : y - 399) / 400;
+        const int yoe = y - era * 400;
+        const int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return qint64(era) * 146097 + doe - 719468;
+    }
+
+    bool digits(const char *p, int count, int &value)
+    {
+        value = 0;
+        for (int i = 0; i < count; i++) {
+            if (p[i] < '0' || p[i] > '9') return false;
+            value = value * 10 + (p[i] - '0');
+        }
+        return true;
+    }
+
+    // "[yyyy-MM-dd hh:mm:ss.zzz]" at the start of a line
+    bool parseTimestamp(const char *p, const char *end, qint64 &ms)
+    {
+        if (end - p < 25 || p[0] != '[' || p[24] != ']') return false;
+        int year, month, day, hour, minute, second, milli;
+        if (!digits(p + 1, 4, year) || !digits(p + 6, 2, month) || !digits(p + 9, 2, day)
+            || !digits(p + 12, 2, hour) || !digits(p + 15, 2, minute) || !digits(p + 18, 2, second)
+            || !digits(p + 21, 3, milli)) {
+            return false;
+        }
+        ms = ((daysFromCivil(year, month, day) * 24 + hour) * 60 + minute) * 60000LL + second * 1000LL + milli;
+        return true;
+    }
+
+    quint8 parseDirection(const char *p, const char *end)
+    {
+        auto is = [&](const char *word) {
+            size_t n = std::strlen(word);
+            return size_t(end - p) > n && std::memcmp(p, word, n) == 0 && p[n] == ':';
+        };
+        if (is("RECV")) return WebSocketLogIndex::Receive;
+        if (is("SEND")) return WebSocketLogIndex::Send;
+        if (is("SYSTEM")) return WebSocketLogIndex::System;
+        return WebSocketLogIndex::Other;
+    }
+
+    // Value ranges of the indexed fields, in one pass over the quotes of a line
+    void fieldValues(const char *p, const char *end, const char *value[], int length[])
+    {
+        int found = 0;
+        while (found < WebSocketLogIndex::FieldCount) {
+            p = static_cast<const char*>(std::memchr(p, '"', end - p));
+            if (!p) return;
+
+            int f = 0;
+            while (f < WebSocketLogIndex::FieldCount
+                   && (value[f] || end - p <= KEY_LENGTHS[f] || std::memcmp(p, KEYS[f], KEY_LENGTHS[f]) != 0)) {
+                f++;
+            }
+            if (f == WebSocketLogIndex::FieldCount) {
+                p++;
+                continue;
+            }
+
+            p += KEY_LENGTHS[f];
+            while (p < end && (*p == ' ' || *p == ':')) p++;
+            if (p >= end || *p != '"') continue;
+            const char *close = static_cast<const char*>(std::memchr(p + 1, '"', end - p - 1));
+            if (!close) return;
+            value[f] = p + 1;
+            length[f] = int(close - value[f]);
+            found++;
+            p = close + 1;
+        }
+    }
+
+    // What one chunk contributes; field ids are local to the chunk until merged
+    struct Chunk {
+        qint64 begin = 0;
+        qint64 end = 0;
+        QVector<WebSocketLogIndex::Line> lines;
+        QList<QByteArray> values[WebSocketLogIndex::FieldCount];
+    };
+
+    void parseChunk(const char *data, Chunk &chunk)
+    {
+        QHash<QByteArray, quint16> ids[WebSocketLogIndex::FieldCount];
+
+        qint64 lastTime = 0;
+        const char *p = data + chunk.begin;
+        const char *chunkEnd = data + chunk.end;
+        while (p < chunkEnd) {
+            const char *newline = static_cast<const char*>(std::memchr(p, '\n', chunkEnd - p));
+            const char *end = newline ? newline : chunkEnd;
+
+            WebSocketLogIndex::Line line;
+            line.offset = p - data;
+            line.timeMs = lastTime;
+            line.direction = WebSocketLogIndex::Other;
+            const char *body = p;
+            if (parseTimestamp(p, end, line.timeMs)) {
+                lastTime = line.timeMs;
+                body = p + 26;
+                line.direction = parseDirection(body, end);
+            }
+
+            const char *value[WebSocketLogIndex::FieldCount] = {};
+            int length[WebSocketLogIndex::FieldCount] = {};
+            fieldValues(body, end, value, length);
+            for (int f = 0; f < WebSocketLogIndex::FieldCount; f++) {
+                line.field[f] = 0;
+                if (!value[f]) continue;
+
+                // Look up without copying; only a new value is copied into the table
+                QByteArray key = QByteArray::fromRawData(value[f], length[f]);
+                auto it = ids[f].constFind(key);
+                if (it == ids[f].constEnd()) {
+                    chunk.values[f].append(QByteArray(value[f], length[f]));
+                    it = ids[f].insert(chunk.values[f].last(), quint16(chunk.values[f].size()));
+                }
+                line.field[f] = it.value();
+            }
+
+            chunk.lines.append(line);
+            p = end + 1;
+        }
+    }
+}
+
+bool WebSocketLogIndex::open(const QString &path)
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open log:" << path << m_file.errorString();
+        return false;
+    }
+
+    m_size = m_file.size();
+    if (m_size > 0) {
+        m_data = reinterpret_cast<const char*>(m_file.map(0, m_size));
+        if (!m_data) {
+            qWarning() << "Failed to map log:" << path << m_file.errorString();
+            return false;
+        }
+    }
+    return true;
+}
+
+void WebSocketLogIndex::build()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    m_lines.clear();
+    for (int f = 0; f < FieldCount; f++) m_values[f] = QStringList(QString());
+    for (auto &postings : m_postings) postings = QVector<QVector<int>>(1);
+    if (!m_data) return;
+
+    // Chunk boundaries just after a newline, so no line straddles two chunks
+    QVector<Chunk> chunks;
+    for (qint64 begin = 0; begin < m_size; ) {
+        qint64 end = qMin(m_size, begin + CHUNK_SIZE);
+        if (end < m_size) {
+            const char *newline = static_cast<const char*>(std::memchr(m_data + end, '\n', m_size - end));
+            end = newline ? newline - m_data + 1 : m_size;
+        }
+        Chunk chunk;
+        chunk.begin = begin;
+        chunk.end = end;
+        chunks.append(chunk);
+        begin = end;
+    }
+
+    parallelFor(chunks.size(), [&](int begin, int end) {
+        for (int c = begin; c < end; c++) parseChunk(m_data, chunks[c]);
+    }, 1);
+
+    // Merge in file order, renumbering each chunk's field ids into the global tables
+    qsizetype total = 0;
+    for (const Chunk &chunk : chunks) total += chunk.lines.size();
+    m_lines.reserve(total);
+
+    QHash<QByteArray, quint16> ids[FieldCount];
+    qint64 lastTime = 0;
+    for (Chunk &chunk : chunks) {
+        QVector<quint16> remap[FieldCount];
+        for (int f = 0; f < FieldCount; f++) {
+            remap[f].append(0);
+            for (const QByteArray &value : chunk.values[f]) {
+                auto it = ids[f].constFind(value);
+                if (it == ids[f].constEnd()) {
+                    m_values[f].append(QString::fromUtf8(value));
+                    it = ids[f].insert(value, quint16(m_values[f].size() - 1));
+                    if (f < Type) m_postings[f].append(QVector<int>());
+                }
+                remap[f].append(it.value());
+            }
+        }
+
+        for (Line line : chunk.lines) {
+            // A chunk starting with untimed lines does not know the previous time
+            if (!line.timeMs) line.timeMs = lastTime;
+            lastTime = line.timeMs;
+            for (int f = 0; f < FieldCount; f++) line.field[f] = remap[f][line.field[f]];
+
+            const int number = m_lines.size();
+            for (int f = 0; f < Type; f++) {
+                if (line.field[f]) m_postings[f][line.field[f]].append(number);
+            }
+            m_lines.append(line);
+        }
+        chunk.lines = QVector<Line>();
+    }
+
+    qDebug() << "Indexed" << m_lines.size() << "lines of" << m_file.fileName() << "in" << timer.elapsed() << "ms";
+}
+
+void WebSocketLogIndex::lineRange(int line, const char *&begin, const char *&end) const
+{
+    begin = m_data + m_lines[line].offset;
+    end = line + 1 < m_lines.size() ? m_data + m_lines[line + 1].offset - 1 : m_data + m_size;
+    if (end > begin && end[-1] == '\n') end--;
+    if (end > begin && end[-1] == '\r') end--;
+}
+
+QString WebSocketLogIndex::lineText(int line, int maxLength) const
+{
+    if (line < 0 || line >= m_lines.size()) return QString();
+    const char *begin;
+    const char *end;
+    lineRange(line, begin, end);
+    if (maxLength >= 0 && end - begin > maxLength) {
+        return QString::fromUtf8(begin, maxLength) + QChar(0x2026);
+    }
+    return QString::fromUtf8(begin, end - begin);
+}
+
+QVector<int> WebSocketLogIndex::find(const Filter &filter) const
+{
+    quint16 wanted[FieldCount] = {};
+    for (int f = 0; f < FieldCount; f++) {
+        if (filter.values[f].isEmpty()) continue;
+        int id = m_values[f].indexOf(filter.values[f]);
+        if (id <= 0) return QVector<int>();
+        wanted[f] = quint16(id);
+    }
+
+    // Candidates: the shorter posting list of the indexed fields, else every line
+    const QVector<int> *postings = nullptr;
+    for (int f = 0; f < Type; f++) {
+        if (wanted[f] && (!postings || m_postings[f][wanted[f]].size() < postings->size())) {
+            postings = &m_postings[f][wanted[f]];
+        }
+    }
+    const int candidateCount = postings ? postings->size() : m_lines.size();
+    auto candidate = [&](int i) { return postings ? (*postings)[i] : i; };
+
+    // Lines are in time order, so both bounds are binary searches
+    int first = 0;
+    int last = candidateCount;
+    if (filter.fromMs > 0) {
+        int lo = 0, hi = candidateCount;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (m_lines[candidate(mid)].timeMs < filter.fromMs) lo = mid + 1; else hi = mid;
+        }
+        first = lo;
+    }
+    if (filter.toMs > 0) {
+        int lo = first, hi = candidateCount;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (m_lines[candidate(mid)].timeMs < filter.toMs) lo = mid + 1; else hi = mid;
+        }
+        last = lo;
+    }
+    if (first >= last) return QVector<int>();
+
+    const bool usePattern = filter.pattern.isValid() && !filter.pattern.pattern().isEmpty();
+    if (usePattern) filter.pattern.optimize();
+
+    // Bands keep their matches apart and are concatenated in order afterwards
+    const int count = last - first;
+    const int grain = qMax(4096, count / (QThread::idealThreadCount() * 4));
+    const int bands = (count + grain - 1) / grain;
+    QVector<QVector<int>> found(bands);
+    parallelFor(bands, [&](int begin, int end) {
+        for (int band = begin; band < end; band++) {
+            const int stop = qMin(last, first + (band + 1) * grain);
+            for (int i = first + band * grain; i < stop; i++) {
+                const int number = candidate(i);
+                const Line &line = m_lines[number];
+                bool match = true;
+                for (int f = 0; f < FieldCount && match; f++) {
+                    if (wanted[f] && line.field[f] != wanted[f]) match = false;
+                }
+                if (!match || (filter.direction >= 0 && line.direction != filter.direction)) continue;
+                if (usePattern) {
+                    const char *from;
+                    const char *to;
+                    lineRange(number, from, to);
+                    if (!filter.pattern.match(QString::fromUtf8(from, to - from)).hasMatch()) continue;
+                }
+                found[band].append(number);
+            }
+        }
+    }, 1);
+
+    QVector<int> result;
+    for (const QVector<int> &band : found) result += band;
+    return result;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief Line and field index over a websocket_log_*.txt file
+ *
+ * The file is memory-mapped, never read into memory. build() makes one
+ * pass over the mapping, split into chunks parsed in parallel, and records
+ * for every line its offset, timestamp, direction and the Source, Command
+ * and Type of its JSON message; Source and Command also get a posting
+ * list of the lines carrying each value. Lines are written in time order,
+ * so a time bound is a binary search, and a query such as "Focuser
+ * responses after 02:00" only visits the Focuser lines past that point.
+ *
+ * Lines have the form written by OriginBackend::logWebSocketMessage:
+ * "[yyyy-MM-dd hh:mm:ss.zzz] RECV: {...}". Times are the wall-clock time
+ * as written, kept as ms since epoch as if it were UTC.
+ *
+ * open() and build() are called once, build() possibly on another thread;
+ * after that the index is read-only and safe to query from any thread.
+ */
+class WebSocketLogIndex
+{
+public:
+    enum Direction : quint8 {
+        Other,
+        Send,
+        Receive,
+        System
+    };
+
+    enum Field {
+        Source,
+        Command,
+        Type,
+        FieldCount
+    };
+
+    /** @brief Index entry of one line; field ids index values(), 0 when absent */
+    struct Line {
+        qint64 offset;
+        qint64 timeMs;
+        quint16 field[FieldCount];
+        quint8 direction;
+    };
+
+    /** @brief A query; empty or negative members match anything */
+    struct Filter {
+        QString values[FieldCount];
+        int direction = -1;
+        qint64 fromMs = 0;
+        qint64 toMs = 0;
+        /** Matched against the whole line */
+        QRegularExpression pattern;
+    };
+
+    /**
+     * @brief Map a log file
+     * @return False if the file cannot be opened or mapped
+     */
+    bool open(const QString &path);
+
+    /** @brief Index the mapped file; takes a fraction of a second per GB on a multicore machine */
+    void build();
+
+    QString path() const { return m_file.fileName(); }
+    qint64 size() const { return m_size; }
+    int lineCount() const { return m_lines.size(); }
+
+    /** @brief Time of a line in ms (wall clock as written, see class comment) */
+    qint64 lineTime(int line) const { return m_lines[line].timeMs; }
+    Direction lineDirection(int line) const { return Direction(m_lines[line].direction); }
+
+    /**
+     * @brief Text of a line
+     * @param maxLength Longer lines are cut short, for display
+     */
+    QString lineText(int line, int maxLength = -1) const;
+
+    /** @brief Values seen for a field, in order of first appearance; entry 0 is the empty "absent" value */
+    const QStringList &values(Field field) const { return m_values[field]; }
+
+    /**
+     * @brief Lines matching a filter, in file order
+     *
+     * The field index and time bounds narrow the candidates first; the
+     * pattern, the most expensive test, is only run on what is left, in
+     * parallel.
+     */
+    QVector<int> find(const Filter &filter) const;
+
+private:
+    /** @brief Byte range of a line, without its line ending */
+    void lineRange(int line, const char *&begin, const char *&end) const;
+
+    QFile m_file;
+    const char *m_data = nullptr;
+    qint64 m_size = 0;
+
+    QVector<Line> m_lines;
+    /** Value 0 of every field is "absent" */
+    QStringList m_values[FieldCount];
+    /** Lines carrying each value, for Source and Command */
+    QVector<QVector<int>> m_postings[2];
+};
@@ -0,0 +1,285 @@
+#include "WebSocketLogViewer.hpp"
+#include <QAbstractListModel>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QFontDatabase>
+#include <QGridLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListView>
+#include <QMessageBox>
+#include <QPointer>
+#include <QPushButton>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QTimeEdit>
+#include <QVBoxLayout>
+
+namespace {
+    // Log lines can be many kB of JSON; the list shows the start, the tooltip a little more
+    const int DISPLAY_LENGTH = 400;
+    const int TOOLTIP_LENGTH = 4000;
+    const qint64 DAY_MS = 24 * 3600 * 1000LL;
+
+    QString timeOfDay(qint64 ms)
+    {
+        return QTime::fromMSecsSinceStartOfDay(int(ms % DAY_MS)).toString("HH:mm:ss");
+    }
+}
+
+/**
+ * @brief Rows of a log index, all lines or a filtered subset
+ *
+ * Text is produced per visible row on demand, so the model costs nothing
+ * per line beyond the filter result itself.
+ */
+class WebSocketLogModel : public QAbstractListModel
+{
+public:
+    explicit WebSocketLogModel(QObject *parent)
+        : QAbstractListModel(parent)
+    {
+    }
+
+    /** @brief Show every line of an index */
+    void showAll(const std::shared_ptr<WebSocketLogIndex> &index)
+    {
+        beginResetModel();
+        m_index = index;
+        m_lines.clear();
+        m_filtered = false;
+        endResetModel();
+    }
+
+    /** @brief Show some lines of the current index */
+    void showLines(const QVector<int> &lines)
+    {
+        beginResetModel();
+        m_lines = lines;
+        m_filtered = true;
+        endResetModel();
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        if (parent.isValid() || !m_index) return 0;
+        return m_filtered ? m_lines.size() : m_index->lineCount();
+    }
+
+    QVariant data(const QModelIndex &index, int role) const override
+    {
+        if (!index.isValid() || !m_index) return QVariant();
+        int line = m_filtered ? m_lines[index.row()] : index.row();
+        if (role == Qt::DisplayRole) return m_index->lineText(line, DISPLAY_LENGTH);
+        if (role == Qt::ToolTipRole) return m_index->lineText(line, TOOLTIP_LENGTH);
+        return QVariant();
+    }
+
+private:
+    std::shared_ptr<WebSocketLogIndex> m_index;
+    QVector<int> m_lines;
+    bool m_filtered = false;
+};
+
+WebSocketLogViewer::WebSocketLogViewer(QWidget *parent)
+    : QWidget(parent)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    QHBoxLayout *fileLayout = new QHBoxLayout();
+    m_openButton = new QPushButton("Open Log...", this);
+    fileLayout->addWidget(m_openButton);
+    m_fileLabel = new QLabel("No log open", this);
+    fileLayout->addWidget(m_fileLabel, 1);
+    layout->addLayout(fileLayout);
+
+    QGridLayout *filterLayout = new QGridLayout();
+    const char *fieldNames[WebSocketLogIndex::FieldCount] = {"Source:", "Command:", "Type:"};
+    for (int f = 0; f < WebSocketLogIndex::FieldCount; f++) {
+        filterLayout->addWidget(new QLabel(fieldNames[f], this), 0, 2 * f);
+        m_fieldBoxes[f] = new QComboBox(this);
+        m_fieldBoxes[f]->addItem("Any");
+        filterLayout->addWidget(m_fieldBoxes[f], 0, 2 * f + 1);
+    }
+
+    filterLayout->addWidget(new QLabel("Direction:", this), 1, 0);
+    m_directionBox = new QComboBox(this);
+    m_directionBox->addItem("Any", -1);
+    m_directionBox->addItem("SEND", WebSocketLogIndex::Send);
+    m_directionBox->addItem("RECV", WebSocketLogIndex::Receive);
+    m_directionBox->addItem("SYSTEM", WebSocketLogIndex::System);
+    filterLayout->addWidget(m_directionBox, 1, 1);
+
+    m_afterCheckBox = new QCheckBox("After:", this);
+    filterLayout->addWidget(m_afterCheckBox, 1, 2);
+    m_afterEdit = new QTimeEdit(QTime(0, 0), this);
+    m_afterEdit->setDisplayFormat("HH:mm:ss");
+    m_afterEdit->setToolTip("The first time the clock reads this after the log starts");
+    filterLayout->addWidget(m_afterEdit, 1, 3);
+
+    filterLayout->addWidget(new QLabel("Pattern:", this), 1, 4);
+    m_patternEdit = new QLineEdit(this);
+    m_patternEdit->setPlaceholderText("Regular expression");
+    filterLayout->addWidget(m_patternEdit, 1, 5);
+
+    m_filterButton = new QPushButton("Filter", this);
+    filterLayout->addWidget(m_filterButton, 1, 6);
+    layout->addLayout(filterLayout);
+
+    m_statusLabel = new QLabel(this);
+    layout->addWidget(m_statusLabel);
+
+    m_model = new WebSocketLogModel(this);
+    m_view = new QListView(this);
+    m_view->setModel(m_model);
+    // Every row the same height lets the view skip measuring millions of rows
+    m_view->setUniformItemSizes(true);
+    m_view->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    m_view->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    layout->addWidget(m_view, 1);
+
+    connect(m_openButton, &QPushButton::clicked, this, &WebSocketLogViewer::chooseLog);
+    connect(m_filterButton, &QPushButton::clicked, this, &WebSocketLogViewer::applyFilter);
+    connect(m_patternEdit, &QLineEdit::returnPressed, this, &WebSocketLogViewer::applyFilter);
+    m_filterButton->setEnabled(false);
+}
+
+QString WebSocketLogViewer::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/CelestronOriginLogs";
+}
+
+void WebSocketLogViewer::chooseLog()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, "Open WebSocket Log", defaultDirectory(),
+                                                    "WebSocket logs (websocket_log_*.txt);;All files (*)");
+    if (!fileName.isEmpty()) {
+        openLog(fileName);
+    }
+}
+
+bool WebSocketLogViewer::openLog(const QString &path)
+{
+    auto index = std::make_shared<WebSocketLogIndex>();
+    if (!index->open(path)) {
+        QMessageBox::warning(this, "Error", "Could not open " + path);
+        return false;
+    }
+
+    m_index.reset();
+    m_model->showAll(nullptr);
+    m_filterButton->setEnabled(false);
+    m_fileLabel->setText(QFileInfo(path).fileName());
+    m_statusLabel->setText(QString("Indexing %1 MB...").arg(index->size() / (1024 * 1024)));
+
+    // The result comes back through the application object so a viewer
+    // destroyed meanwhile is simply skipped
+    int generation = ++m_generation;
+    QPointer<WebSocketLogViewer> self(this);
+    QThreadPool::globalInstance()->start([self, index, generation]() {
+        QElapsedTimer timer;
+        timer.start();
+        index->build();
+        qint64 elapsed = timer.elapsed();
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, index, generation, elapsed]() {
+            if (self && self->m_generation == generation) {
+                self->onIndexBuilt(index);
+                self->m_statusLabel->setText(QString("%1 lines, indexed in %2 ms")
+                                             .arg(index->lineCount()).arg(elapsed));
+            }
+        }, Qt::QueuedConnection);
+    });
+    return true;
+}
+
+void WebSocketLogViewer::onIndexBuilt(const std::shared_ptr<WebSocketLogIndex> &index)
+{
+    m_index = index;
+    for (int f = 0; f < WebSocketLogIndex::FieldCount; f++) {
+        fillCombo(m_fieldBoxes[f], WebSocketLogIndex::Field(f));
+    }
+    if (index->lineCount() > 0) {
+        m_fileLabel->setText(QString("%1 (%2 - %3)").arg(QFileInfo(index->path()).fileName(),
+                                                         timeOfDay(index->lineTime(0)),
+                                                         timeOfDay(index->lineTime(index->lineCount() - 1))));
+    }
+    m_model->showAll(index);
+    m_filterButton->setEnabled(true);
+}
+
+void WebSocketLogViewer::fillCombo(QComboBox *combo, WebSocketLogIndex::Field field)
+{
+    QStringList values = m_index->values(field).mid(1);
+    values.sort(Qt::CaseInsensitive);
+
+    combo->clear();
+    combo->addItem("Any");
+    combo->addItems(values);
+}
+
+void WebSocketLogViewer::applyFilter()
+{
+    if (!m_index) return;
+
+    WebSocketLogIndex::Filter filter;
+    for (int f = 0; f < WebSocketLogIndex::FieldCount; f++) {
+        if (m_fieldBoxes[f]->currentIndex() > 0) filter.values[f] = m_fieldBoxes[f]->currentText();
+    }
+    filter.direction = m_directionBox->currentData().toInt();
+
+    if (m_afterCheckBox->isChecked() && m_index->lineCount() > 0) {
+        // The next time the clock shows this after the log starts; a night's log crosses midnight
+        qint64 start = m_index->lineTime(0);
+        filter.fromMs = start - start % DAY_MS + m_afterEdit->time().msecsSinceStartOfDay();
+        if (filter.fromMs < start) filter.fromMs += DAY_MS;
+    }
+
+    if (!m_patternEdit->text().isEmpty()) {
+        filter.pattern = QRegularExpression(m_patternEdit->text());
+        if (!filter.pattern.isValid()) {
+            m_statusLabel->setText("Invalid pattern: " + filter.pattern.errorString());
+            return;
+        }
+    }
+
+    bool unfiltered = filter.direction < 0 && filter.fromMs == 0 && filter.pattern.pattern().isEmpty()
+                      && filter.values[0].isEmpty() && filter.values[1].isEmpty() && filter.values[2].isEmpty();
+    if (unfiltered) {
+        ++m_generation;
+        m_model->showAll(m_index);
+        m_statusLabel->setText(QString("%1 lines").arg(m_index->lineCount()));
+        return;
+    }
+
+    m_statusLabel->setText("Filtering...");
+    int generation = ++m_generation;
+    QPointer<WebSocketLogViewer> self(this);
+    std::shared_ptr<WebSocketLogIndex> index = m_index;
+    QThreadPool::globalInstance()->start([self, index, filter, generation]() {
+        QElapsedTimer timer;
+        timer.start();
+        QVector<int> lines = index->find(filter);
+        qint64 elapsed = timer.elapsed();
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, lines, generation, elapsed]() {
+            if (self && self->m_generation == generation) {
+                self->onFiltered(lines, elapsed);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void WebSocketLogViewer::onFiltered(const QVector<int> &lines, qint64 elapsedMs)
+{
+    m_model->showLines(lines);
+    m_statusLabel->setText(QString("%1 of %2 lines, filtered in %3 ms")
+                           .arg(lines.size()).arg(m_index->lineCount()).arg(elapsedMs));
+    if (!lines.isEmpty()) {
+        m_view->scrollToTop();
+    }
+}
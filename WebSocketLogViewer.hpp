@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QWidget>
+#include <memory>
+#include "WebSocketLogIndex.hpp"
+
+class QCheckBox;
+class QComboBox;
+class QLabel;
+class QLineEdit;
+class QListView;
+class QPushButton;
+class QTimeEdit;
+class WebSocketLogModel;
+
+/**
+ * @brief Viewer for the websocket_log_*.txt files written by OriginBackend
+ *
+ * The log is memory-mapped and indexed on the thread pool (see
+ * WebSocketLogIndex), so a night's log of hundreds of MB opens without
+ * blocking the GUI. The list is virtual: only the rows on screen are ever
+ * turned into text. Filters on Source, Command, Type, direction, a start
+ * time and a regular expression run on the thread pool as well.
+ */
+class WebSocketLogViewer : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit WebSocketLogViewer(QWidget *parent = nullptr);
+
+    /** @brief Directory OriginBackend writes its logs to */
+    static QString defaultDirectory();
+
+    /**
+     * @brief Open and index a log
+     * @return False if the file cannot be opened
+     */
+    bool openLog(const QString &path);
+
+private slots:
+    void chooseLog();
+    void applyFilter();
+
+private:
+    void onIndexBuilt(const std::shared_ptr<WebSocketLogIndex> &index);
+    void onFiltered(const QVector<int> &lines, qint64 elapsedMs);
+    void fillCombo(QComboBox *combo, WebSocketLogIndex::Field field);
+
+    std::shared_ptr<WebSocketLogIndex> m_index;
+    /** Bumped for every open and filter, so late results of superseded work are dropped */
+    int m_generation = 0;
+
+    WebSocketLogModel *m_model;
+    QPushButton *m_openButton;
+    QLabel *m_fileLabel;
+    QComboBox *m_fieldBoxes[WebSocketLogIndex::FieldCount];
+    QComboBox *m_directionBox;
+    QCheckBox *m_afterCheckBox;
+    QTimeEdit *m_afterEdit;
+    QLineEdit *m_patternEdit;
+    QPushButton *m_filterButton;
+    QLabel *m_statusLabel;
+    QListView *m_view;
+};
@@ -0,0 +1,256 @@
+/*
+ * origin_telemetry_shm.h - live Origin telemetry in POSIX shared memory
+ *
+ * The monitor (and the Alpaca server) publish their latest telemetry
+ * snapshot into the shared-memory object ORIGIN_TELEMETRY_SHM_NAME. Local
+ * guiding and sequencing tools can map it read-only and read position,
+ * tracking and environment data at any rate: a read is a memcpy, with no
+ * system call and no load on the monitor or the telescope.
+ *
+ * Consistency is by a sequence lock. The writer makes `sequence` odd,
+ * updates the snapshot and makes it even again; a reader copies the
+ * snapshot and retries if `sequence` was odd or changed meanwhile.
+ * origin_telemetry_read() does exactly that. The writer never waits for
+ * readers, so a reader that is slow or crashes cannot stall it.
+ *
+ * Layout rules: fields are only ever appended to origin_telemetry_snapshot,
+ * and `size` says how much of it the writer fills, so a reader built
+ * against an older header keeps working. `version` changes only if
+ * existing fields move or change meaning. `magic` is cleared when the
+ * publisher exits; `writer_pid` identifies it while it runs, and a second
+ * publisher leaves the segment alone while that process is alive.
+ *
+ * Units follow the telescope: angles in radians except where the field
+ * name says otherwise, temperatures in degrees C, times in ms since the
+ * Unix epoch. Each group has its own update time; 0 means never received.
+ * Booleans are int32_t 0/1. Strings are UTF-8 and always NUL terminated.
+ *
+ * Example:
+ *
+ *     origin_telemetry_shm *shm = origin_telemetry_open(ORIGIN_TELEMETRY_SHM_NAME);
+ *     origin_telemetry_snapshot snap;
+ *     if (shm && origin_telemetry_read(shm, &snap, 1000))
+ *         printf("tracking %d, ambient %.1f C\n", snap.mount.is_tracking,
+ *                snap.environment.ambient_temperature);
+ *
+ * Plain C99 plus POSIX; compiles as C++ too. Uses GCC/Clang atomic builtins.
+ */
+#ifndef ORIGIN_TELEMETRY_SHM_H
+#define ORIGIN_TELEMETRY_SHM_H
+
+#include <stdint.h>
+#include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#define ORIGIN_TELEMETRY_POSIX 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORIGIN_TELEMETRY_SHM_NAME "/origin_telemetry"
+#define ORIGIN_TELEMETRY_MAGIC 0x4c45544fu  /* "OTEL" little endian */
+#define ORIGIN_TELEMETRY_VERSION 1u
+
+typedef struct origin_telemetry_mount {
+    int64_t updated_ms;
+    double latitude;
+    double longitude;
+    double enc0;
+    double enc1;
+    double battery_voltage;
+    int32_t is_aligned;
+    int32_t is_goto_over;
+    int32_t is_tracking;
+    int32_t num_align_refs;
+    char battery_level[16];
+    char charger_status[16];
+    char date[16];
+    char time[16];
+    char time_zone[64];
+} origin_telemetry_mount;
+
+typedef struct origin_telemetry_camera {
+    int64_t updated_ms;
+    double exposure;           /* seconds */
+    double color_r_balance;
+    double color_g_balance;
+    double color_b_balance;
+    int32_t binning;
+    int32_t bit_depth;
+    int32_t iso;
+    int32_t offset;
+} origin_telemetry_camera;
+
+typedef struct origin_telemetry_focuser {
+    int64_t updated_ms;
+    double velocity;
+    int32_t position;
+    int32_t backlash;
+    int32_t calibration_lower_limit;
+    int32_t calibration_upper_limit;
+    int32_t percentage_calibration_complete;
+    int32_t is_calibration_complete;
+    int32_t is_move_to_over;
+    int32_t need_auto_focus;
+    int32_t requires_calibration;
+    int32_t reserved;
+} origin_telemetry_focuser;
+
+typedef struct origin_telemetry_environment {
+    int64_t updated_ms;
+    double ambient_temperature;
+    double camera_temperature;
+    double cpu_temperature;
+    double front_cell_temperature;
+    double dew_point;
+    double humidity;           /* percent */
+    int32_t cpu_fan_on;
+    int32_t ota_fan_on;
+    int32_t recalibrating;
+    int32_t reserved;
+} origin_telemetry_environment;
+
+typedef struct origin_telemetry_image {
+    int64_t updated_ms;
+    double ra;
+    double dec;
+    double orientation;
+    double fov_x;
+    double fov_y;
+    char file_location[256];
+    char image_type[32];
+} origin_telemetry_image;
+
+typedef struct origin_telemetry_disk {
+    int64_t updated_ms;
+    int64_t capacity;          /* bytes */
+    int64_t free_bytes;
+    int64_t seconds_to_full;   /* -1 while not filling */
+    double fill_rate;          /* bytes per second */
+    char level[16];
+} origin_telemetry_disk;
+
+typedef struct origin_telemetry_dew_heater {
+    int64_t updated_ms;
+    double heater_level;
+    double manual_power_level;
+    int32_t aggression;
+    int32_t reserved;
+    char mode[32];
+} origin_telemetry_dew_heater;
+
+typedef struct origin_telemetry_orientation {
+    int64_t updated_ms;
+    int32_t altitude;
+    int32_t reserved;
+} origin_telemetry_orientation;
+
+/* The Alpaca backend's summary of the mount, when one is running */
+typedef struct origin_telemetry_status {
+    int64_t updated_ms;
+    double alt_degrees;
+    double az_degrees;
+    double ra_hours;
+    double dec_degrees;
+    double temperature;
+    int32_t is_connected;
+    int32_t is_slewing;
+    int32_t is_tracking;
+    int32_t is_parked;
+    int32_t is_aligned;
+    int32_t reserved;
+    char current_operation[32];
+} origin_telemetry_status;
+
+typedef struct origin_telemetry_snapshot {
+    int64_t published_ms;
+    origin_telemetry_mount mount;
+    origin_telemetry_camera camera;
+    origin_telemetry_focuser focuser;
+    origin_telemetry_environment environment;
+    origin_telemetry_image image;
+    origin_telemetry_disk disk;
+    origin_telemetry_dew_heater dew_heater;
+    origin_telemetry_orientation orientation;
+    origin_telemetry_status status;
+} origin_telemetry_snapshot;
+
+typedef struct origin_telemetry_shm {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;             /* bytes of snapshot the writer fills */
+    uint32_t sequence;         /* odd while the writer is updating */
+    int64_t writer_pid;
+    origin_telemetry_snapshot snapshot;
+} origin_telemetry_shm;
+
+#ifdef ORIGIN_TELEMETRY_POSIX
+
+/**
+ * Copy a consistent snapshot, trying up to max_tries times.
+ * Returns 1 on success, 0 if every try overlapped a write (or the
+ * publisher has gone).
+ */
+static inline int origin_telemetry_read(const origin_telemetry_shm *shm, origin_telemetry_snapshot *out, int max_tries)
+{
+    size_t size = sizeof(*out);
+    int i;
+    for (i = 0; i < max_tries; i++) {
+        uint32_t before = __atomic_load_n(&shm->sequence, __ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&shm->magic, __ATOMIC_RELAXED) != ORIGIN_TELEMETRY_MAGIC) {
+            return 0;
+        }
+        if (before & 1u) {
+            continue;
+        }
+        if (shm->size < size) {
+            /* Older writer: fields it does not know about read as zero */
+            memset(out, 0, size);
+            size = shm->size;
+        }
+        memcpy(out, (const void *)&shm->snapshot, size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&shm->sequence, __ATOMIC_RELAXED) == before) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Map the segment read-only. Returns NULL if it does not exist or was
+ * written with an incompatible layout. Unmap with
+ * munmap(shm, sizeof(origin_telemetry_shm)).
+ */
+static inline origin_telemetry_shm *origin_telemetry_open(const char *name)
+{
+    void *mapping;
+    origin_telemetry_shm *shm;
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    mapping = mmap(NULL, sizeof(origin_telemetry_shm), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+    shm = (origin_telemetry_shm *)mapping;
+    if (shm->magic != ORIGIN_TELEMETRY_MAGIC || shm->version != ORIGIN_TELEMETRY_VERSION) {
+        munmap(mapping, sizeof(origin_telemetry_shm));
+        return NULL;
+    }
+    return shm;
+}
+
+#endif /* ORIGIN_TELEMETRY_POSIX */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ORIGIN_TELEMETRY_SHM_H */